@@ -7,9 +7,12 @@ namespace Library
 {
 	RTTI_DEFINITIONS(FpsComponent)
 
+	const float FpsComponent::CpuFrameTimeSmoothing = 0.05f;
+
 	FpsComponent::FpsComponent(Game& game) :
 		DrawableGameComponent(game),
-		mTextPosition(0.0f, 20.0f), mFrameCount(0), mFrameRate(0)
+		mTextPosition(0.0f, 20.0f), mFrameCount(0), mFrameRate(0), mLastTotalGameTime(0), mCpuFrameMilliseconds(0.0f),
+		mLatencyFrames(0)
 	{
 	}
 
@@ -23,6 +26,13 @@ namespace Library
 		return mFrameCount;
 	}
 
+	void FpsComponent::SetFrameStatistics(chrono::nanoseconds cpuFrameTime, uint32_t latencyFrames)
+	{
+		float milliseconds = chrono::duration<float, milli>(cpuFrameTime).count();
+		mCpuFrameMilliseconds += (milliseconds - mCpuFrameMilliseconds) * CpuFrameTimeSmoothing;
+		mLatencyFrames = latencyFrames;
+	}
+
 	void FpsComponent::Initialize()
 	{
 		mSpriteBatch = make_unique<SpriteBatch>(mGame->Direct3DDeviceContext());
@@ -31,7 +41,7 @@ namespace Library
 
 	void FpsComponent::Update(const GameTime& gameTime)
 	{
-		if ((gameTime.TotalGameTime() - mLastTotalGameTime).count() >= 1000)
+		if (gameTime.TotalGameTime() - mLastTotalGameTime >= chrono::seconds(1))
 		{
 			mLastTotalGameTime = gameTime.TotalGameTime();
 			mFrameRate = mFrameCount;
@@ -46,7 +56,9 @@ namespace Library
 		mSpriteBatch->Begin();
 
 		wostringstream fpsLabel;
-		fpsLabel << setprecision(4) << L"Frame Rate: " << mFrameRate << "    Total Elapsed Time: " << gameTime.TotalGameTimeSeconds().count();
+		fpsLabel << setprecision(4) << L"Frame Rate: " << mFrameRate << "    Total Elapsed Time: " << gameTime.TotalGameTimeSeconds().count() << "\n";
+		fpsLabel << L"CPU Frame Time: " << mCpuFrameMilliseconds << L" ms (" << ((mCpuFrameMilliseconds > 0.0f) ? 1000.0f / mCpuFrameMilliseconds : 0.0f)
+			<< L" frames/s)    Simulation Latency: " << mLatencyFrames << L" frames";
 		mSpriteFont->DrawString(mSpriteBatch.get(), fpsLabel.str().c_str(), mTextPosition);
 
 		mSpriteBatch->End();
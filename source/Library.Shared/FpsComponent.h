@@ -3,6 +3,7 @@
 #include "DrawableGameComponent.h"
 #include <DirectXMath.h>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 
 namespace DirectX
@@ -26,6 +27,8 @@ namespace Library
 
 		DirectX::XMFLOAT2& TextPosition();
 		int FrameRate() const;
+		// CPU time of the last frame, short of waiting to present it, and how many frames the state it drew was behind.
+		void SetFrameStatistics(std::chrono::nanoseconds cpuFrameTime, std::uint32_t latencyFrames);
 
 		virtual void Initialize() override;
 		virtual void Update(const GameTime& gameTime) override;
@@ -38,6 +41,10 @@ namespace Library
 
 		int mFrameCount;
 		int mFrameRate;
-		std::chrono::milliseconds mLastTotalGameTime;
+		std::chrono::nanoseconds mLastTotalGameTime;
+		float mCpuFrameMilliseconds;
+		std::uint32_t mLatencyFrames;
+
+		static const float CpuFrameTimeSmoothing;
 	};
 }
\ No newline at end of file
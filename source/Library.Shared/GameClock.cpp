@@ -36,8 +36,8 @@ namespace Library
 		mCurrentTime = high_resolution_clock::now();
 
 		gameTime.SetCurrentTime(mCurrentTime);
-		gameTime.SetTotalGameTime(duration_cast<milliseconds>(mCurrentTime - mStartTime));
-		gameTime.SetElapsedGameTime(duration_cast<milliseconds>(mCurrentTime - mLastTime));
+		gameTime.SetTotalGameTime(duration_cast<nanoseconds>(mCurrentTime - mStartTime));
+		gameTime.SetElapsedGameTime(duration_cast<nanoseconds>(mCurrentTime - mLastTime));
 		mLastTime = mCurrentTime;
 	}
 }
\ No newline at end of file
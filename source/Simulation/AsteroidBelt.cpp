@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "AsteroidBelt.h"
+#include "BodyStateStore.h"
+#include "KeplerSolver.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t AsteroidBelt::BatchSize = 4;
+	const uint32_t AsteroidBelt::GenerationChunkSize = 4096;
+	const uint32_t AsteroidBelt::EvaluationGrainSize = 4096;
+
+	namespace
+	{
+		const float QuantizedMax = 65535.0f;
+		const float SignedQuantizedMax = 32767.0f;
+
+		inline uint16_t Quantize(float value, float minimum, float maximum)
+		{
+			float fraction = (maximum > minimum) ? (value - minimum) / (maximum - minimum) : 0.0f;
+			return static_cast<uint16_t>(min(max(fraction, 0.0f), 1.0f) * QuantizedMax + 0.5f);
+		}
+
+		inline float Dequantize(uint16_t value, float minimum, float maximum)
+		{
+			return minimum + (maximum - minimum) * (value / QuantizedMax);
+		}
+
+		inline int16_t QuantizeSigned(float value)
+		{
+			return static_cast<int16_t>(floor(min(max(value, -1.0f), 1.0f) * SignedQuantizedMax + 0.5f));
+		}
+	}
+
+	AsteroidBelt::AsteroidBelt() :
+		mShape(), mParent(0), mFrequencyConstant(0)
+	{
+	}
+
+	void AsteroidBelt::Generate(uint32_t parent, const BeltShape& shape)
+	{
+		mParent = parent;
+		mShape = shape;
+		Resize();
+
+		uint32_t chunkCount = (mShape.mCount + GenerationChunkSize - 1) / GenerationChunkSize;
+		for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			GenerateChunk(chunk);
+		}
+	}
+
+	void AsteroidBelt::Generate(uint32_t parent, const BeltShape& shape, ThreadPool& threadPool)
+	{
+		mParent = parent;
+		mShape = shape;
+		Resize();
+
+		auto generateChunks = [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t chunk = begin; chunk < end; ++chunk)
+			{
+				GenerateChunk(chunk);
+			}
+		};
+		uint32_t chunkCount = (mShape.mCount + GenerationChunkSize - 1) / GenerationChunkSize;
+		threadPool.ParallelFor(0, chunkCount, 1, generateChunks);
+	}
+
+	void AsteroidBelt::Restore(uint32_t parent, const BeltShape& shape, const uint8_t* orbitData, uint64_t size)
+	{
+		mParent = parent;
+		mShape = shape;
+		Resize();
+		if (size != OrbitDataSize())
+		{
+			throw runtime_error("Belt orbits do not match its shape");
+		}
+		memcpy(mShape.mQuantized ? static_cast<void*>(mPackedOrbits.data()) : static_cast<void*>(mOrbits.data()), orbitData, static_cast<size_t>(size));
+	}
+
+	void AsteroidBelt::Evaluate(double time)
+	{
+		EvaluateRange(0, static_cast<uint32_t>(mInstances.size()), time);
+	}
+
+	void AsteroidBelt::Evaluate(double time, ThreadPool& threadPool)
+	{
+		assert(EvaluationGrainSize % BatchSize == 0);
+
+		auto evaluateRange = [this, time](uint32_t begin, uint32_t end)
+		{
+			EvaluateRange(begin, end, time);
+		};
+		threadPool.ParallelFor(0, static_cast<uint32_t>(mInstances.size()), EvaluationGrainSize, evaluateRange);
+	}
+
+	uint32_t AsteroidBelt::Parent() const
+	{
+		return mParent;
+	}
+
+	uint32_t AsteroidBelt::Count() const
+	{
+		return mShape.mCount;
+	}
+
+	const BeltShape& AsteroidBelt::Shape() const
+	{
+		return mShape;
+	}
+
+	const vector<XMFLOAT4>& AsteroidBelt::Instances() const
+	{
+		return mInstances;
+	}
+
+	uint32_t AsteroidBelt::BytesPerAsteroid() const
+	{
+		return static_cast<uint32_t>((mShape.mQuantized ? sizeof(PackedOrbit) : sizeof(Orbit)) + sizeof(XMFLOAT4));
+	}
+
+	const uint8_t* AsteroidBelt::OrbitData() const
+	{
+		return mShape.mQuantized ? reinterpret_cast<const uint8_t*>(mPackedOrbits.data()) : reinterpret_cast<const uint8_t*>(mOrbits.data());
+	}
+
+	uint64_t AsteroidBelt::OrbitDataSize() const
+	{
+		return mShape.mQuantized ? mPackedOrbits.size() * sizeof(PackedOrbit) : mOrbits.size() * sizeof(Orbit);
+	}
+
+	void AsteroidBelt::Resize()
+	{
+		if (mShape.mInnerPeriod == 0)
+		{
+			throw runtime_error("Belt period must not be zero");
+		}
+
+		// frequency = (r0 / a)^1.5 / P0, so only a sqrt and a divide per asteroid and frame
+		double innerRadius = mShape.mInnerRadius;
+		mFrequencyConstant = innerRadius * sqrt(innerRadius) / mShape.mInnerPeriod;
+
+		// spare lanes of the last batch sit still at the inner radius with no size
+		uint32_t paddedCount = ((mShape.mCount + BatchSize - 1) / BatchSize) * BatchSize;
+		Orbit padding = { mShape.mInnerRadius, 0.0f, 0.0f, 0.0f, XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f) };
+		if (mShape.mQuantized)
+		{
+			PackedOrbit packedPadding;
+			Pack(padding, packedPadding);
+			mOrbits.clear();
+			mOrbits.shrink_to_fit();
+			mPackedOrbits.assign(paddedCount, packedPadding);
+		}
+		else
+		{
+			mPackedOrbits.clear();
+			mPackedOrbits.shrink_to_fit();
+			mOrbits.assign(paddedCount, padding);
+		}
+		mInstances.assign(paddedCount, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+	}
+
+	void AsteroidBelt::GenerateChunk(uint32_t chunk)
+	{
+		// mt19937 and seed_seq are fully specified, unlike the standard distributions, so the draws are converted by hand
+		seed_seq seeds = { mShape.mSeed, chunk };
+		mt19937 generator(seeds);
+		auto uniform = [&generator]()
+		{
+			return (generator() >> 8) * (1.0f / 16777216.0f);
+		};
+
+		// inverse of the cumulative power law between the minimum and maximum diameters
+		double exponent = mShape.mSizeExponent;
+		double minimumTerm = (exponent != 0) ? pow(static_cast<double>(mShape.mMinDiameter), -exponent) : 0.0;
+		double maximumTerm = (exponent != 0) ? pow(static_cast<double>(mShape.mMaxDiameter), -exponent) : 0.0;
+
+		uint32_t begin = chunk * GenerationChunkSize;
+		uint32_t end = min(mShape.mCount, begin + GenerationChunkSize);
+		for (uint32_t index = begin; index < end; ++index)
+		{
+			Orbit orbit;
+			orbit.mSemiMajorAxis = mShape.mInnerRadius + (mShape.mOuterRadius - mShape.mInnerRadius) * uniform();
+			orbit.mEccentricity = mShape.mMaxEccentricity * uniform();
+			orbit.mMeanAnomaly = uniform();
+
+			float size = uniform();
+			orbit.mDiameter = (exponent != 0) ? static_cast<float>(pow(minimumTerm - size * (minimumTerm - maximumTerm), -1.0 / exponent)) :
+				(mShape.mMinDiameter + (mShape.mMaxDiameter - mShape.mMinDiameter) * size);
+
+			OrbitalElements elements = {};
+			elements.mInclination = mShape.mMaxInclination * uniform();
+			elements.mLongitudeOfAscendingNode = XM_2PI * uniform();
+			elements.mArgumentOfPeriapsis = XM_2PI * uniform();
+			BodyStateStore::PerifocalAxes(elements, orbit.mPeriapsisAxis, orbit.mSemiLatusAxis);
+
+			if (mShape.mQuantized)
+			{
+				Pack(orbit, mPackedOrbits[index]);
+			}
+			else
+			{
+				mOrbits[index] = orbit;
+			}
+		}
+	}
+
+	void AsteroidBelt::EvaluateRange(uint32_t begin, uint32_t end, double time)
+	{
+		assert(begin % BatchSize == 0);
+
+		XMFLOAT4 semiMajorAxes;
+		XMFLOAT4 eccentricities;
+		XMFLOAT4 meanAnomalies;
+		XMFLOAT4 diameters;
+		XMFLOAT4 periapsisX, periapsisY, periapsisZ;
+		XMFLOAT4 semiLatusX, semiLatusY, semiLatusZ;
+		for (uint32_t index = begin; index < end; index += BatchSize)
+		{
+			for (uint32_t lane = 0; lane < BatchSize; ++lane)
+			{
+				Orbit orbit;
+				Unpack(index + lane, orbit);
+
+				// whole turns are dropped in double precision, as for the bodies
+				double semiMajorAxis = orbit.mSemiMajorAxis;
+				double turns = orbit.mMeanAnomaly + mFrequencyConstant / (semiMajorAxis * sqrt(semiMajorAxis)) * time;
+				turns -= floor(turns + 0.5);
+
+				(&semiMajorAxes.x)[lane] = orbit.mSemiMajorAxis;
+				(&eccentricities.x)[lane] = orbit.mEccentricity;
+				(&meanAnomalies.x)[lane] = static_cast<float>(turns * XM_2PI);
+				(&diameters.x)[lane] = orbit.mDiameter;
+				(&periapsisX.x)[lane] = orbit.mPeriapsisAxis.x;
+				(&periapsisY.x)[lane] = orbit.mPeriapsisAxis.y;
+				(&periapsisZ.x)[lane] = orbit.mPeriapsisAxis.z;
+				(&semiLatusX.x)[lane] = orbit.mSemiLatusAxis.x;
+				(&semiLatusY.x)[lane] = orbit.mSemiLatusAxis.y;
+				(&semiLatusZ.x)[lane] = orbit.mSemiLatusAxis.z;
+			}
+
+			XMVECTOR semiMajorAxis = XMLoadFloat4(&semiMajorAxes);
+			XMVECTOR eccentricity = XMLoadFloat4(&eccentricities);
+			XMVECTOR sinEccentricAnomaly;
+			XMVECTOR cosEccentricAnomaly;
+			XMVectorSinCos(&sinEccentricAnomaly, &cosEccentricAnomaly, KeplerSolver::SolveEccentricAnomaly(XMLoadFloat4(&meanAnomalies), eccentricity));
+
+			XMVECTOR minorAxisRatio = XMVectorSqrt(XMVectorNegativeMultiplySubtract(eccentricity, eccentricity, XMVectorSplatOne()));
+			XMVECTOR periapsisDistance = XMVectorMultiply(semiMajorAxis, XMVectorSubtract(cosEccentricAnomaly, eccentricity));
+			XMVECTOR semiLatusDistance = XMVectorMultiply(XMVectorMultiply(semiMajorAxis, minorAxisRatio), sinEccentricAnomaly);
+
+			XMVECTOR x = XMVectorMultiplyAdd(periapsisDistance, XMLoadFloat4(&periapsisX), XMVectorMultiply(semiLatusDistance, XMLoadFloat4(&semiLatusX)));
+			XMVECTOR y = XMVectorMultiplyAdd(periapsisDistance, XMLoadFloat4(&periapsisY), XMVectorMultiply(semiLatusDistance, XMLoadFloat4(&semiLatusY)));
+			XMVECTOR z = XMVectorMultiplyAdd(periapsisDistance, XMLoadFloat4(&periapsisZ), XMVectorMultiply(semiLatusDistance, XMLoadFloat4(&semiLatusZ)));
+
+			XMMATRIX instances = XMMatrixTranspose(XMMATRIX(x, y, z, XMLoadFloat4(&diameters)));
+			for (uint32_t lane = 0; lane < BatchSize; ++lane)
+			{
+				XMStoreFloat4(&mInstances[index + lane], instances.r[lane]);
+			}
+		}
+	}
+
+	void AsteroidBelt::Pack(const Orbit& orbit, PackedOrbit& packed) const
+	{
+		packed.mSemiMajorAxis = Quantize(orbit.mSemiMajorAxis, mShape.mInnerRadius, mShape.mOuterRadius);
+		packed.mEccentricity = Quantize(orbit.mEccentricity, 0.0f, mShape.mMaxEccentricity);
+		packed.mMeanAnomaly = static_cast<uint16_t>(static_cast<uint32_t>(orbit.mMeanAnomaly * (QuantizedMax + 1.0f)) & 0xFFFF);
+		packed.mDiameter = Quantize(orbit.mDiameter, mShape.mMinDiameter, mShape.mMaxDiameter);
+		packed.mPeriapsisAxis[0] = QuantizeSigned(orbit.mPeriapsisAxis.x);
+		packed.mPeriapsisAxis[1] = QuantizeSigned(orbit.mPeriapsisAxis.y);
+		packed.mPeriapsisAxis[2] = QuantizeSigned(orbit.mPeriapsisAxis.z);
+		packed.mSemiLatusAxis[0] = QuantizeSigned(orbit.mSemiLatusAxis.x);
+		packed.mSemiLatusAxis[1] = QuantizeSigned(orbit.mSemiLatusAxis.y);
+		packed.mSemiLatusAxis[2] = QuantizeSigned(orbit.mSemiLatusAxis.z);
+	}
+
+	void AsteroidBelt::Unpack(uint32_t index, Orbit& orbit) const
+	{
+		if (!mShape.mQuantized)
+		{
+			orbit = mOrbits[index];
+			return;
+		}
+
+		// padding diameters of zero fall below the range and come back as the minimum; the instance keeps them at zero
+		const PackedOrbit& packed = mPackedOrbits[index];
+		orbit.mSemiMajorAxis = Dequantize(packed.mSemiMajorAxis, mShape.mInnerRadius, mShape.mOuterRadius);
+		orbit.mEccentricity = Dequantize(packed.mEccentricity, 0.0f, mShape.mMaxEccentricity);
+		orbit.mMeanAnomaly = packed.mMeanAnomaly / (QuantizedMax + 1.0f);
+		orbit.mDiameter = (index < mShape.mCount) ? Dequantize(packed.mDiameter, mShape.mMinDiameter, mShape.mMaxDiameter) : 0.0f;
+		orbit.mPeriapsisAxis = XMFLOAT3(packed.mPeriapsisAxis[0] / SignedQuantizedMax, packed.mPeriapsisAxis[1] / SignedQuantizedMax,
+			packed.mPeriapsisAxis[2] / SignedQuantizedMax);
+		orbit.mSemiLatusAxis = XMFLOAT3(packed.mSemiLatusAxis[0] / SignedQuantizedMax, packed.mSemiLatusAxis[1] / SignedQuantizedMax,
+			packed.mSemiLatusAxis[2] / SignedQuantizedMax);
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+namespace Simulation
+{
+	class ThreadPool;
+
+	// A belt in world units, resolved from a BeltData section by BodySystem. Angles are in radians and the period is
+	// that of an orbit at the inner radius.
+	struct BeltShape
+	{
+		float mInnerRadius;
+		float mOuterRadius;
+		double mInnerPeriod;
+		float mMinDiameter;
+		float mMaxDiameter;
+		float mSizeExponent;
+		float mMaxEccentricity;
+		float mMaxInclination;
+		std::uint32_t mCount;
+		std::uint32_t mSeed;
+		bool mQuantized;
+	};
+
+	// Procedurally generated swarm of massless bodies on fixed Kepler orbits about a parent, stored as bare orbital
+	// parameters rather than as bodies. Semi-major axes are uniform between the radii, eccentricities and inclinations
+	// uniform up to their maxima, the remaining angles uniform, and diameters follow a cumulative power law
+	// N(> D) ~ D^-SizeExponent. Periods follow Kepler's third law from the one at the inner radius.
+	//
+	// Generation runs in chunks of GenerationChunkSize asteroids, each drawing from its own generator seeded with the
+	// seed and the chunk index, so a belt comes out the same for a given seed however many threads build it. Quantized
+	// belts keep every parameter in 16 bits (20 bytes per asteroid instead of 40); Evaluate adds a 16 byte instance, the
+	// position relative to the parent with the diameter in w, which a renderer can draw as one instanced batch.
+	class AsteroidBelt final
+	{
+	public:
+		AsteroidBelt();
+		AsteroidBelt(const AsteroidBelt&) = delete;
+		AsteroidBelt& operator=(const AsteroidBelt&) = delete;
+		AsteroidBelt(AsteroidBelt&&) = default;
+		AsteroidBelt& operator=(AsteroidBelt&&) = default;
+		~AsteroidBelt() = default;
+
+		void Generate(std::uint32_t parent, const BeltShape& shape);
+		void Generate(std::uint32_t parent, const BeltShape& shape, ThreadPool& threadPool);
+		// Takes back the OrbitData() of a belt of the same shape, as saved in a checkpoint, instead of generating it.
+		void Restore(std::uint32_t parent, const BeltShape& shape, const std::uint8_t* orbitData, std::uint64_t size);
+
+		void Evaluate(double time);
+		void Evaluate(double time, ThreadPool& threadPool);
+
+		std::uint32_t Parent() const;
+		std::uint32_t Count() const;
+		const BeltShape& Shape() const;
+		// One instance per asteroid, padded to a whole number of batches.
+		const std::vector<DirectX::XMFLOAT4>& Instances() const;
+		// Stored orbit plus instance.
+		std::uint32_t BytesPerAsteroid() const;
+		// The stored orbits as raw bytes, the padding of the last batch included.
+		const std::uint8_t* OrbitData() const;
+		std::uint64_t OrbitDataSize() const;
+
+		static const std::uint32_t BatchSize;
+		static const std::uint32_t GenerationChunkSize;
+		static const std::uint32_t EvaluationGrainSize;
+
+	private:
+		// mMeanAnomaly is the phase at time zero in turns
+		struct Orbit
+		{
+			float mSemiMajorAxis;
+			float mEccentricity;
+			float mMeanAnomaly;
+			float mDiameter;
+			DirectX::XMFLOAT3 mPeriapsisAxis;
+			DirectX::XMFLOAT3 mSemiLatusAxis;
+		};
+
+		// Scalars are fractions of their range in [0, 65535], axes signed normalized.
+		struct PackedOrbit
+		{
+			std::uint16_t mSemiMajorAxis;
+			std::uint16_t mEccentricity;
+			std::uint16_t mMeanAnomaly;
+			std::uint16_t mDiameter;
+			std::int16_t mPeriapsisAxis[3];
+			std::int16_t mSemiLatusAxis[3];
+		};
+
+		void Resize();
+		void GenerateChunk(std::uint32_t chunk);
+		void EvaluateRange(std::uint32_t begin, std::uint32_t end, double time);
+		void Pack(const Orbit& orbit, PackedOrbit& packed) const;
+		void Unpack(std::uint32_t index, Orbit& orbit) const;
+
+		BeltShape mShape;
+		std::uint32_t mParent;
+		double mFrequencyConstant;
+		std::vector<Orbit> mOrbits;
+		std::vector<PackedOrbit> mPackedOrbits;
+		std::vector<DirectX::XMFLOAT4> mInstances;
+	};
+}
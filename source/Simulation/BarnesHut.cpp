@@ -0,0 +1,595 @@
+#include "pch.h"
+#include "BarnesHut.h"
+#include "NBodyState.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const float BarnesHut::DefaultOpeningAngle = 0.5f;
+	const uint32_t BarnesHut::LeafSize = 16;
+	const uint32_t BarnesHut::MortonBitsPerAxis = 21;
+	const uint32_t BarnesHut::RadixBits = 8;
+	const uint32_t BarnesHut::ChunksPerThread = 4;
+	const uint32_t BarnesHut::TraversalGrainSize = 64;
+
+	namespace
+	{
+		// Spreads the low 21 bits of a value so that bit i lands on bit 3i.
+		uint64_t SpreadBits(uint64_t value)
+		{
+			value &= 0x1FFFFF;
+			value = (value | (value << 32)) & 0x1F00000000FFFF;
+			value = (value | (value << 16)) & 0x1F0000FF0000FF;
+			value = (value | (value << 8)) & 0x100F00F00F00F00F;
+			value = (value | (value << 4)) & 0x10C30C30C30C30C3;
+			value = (value | (value << 2)) & 0x1249249249249249;
+			return value;
+		}
+	}
+
+	BarnesHut::BarnesHut() :
+		mOpeningAngle(DefaultOpeningAngle), mChunkSize(0), mSubtreeSize(0), mNodeCount(0)
+	{
+	}
+
+	template <typename Body>
+	void BarnesHut::ForEachChunk(uint32_t begin, uint32_t end, uint32_t grainSize, Body& body)
+	{
+		if (mThreadPool != nullptr)
+		{
+			mThreadPool->ParallelFor(begin, end, grainSize, body);
+			return;
+		}
+
+		for (uint32_t chunkBegin = begin; chunkBegin < end; chunkBegin += grainSize)
+		{
+			body(chunkBegin, min(end, chunkBegin + grainSize));
+		}
+	}
+
+	float BarnesHut::OpeningAngle() const
+	{
+		return mOpeningAngle;
+	}
+
+	void BarnesHut::SetOpeningAngle(float openingAngle)
+	{
+		if (openingAngle < 0.0f)
+		{
+			throw runtime_error("Opening angle must be non-negative");
+		}
+		mOpeningAngle = openingAngle;
+	}
+
+	uint32_t BarnesHut::NodeCount() const
+	{
+		return mNodeCount;
+	}
+
+	void BarnesHut::ComputeAccelerations(NBodyState& state)
+	{
+		if (!BuildTree(state))
+		{
+			return;
+		}
+
+		atomic<uint64_t> interactions(0);
+		auto computeRows = [this, &state, &interactions](uint32_t begin, uint32_t end)
+		{
+			interactions += ComputeRows(state, nullptr, begin, end);
+		};
+		ForEachChunk(0, static_cast<uint32_t>(mSortedX.size()), TraversalGrainSize, computeRows);
+		mInteractions += interactions;
+	}
+
+	void BarnesHut::ComputeAccelerations(NBodyState& state, const vector<uint32_t>& targets)
+	{
+		if (targets.empty() || !BuildTree(state))
+		{
+			return;
+		}
+
+		// the whole tree is rebuilt, as every body is a source; only batches holding a target are walked
+		mActive.assign(state.Count(), 0);
+		for (uint32_t target : targets)
+		{
+			mActive[target] = 1;
+		}
+
+		atomic<uint64_t> interactions(0);
+		auto computeRows = [this, &state, &interactions](uint32_t begin, uint32_t end)
+		{
+			interactions += ComputeRows(state, mActive.data(), begin, end);
+		};
+		ForEachChunk(0, static_cast<uint32_t>(mSortedX.size()), TraversalGrainSize, computeRows);
+		mInteractions += interactions;
+	}
+
+	bool BarnesHut::BuildTree(const NBodyState& state)
+	{
+		assert(TraversalGrainSize % NBodyState::BatchSize == 0);
+
+		uint32_t bodyCount = state.Count();
+		mNodeCount = 0;
+		if (bodyCount == 0)
+		{
+			return false;
+		}
+
+		// a few chunks per thread balance the sort and gather passes; without a pool everything is one chunk
+		uint32_t chunkCount = (mThreadPool != nullptr) ? mThreadPool->ThreadCount() * ChunksPerThread : 1;
+		mChunkSize = (bodyCount + chunkCount - 1) / chunkCount;
+		mChunkSize = ((mChunkSize + NBodyState::BatchSize - 1) / NBodyState::BatchSize) * NBodyState::BatchSize;
+		mSubtreeSize = (mThreadPool != nullptr) ? max(mChunkSize / ChunksPerThread, LeafSize) : bodyCount;
+
+		ComputeKeys(state);
+		SortKeys();
+		GatherBodies(state);
+		BuildNodes();
+		return true;
+	}
+
+	void BarnesHut::ComputeKeys(const NBodyState& state)
+	{
+		uint32_t bodyCount = state.Count();
+		uint32_t chunkCount = (bodyCount + mChunkSize - 1) / mChunkSize;
+		const float* positions[3] = { state.PositionX(), state.PositionY(), state.PositionZ() };
+
+		// per chunk bounds, then reduced serially
+		mBounds.resize(chunkCount * 6);
+		auto computeBounds = [this, &positions](uint32_t begin, uint32_t end)
+		{
+			float* bounds = &mBounds[(begin / mChunkSize) * 6];
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				const float* position = positions[axis];
+				float minimum = position[begin];
+				float maximum = position[begin];
+				for (uint32_t index = begin + 1; index < end; ++index)
+				{
+					minimum = min(minimum, position[index]);
+					maximum = max(maximum, position[index]);
+				}
+				bounds[axis] = minimum;
+				bounds[axis + 3] = maximum;
+			}
+		};
+		ForEachChunk(0, bodyCount, mChunkSize, computeBounds);
+
+		float origin[3] = { mBounds[0], mBounds[1], mBounds[2] };
+		float extent = 0.0f;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			float maximum = mBounds[axis + 3];
+			for (uint32_t chunk = 1; chunk < chunkCount; ++chunk)
+			{
+				origin[axis] = min(origin[axis], mBounds[chunk * 6 + axis]);
+				maximum = max(maximum, mBounds[chunk * 6 + axis + 3]);
+			}
+			extent = max(extent, maximum - origin[axis]);
+		}
+
+		// a cube so that every octree cell is a cube too
+		const uint32_t cellsPerAxis = 1U << MortonBitsPerAxis;
+		float scale = (extent > 0.0f) ? (cellsPerAxis / (extent * 1.0001f)) : 0.0f;
+		mKeys.resize(bodyCount);
+		mOrder.resize(bodyCount);
+		auto computeKeys = [this, &positions, &origin, scale, cellsPerAxis](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t index = begin; index < end; ++index)
+			{
+				uint64_t key = 0;
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					uint32_t cell = min(static_cast<uint32_t>((positions[axis][index] - origin[axis]) * scale), cellsPerAxis - 1);
+					key |= SpreadBits(cell) << (2 - axis);
+				}
+				mKeys[index] = key;
+				mOrder[index] = index;
+			}
+		};
+		ForEachChunk(0, bodyCount, mChunkSize, computeKeys);
+	}
+
+	void BarnesHut::SortKeys()
+	{
+		// least significant digit radix sort; each chunk histograms its digits, and after an exclusive scan over
+		// (digit, chunk) scatters them in order, which keeps every pass stable
+		const uint32_t bucketCount = 1U << RadixBits;
+		uint32_t bodyCount = static_cast<uint32_t>(mKeys.size());
+		uint32_t chunkCount = (bodyCount + mChunkSize - 1) / mChunkSize;
+		mScratchKeys.resize(bodyCount);
+		mScratchOrder.resize(bodyCount);
+		mHistograms.resize(chunkCount * bucketCount);
+
+		for (uint32_t shift = 0; shift < 3 * MortonBitsPerAxis; shift += RadixBits)
+		{
+			auto countDigits = [this, shift, bucketCount](uint32_t begin, uint32_t end)
+			{
+				uint32_t* histogram = &mHistograms[(begin / mChunkSize) * bucketCount];
+				fill(histogram, histogram + bucketCount, 0);
+				for (uint32_t index = begin; index < end; ++index)
+				{
+					++histogram[(mKeys[index] >> shift) & (bucketCount - 1)];
+				}
+			};
+			ForEachChunk(0, bodyCount, mChunkSize, countDigits);
+
+			uint32_t offset = 0;
+			bool isSorted = false;
+			for (uint32_t digit = 0; digit < bucketCount && !isSorted; ++digit)
+			{
+				uint32_t digitBegin = offset;
+				for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+				{
+					uint32_t count = mHistograms[chunk * bucketCount + digit];
+					mHistograms[chunk * bucketCount + digit] = offset;
+					offset += count;
+				}
+
+				// every key shares this digit, which is common for the high digits of a clustered population
+				isSorted = (offset - digitBegin == bodyCount);
+			}
+
+			if (isSorted)
+			{
+				continue;
+			}
+
+			auto scatter = [this, shift, bucketCount](uint32_t begin, uint32_t end)
+			{
+				uint32_t* offsets = &mHistograms[(begin / mChunkSize) * bucketCount];
+				for (uint32_t index = begin; index < end; ++index)
+				{
+					uint32_t destination = offsets[(mKeys[index] >> shift) & (bucketCount - 1)]++;
+					mScratchKeys[destination] = mKeys[index];
+					mScratchOrder[destination] = mOrder[index];
+				}
+			};
+			ForEachChunk(0, bodyCount, mChunkSize, scatter);
+
+			mKeys.swap(mScratchKeys);
+			mOrder.swap(mScratchOrder);
+		}
+	}
+
+	void BarnesHut::GatherBodies(const NBodyState& state)
+	{
+		uint32_t bodyCount = state.Count();
+		uint32_t paddedCount = ((bodyCount + NBodyState::BatchSize - 1) / NBodyState::BatchSize) * NBodyState::BatchSize;
+		mSortedX.resize(paddedCount);
+		mSortedY.resize(paddedCount);
+		mSortedZ.resize(paddedCount);
+		mSortedGravitationalParameters.resize(paddedCount);
+
+		const float* positionX = state.PositionX();
+		const float* positionY = state.PositionY();
+		const float* positionZ = state.PositionZ();
+		const float* gravitationalParameters = state.GravitationalParameters();
+		auto gather = [this, positionX, positionY, positionZ, gravitationalParameters](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t index = begin; index < end; ++index)
+			{
+				uint32_t body = mOrder[index];
+				mSortedX[index] = positionX[body];
+				mSortedY[index] = positionY[body];
+				mSortedZ[index] = positionZ[body];
+				mSortedGravitationalParameters[index] = gravitationalParameters[body];
+			}
+		};
+		ForEachChunk(0, bodyCount, mChunkSize, gather);
+
+		// padding lanes of the last batch sit on the last body, massless, so they do not widen any node
+		for (uint32_t index = bodyCount; index < paddedCount; ++index)
+		{
+			mSortedX[index] = mSortedX[bodyCount - 1];
+			mSortedY[index] = mSortedY[bodyCount - 1];
+			mSortedZ[index] = mSortedZ[bodyCount - 1];
+			mSortedGravitationalParameters[index] = 0.0f;
+		}
+	}
+
+	void BarnesHut::BuildNodes()
+	{
+		uint32_t bodyCount = static_cast<uint32_t>(mKeys.size());
+
+		// every interior node has at least two children, so there are fewer interior nodes than leaves
+		if (mNodes.size() < 2 * bodyCount)
+		{
+			mNodes.resize(2 * bodyCount);
+		}
+
+		mSubtrees.clear();
+		mPendingNodes.clear();
+		mNodeCount = 1;
+		if (bodyCount <= mSubtreeSize)
+		{
+			BuildNode(0, 0, bodyCount, false);
+			return;
+		}
+
+		BuildNode(0, 0, bodyCount, true);
+
+		auto buildSubtrees = [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t index = begin; index < end; ++index)
+			{
+				const Subtree& subtree = mSubtrees[index];
+				BuildNode(subtree.mNode, subtree.mFirstBody, subtree.mBodyCount, false);
+			}
+		};
+		ForEachChunk(0, static_cast<uint32_t>(mSubtrees.size()), 1, buildSubtrees);
+
+		// the top of the tree was recorded children first
+		for (uint32_t node : mPendingNodes)
+		{
+			SummarizeNode(node);
+		}
+	}
+
+	void BarnesHut::BuildNode(uint32_t node, uint32_t firstBody, uint32_t bodyCount, bool deferSubtrees)
+	{
+		Node& current = mNodes[node];
+		current.mFirstBody = firstBody;
+		current.mBodyCount = bodyCount;
+		current.mFirstChild = 0;
+		current.mChildCount = 0;
+
+		uint64_t firstKey = mKeys[firstBody];
+		uint64_t lastKey = mKeys[firstBody + bodyCount - 1];
+		if (bodyCount <= LeafSize || firstKey == lastKey)
+		{
+			SummarizeNode(node);
+			return;
+		}
+
+		// split on the highest octant digit the range does not share; the levels above it hold a single octant
+		uint32_t shift = 3 * (MortonBitsPerAxis - 1);
+		while (((firstKey ^ lastKey) >> shift) == 0)
+		{
+			shift -= 3;
+		}
+
+		uint32_t childFirstBodies[8];
+		uint32_t childBodyCounts[8];
+		uint32_t childCount = 0;
+		const uint64_t* keys = mKeys.data();
+		for (uint32_t body = firstBody, end = firstBody + bodyCount; body < end; ++childCount)
+		{
+			uint64_t octant = (keys[body] >> shift) & 7;
+			const uint64_t* next = partition_point(keys + body, keys + end, [shift, octant](uint64_t key)
+			{
+				return ((key >> shift) & 7) == octant;
+			});
+			childFirstBodies[childCount] = body;
+			childBodyCounts[childCount] = static_cast<uint32_t>(next - keys) - body;
+			body += childBodyCounts[childCount];
+		}
+
+		uint32_t firstChild = mNodeCount.fetch_add(childCount);
+		current.mFirstChild = firstChild;
+		current.mChildCount = childCount;
+		for (uint32_t child = 0; child < childCount; ++child)
+		{
+			if (deferSubtrees && childBodyCounts[child] <= mSubtreeSize)
+			{
+				mSubtrees.push_back({ firstChild + child, childFirstBodies[child], childBodyCounts[child] });
+			}
+			else
+			{
+				BuildNode(firstChild + child, childFirstBodies[child], childBodyCounts[child], deferSubtrees);
+			}
+		}
+
+		if (deferSubtrees)
+		{
+			mPendingNodes.push_back(node);
+		}
+		else
+		{
+			SummarizeNode(node);
+		}
+	}
+
+	void BarnesHut::SummarizeNode(uint32_t node)
+	{
+		Node& current = mNodes[node];
+		double gravitationalParameter = 0;
+		double weighted[3] = { 0, 0, 0 };
+		float minimum[3];
+		float maximum[3];
+
+		if (current.mChildCount == 0)
+		{
+			const float* positions[3] = { mSortedX.data(), mSortedY.data(), mSortedZ.data() };
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = maximum[axis] = positions[axis][current.mFirstBody];
+			}
+
+			for (uint32_t body = current.mFirstBody, end = current.mFirstBody + current.mBodyCount; body < end; ++body)
+			{
+				double parameter = mSortedGravitationalParameters[body];
+				gravitationalParameter += parameter;
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					float position = positions[axis][body];
+					weighted[axis] += parameter * position;
+					minimum[axis] = min(minimum[axis], position);
+					maximum[axis] = max(maximum[axis], position);
+				}
+			}
+		}
+		else
+		{
+			const Node& first = mNodes[current.mFirstChild];
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = first.mMin[axis];
+				maximum[axis] = first.mMax[axis];
+			}
+
+			for (uint32_t child = current.mFirstChild, end = current.mFirstChild + current.mChildCount; child < end; ++child)
+			{
+				const Node& childNode = mNodes[child];
+				double parameter = childNode.mGravitationalParameter;
+				gravitationalParameter += parameter;
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					weighted[axis] += parameter * childNode.mCenterOfMass[axis];
+					minimum[axis] = min(minimum[axis], childNode.mMin[axis]);
+					maximum[axis] = max(maximum[axis], childNode.mMax[axis]);
+				}
+			}
+		}
+
+		float size = 0.0f;
+		float offsetSquared = 0.0f;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			float center = 0.5f * (minimum[axis] + maximum[axis]);
+			current.mCenterOfMass[axis] = (gravitationalParameter > 0) ? static_cast<float>(weighted[axis] / gravitationalParameter) : center;
+			current.mMin[axis] = minimum[axis];
+			current.mMax[axis] = maximum[axis];
+
+			float offset = current.mCenterOfMass[axis] - center;
+			offsetSquared += offset * offset;
+			size = max(size, maximum[axis] - minimum[axis]);
+		}
+		current.mGravitationalParameter = static_cast<float>(gravitationalParameter);
+
+		if (mOpeningAngle > 0.0f)
+		{
+			float openingRadius = size / mOpeningAngle + sqrt(offsetSquared);
+			current.mOpeningRadiusSquared = openingRadius * openingRadius;
+		}
+		else
+		{
+			current.mOpeningRadiusSquared = numeric_limits<float>::infinity();
+		}
+	}
+
+	uint64_t BarnesHut::ComputeRows(NBodyState& state, const uint8_t* active, uint32_t begin, uint32_t end) const
+	{
+		static const uint32_t StackSize = 8 * (MortonBitsPerAxis + 1);
+
+		uint32_t bodyCount = state.Count();
+		float* accelerationX = state.AccelerationX();
+		float* accelerationY = state.AccelerationY();
+		float* accelerationZ = state.AccelerationZ();
+		XMVECTOR zero = XMVectorZero();
+		XMVECTOR softeningSquared = XMVectorReplicate(mSoftening * mSoftening);
+		uint64_t interactions = 0;
+
+		uint32_t stack[StackSize];
+		for (uint32_t index = begin; index < end; index += NBodyState::BatchSize)
+		{
+			// lanes of bodies that were not asked for are neither counted nor written back
+			uint32_t laneCount = min(bodyCount - index, NBodyState::BatchSize);
+			uint32_t activeLanes = laneCount;
+			if (active != nullptr)
+			{
+				activeLanes = 0;
+				for (uint32_t lane = 0; lane < laneCount; ++lane)
+				{
+					activeLanes += active[mOrder[index + lane]];
+				}
+				if (activeLanes == 0)
+				{
+					continue;
+				}
+			}
+
+			XMVECTOR targetX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mSortedX[index]));
+			XMVECTOR targetY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mSortedY[index]));
+			XMVECTOR targetZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mSortedZ[index]));
+			XMVECTOR sumX = zero;
+			XMVECTOR sumY = zero;
+			XMVECTOR sumZ = zero;
+
+			uint32_t stackSize = 0;
+			stack[stackSize++] = 0;
+			while (stackSize > 0)
+			{
+				const Node& node = mNodes[stack[--stackSize]];
+				XMVECTOR deltaX = XMVectorSubtract(XMVectorReplicatePtr(&node.mCenterOfMass[0]), targetX);
+				XMVECTOR deltaY = XMVectorSubtract(XMVectorReplicatePtr(&node.mCenterOfMass[1]), targetY);
+				XMVECTOR deltaZ = XMVectorSubtract(XMVectorReplicatePtr(&node.mCenterOfMass[2]), targetZ);
+				XMVECTOR distanceSquared = XMVectorMultiply(deltaX, deltaX);
+				distanceSquared = XMVectorMultiplyAdd(deltaY, deltaY, distanceSquared);
+				distanceSquared = XMVectorMultiplyAdd(deltaZ, deltaZ, distanceSquared);
+
+				if (XMVector4Greater(distanceSquared, XMVectorReplicatePtr(&node.mOpeningRadiusSquared)))
+				{
+					// far enough from every target of the batch for the monopole
+					XMVECTOR inverseDistance = XMVectorReciprocalSqrt(XMVectorAdd(distanceSquared, softeningSquared));
+					XMVECTOR inverseDistanceCubed = XMVectorMultiply(XMVectorMultiply(inverseDistance, inverseDistance), inverseDistance);
+					XMVECTOR strength = XMVectorMultiply(XMVectorReplicatePtr(&node.mGravitationalParameter), inverseDistanceCubed);
+					sumX = XMVectorMultiplyAdd(strength, deltaX, sumX);
+					sumY = XMVectorMultiplyAdd(strength, deltaY, sumY);
+					sumZ = XMVectorMultiplyAdd(strength, deltaZ, sumZ);
+					interactions += activeLanes;
+				}
+				else if (node.mChildCount == 0)
+				{
+					for (uint32_t source = node.mFirstBody, sourceEnd = node.mFirstBody + node.mBodyCount; source < sourceEnd; ++source)
+					{
+						XMVECTOR sourceX = XMVectorSubtract(XMVectorReplicatePtr(&mSortedX[source]), targetX);
+						XMVECTOR sourceY = XMVectorSubtract(XMVectorReplicatePtr(&mSortedY[source]), targetY);
+						XMVECTOR sourceZ = XMVectorSubtract(XMVectorReplicatePtr(&mSortedZ[source]), targetZ);
+
+						XMVECTOR sourceDistanceSquared = XMVectorMultiplyAdd(sourceX, sourceX, softeningSquared);
+						sourceDistanceSquared = XMVectorMultiplyAdd(sourceY, sourceY, sourceDistanceSquared);
+						sourceDistanceSquared = XMVectorMultiplyAdd(sourceZ, sourceZ, sourceDistanceSquared);
+
+						// a body's own lane (r = 0 when unsoftened) is masked out
+						XMVECTOR inverseDistance = XMVectorReciprocalSqrt(sourceDistanceSquared);
+						XMVECTOR inverseDistanceCubed = XMVectorMultiply(XMVectorMultiply(inverseDistance, inverseDistance), inverseDistance);
+						XMVECTOR strength = XMVectorMultiply(XMVectorReplicatePtr(&mSortedGravitationalParameters[source]), inverseDistanceCubed);
+						strength = XMVectorSelect(strength, zero, XMVectorLessOrEqual(sourceDistanceSquared, zero));
+
+						sumX = XMVectorMultiplyAdd(strength, sourceX, sumX);
+						sumY = XMVectorMultiplyAdd(strength, sourceY, sumY);
+						sumZ = XMVectorMultiplyAdd(strength, sourceZ, sumZ);
+					}
+					interactions += static_cast<uint64_t>(node.mBodyCount) * activeLanes;
+				}
+				else
+				{
+					// pushed in reverse so children are visited in Morton order
+					assert(stackSize + node.mChildCount <= StackSize);
+					for (uint32_t child = node.mChildCount; child > 0; --child)
+					{
+						stack[stackSize++] = node.mFirstChild + child - 1;
+					}
+				}
+			}
+
+			XMFLOAT4 batchX;
+			XMFLOAT4 batchY;
+			XMFLOAT4 batchZ;
+			XMStoreFloat4(&batchX, sumX);
+			XMStoreFloat4(&batchY, sumY);
+			XMStoreFloat4(&batchZ, sumZ);
+			const float* laneX = &batchX.x;
+			const float* laneY = &batchY.x;
+			const float* laneZ = &batchZ.x;
+			for (uint32_t lane = 0; lane < laneCount; ++lane)
+			{
+				uint32_t body = mOrder[index + lane];
+				if (active != nullptr && active[body] == 0)
+				{
+					continue;
+				}
+				accelerationX[body] = laneX[lane];
+				accelerationY[body] = laneY[lane];
+				accelerationZ[body] = laneZ[lane];
+			}
+		}
+
+		return interactions;
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include "GravitySolver.h"
+
+namespace Simulation
+{
+	// Approximate O(N log N) gravity after Barnes and Hut. Every call rebuilds an octree over the current positions:
+	// bodies are sorted along a 63 bit Morton curve by a parallel radix sort, so every octree cell is a contiguous range
+	// of the sorted order and the tree is cut out of it top down into a node pool sized once for the population. Cells
+	// with a single occupied octant are collapsed into their child, so every interior node splits and the pool needs
+	// fewer than 2N nodes. The large top of the tree is cut serially and the subtrees below it in parallel.
+	//
+	// Nodes carry their monopole (total GM and centre of mass). Targets are walked BatchSize at a time in Morton order, so
+	// the bodies of a batch are neighbours and share one traversal: a node is accepted for the whole batch when each
+	// target lies farther than size / theta + offset from its centre of mass, where size is the longest side of the node's
+	// bounding box and offset the distance from the centre of mass to the box centre (Barnes' bmax criterion). Otherwise
+	// it is opened, and leaves are summed exactly as in DirectSummation. When only some bodies are asked for, the tree is
+	// still built over all of them and batches without one of those targets are skipped.
+	class BarnesHut final : public GravitySolver
+	{
+	public:
+		BarnesHut();
+		BarnesHut(const BarnesHut&) = delete;
+		BarnesHut& operator=(const BarnesHut&) = delete;
+		BarnesHut(BarnesHut&&) = delete;
+		BarnesHut& operator=(BarnesHut&&) = delete;
+		~BarnesHut() = default;
+
+		// Opening angle theta; smaller is more accurate and slower, 0 degenerates to exact summation.
+		float OpeningAngle() const;
+		void SetOpeningAngle(float openingAngle);
+
+		// Nodes in the tree built by the last ComputeAccelerations.
+		std::uint32_t NodeCount() const;
+
+		void ComputeAccelerations(NBodyState& state) override;
+		void ComputeAccelerations(NBodyState& state, const std::vector<std::uint32_t>& targets) override;
+
+		static const float DefaultOpeningAngle;
+		static const std::uint32_t LeafSize;
+		static const std::uint32_t MortonBitsPerAxis;
+		static const std::uint32_t RadixBits;
+		static const std::uint32_t ChunksPerThread;
+		static const std::uint32_t TraversalGrainSize;
+
+	private:
+		struct Node
+		{
+			float mCenterOfMass[3];
+			float mGravitationalParameter;
+			float mOpeningRadiusSquared;
+			float mMin[3];
+			float mMax[3];
+			std::uint32_t mFirstBody;
+			std::uint32_t mBodyCount;
+			std::uint32_t mFirstChild;
+			std::uint32_t mChildCount;
+		};
+
+		struct Subtree
+		{
+			std::uint32_t mNode;
+			std::uint32_t mFirstBody;
+			std::uint32_t mBodyCount;
+		};
+
+		void ComputeKeys(const NBodyState& state);
+		void SortKeys();
+		void GatherBodies(const NBodyState& state);
+		bool BuildTree(const NBodyState& state);
+		void BuildNodes();
+		void BuildNode(std::uint32_t node, std::uint32_t firstBody, std::uint32_t bodyCount, bool deferSubtrees);
+		void SummarizeNode(std::uint32_t node);
+		std::uint64_t ComputeRows(NBodyState& state, const std::uint8_t* active, std::uint32_t begin, std::uint32_t end) const;
+
+		template <typename Body>
+		void ForEachChunk(std::uint32_t begin, std::uint32_t end, std::uint32_t grainSize, Body& body);
+
+		float mOpeningAngle;
+		std::uint32_t mChunkSize;
+		std::uint32_t mSubtreeSize;
+
+		std::vector<std::uint64_t> mKeys;
+		std::vector<std::uint64_t> mScratchKeys;
+		std::vector<std::uint32_t> mOrder;
+		std::vector<std::uint32_t> mScratchOrder;
+		std::vector<std::uint32_t> mHistograms;
+		std::vector<float> mBounds;
+
+		std::vector<float> mSortedX;
+		std::vector<float> mSortedY;
+		std::vector<float> mSortedZ;
+		std::vector<float> mSortedGravitationalParameters;
+
+		std::vector<Node> mNodes;
+		std::atomic<std::uint32_t> mNodeCount;
+		std::vector<Subtree> mSubtrees;
+		std::vector<std::uint32_t> mPendingNodes;
+		std::vector<std::uint8_t> mActive;
+	};
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace Simulation
+{
+	// A [Section] of CelestialBodies.ini with Type=Belt. Distances, diameters and the period are scaled by the constants
+	// like those of a body; the period is that of an orbit at the inner edge, and the others follow Kepler's third law.
+	struct BeltData
+	{
+		std::string mName;
+		std::string mParent;
+		float mInnerDistance;
+		float mOuterDistance;
+		float mOrbitalPeriod;
+		std::uint32_t mCount;
+		float mMinDiameter;
+		float mMaxDiameter;
+		float mSizeExponent;
+		float mMaxEccentricity;
+		float mMaxInclination;
+		std::uint32_t mSeed;
+		bool mQuantized;
+	};
+}
@@ -0,0 +1,146 @@
+#include "pch.h"
+#include "BlockTimestepIntegrator.h"
+#include "LeapfrogIntegrator.h"
+#include "NBodyState.h"
+#include "GravitySolver.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t BlockTimestepIntegrator::MaxLevel = 16;
+
+	BlockTimestepIntegrator::BlockTimestepIntegrator(const vector<double>& preferredTimesteps) :
+		mPreferredTimesteps(preferredTimesteps), mLevels(preferredTimesteps.size(), 0)
+	{
+		for (double preferredTimestep : mPreferredTimesteps)
+		{
+			if (!(preferredTimestep > 0))
+			{
+				throw runtime_error("Preferred timesteps must be positive");
+			}
+		}
+
+		mAll.resize(mPreferredTimesteps.size());
+		for (uint32_t index = 0; index < mAll.size(); ++index)
+		{
+			mAll[index] = index;
+		}
+	}
+
+	void BlockTimestepIntegrator::Initialize(NBodyState& state, GravitySolver& solver)
+	{
+		if (state.Count() != mPreferredTimesteps.size())
+		{
+			throw runtime_error("Preferred timesteps do not match the body count");
+		}
+		mCarries.assign(3ull * state.PaddedCount(), 0.0f);
+		solver.ComputeAccelerations(state);
+	}
+
+	void BlockTimestepIntegrator::Step(NBodyState& state, GravitySolver& solver, double timestep)
+	{
+		AssignLevels(timestep);
+		// a system without bodies has no deepest level
+		if (mLevels.empty())
+		{
+			return;
+		}
+
+		uint32_t deepestLevel = *max_element(mLevels.begin(), mLevels.end());
+		uint32_t substepCount = 1u << deepestLevel;
+		double substep = timestep / substepCount;
+
+		// every body opens its own step with a half kick from the accelerations it is synchronized with
+		Kick(state, mAll, substep, deepestLevel, 0.5);
+
+		for (uint32_t substepIndex = 1; substepIndex <= substepCount; ++substepIndex)
+		{
+			LeapfrogIntegrator::Drift(state, static_cast<float>(substep), mCarries);
+
+			// level L ends a step every 2^(deepest - L) substeps; all of them end on the last one
+			if (substepIndex == substepCount)
+			{
+				solver.ComputeAccelerations(state);
+				Kick(state, mAll, substep, deepestLevel, 0.5);
+				break;
+			}
+
+			mActive.clear();
+			for (uint32_t index = 0; index < mLevels.size(); ++index)
+			{
+				if ((substepIndex & ((1u << (deepestLevel - mLevels[index])) - 1)) == 0)
+				{
+					mActive.push_back(index);
+				}
+			}
+
+			// the closing half kick of one step and the opening half kick of the next
+			if (mActive.size() == mAll.size())
+			{
+				solver.ComputeAccelerations(state);
+			}
+			else
+			{
+				solver.ComputeAccelerations(state, mActive);
+			}
+			Kick(state, mActive, substep, deepestLevel, 1.0);
+		}
+	}
+
+	void BlockTimestepIntegrator::SaveState(vector<double>& values) const
+	{
+		values.insert(values.end(), mCarries.begin(), mCarries.end());
+	}
+
+	void BlockTimestepIntegrator::RestoreState(NBodyState& state, const double* values, uint64_t count)
+	{
+		if (state.Count() != mPreferredTimesteps.size() || count != 3ull * state.PaddedCount())
+		{
+			throw runtime_error("Block timestep state does not match the body count");
+		}
+		mCarries.assign(values, values + count);
+	}
+
+	const vector<uint32_t>& BlockTimestepIntegrator::Levels() const
+	{
+		return mLevels;
+	}
+
+	vector<uint32_t> BlockTimestepIntegrator::LevelPopulation() const
+	{
+		vector<uint32_t> population(MaxLevel + 1, 0);
+		for (uint32_t level : mLevels)
+		{
+			++population[level];
+		}
+		return population;
+	}
+
+	void BlockTimestepIntegrator::AssignLevels(double timestep)
+	{
+		for (uint32_t index = 0; index < mLevels.size(); ++index)
+		{
+			double level = ceil(log2(timestep / mPreferredTimesteps[index]));
+			mLevels[index] = static_cast<uint32_t>(min(max(level, 0.0), static_cast<double>(MaxLevel)));
+		}
+	}
+
+	void BlockTimestepIntegrator::Kick(NBodyState& state, const vector<uint32_t>& bodies, double substep, uint32_t deepestLevel, double fraction) const
+	{
+		float* velocityX = state.VelocityX();
+		float* velocityY = state.VelocityY();
+		float* velocityZ = state.VelocityZ();
+		const float* accelerationX = state.AccelerationX();
+		const float* accelerationY = state.AccelerationY();
+		const float* accelerationZ = state.AccelerationZ();
+		for (uint32_t body : bodies)
+		{
+			float kick = static_cast<float>(fraction * substep * (1u << (deepestLevel - mLevels[body])));
+			velocityX[body] += accelerationX[body] * kick;
+			velocityY[body] += accelerationY[body] * kick;
+			velocityZ[body] += accelerationZ[body] * kick;
+		}
+	}
+}
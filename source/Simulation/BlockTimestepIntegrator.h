@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Integrator.h"
+
+namespace Simulation
+{
+	// Kick-drift-kick leapfrog with individual timesteps on a power-of-two block hierarchy. Each Step(timestep) puts body
+	// i on level L = ceil(log2(timestep / preferred_i)), clamped to MaxLevel, so it is kicked every timestep / 2^L; the
+	// whole state drifts in steps of the finest occupied level and forces are evaluated only for the bodies whose own
+	// step ends there. Slow bodies are predicted along their last velocity in between, which is what makes the fast ones
+	// cheap: a moon system on level 10 costs a thousand small force evaluations of a few bodies, not of the population.
+	//
+	// Levels are fixed for the duration of a step and every body is synchronized with fresh accelerations at its end, so
+	// the scheme is time symmetric within a step but not symplectic across level changes.
+	class BlockTimestepIntegrator final : public Integrator
+	{
+	public:
+		// preferredTimesteps[i] is the longest step body i is allowed to take.
+		explicit BlockTimestepIntegrator(const std::vector<double>& preferredTimesteps);
+		BlockTimestepIntegrator(const BlockTimestepIntegrator&) = delete;
+		BlockTimestepIntegrator& operator=(const BlockTimestepIntegrator&) = delete;
+		BlockTimestepIntegrator(BlockTimestepIntegrator&&) = delete;
+		BlockTimestepIntegrator& operator=(BlockTimestepIntegrator&&) = delete;
+		~BlockTimestepIntegrator() = default;
+
+		void Initialize(NBodyState& state, GravitySolver& solver) override;
+		void Step(NBodyState& state, GravitySolver& solver, double timestep) override;
+		// The rounding carries of the leapfrog drift.
+		void SaveState(std::vector<double>& values) const override;
+		void RestoreState(NBodyState& state, const double* values, std::uint64_t count) override;
+
+		// Level of every body in the last Step, and how many bodies were on each level.
+		const std::vector<std::uint32_t>& Levels() const;
+		std::vector<std::uint32_t> LevelPopulation() const;
+
+		static const std::uint32_t MaxLevel;
+
+	private:
+		void AssignLevels(double timestep);
+		void Kick(NBodyState& state, const std::vector<std::uint32_t>& bodies, double substep, std::uint32_t deepestLevel, double fraction) const;
+
+		std::vector<double> mPreferredTimesteps;
+		std::vector<std::uint32_t> mLevels;
+		std::vector<std::uint32_t> mActive;
+		std::vector<std::uint32_t> mAll;
+		std::vector<float> mCarries;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "RenderTransforms.h"
+#include "ParticleSystem.h"
+
+namespace Simulation
+{
+	enum class SimulationMode;
+	enum class IntegrationMethod;
+
+	// Everything a renderer reads from a BodySystem in one frame, copied out by BodySystem::WriteSnapshot so that it can
+	// be drawn on another thread while the simulation moves on. Catalog data, the catalog's hierarchy and the orbit shapes
+	// never change after Initialize and are read from the BodySystem itself; mParents are the dominant parents, which
+	// the dynamic hierarchy changes, and mReparentCount tells a renderer when they did. Refilling a snapshot reuses its
+	// arrays.
+	//
+	// mTransforms are the render transforms of the last Interpolate; their origin is the BodySystem's render origin
+	// until a renderer rebases them on its own. mParticleVertices are already rewound to mRenderTime, and mBeltInstances
+	// hold one array of AsteroidBelt::Instances() per belt. mSpawnedInstances and mSpawnedParents are those of
+	// SpawnedBodies, in its dense order, which changes as bodies come and go, and the spacecraft ones those of
+	// SpacecraftFleet, whose parents also change as craft cross spheres of influence. mSequence and mFrame, the publisher's count
+	// of snapshots and the frame it stepped this one for, are left to the publisher to number.
+	struct BodySnapshot
+	{
+		std::uint64_t mSequence;
+		std::uint64_t mFrame;
+		double mSimulationTime;
+		double mRenderTime;
+		RenderTransforms mTransforms;
+		SimulationMode mMode;
+		IntegrationMethod mIntegration;
+		bool mHasEphemeris;
+		std::vector<std::uint8_t> mPaused;
+		std::vector<std::uint32_t> mUpdateIntervals;
+		std::uint32_t mUpdatedCount;
+		std::uint32_t mInterpolatedCount;
+		std::uint32_t mSolvedCount;
+		std::uint32_t mExtrapolatedCount;
+		std::vector<std::vector<DirectX::XMFLOAT4>> mBeltInstances;
+		std::vector<ParticleColorVertex> mParticleVertices;
+		std::vector<DirectX::XMFLOAT4> mSpawnedInstances;
+		std::vector<std::uint32_t> mSpawnedParents;
+		std::uint64_t mSpawnedDroppedCount;
+		std::vector<DirectX::XMFLOAT4> mSpacecraftInstances;
+		std::vector<std::uint32_t> mSpacecraftParents;
+		std::uint64_t mSpacecraftTransitionCount;
+		bool mDynamicHierarchy;
+		std::vector<std::uint32_t> mParents;
+		std::uint64_t mReparentCount;
+	};
+}
@@ -0,0 +1,638 @@
+#include "pch.h"
+#include "BodyStateStore.h"
+#include "ThreadPool.h"
+#include "KeplerSolver.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t BodyStateStore::BatchSize = 4;
+	const uint32_t BodyStateStore::InvalidIndex = numeric_limits<uint32_t>::max();
+	const uint32_t BodyStateStore::ParallelGrainSize = 1024;
+
+	namespace
+	{
+		inline XMVECTOR XM_CALLCONV LoadBatch(const vector<float>& values, uint32_t index)
+		{
+			return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&values[index]));
+		}
+
+		// Transposes one matrix row of four bodies from SoA lanes into the AoS world matrices.
+		inline void XM_CALLCONV StoreRow(XMFLOAT4X4* transforms, uint32_t row, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, GXMVECTOR w)
+		{
+			XMMATRIX rows = XMMatrixTranspose(XMMATRIX(x, y, z, w));
+			for (uint32_t lane = 0; lane < BodyStateStore::BatchSize; ++lane)
+			{
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(transforms[lane].m[row]), rows.r[lane]);
+			}
+		}
+	}
+
+	BodyStateStore::BodyStateStore() :
+		mEvaluatedTime(0), mEvaluationCount(0), mCount(0), mComposedCount(0), mExtrapolatedCount(0), mUpdatedCount(0)
+	{
+	}
+
+	void BodyStateStore::Resize(uint32_t count)
+	{
+		mCount = count;
+
+		// pad to a whole number of batches so the kernel never needs a scalar tail
+		uint32_t paddedCount = ((count + BatchSize - 1) / BatchSize) * BatchSize;
+		mParents.assign(paddedCount, InvalidIndex);
+		mScales.assign(paddedCount, 0.0f);
+		mSinAxialTilts.assign(paddedCount, 0.0f);
+		mCosAxialTilts.assign(paddedCount, 1.0f);
+		mSemiMajorAxes.assign(paddedCount, 0.0f);
+		mEccentricities.assign(paddedCount, 0.0f);
+		mMinorAxisRatios.assign(paddedCount, 1.0f);
+		mPeriapsisAxisX.assign(paddedCount, 1.0f);
+		mPeriapsisAxisY.assign(paddedCount, 0.0f);
+		mPeriapsisAxisZ.assign(paddedCount, 0.0f);
+		mSemiLatusAxisX.assign(paddedCount, 0.0f);
+		mSemiLatusAxisY.assign(paddedCount, 0.0f);
+		mSemiLatusAxisZ.assign(paddedCount, -1.0f);
+		mRotationFrequencies.assign(paddedCount, 0.0);
+		mRotationPhases.assign(paddedCount, 0.0);
+		mOrbitalFrequencies.assign(paddedCount, 0.0);
+		mOrbitalPhases.assign(paddedCount, 0.0);
+		mRotationAngles.assign(paddedCount, 0.0f);
+		mMeanAnomalies.assign(paddedCount, 0.0f);
+		mFrozen.assign(paddedCount, 0);
+		mFrozenTimes.assign(paddedCount, 0.0);
+		mPending.assign(paddedCount, 1);
+		mUpdateIntervals.assign(paddedCount, 1);
+		mLocalChanged.assign(paddedCount, 0);
+		mExtrapolated.assign(paddedCount, 0);
+		mChanged.assign(paddedCount, 0);
+		mMoved.assign(paddedCount, 0);
+		mLocalPositions.assign(paddedCount, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+		mLocalVelocities.assign(paddedCount, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+		mWorldTransforms.assign(paddedCount, XMFLOAT4X4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1));
+		mPositions.assign(paddedCount, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+		mWorldPositionX.assign(paddedCount, 0.0);
+		mWorldPositionY.assign(paddedCount, 0.0);
+		mWorldPositionZ.assign(paddedCount, 0.0);
+	}
+
+	void BodyStateStore::SetBody(uint32_t index, uint32_t parent, float scale, float axialTilt, double rotationPeriod, const OrbitalElements& orbit)
+	{
+		assert(index < mCount);
+		assert(parent == InvalidIndex || parent < index);
+		assert(orbit.mEccentricity >= 0.0f && orbit.mEccentricity < 1.0f);
+
+		mParents[index] = parent;
+		mScales[index] = scale;
+		XMScalarSinCos(&mSinAxialTilts[index], &mCosAxialTilts[index], axialTilt);
+		mSemiMajorAxes[index] = orbit.mSemiMajorAxis;
+		mEccentricities[index] = orbit.mEccentricity;
+		mMinorAxisRatios[index] = sqrt(1.0f - orbit.mEccentricity * orbit.mEccentricity);
+
+		XMFLOAT3 periapsisAxis;
+		XMFLOAT3 semiLatusAxis;
+		PerifocalAxes(orbit, periapsisAxis, semiLatusAxis);
+		mPeriapsisAxisX[index] = periapsisAxis.x;
+		mPeriapsisAxisY[index] = periapsisAxis.y;
+		mPeriapsisAxisZ[index] = periapsisAxis.z;
+		mSemiLatusAxisX[index] = semiLatusAxis.x;
+		mSemiLatusAxisY[index] = semiLatusAxis.y;
+		mSemiLatusAxisZ[index] = semiLatusAxis.z;
+
+		mRotationFrequencies[index] = (rotationPeriod == 0) ? 0 : (1.0 / rotationPeriod);
+		mRotationPhases[index] = 0.0;
+		mOrbitalFrequencies[index] = (orbit.mPeriod == 0) ? 0 : (1.0 / orbit.mPeriod);
+		mOrbitalPhases[index] = orbit.mMeanAnomaly / XM_2PI;
+		mRotationAngles[index] = 0.0f;
+		mMeanAnomalies[index] = 0.0f;
+		mFrozen[index] = 0;
+		mPending[index] = 1;
+	}
+
+	void BodyStateStore::SetFrozen(uint32_t index, bool frozen, double time)
+	{
+		assert(index < mCount);
+		if (frozen == (mFrozen[index] != 0))
+		{
+			return;
+		}
+
+		if (frozen)
+		{
+			mFrozenTimes[index] = time;
+		}
+		else
+		{
+			// shift the phases so the closed form resumes where the body stopped rather than where it would be by now
+			double frozenDuration = time - mFrozenTimes[index];
+			mRotationPhases[index] -= mRotationFrequencies[index] * frozenDuration;
+			mOrbitalPhases[index] -= mOrbitalFrequencies[index] * frozenDuration;
+		}
+		mFrozen[index] = frozen ? 1 : 0;
+		mPending[index] = 1;
+	}
+
+	void BodyStateStore::SetPhases(uint32_t index, double rotationPhase, double orbitalPhase)
+	{
+		assert(index < mCount);
+		mRotationPhases[index] = rotationPhase;
+		mOrbitalPhases[index] = orbitalPhase;
+		mPending[index] = 1;
+	}
+
+	void BodyStateStore::SetUpdateIntervals(const vector<uint32_t>& intervals)
+	{
+		assert(intervals.size() == mCount);
+		for (uint32_t index = 0; index < mCount; ++index)
+		{
+			mUpdateIntervals[index] = max(intervals[index], 1U);
+		}
+	}
+
+	void BodyStateStore::Invalidate()
+	{
+		fill(mPending.begin(), mPending.begin() + mCount, static_cast<uint8_t>(1));
+	}
+
+	void BodyStateStore::Evaluate(double time)
+	{
+		EvaluateLocalTransforms(0, mCount, time);
+		ApplyParentTranslations(0, mCount);
+		CountChanges();
+		mEvaluatedTime = time;
+		++mEvaluationCount;
+	}
+
+	void BodyStateStore::Evaluate(double time, ThreadPool& threadPool, const vector<uint32_t>& levelOffsets)
+	{
+		assert(ParallelGrainSize % BatchSize == 0);
+		assert(levelOffsets.size() >= 2 && levelOffsets.back() == mCount);
+
+		// local transforms do not depend on the hierarchy, so the kernel is one flat parallel loop
+		auto evaluateLocalTransforms = [this, time](uint32_t begin, uint32_t end)
+		{
+			EvaluateLocalTransforms(begin, end, time);
+		};
+		threadPool.ParallelFor(0, mCount, ParallelGrainSize, evaluateLocalTransforms);
+
+		// every level only reads positions and change flags finished by the level above it
+		auto applyParentTranslations = [this](uint32_t begin, uint32_t end)
+		{
+			ApplyParentTranslations(begin, end);
+		};
+		for (size_t level = 0; level + 1 < levelOffsets.size(); ++level)
+		{
+			threadPool.ParallelFor(levelOffsets[level], levelOffsets[level + 1], ParallelGrainSize, applyParentTranslations);
+		}
+		CountChanges();
+		mEvaluatedTime = time;
+		++mEvaluationCount;
+	}
+
+	void BodyStateStore::EvaluateLocalTransforms(uint32_t begin, uint32_t end, double time)
+	{
+		assert(begin % BatchSize == 0);
+
+		float elapsedSeconds = static_cast<float>(time - mEvaluatedTime);
+		for (uint32_t index = begin; index < end; index += BatchSize)
+		{
+			uint8_t batchChanged = 0;
+			uint8_t batchDue = 0;
+			uint64_t phase = mEvaluationCount + index / BatchSize;
+			for (uint32_t lane = index; lane < index + BatchSize; ++lane)
+			{
+				uint8_t changed = (Animated(lane) || mPending[lane] != 0) ? 1 : 0;
+				mLocalChanged[lane] = changed;
+				mExtrapolated[lane] = 0;
+				mChanged[lane] = changed;
+				mMoved[lane] = (Orbiting(lane) || mPending[lane] != 0) ? 1 : 0;
+				batchChanged |= changed;
+				batchDue |= (changed != 0 && (phase % mUpdateIntervals[lane] == 0 || mPending[lane] != 0)) ? 1 : 0;
+			}
+
+			// static lanes of a moving batch are recomposed to the same values and are not reported as changed
+			if (batchChanged == 0)
+			{
+				continue;
+			}
+
+			// a batch that is not due only slides its translations along, so a spinning body stays as it is
+			if (batchDue == 0)
+			{
+				for (uint32_t lane = index; lane < index + BatchSize; ++lane)
+				{
+					if (mLocalChanged[lane] == 0)
+					{
+						continue;
+					}
+
+					XMVECTOR position = XMLoadFloat4(&mLocalPositions[lane]);
+					XMStoreFloat4(&mLocalPositions[lane], XMVectorMultiplyAdd(XMLoadFloat4(&mLocalVelocities[lane]), XMVectorReplicate(elapsedSeconds), position));
+					mLocalChanged[lane] = 0;
+					mExtrapolated[lane] = 1;
+					mChanged[lane] = mMoved[lane];
+				}
+				continue;
+			}
+
+			for (uint32_t lane = index; lane < index + BatchSize; ++lane)
+			{
+				double localTime = LocalTime(lane, time);
+				mRotationAngles[lane] = Angle(mRotationPhases[lane], mRotationFrequencies[lane], localTime);
+				mMeanAnomalies[lane] = Angle(mOrbitalPhases[lane], mOrbitalFrequencies[lane], localTime);
+				mPending[lane] = 0;
+			}
+			ComposeBatch(index);
+		}
+	}
+
+	void BodyStateStore::ApplyParentTranslations(uint32_t begin, uint32_t end)
+	{
+		for (uint32_t index = begin; index < end; ++index)
+		{
+			uint32_t parent = mParents[index];
+			if (parent != InvalidIndex)
+			{
+				mMoved[index] |= mMoved[parent];
+				mChanged[index] |= mMoved[parent];
+			}
+			if (mMoved[index] == 0)
+			{
+				continue;
+			}
+
+			const XMFLOAT4& localPosition = mLocalPositions[index];
+			double x = localPosition.x;
+			double y = localPosition.y;
+			double z = localPosition.z;
+			if (parent != InvalidIndex)
+			{
+				x += mWorldPositionX[parent];
+				y += mWorldPositionY[parent];
+				z += mWorldPositionZ[parent];
+			}
+			mWorldPositionX[index] = x;
+			mWorldPositionY[index] = y;
+			mWorldPositionZ[index] = z;
+
+			XMFLOAT4 position(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z), 1.0f);
+			mPositions[index] = position;
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(mWorldTransforms[index].m[3]), XMLoadFloat4(&position));
+		}
+	}
+
+	XMMATRIX XM_CALLCONV BodyStateStore::EvaluateLocalTransform(uint32_t index, double time) const
+	{
+		float scale = mScales[index];
+		float sinTilt = mSinAxialTilts[index];
+		float cosTilt = mCosAxialTilts[index];
+		XMMATRIX tilt(cosTilt, sinTilt, 0, 0, -sinTilt, cosTilt, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+
+		double localTime = LocalTime(index, time);
+		float meanAnomaly = Angle(mOrbitalPhases[index], mOrbitalFrequencies[index], localTime);
+
+		XMMATRIX transform = XMMatrixScaling(scale, scale, scale);
+		transform = XMMatrixMultiply(transform, XMMatrixRotationY(Angle(mRotationPhases[index], mRotationFrequencies[index], localTime)));
+		transform = XMMatrixMultiply(transform, tilt);
+		transform = XMMatrixMultiply(transform, XMMatrixRotationY(meanAnomaly));
+		transform.r[3] = OrbitalPosition(index, meanAnomaly);
+		return transform;
+	}
+
+	XMMATRIX XM_CALLCONV BodyStateStore::EvaluateWorldTransform(uint32_t index, double time) const
+	{
+		XMMATRIX transform = EvaluateLocalTransform(index, time);
+		uint32_t parent = mParents[index];
+		if (parent != InvalidIndex)
+		{
+			transform.r[3] = XMVectorAdd(transform.r[3], XMVectorSetW(EvaluateWorldPosition(parent, time), 0.0f));
+		}
+		return transform;
+	}
+
+	XMVECTOR XM_CALLCONV BodyStateStore::EvaluateWorldPosition(uint32_t index, double time) const
+	{
+		// only translations are inherited, so the chain needs no rotations or matrices
+		XMVECTOR position = XMVectorZero();
+		for (; index != InvalidIndex; index = mParents[index])
+		{
+			position = XMVectorAdd(position, EvaluateLocalPosition(index, time));
+		}
+		return XMVectorSetW(position, 1.0f);
+	}
+
+	XMVECTOR XM_CALLCONV BodyStateStore::EvaluateLocalPosition(uint32_t index, double time) const
+	{
+		return OrbitalPosition(index, Angle(mOrbitalPhases[index], mOrbitalFrequencies[index], LocalTime(index, time)));
+	}
+
+	XMVECTOR XM_CALLCONV BodyStateStore::EvaluateLocalVelocity(uint32_t index, double time) const
+	{
+		float meanAnomaly = Angle(mOrbitalPhases[index], mOrbitalFrequencies[index], LocalTime(index, time));
+		float eccentricity = mEccentricities[index];
+		float sinEccentricAnomaly;
+		float cosEccentricAnomaly;
+		XMScalarSinCos(&sinEccentricAnomaly, &cosEccentricAnomaly, KeplerSolver::SolveEccentricAnomaly(meanAnomaly, eccentricity));
+
+		// dE/dt = n / (1 - e cos E), with the sign of the frequency carrying retrograde motion
+		float meanMotion = static_cast<float>(XM_2PI * mOrbitalFrequencies[index]);
+		float rate = mSemiMajorAxes[index] * meanMotion / (1.0f - eccentricity * cosEccentricAnomaly);
+		float periapsisSpeed = -rate * sinEccentricAnomaly;
+		float semiLatusSpeed = rate * mMinorAxisRatios[index] * cosEccentricAnomaly;
+		return XMVectorSet(periapsisSpeed * mPeriapsisAxisX[index] + semiLatusSpeed * mSemiLatusAxisX[index],
+			periapsisSpeed * mPeriapsisAxisY[index] + semiLatusSpeed * mSemiLatusAxisY[index],
+			periapsisSpeed * mPeriapsisAxisZ[index] + semiLatusSpeed * mSemiLatusAxisZ[index], 0.0f);
+	}
+
+	void BodyStateStore::SetPositions(const float* positionX, const float* positionY, const float* positionZ)
+	{
+		for (uint32_t index = 0; index < mCount; ++index)
+		{
+			mPositions[index] = XMFLOAT4(positionX[index], positionY[index], positionZ[index], 1.0f);
+			mWorldPositionX[index] = positionX[index];
+			mWorldPositionY[index] = positionY[index];
+			mWorldPositionZ[index] = positionZ[index];
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(mWorldTransforms[index].m[3]), XMLoadFloat4(&mPositions[index]));
+			mChanged[index] = 1;
+			mMoved[index] = 1;
+			mPending[index] = 1;
+		}
+		mUpdatedCount = mCount;
+	}
+
+	bool BodyStateStore::Frozen(uint32_t index) const
+	{
+		return (mFrozen[index] != 0);
+	}
+
+	double BodyStateStore::FrozenTime(uint32_t index) const
+	{
+		return mFrozenTimes[index];
+	}
+
+	bool BodyStateStore::Changed(uint32_t index) const
+	{
+		return (mChanged[index] != 0);
+	}
+
+	uint32_t BodyStateStore::UpdateInterval(uint32_t index) const
+	{
+		return mUpdateIntervals[index];
+	}
+
+	uint32_t BodyStateStore::ComposedCount() const
+	{
+		return mComposedCount;
+	}
+
+	uint32_t BodyStateStore::ExtrapolatedCount() const
+	{
+		return mExtrapolatedCount;
+	}
+
+	uint32_t BodyStateStore::UpdatedCount() const
+	{
+		return mUpdatedCount;
+	}
+
+	uint32_t BodyStateStore::Count() const
+	{
+		return mCount;
+	}
+
+	uint32_t BodyStateStore::Parent(uint32_t index) const
+	{
+		return mParents[index];
+	}
+
+	float BodyStateStore::Scale(uint32_t index) const
+	{
+		return mScales[index];
+	}
+
+	float BodyStateStore::SemiMajorAxis(uint32_t index) const
+	{
+		return mSemiMajorAxes[index];
+	}
+
+	float BodyStateStore::Eccentricity(uint32_t index) const
+	{
+		return mEccentricities[index];
+	}
+
+	XMFLOAT4X4 BodyStateStore::OrbitOrientation(uint32_t index) const
+	{
+		// rows map the orbit's local frame (periapsis along x, normal along y, semi-latus along -z) to the world
+		XMVECTOR periapsisAxis = XMVectorSet(mPeriapsisAxisX[index], mPeriapsisAxisY[index], mPeriapsisAxisZ[index], 0.0f);
+		XMVECTOR semiLatusAxis = XMVectorSet(mSemiLatusAxisX[index], mSemiLatusAxisY[index], mSemiLatusAxisZ[index], 0.0f);
+		XMVECTOR normal = XMVector3Cross(periapsisAxis, semiLatusAxis);
+
+		XMFLOAT4X4 orientation;
+		XMStoreFloat4x4(&orientation, XMMATRIX(periapsisAxis, normal, XMVectorNegate(semiLatusAxis), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f)));
+		return orientation;
+	}
+
+	float BodyStateStore::RotationAngle(uint32_t index) const
+	{
+		return mRotationAngles[index];
+	}
+
+	float BodyStateStore::MeanAnomaly(uint32_t index) const
+	{
+		return mMeanAnomalies[index];
+	}
+
+	double BodyStateStore::RotationFrequency(uint32_t index) const
+	{
+		return mRotationFrequencies[index];
+	}
+
+	double BodyStateStore::OrbitalFrequency(uint32_t index) const
+	{
+		return mOrbitalFrequencies[index];
+	}
+
+	double BodyStateStore::RotationPhase(uint32_t index) const
+	{
+		return mRotationPhases[index];
+	}
+
+	double BodyStateStore::OrbitalPhase(uint32_t index) const
+	{
+		return mOrbitalPhases[index];
+	}
+
+	const XMFLOAT4X4& BodyStateStore::WorldTransform(uint32_t index) const
+	{
+		return mWorldTransforms[index];
+	}
+
+	const XMFLOAT4& BodyStateStore::Position(uint32_t index) const
+	{
+		return mPositions[index];
+	}
+
+	const vector<XMFLOAT4X4>& BodyStateStore::WorldTransforms() const
+	{
+		return mWorldTransforms;
+	}
+
+	WorldPosition BodyStateStore::PrecisePosition(uint32_t index) const
+	{
+		WorldPosition position = { mWorldPositionX[index], mWorldPositionY[index], mWorldPositionZ[index] };
+		return position;
+	}
+
+	const vector<XMFLOAT4>& BodyStateStore::Positions() const
+	{
+		return mPositions;
+	}
+
+	float BodyStateStore::Angle(double phase, double frequency, double time)
+	{
+		// whole turns are dropped in double precision so the phase stays exact at any time warp
+		double turns = phase + frequency * time;
+		turns -= floor(turns + 0.5);
+		return static_cast<float>(turns * XM_2PI);
+	}
+
+	void BodyStateStore::PerifocalAxes(const OrbitalElements& orbit, XMFLOAT3& periapsisAxis, XMFLOAT3& semiLatusAxis)
+	{
+		float sinNode, cosNode, sinInclination, cosInclination, sinPeriapsis, cosPeriapsis;
+		XMScalarSinCos(&sinNode, &cosNode, orbit.mLongitudeOfAscendingNode);
+		XMScalarSinCos(&sinInclination, &cosInclination, orbit.mInclination);
+		XMScalarSinCos(&sinPeriapsis, &cosPeriapsis, orbit.mArgumentOfPeriapsis);
+
+		// perifocal axes in the reference plane (X toward the node origin, Y in plane, Z north), mapped to the world as
+		// x = X, y = Z, z = -Y so that prograde motion matches the existing RotationY convention
+		float periapsisX = cosNode * cosPeriapsis - sinNode * sinPeriapsis * cosInclination;
+		float periapsisY = sinNode * cosPeriapsis + cosNode * sinPeriapsis * cosInclination;
+		float periapsisZ = sinPeriapsis * sinInclination;
+		float semiLatusX = -cosNode * sinPeriapsis - sinNode * cosPeriapsis * cosInclination;
+		float semiLatusY = -sinNode * sinPeriapsis + cosNode * cosPeriapsis * cosInclination;
+		float semiLatusZ = cosPeriapsis * sinInclination;
+
+		periapsisAxis = XMFLOAT3(periapsisX, periapsisZ, -periapsisY);
+		semiLatusAxis = XMFLOAT3(semiLatusX, semiLatusZ, -semiLatusY);
+	}
+
+	void BodyStateStore::ComposeBatch(uint32_t index)
+	{
+		XMVECTOR rotationAngle = LoadBatch(mRotationAngles, index);
+		XMVECTOR orbitalAngle = LoadBatch(mMeanAnomalies, index);
+
+		XMVECTOR sinRotation;
+		XMVECTOR cosRotation;
+		XMVectorSinCos(&sinRotation, &cosRotation, rotationAngle);
+
+		XMVECTOR sinOrbit;
+		XMVECTOR cosOrbit;
+		XMVectorSinCos(&sinOrbit, &cosOrbit, orbitalAngle);
+
+		XMVECTOR scale = LoadBatch(mScales, index);
+		XMVECTOR sinTilt = LoadBatch(mSinAxialTilts, index);
+		XMVECTOR cosTilt = LoadBatch(mCosAxialTilts, index);
+
+		// Expanded form of Scaling * RotationY(rotation) * RotationZ(tilt) * RotationY(orbit)
+		XMVECTOR cosTiltCosOrbit = XMVectorMultiply(cosTilt, cosOrbit);
+		XMVECTOR cosTiltSinOrbit = XMVectorMultiply(cosTilt, sinOrbit);
+		XMVECTOR scaledSinTilt = XMVectorMultiply(scale, sinTilt);
+		XMVECTOR scaledCosRotation = XMVectorMultiply(scale, cosRotation);
+		XMVECTOR scaledSinRotation = XMVectorMultiply(scale, sinRotation);
+
+		XMVECTOR m00 = XMVectorNegativeMultiplySubtract(scaledSinRotation, sinOrbit, XMVectorMultiply(scaledCosRotation, cosTiltCosOrbit));
+		XMVECTOR m01 = XMVectorMultiply(scaledCosRotation, sinTilt);
+		XMVECTOR m02 = XMVectorNegate(XMVectorMultiplyAdd(scaledCosRotation, cosTiltSinOrbit, XMVectorMultiply(scaledSinRotation, cosOrbit)));
+
+		XMVECTOR m10 = XMVectorNegate(XMVectorMultiply(scaledSinTilt, cosOrbit));
+		XMVECTOR m11 = XMVectorMultiply(scale, cosTilt);
+		XMVECTOR m12 = XMVectorMultiply(scaledSinTilt, sinOrbit);
+
+		XMVECTOR m20 = XMVectorMultiplyAdd(scaledSinRotation, cosTiltCosOrbit, XMVectorMultiply(scaledCosRotation, sinOrbit));
+		XMVECTOR m21 = XMVectorMultiply(scaledSinRotation, sinTilt);
+		XMVECTOR m22 = XMVectorNegativeMultiplySubtract(scaledSinRotation, cosTiltSinOrbit, XMVectorMultiply(scaledCosRotation, cosOrbit));
+
+		// position on the ellipse from the eccentric anomaly
+		XMVECTOR semiMajorAxis = LoadBatch(mSemiMajorAxes, index);
+		XMVECTOR eccentricity = LoadBatch(mEccentricities, index);
+		XMVECTOR sinEccentricAnomaly;
+		XMVECTOR cosEccentricAnomaly;
+		XMVectorSinCos(&sinEccentricAnomaly, &cosEccentricAnomaly, KeplerSolver::SolveEccentricAnomaly(orbitalAngle, eccentricity));
+		XMVECTOR minorAxisRatio = LoadBatch(mMinorAxisRatios, index);
+		XMVECTOR periapsisDistance = XMVectorMultiply(semiMajorAxis, XMVectorSubtract(cosEccentricAnomaly, eccentricity));
+		XMVECTOR semiLatusDistance = XMVectorMultiply(XMVectorMultiply(semiMajorAxis, minorAxisRatio), sinEccentricAnomaly);
+
+		XMVECTOR m30 = XMVectorMultiplyAdd(periapsisDistance, LoadBatch(mPeriapsisAxisX, index), XMVectorMultiply(semiLatusDistance, LoadBatch(mSemiLatusAxisX, index)));
+		XMVECTOR m31 = XMVectorMultiplyAdd(periapsisDistance, LoadBatch(mPeriapsisAxisY, index), XMVectorMultiply(semiLatusDistance, LoadBatch(mSemiLatusAxisY, index)));
+		XMVECTOR m32 = XMVectorMultiplyAdd(periapsisDistance, LoadBatch(mPeriapsisAxisZ, index), XMVectorMultiply(semiLatusDistance, LoadBatch(mSemiLatusAxisZ, index)));
+
+		XMVECTOR zero = XMVectorZero();
+		XMVECTOR one = XMVectorSplatOne();
+
+		// velocity along the ellipse for the evaluations in between solves, dE/dt = n / (1 - e cos E), and none while frozen
+		XMFLOAT4 meanMotions;
+		for (uint32_t lane = 0; lane < BatchSize; ++lane)
+		{
+			(&meanMotions.x)[lane] = Orbiting(index + lane) ? static_cast<float>(XM_2PI * mOrbitalFrequencies[index + lane]) : 0.0f;
+		}
+		XMVECTOR rate = XMVectorDivide(XMVectorMultiply(semiMajorAxis, XMLoadFloat4(&meanMotions)), XMVectorNegativeMultiplySubtract(eccentricity, cosEccentricAnomaly, one));
+		XMVECTOR periapsisSpeed = XMVectorNegate(XMVectorMultiply(rate, sinEccentricAnomaly));
+		XMVECTOR semiLatusSpeed = XMVectorMultiply(XMVectorMultiply(rate, minorAxisRatio), cosEccentricAnomaly);
+		XMVECTOR v0 = XMVectorMultiplyAdd(periapsisSpeed, LoadBatch(mPeriapsisAxisX, index), XMVectorMultiply(semiLatusSpeed, LoadBatch(mSemiLatusAxisX, index)));
+		XMVECTOR v1 = XMVectorMultiplyAdd(periapsisSpeed, LoadBatch(mPeriapsisAxisY, index), XMVectorMultiply(semiLatusSpeed, LoadBatch(mSemiLatusAxisY, index)));
+		XMVECTOR v2 = XMVectorMultiplyAdd(periapsisSpeed, LoadBatch(mPeriapsisAxisZ, index), XMVectorMultiply(semiLatusSpeed, LoadBatch(mSemiLatusAxisZ, index)));
+
+		XMFLOAT4X4* transforms = &mWorldTransforms[index];
+		StoreRow(transforms, 0, m00, m01, m02, zero);
+		StoreRow(transforms, 1, m10, m11, m12, zero);
+		StoreRow(transforms, 2, m20, m21, m22, zero);
+
+		// translations are relative to the parent until ApplyParentTranslations adds the parent's world position
+		XMMATRIX positions = XMMatrixTranspose(XMMATRIX(m30, m31, m32, one));
+		for (uint32_t lane = 0; lane < BatchSize; ++lane)
+		{
+			XMStoreFloat4(&mLocalPositions[index + lane], positions.r[lane]);
+		}
+		XMMATRIX velocities = XMMatrixTranspose(XMMATRIX(v0, v1, v2, zero));
+		for (uint32_t lane = 0; lane < BatchSize; ++lane)
+		{
+			XMStoreFloat4(&mLocalVelocities[index + lane], velocities.r[lane]);
+		}
+	}
+
+	void BodyStateStore::CountChanges()
+	{
+		mComposedCount = static_cast<uint32_t>(count(mLocalChanged.begin(), mLocalChanged.begin() + mCount, 1));
+		mExtrapolatedCount = static_cast<uint32_t>(count(mExtrapolated.begin(), mExtrapolated.begin() + mCount, 1));
+		mUpdatedCount = static_cast<uint32_t>(count(mChanged.begin(), mChanged.begin() + mCount, 1));
+	}
+
+	bool BodyStateStore::Animated(uint32_t index) const
+	{
+		return (mFrozen[index] == 0 && (mRotationFrequencies[index] != 0 || mOrbitalFrequencies[index] != 0));
+	}
+
+	bool BodyStateStore::Orbiting(uint32_t index) const
+	{
+		return (mFrozen[index] == 0 && mOrbitalFrequencies[index] != 0);
+	}
+
+	double BodyStateStore::LocalTime(uint32_t index, double time) const
+	{
+		return (mFrozen[index] != 0) ? mFrozenTimes[index] : time;
+	}
+
+	XMVECTOR XM_CALLCONV BodyStateStore::OrbitalPosition(uint32_t index, float meanAnomaly) const
+	{
+		float sinEccentricAnomaly;
+		float cosEccentricAnomaly;
+		XMScalarSinCos(&sinEccentricAnomaly, &cosEccentricAnomaly, KeplerSolver::SolveEccentricAnomaly(meanAnomaly, mEccentricities[index]));
+
+		float periapsisDistance = mSemiMajorAxes[index] * (cosEccentricAnomaly - mEccentricities[index]);
+		float semiLatusDistance = mSemiMajorAxes[index] * mMinorAxisRatios[index] * sinEccentricAnomaly;
+		return XMVectorSet(periapsisDistance * mPeriapsisAxisX[index] + semiLatusDistance * mSemiLatusAxisX[index],
+			periapsisDistance * mPeriapsisAxisY[index] + semiLatusDistance * mSemiLatusAxisY[index],
+			periapsisDistance * mPeriapsisAxisZ[index] + semiLatusDistance * mSemiLatusAxisZ[index], 1.0f);
+	}
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "OrbitalElements.h"
+#include "WorldPosition.h"
+
+namespace Simulation
+{
+	class ThreadPool;
+
+	// Structure of arrays store for the kinematic state of every body. State is a closed-form function of the absolute
+	// simulation time: the rotation angle and orbital mean anomaly are derived from each body's frequencies in double
+	// precision, and the batched kernel solves Kepler's equation and composes the world matrices of BatchSize bodies per
+	// DirectXMath vector instruction, so seeking to any time costs the same as a single frame.
+	//
+	// Each orbit is stored as its semi-major axis and eccentricity plus the unit periapsis (P) and semi-latus (Q) axes of
+	// its plane, so a position is a(cos E - e) P + a sqrt(1 - e^2) sin E Q. A circular orbit with zero angles reduces to
+	// the old Translation(radius, 0, 0) * RotationY(orbit). The body's own orientation still turns with the mean anomaly.
+	//
+	// Bodies must be stored parent before child (Parent(index) < index) so that a single forward sweep can apply the
+	// parent translations after the kernel has run. Given the offsets of the depth levels of that order, the threaded
+	// Evaluate runs the kernel as one flat parallel loop and then sweeps the levels one after another, each in parallel.
+	//
+	// Evaluation only touches what moved. A batch whose four bodies have neither a rotation nor an orbital rate, or are
+	// frozen, keeps its local transforms. Children only inherit translations, so a body's world translation is only
+	// recomposed when it orbits or an ancestor's translation moved; a spinning parent does not touch its subtree.
+	// Changed(index) reports which world transforms the last Evaluate or SetPositions altered. A frozen body holds the
+	// state of the time it was frozen at and picks up from there when thawed.
+	//
+	// A body with an update interval of n is only solved every n-th Evaluate, staggered by batch so that a tier of equal
+	// intervals spreads its solves over the interval. In between, a batch with no body due has its translations carried
+	// along the orbital velocities of their last solve and leaves its rotations where they were. The kernel works those
+	// velocities out alongside the positions. A pending body is always solved, and whoever sets the intervals decides how
+	// long a straight line stays close enough to the ellipse.
+	//
+	// Local offsets from the parent stay float, but world translations are summed and kept in double precision, so a
+	// moon far from the origin keeps the same offset from its planet that it has near it. Position and WorldTransform
+	// carry the same translations rounded to float.
+	class BodyStateStore final
+	{
+	public:
+		BodyStateStore();
+		BodyStateStore(const BodyStateStore&) = delete;
+		BodyStateStore& operator=(const BodyStateStore&) = delete;
+		BodyStateStore(BodyStateStore&&) = default;
+		BodyStateStore& operator=(BodyStateStore&&) = default;
+		~BodyStateStore() = default;
+
+		void Resize(std::uint32_t count);
+		void SetBody(std::uint32_t index, std::uint32_t parent, float scale, float axialTilt, double rotationPeriod, const OrbitalElements& orbit);
+		void SetFrozen(std::uint32_t index, bool frozen, double time);
+		// Puts back phases that thawing shifted, for checkpoints; SetBody starts them from the orbit's elements.
+		void SetPhases(std::uint32_t index, double rotationPhase, double orbitalPhase);
+		// One interval per body, 1 to solve it at every Evaluate.
+		void SetUpdateIntervals(const std::vector<std::uint32_t>& intervals);
+		// Marks every body pending, so the next Evaluate solves and recomposes all of them.
+		void Invalidate();
+
+		void Evaluate(double time);
+		void Evaluate(double time, ThreadPool& threadPool, const std::vector<std::uint32_t>& levelOffsets);
+		void EvaluateLocalTransforms(std::uint32_t begin, std::uint32_t end, double time);
+		void ApplyParentTranslations(std::uint32_t begin, std::uint32_t end);
+
+		DirectX::XMMATRIX XM_CALLCONV EvaluateLocalTransform(std::uint32_t index, double time) const;
+		DirectX::XMMATRIX XM_CALLCONV EvaluateWorldTransform(std::uint32_t index, double time) const;
+		DirectX::XMVECTOR XM_CALLCONV EvaluateWorldPosition(std::uint32_t index, double time) const;
+		// Position relative to the parent.
+		DirectX::XMVECTOR XM_CALLCONV EvaluateLocalPosition(std::uint32_t index, double time) const;
+		DirectX::XMVECTOR XM_CALLCONV EvaluateLocalVelocity(std::uint32_t index, double time) const;
+
+		// Replaces the translation of every body with externally integrated world positions. Every body counts as
+		// changed, and the next Evaluate recomposes all of them.
+		void SetPositions(const float* positionX, const float* positionY, const float* positionZ);
+
+		bool Frozen(std::uint32_t index) const;
+		// Time the body was frozen at, meaningless while it is not.
+		double FrozenTime(std::uint32_t index) const;
+		std::uint32_t UpdateInterval(std::uint32_t index) const;
+		bool Changed(std::uint32_t index) const;
+		// Bodies whose local transform the last Evaluate recomposed, that it extrapolated instead, and whose world
+		// transform it changed.
+		std::uint32_t ComposedCount() const;
+		std::uint32_t ExtrapolatedCount() const;
+		std::uint32_t UpdatedCount() const;
+
+		std::uint32_t Count() const;
+		std::uint32_t Parent(std::uint32_t index) const;
+		// Diameter of the body in world units.
+		float Scale(std::uint32_t index) const;
+		float SemiMajorAxis(std::uint32_t index) const;
+		float Eccentricity(std::uint32_t index) const;
+		DirectX::XMFLOAT4X4 OrbitOrientation(std::uint32_t index) const;
+		float RotationAngle(std::uint32_t index) const;
+		float MeanAnomaly(std::uint32_t index) const;
+		double RotationFrequency(std::uint32_t index) const;
+		double OrbitalFrequency(std::uint32_t index) const;
+		double RotationPhase(std::uint32_t index) const;
+		double OrbitalPhase(std::uint32_t index) const;
+
+		const DirectX::XMFLOAT4X4& WorldTransform(std::uint32_t index) const;
+		const DirectX::XMFLOAT4& Position(std::uint32_t index) const;
+		WorldPosition PrecisePosition(std::uint32_t index) const;
+		const std::vector<DirectX::XMFLOAT4X4>& WorldTransforms() const;
+		const std::vector<DirectX::XMFLOAT4>& Positions() const;
+
+		static const std::uint32_t BatchSize;
+		static const std::uint32_t InvalidIndex;
+		static const std::uint32_t ParallelGrainSize;
+
+		static float Angle(double phase, double frequency, double time);
+		// World directions of the periapsis and semi-latus axes of an orbit plane given by the orbit's angles.
+		static void PerifocalAxes(const OrbitalElements& orbit, DirectX::XMFLOAT3& periapsisAxis, DirectX::XMFLOAT3& semiLatusAxis);
+
+	private:
+		void ComposeBatch(std::uint32_t index);
+		void CountChanges();
+		bool Animated(std::uint32_t index) const;
+		bool Orbiting(std::uint32_t index) const;
+		double LocalTime(std::uint32_t index, double time) const;
+		DirectX::XMVECTOR XM_CALLCONV OrbitalPosition(std::uint32_t index, float meanAnomaly) const;
+
+		std::vector<std::uint32_t> mParents;
+		std::vector<float> mScales;
+		std::vector<float> mSinAxialTilts;
+		std::vector<float> mCosAxialTilts;
+		std::vector<float> mSemiMajorAxes;
+		std::vector<float> mEccentricities;
+		std::vector<float> mMinorAxisRatios;
+		std::vector<float> mPeriapsisAxisX;
+		std::vector<float> mPeriapsisAxisY;
+		std::vector<float> mPeriapsisAxisZ;
+		std::vector<float> mSemiLatusAxisX;
+		std::vector<float> mSemiLatusAxisY;
+		std::vector<float> mSemiLatusAxisZ;
+		std::vector<double> mRotationFrequencies;
+		std::vector<double> mRotationPhases;
+		std::vector<double> mOrbitalFrequencies;
+		std::vector<double> mOrbitalPhases;
+		std::vector<float> mRotationAngles;
+		std::vector<float> mMeanAnomalies;
+
+		std::vector<std::uint8_t> mFrozen;
+		std::vector<double> mFrozenTimes;
+
+		std::vector<std::uint8_t> mPending;
+		std::vector<std::uint32_t> mUpdateIntervals;
+		std::vector<std::uint8_t> mLocalChanged;
+		std::vector<std::uint8_t> mExtrapolated;
+		std::vector<std::uint8_t> mChanged;
+		std::vector<std::uint8_t> mMoved;
+		std::vector<DirectX::XMFLOAT4> mLocalPositions;
+		std::vector<DirectX::XMFLOAT4> mLocalVelocities;
+		std::vector<DirectX::XMFLOAT4X4> mWorldTransforms;
+		std::vector<DirectX::XMFLOAT4> mPositions;
+		std::vector<double> mWorldPositionX;
+		std::vector<double> mWorldPositionY;
+		std::vector<double> mWorldPositionZ;
+		double mEvaluatedTime;
+		std::uint64_t mEvaluationCount;
+		std::uint32_t mCount;
+		std::uint32_t mComposedCount;
+		std::uint32_t mExtrapolatedCount;
+		std::uint32_t mUpdatedCount;
+	};
+}
@@ -0,0 +1,1568 @@
+#include "pch.h"
+#include "BodySystem.h"
+#include "DirectSummation.h"
+#include "LeapfrogIntegrator.h"
+#include "WisdomHolmanIntegrator.h"
+#include "BlockTimestepIntegrator.h"
+#include "Ephemeris.h"
+#include "Checkpoint.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t BodySystem::InvalidIndex = numeric_limits<uint32_t>::max();
+	const uint32_t BodySystem::PhysicsStepsPerOrbit = 256;
+	const uint32_t BodySystem::WisdomHolmanStepsPerOrbit = 16;
+	const double BodySystem::HillSphereFraction = 1.0 / 3.0;
+	const double BodySystem::MutualHillSpacing = 8.0;
+	const uint32_t BodySystem::SpawnCapacity = 65536;
+	const uint32_t BodySystem::SpacecraftCapacity = 16384;
+	const uint32_t BodySystem::ReparentInterval = 4;
+
+	namespace
+	{
+		// Sections of a checkpoint. Each belt's stored orbits get their own, from BeltOrbitsSection up.
+		const uint32_t SettingsSection = 1;
+		const uint32_t ConstantsSection = 2;
+		const uint32_t BodiesSection = 3;
+		const uint32_t StringsSection = 4;
+		const uint32_t PhasesSection = 5;
+		const uint32_t DominantParentsSection = 6;
+		const uint32_t BeltsSection = 7;
+		const uint32_t EmittersSection = 8;
+		const uint32_t EmitterBodiesSection = 9;
+		const uint32_t SpawnedSection = 10;
+		const uint32_t SpacecraftSection = 11;
+		const uint32_t GravitySection = 12;
+		const uint32_t IntegratorSection = 13;
+		const uint32_t BeltOrbitsSection = 1 << 16;
+
+		struct CheckpointSettings
+		{
+			double mTime;
+			double mInitialEnergy;
+			uint64_t mReparentCount;
+			uint32_t mMode;
+			uint32_t mIntegration;
+			uint32_t mDynamicHierarchy;
+			uint32_t mReparentCursor;
+			uint32_t mParticleCapacity;
+			float mSoftening;
+		};
+
+		// A CelestialBodyData with its strings as offsets into the string section, each ended by a zero.
+		struct CheckpointBody
+		{
+			uint32_t mName;
+			uint32_t mTextureName;
+			uint32_t mParentName;
+			uint32_t mOrdinal;
+			uint32_t mParent;
+			float mMeanDistance;
+			float mRotationPeriod;
+			float mOrbitalPeriod;
+			float mAxialTilt;
+			float mDiameter;
+			float mReflectance;
+			float mIsLit;
+			float mEccentricity;
+			float mInclination;
+			float mAscendingNode;
+			float mArgumentOfPeriapsis;
+			float mMeanAnomaly;
+		};
+
+		struct CheckpointPhases
+		{
+			double mRotationPhase;
+			double mOrbitalPhase;
+			double mFrozenTime;
+			uint32_t mFrozen;
+		};
+
+		struct CheckpointBelt
+		{
+			BeltShape mShape;
+			uint32_t mParent;
+		};
+
+		struct CheckpointGravity
+		{
+			float mPosition[3];
+			float mVelocity[3];
+			float mAcceleration[3];
+			float mGravitationalParameter;
+		};
+
+		uint32_t AddString(vector<char>& strings, const string& value)
+		{
+			uint32_t offset = static_cast<uint32_t>(strings.size());
+			strings.insert(strings.end(), value.begin(), value.end());
+			strings.push_back('\0');
+			return offset;
+		}
+
+		string ReadString(const char* strings, uint64_t size, uint32_t offset)
+		{
+			const char* end = (offset < size) ? static_cast<const char*>(memchr(strings + offset, '\0', static_cast<size_t>(size - offset))) : nullptr;
+			if (end == nullptr)
+			{
+				throw runtime_error("Checkpoint string table is corrupt");
+			}
+			return string(strings + offset, end);
+		}
+
+		CheckpointBody SaveBody(const CelestialBodyData& data, uint32_t parent, vector<char>& strings)
+		{
+			CheckpointBody body;
+			body.mName = AddString(strings, data.mName);
+			body.mTextureName = AddString(strings, data.mTextureName);
+			body.mParentName = AddString(strings, data.mParent);
+			body.mOrdinal = data.mOrdinal;
+			body.mParent = parent;
+			body.mMeanDistance = data.mMeanDistance;
+			body.mRotationPeriod = data.mRotationPeriod;
+			body.mOrbitalPeriod = data.mOrbitalPeriod;
+			body.mAxialTilt = data.mAxialTilt;
+			body.mDiameter = data.mDiameter;
+			body.mReflectance = data.mReflectance;
+			body.mIsLit = data.mIsLit;
+			body.mEccentricity = data.mEccentricity;
+			body.mInclination = data.mInclination;
+			body.mAscendingNode = data.mAscendingNode;
+			body.mArgumentOfPeriapsis = data.mArgumentOfPeriapsis;
+			body.mMeanAnomaly = data.mMeanAnomaly;
+			return body;
+		}
+
+		CelestialBodyData RestoreBody(const CheckpointBody& body, const char* strings, uint64_t stringSize)
+		{
+			CelestialBodyData data;
+			data.mName = ReadString(strings, stringSize, body.mName);
+			data.mTextureName = ReadString(strings, stringSize, body.mTextureName);
+			data.mParent = ReadString(strings, stringSize, body.mParentName);
+			data.mOrdinal = body.mOrdinal;
+			data.mMeanDistance = body.mMeanDistance;
+			data.mRotationPeriod = body.mRotationPeriod;
+			data.mOrbitalPeriod = body.mOrbitalPeriod;
+			data.mAxialTilt = body.mAxialTilt;
+			data.mDiameter = body.mDiameter;
+			data.mReflectance = body.mReflectance;
+			data.mIsLit = body.mIsLit;
+			data.mEccentricity = body.mEccentricity;
+			data.mInclination = body.mInclination;
+			data.mAscendingNode = body.mAscendingNode;
+			data.mArgumentOfPeriapsis = body.mArgumentOfPeriapsis;
+			data.mMeanAnomaly = body.mMeanAnomaly;
+			return data;
+		}
+	}
+
+	BodySystem::BodySystem() :
+		mTime(0), mPreviousTime(0), mRenderTime(0), mInterpolatedCount(0), mMode(SimulationMode::Kinematic), mIntegration(IntegrationMethod::Leapfrog), mShortestPeriod(0), mPhysicsTimestep(0), mInitialEnergy(0),
+		mGravitySolver(make_unique<DirectSummation>()), mIntegrator(make_unique<LeapfrogIntegrator>()), mDynamicHierarchy(false), mReparentCursor(0), mReparentCount(0)
+	{
+	}
+
+	void BodySystem::Initialize(const ConfigData& configData)
+	{
+		mConstants = configData.GetConstantsData();
+		const auto& sections = configData.GetAllData();
+		uint32_t bodyCount = static_cast<uint32_t>(sections.size());
+
+		unordered_map<string, uint32_t> sectionIndices;
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			sectionIndices.insert({sections[index].mName, index});
+		}
+
+		vector<uint32_t> sectionParents(bodyCount, InvalidIndex);
+		vector<vector<uint32_t>> sectionChildren(bodyCount);
+		vector<uint32_t> order;
+		order.reserve(bodyCount);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			const CelestialBodyData& data = sections[index];
+			if (data.mParent.empty())
+			{
+				order.push_back(index);
+				continue;
+			}
+
+			auto parent = sectionIndices.find(data.mParent);
+			if (parent == sectionIndices.end())
+			{
+				throw runtime_error("Unknown parent body: " + data.mParent);
+			}
+			sectionParents[index] = parent->second;
+			sectionChildren[parent->second].push_back(index);
+		}
+
+		// breadth first from the roots so that every parent is stored before its children
+		for (size_t cursor = 0; cursor < order.size(); ++cursor)
+		{
+			const auto& children = sectionChildren[order[cursor]];
+			order.insert(order.end(), children.begin(), children.end());
+		}
+
+		if (order.size() != bodyCount)
+		{
+			throw runtime_error("Celestial body hierarchy contains a cycle");
+		}
+
+		vector<uint32_t> indices(bodyCount);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			indices[order[index]] = index;
+		}
+
+		vector<CelestialBodyData> data;
+		data.reserve(bodyCount);
+		vector<uint32_t> parents(bodyCount, InvalidIndex);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			data.push_back(sections[order[index]]);
+			if (sectionParents[order[index]] != InvalidIndex)
+			{
+				parents[index] = indices[sectionParents[order[index]]];
+			}
+		}
+
+		InitializeBodies(move(data), parents);
+		InitializeBelts(configData);
+		InitializeEmitters(configData);
+		mSpawned.SetCapacity(SpawnCapacity);
+		InitializeGravitationalParameters();
+		mSpacecraft.SetCapacity(SpacecraftCapacity);
+		mSpacecraft.SetBodies(mStates, mGravitationalParameters, 0);
+		mDominantParents.clear();
+		ResetDominantParents();
+		mReparentCount = 0;
+		CreateIntegrator();
+
+		// only keeps close passes finite; the spread moon systems keep even Charon some ten softening lengths from Pluto
+		mGravitySolver->SetSoftening(mConstants.mDiameter * 0.1f);
+		Seek(0);
+	}
+
+	void BodySystem::InitializeBodies(vector<CelestialBodyData> bodies, const vector<uint32_t>& parents)
+	{
+		uint32_t bodyCount = static_cast<uint32_t>(bodies.size());
+		mData = move(bodies);
+		mChildren.assign(bodyCount, vector<uint32_t>());
+		mLevelOffsets.assign(1, 0);
+		vector<uint32_t> depths(bodyCount, 0);
+		mStates.Resize(bodyCount);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			const CelestialBodyData& data = mData[index];
+			uint32_t parent = parents[index];
+			float orbitRadius = mConstants.mMeanDistance * data.mMeanDistance;
+			if (parent != InvalidIndex)
+			{
+				mChildren[parent].push_back(index);
+				depths[index] = depths[parent] + 1;
+
+				// calculate distance from the outer edge of the parent instead of origin
+				orbitRadius += (mData[parent].mDiameter / 2) * 20;
+			}
+
+			// breadth first order never decreases in depth, so each new depth opens the next level
+			if (index > 0 && depths[index] != depths[index - 1])
+			{
+				assert(depths[index] == depths[index - 1] + 1);
+				mLevelOffsets.push_back(index);
+			}
+
+			double netRotationPeriod = static_cast<double>(mConstants.mRotationPeriod) * data.mRotationPeriod;
+			OrbitalElements orbit;
+			orbit.mSemiMajorAxis = orbitRadius;
+			orbit.mEccentricity = data.mEccentricity;
+			orbit.mInclination = XMConvertToRadians(data.mInclination);
+			orbit.mLongitudeOfAscendingNode = XMConvertToRadians(data.mAscendingNode);
+			orbit.mArgumentOfPeriapsis = XMConvertToRadians(data.mArgumentOfPeriapsis);
+			orbit.mMeanAnomaly = XMConvertToRadians(data.mMeanAnomaly);
+			orbit.mPeriod = static_cast<double>(mConstants.mOrbitalPeriod) * data.mOrbitalPeriod;
+			if (orbit.mEccentricity < 0.0f || orbit.mEccentricity >= 1.0f)
+			{
+				throw runtime_error("Eccentricity must be in [0, 1): " + data.mName);
+			}
+
+			mStates.SetBody(index, parent, mConstants.mDiameter * data.mDiameter, XMConvertToRadians(data.mAxialTilt), netRotationPeriod, orbit);
+		}
+		mLevelOffsets.push_back(bodyCount);
+	}
+
+	void BodySystem::SaveCheckpoint(const string& path) const
+	{
+		uint32_t bodyCount = BodyCount();
+		CheckpointSettings settings = {};
+		settings.mTime = mTime;
+		settings.mInitialEnergy = mInitialEnergy;
+		settings.mReparentCount = mReparentCount;
+		settings.mMode = static_cast<uint32_t>(mMode);
+		settings.mIntegration = static_cast<uint32_t>(mIntegration);
+		settings.mDynamicHierarchy = mDynamicHierarchy ? 1 : 0;
+		settings.mReparentCursor = mReparentCursor;
+		settings.mParticleCapacity = mParticles.Capacity();
+		settings.mSoftening = mGravitySolver->Softening();
+
+		vector<char> strings;
+		CheckpointBody constants = SaveBody(mConstants, InvalidIndex, strings);
+		vector<CheckpointBody> bodies(bodyCount);
+		vector<CheckpointPhases> phases(bodyCount);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			bodies[index] = SaveBody(mData[index], Parent(index), strings);
+			CheckpointPhases& phase = phases[index];
+			phase.mRotationPhase = mStates.RotationPhase(index);
+			phase.mOrbitalPhase = mStates.OrbitalPhase(index);
+			phase.mFrozenTime = mStates.FrozenTime(index);
+			phase.mFrozen = mStates.Frozen(index) ? 1 : 0;
+		}
+
+		vector<CheckpointBelt> belts(mBelts.size());
+		for (size_t index = 0; index < mBelts.size(); ++index)
+		{
+			belts[index].mShape = mBelts[index].Shape();
+			belts[index].mParent = mBelts[index].Parent();
+		}
+
+		vector<ParticleEmitter> emitters;
+		for (uint32_t index = 0; index < mParticles.EmitterCount(); ++index)
+		{
+			emitters.push_back(mParticles.Emitter(index));
+		}
+
+		vector<SpawnedBody> spawned;
+		for (uint32_t index = 0; index < mSpawned.Count(); ++index)
+		{
+			spawned.push_back(mSpawned.BodyAt(index));
+		}
+
+		vector<Spacecraft> spacecraft;
+		for (uint32_t index = 0; index < mSpacecraft.Count(); ++index)
+		{
+			spacecraft.push_back(mSpacecraft.CraftAt(index));
+		}
+
+		// empty unless the N-body mode ran since the catalog was loaded
+		vector<CheckpointGravity> gravity(mGravityState.Count());
+		for (uint32_t index = 0; index < mGravityState.Count(); ++index)
+		{
+			CheckpointGravity& body = gravity[index];
+			body.mPosition[0] = mGravityState.PositionX()[index];
+			body.mPosition[1] = mGravityState.PositionY()[index];
+			body.mPosition[2] = mGravityState.PositionZ()[index];
+			body.mVelocity[0] = mGravityState.VelocityX()[index];
+			body.mVelocity[1] = mGravityState.VelocityY()[index];
+			body.mVelocity[2] = mGravityState.VelocityZ()[index];
+			body.mAcceleration[0] = mGravityState.AccelerationX()[index];
+			body.mAcceleration[1] = mGravityState.AccelerationY()[index];
+			body.mAcceleration[2] = mGravityState.AccelerationZ()[index];
+			body.mGravitationalParameter = mGravityState.GravitationalParameters()[index];
+		}
+		vector<double> integratorState;
+		mIntegrator->SaveState(integratorState);
+
+		CheckpointWriter writer;
+		writer.AddSection(SettingsSection, &settings, 1);
+		writer.AddSection(ConstantsSection, &constants, 1);
+		writer.AddSection(BodiesSection, bodies);
+		writer.AddSection(StringsSection, strings);
+		writer.AddSection(PhasesSection, phases);
+		writer.AddSection(DominantParentsSection, mDominantParents);
+		writer.AddSection(BeltsSection, belts);
+		writer.AddSection(EmittersSection, emitters);
+		writer.AddSection(EmitterBodiesSection, mEmitterBodies);
+		writer.AddSection(SpawnedSection, spawned);
+		writer.AddSection(SpacecraftSection, spacecraft);
+		writer.AddSection(GravitySection, gravity);
+		writer.AddSection(IntegratorSection, integratorState);
+		for (uint32_t index = 0; index < mBelts.size(); ++index)
+		{
+			writer.AddSection(BeltOrbitsSection + index, mBelts[index].OrbitData(), mBelts[index].OrbitDataSize());
+		}
+		writer.Write(path);
+	}
+
+	void BodySystem::RestoreCheckpoint(const string& path)
+	{
+		Checkpoint checkpoint(path);
+
+		// every section is looked up, and its layout checked, before anything changes
+		uint32_t bodyCount = static_cast<uint32_t>(checkpoint.RecordCount(BodiesSection));
+		uint32_t beltCount = static_cast<uint32_t>(checkpoint.RecordCount(BeltsSection));
+		uint32_t emitterCount = static_cast<uint32_t>(checkpoint.RecordCount(EmittersSection));
+		uint32_t gravityCount = static_cast<uint32_t>(checkpoint.RecordCount(GravitySection));
+		uint64_t stringSize = checkpoint.RecordCount(StringsSection);
+		const CheckpointSettings* settings = checkpoint.Section<CheckpointSettings>(SettingsSection);
+		const CheckpointBody* constants = checkpoint.Section<CheckpointBody>(ConstantsSection);
+		const CheckpointBody* bodies = checkpoint.Section<CheckpointBody>(BodiesSection);
+		const char* strings = checkpoint.Section<char>(StringsSection);
+		const CheckpointPhases* phases = checkpoint.Section<CheckpointPhases>(PhasesSection);
+		const uint32_t* dominantParents = checkpoint.Section<uint32_t>(DominantParentsSection);
+		const CheckpointBelt* belts = checkpoint.Section<CheckpointBelt>(BeltsSection);
+		const ParticleEmitter* emitters = checkpoint.Section<ParticleEmitter>(EmittersSection);
+		const uint32_t* emitterBodies = checkpoint.Section<uint32_t>(EmitterBodiesSection);
+		const SpawnedBody* spawned = checkpoint.Section<SpawnedBody>(SpawnedSection);
+		const Spacecraft* spacecraft = checkpoint.Section<Spacecraft>(SpacecraftSection);
+		const CheckpointGravity* gravity = checkpoint.Section<CheckpointGravity>(GravitySection);
+		const double* integratorState = checkpoint.Section<double>(IntegratorSection);
+		for (uint32_t index = 0; index < beltCount; ++index)
+		{
+			checkpoint.Section<uint8_t>(BeltOrbitsSection + index);
+		}
+
+		bool matches = checkpoint.RecordCount(SettingsSection) == 1 && checkpoint.RecordCount(ConstantsSection) == 1 &&
+			checkpoint.RecordCount(PhasesSection) == bodyCount && checkpoint.RecordCount(DominantParentsSection) == bodyCount &&
+			checkpoint.RecordCount(EmitterBodiesSection) == emitterCount && (gravityCount == 0 || gravityCount == bodyCount) &&
+			settings->mMode <= static_cast<uint32_t>(SimulationMode::Playback) && settings->mIntegration <= static_cast<uint32_t>(IntegrationMethod::BlockTimestep);
+		for (uint32_t index = 0; matches && index < bodyCount; ++index)
+		{
+			matches = (bodies[index].mParent == InvalidIndex || bodies[index].mParent < index) && (dominantParents[index] == InvalidIndex || dominantParents[index] < bodyCount);
+		}
+		for (uint32_t index = 0; matches && index < beltCount; ++index)
+		{
+			matches = (belts[index].mParent < bodyCount);
+		}
+		for (uint32_t index = 0; matches && index < emitterCount; ++index)
+		{
+			matches = (emitterBodies[index] < bodyCount);
+		}
+		// SpawnBody has already worked out every saved body's period about a parent with mass
+		for (uint64_t index = 0; matches && index < checkpoint.RecordCount(SpawnedSection); ++index)
+		{
+			matches = (spawned[index].mParent < bodyCount) && (spawned[index].mElements.mPeriod > 0);
+		}
+		SimulationMode mode = matches ? static_cast<SimulationMode>(settings->mMode) : SimulationMode::Kinematic;
+		if (!matches || (mode == SimulationMode::NBody && gravityCount != bodyCount))
+		{
+			throw runtime_error("Checkpoint is inconsistent: " + path);
+		}
+
+		CelestialBodyData constantsData = RestoreBody(*constants, strings, stringSize);
+		vector<CelestialBodyData> data;
+		data.reserve(bodyCount);
+		vector<uint32_t> parents(bodyCount);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			data.push_back(RestoreBody(bodies[index], strings, stringSize));
+			parents[index] = bodies[index].mParent;
+		}
+		if (mode == SimulationMode::Playback)
+		{
+			bool ephemerisMatches = (mEphemeris != nullptr) && (mEphemeris->BodyCount() == bodyCount);
+			for (uint32_t index = 0; ephemerisMatches && index < bodyCount; ++index)
+			{
+				ephemerisMatches = (mEphemeris->BodyName(index) == data[index].mName);
+			}
+			if (!ephemerisMatches)
+			{
+				throw runtime_error("Playback needs an ephemeris of the checkpoint's catalog");
+			}
+		}
+
+		mConstants = constantsData;
+		InitializeBodies(move(data), parents);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			mStates.SetPhases(index, phases[index].mRotationPhase, phases[index].mOrbitalPhase);
+			if (phases[index].mFrozen != 0)
+			{
+				mStates.SetFrozen(index, true, phases[index].mFrozenTime);
+			}
+		}
+
+		mBelts.clear();
+		mBelts.resize(beltCount);
+		for (uint32_t index = 0; index < beltCount; ++index)
+		{
+			mBelts[index].Restore(belts[index].mParent, belts[index].mShape, checkpoint.Section<uint8_t>(BeltOrbitsSection + index),
+				checkpoint.RecordCount(BeltOrbitsSection + index));
+		}
+
+		mParticles = ParticleSystem();
+		mEmitterBodies.clear();
+		mEmitterRoots.clear();
+		for (uint32_t index = 0; index < emitterCount; ++index)
+		{
+			uint32_t root = emitterBodies[index];
+			while (Parent(root) != InvalidIndex)
+			{
+				root = Parent(root);
+			}
+			mParticles.AddEmitter(emitters[index]);
+			mEmitterBodies.push_back(emitterBodies[index]);
+			mEmitterRoots.push_back(root);
+		}
+		mParticles.SetCapacity(settings->mParticleCapacity);
+
+		// in dense order, so the bodies keep their places though not their handles
+		mSpawned.SetCapacity(SpawnCapacity);
+		for (uint64_t index = 0; index < checkpoint.RecordCount(SpawnedSection); ++index)
+		{
+			mSpawned.Spawn(spawned[index]);
+		}
+
+		InitializeGravitationalParameters();
+		mSpacecraft.SetCapacity(SpacecraftCapacity);
+		mSpacecraft.SetBodies(mStates, mGravitationalParameters, settings->mTime);
+		for (uint64_t index = 0; index < checkpoint.RecordCount(SpacecraftSection); ++index)
+		{
+			mSpacecraft.Restore(spacecraft[index]);
+		}
+
+		mMode = mode;
+		mIntegration = static_cast<IntegrationMethod>(settings->mIntegration);
+		mDynamicHierarchy = (settings->mDynamicHierarchy != 0);
+		mDominantParents.assign(dominantParents, dominantParents + bodyCount);
+		mReparentCursor = settings->mReparentCursor;
+		mReparentCount = settings->mReparentCount;
+		CreateIntegrator();
+		mGravitySolver->SetSoftening(settings->mSoftening);
+
+		mGravityState.Resize(gravityCount);
+		for (uint32_t index = 0; index < gravityCount; ++index)
+		{
+			const CheckpointGravity& body = gravity[index];
+			mGravityState.SetBody(index, XMFLOAT3(body.mPosition[0], body.mPosition[1], body.mPosition[2]), XMFLOAT3(body.mVelocity[0], body.mVelocity[1], body.mVelocity[2]),
+				body.mGravitationalParameter);
+			mGravityState.AccelerationX()[index] = body.mAcceleration[0];
+			mGravityState.AccelerationY()[index] = body.mAcceleration[1];
+			mGravityState.AccelerationZ()[index] = body.mAcceleration[2];
+		}
+		if (mMode == SimulationMode::NBody)
+		{
+			mIntegrator->RestoreState(mGravityState, integratorState, checkpoint.RecordCount(IntegratorSection));
+		}
+		mInitialEnergy = settings->mInitialEnergy;
+
+		// as in Seek, but the state comes from the file rather than the scripts
+		mTime = settings->mTime;
+		mPreviousTime = mTime;
+		mStates.Invalidate();
+		EvaluateKinematics();
+		if (mMode == SimulationMode::NBody)
+		{
+			mStates.SetPositions(mGravityState.PositionX(), mGravityState.PositionY(), mGravityState.PositionZ());
+		}
+		else if (mMode == SimulationMode::Playback)
+		{
+			EvaluatePlayback();
+		}
+		ResetPreviousPositions();
+		Interpolate(1.0f);
+	}
+
+	void BodySystem::SetThreadPool(const shared_ptr<ThreadPool>& threadPool)
+	{
+		mThreadPool = threadPool;
+		mGravitySolver->SetThreadPool(threadPool);
+	}
+
+	void BodySystem::Update(float elapsedSeconds)
+	{
+		mPreviousTime = mTime;
+		SavePreviousPositions();
+		if (mMode != SimulationMode::NBody)
+		{
+			mTime += elapsedSeconds;
+			EvaluateKinematics();
+			if (mMode == SimulationMode::Playback)
+			{
+				EvaluatePlayback();
+			}
+		}
+		else
+		{
+			// gravity only integrates forward, and the clock only moves with it so the scripted spin stays in step
+			if (elapsedSeconds > 0 && mPhysicsTimestep > 0)
+			{
+				double stepCount = ceil(elapsedSeconds / mPhysicsTimestep);
+				double timestep = elapsedSeconds / stepCount;
+				for (uint32_t step = 0; step < static_cast<uint32_t>(stepCount); ++step)
+				{
+					mIntegrator->Step(mGravityState, *mGravitySolver, timestep);
+				}
+				mTime += elapsedSeconds;
+			}
+
+			// spin and tilt stay scripted; only the translations come from the integration
+			EvaluateKinematics();
+			mStates.SetPositions(mGravityState.PositionX(), mGravityState.PositionY(), mGravityState.PositionZ());
+			if (mDynamicHierarchy)
+			{
+				UpdateDominantParents();
+			}
+		}
+
+		UpdateParticles(elapsedSeconds);
+		mSpawned.RemoveExpired(mTime);
+		AdvanceSpacecraft();
+	}
+
+	void BodySystem::Seek(double time)
+	{
+		mTime = time;
+		mPreviousTime = time;
+
+		// nothing can be extrapolated across a jump
+		mStates.Invalidate();
+		EvaluateKinematics();
+
+		// the scripted orbits put every body back under its catalog parent, and the integrator with it
+		if (ResetDominantParents())
+		{
+			CreateIntegrator();
+		}
+		if (mMode == SimulationMode::NBody)
+		{
+			ResetGravityState();
+		}
+		else if (mMode == SimulationMode::Playback)
+		{
+			EvaluatePlayback();
+		}
+
+		// nothing to blend across a jump, and particles do not follow their sources through it
+		ResetPreviousPositions();
+		mParticles.Clear();
+		mSpawned.RemoveExpired(mTime);
+		AdvanceSpacecraft();
+		Interpolate(1.0f);
+	}
+
+	double BodySystem::SimulationTime() const
+	{
+		return mTime;
+	}
+
+	void BodySystem::Interpolate(float alpha)
+	{
+		uint32_t bodyCount = BodyCount();
+		if (mRender.Count() != bodyCount)
+		{
+			mRender.Resize(bodyCount);
+		}
+		mRender.ClearChanged();
+		mInterpolatedCount = 0;
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			// a body that moved in an earlier Update still has to land on its final position once
+			bool moved = mStates.Changed(index);
+			if (!moved && mRenderStale[index] == 0)
+			{
+				continue;
+			}
+
+			WorldPosition position = mStates.PrecisePosition(index);
+			WorldPosition blended = { mPreviousX[index] + (position.mX - mPreviousX[index]) * alpha, mPreviousY[index] + (position.mY - mPreviousY[index]) * alpha, mPreviousZ[index] + (position.mZ - mPreviousZ[index]) * alpha };
+			mRender.Set(index, mStates.WorldTransform(index), blended);
+			mRenderStale[index] = moved ? 1 : 0;
+			++mInterpolatedCount;
+		}
+		mRender.Rebase();
+
+		mRenderTime = mPreviousTime + (mTime - mPreviousTime) * alpha;
+		for (auto& belt : mBelts)
+		{
+			if (mThreadPool != nullptr)
+			{
+				belt.Evaluate(mRenderTime, *mThreadPool);
+			}
+			else
+			{
+				belt.Evaluate(mRenderTime);
+			}
+		}
+
+		if (mThreadPool != nullptr)
+		{
+			mSpawned.Evaluate(mRenderTime, *mThreadPool);
+		}
+		else
+		{
+			mSpawned.Evaluate(mRenderTime);
+		}
+
+		if (mThreadPool != nullptr)
+		{
+			mSpacecraft.Evaluate(mRenderTime, *mThreadPool);
+		}
+		else
+		{
+			mSpacecraft.Evaluate(mRenderTime);
+		}
+	}
+
+	double BodySystem::RenderTime() const
+	{
+		return mRenderTime;
+	}
+
+	const XMFLOAT4X4& BodySystem::RenderTransform(uint32_t index) const
+	{
+		return mRender.Transform(index);
+	}
+
+	WorldPosition BodySystem::RenderPosition(uint32_t index) const
+	{
+		return mRender.Position(index);
+	}
+
+	bool BodySystem::RenderTransformChanged(uint32_t index) const
+	{
+		return mRender.Changed(index);
+	}
+
+	const WorldPosition& BodySystem::RenderOrigin() const
+	{
+		return mRender.Origin();
+	}
+
+	void BodySystem::SetRenderOrigin(const WorldPosition& origin)
+	{
+		mRender.SetOrigin(origin);
+	}
+
+	uint32_t BodySystem::UpdatedBodyCount() const
+	{
+		return mStates.UpdatedCount();
+	}
+
+	uint32_t BodySystem::InterpolatedBodyCount() const
+	{
+		return mInterpolatedCount;
+	}
+
+	uint32_t BodySystem::SolvedBodyCount() const
+	{
+		return mStates.ComposedCount();
+	}
+
+	uint32_t BodySystem::ExtrapolatedBodyCount() const
+	{
+		return mStates.ExtrapolatedCount();
+	}
+
+	void BodySystem::SetUpdateIntervals(const vector<uint32_t>& intervals)
+	{
+		mStates.SetUpdateIntervals(intervals);
+	}
+
+	void BodySystem::WriteSnapshot(BodySnapshot& snapshot) const
+	{
+		// assignments keep the snapshot's capacity, so a reused snapshot does not allocate
+		uint32_t bodyCount = BodyCount();
+		snapshot.mSimulationTime = mTime;
+		snapshot.mRenderTime = mRenderTime;
+		snapshot.mTransforms = mRender;
+		snapshot.mMode = mMode;
+		snapshot.mIntegration = mIntegration;
+		snapshot.mHasEphemeris = HasEphemeris();
+		snapshot.mPaused.resize(bodyCount);
+		snapshot.mUpdateIntervals.resize(bodyCount);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			snapshot.mPaused[index] = mStates.Frozen(index) ? 1 : 0;
+			snapshot.mUpdateIntervals[index] = mStates.UpdateInterval(index);
+		}
+		snapshot.mUpdatedCount = UpdatedBodyCount();
+		snapshot.mInterpolatedCount = mInterpolatedCount;
+		snapshot.mSolvedCount = SolvedBodyCount();
+		snapshot.mExtrapolatedCount = ExtrapolatedBodyCount();
+
+		snapshot.mBeltInstances.resize(mBelts.size());
+		for (size_t belt = 0; belt < mBelts.size(); ++belt)
+		{
+			snapshot.mBeltInstances[belt] = mBelts[belt].Instances();
+		}
+		snapshot.mSpawnedInstances = mSpawned.Instances();
+		snapshot.mSpawnedParents = mSpawned.Parents();
+		snapshot.mSpawnedDroppedCount = mSpawned.DroppedCount();
+		snapshot.mSpacecraftInstances = mSpacecraft.Instances();
+		snapshot.mSpacecraftParents = mSpacecraft.Parents();
+		snapshot.mSpacecraftTransitionCount = mSpacecraft.TransitionCount();
+		snapshot.mDynamicHierarchy = mDynamicHierarchy;
+		snapshot.mParents = mDominantParents;
+		snapshot.mReparentCount = mReparentCount;
+
+		snapshot.mParticleVertices.resize(mParticles.Count());
+		if (!snapshot.mParticleVertices.empty())
+		{
+			float rewindSeconds = static_cast<float>(mTime - mRenderTime);
+			if (mThreadPool != nullptr)
+			{
+				mParticles.WriteVertices(&snapshot.mParticleVertices[0], rewindSeconds, *mThreadPool);
+			}
+			else
+			{
+				mParticles.WriteVertices(&snapshot.mParticleVertices[0], rewindSeconds);
+			}
+		}
+	}
+
+	void BodySystem::SetPaused(uint32_t index, bool paused)
+	{
+		mStates.SetFrozen(index, paused, mTime);
+		for (uint32_t child : mChildren[index])
+		{
+			SetPaused(child, paused);
+		}
+	}
+
+	bool BodySystem::Paused(uint32_t index) const
+	{
+		return mStates.Frozen(index);
+	}
+
+	SimulationMode BodySystem::Mode() const
+	{
+		return mMode;
+	}
+
+	void BodySystem::SetMode(SimulationMode mode)
+	{
+		if (mode == SimulationMode::Playback && mEphemeris == nullptr)
+		{
+			throw runtime_error("Playback needs an ephemeris");
+		}
+		mMode = mode;
+		Seek(mTime);
+	}
+
+	IntegrationMethod BodySystem::Integration() const
+	{
+		return mIntegration;
+	}
+
+	void BodySystem::SetIntegration(IntegrationMethod integration)
+	{
+		mIntegration = integration;
+		CreateIntegrator();
+		Seek(mTime);
+	}
+
+	double BodySystem::PhysicsTimestep() const
+	{
+		return mPhysicsTimestep;
+	}
+
+	double BodySystem::Energy() const
+	{
+		return mGravityState.KineticEnergy() + mGravityState.PotentialEnergy(mGravitySolver->Softening());
+	}
+
+	double BodySystem::EnergyDrift() const
+	{
+		return (mInitialEnergy != 0) ? (Energy() - mInitialEnergy) / fabs(mInitialEnergy) : 0.0;
+	}
+
+	float BodySystem::GravitationalParameter(uint32_t index) const
+	{
+		return mGravitationalParameters[index];
+	}
+
+	const NBodyState& BodySystem::GravityState() const
+	{
+		return mGravityState;
+	}
+
+	GravitySolver& BodySystem::Solver()
+	{
+		return *mGravitySolver;
+	}
+
+	void BodySystem::SetSolver(unique_ptr<GravitySolver> solver)
+	{
+		if (solver == nullptr)
+		{
+			throw runtime_error("Gravity solver must not be null");
+		}
+
+		solver->SetThreadPool(mThreadPool);
+		solver->SetSoftening(mGravitySolver->Softening());
+		mGravitySolver = move(solver);
+		if (mMode == SimulationMode::NBody)
+		{
+			mIntegrator->Initialize(mGravityState, *mGravitySolver);
+		}
+	}
+
+	void BodySystem::SetEphemeris(const shared_ptr<const Ephemeris>& ephemeris)
+	{
+		if (ephemeris != nullptr)
+		{
+			bool matches = (ephemeris->BodyCount() == BodyCount());
+			for (uint32_t index = 0; matches && index < BodyCount(); ++index)
+			{
+				matches = (ephemeris->BodyName(index) == mData[index].mName);
+			}
+			if (!matches)
+			{
+				throw runtime_error("Ephemeris does not match the catalog");
+			}
+		}
+
+		mEphemeris = ephemeris;
+		if (mMode == SimulationMode::Playback)
+		{
+			SetMode((mEphemeris != nullptr) ? SimulationMode::Playback : SimulationMode::Kinematic);
+		}
+	}
+
+	bool BodySystem::HasEphemeris() const
+	{
+		return (mEphemeris != nullptr);
+	}
+
+	uint32_t BodySystem::BodyCount() const
+	{
+		return static_cast<uint32_t>(mData.size());
+	}
+
+	uint32_t BodySystem::FindBody(const string& name) const
+	{
+		for (uint32_t index = 0; index < mData.size(); ++index)
+		{
+			if (mData[index].mName == name)
+			{
+				return index;
+			}
+		}
+		return InvalidIndex;
+	}
+
+	const CelestialBodyData& BodySystem::Constants() const
+	{
+		return mConstants;
+	}
+
+	const CelestialBodyData& BodySystem::Data(uint32_t index) const
+	{
+		return mData[index];
+	}
+
+	uint32_t BodySystem::Parent(uint32_t index) const
+	{
+		return mStates.Parent(index);
+	}
+
+	const vector<uint32_t>& BodySystem::Children(uint32_t index) const
+	{
+		return mChildren[index];
+	}
+
+	void BodySystem::SetDynamicHierarchy(bool enabled)
+	{
+		mDynamicHierarchy = enabled;
+	}
+
+	bool BodySystem::DynamicHierarchy() const
+	{
+		return mDynamicHierarchy;
+	}
+
+	uint32_t BodySystem::DominantParent(uint32_t index) const
+	{
+		return mDominantParents[index];
+	}
+
+	const vector<uint32_t>& BodySystem::DominantParents() const
+	{
+		return mDominantParents;
+	}
+
+	uint64_t BodySystem::ReparentCount() const
+	{
+		return mReparentCount;
+	}
+
+	uint32_t BodySystem::LevelCount() const
+	{
+		return static_cast<uint32_t>(mLevelOffsets.size()) - 1;
+	}
+
+	uint32_t BodySystem::LevelBegin(uint32_t level) const
+	{
+		return mLevelOffsets[level];
+	}
+
+	uint32_t BodySystem::LevelEnd(uint32_t level) const
+	{
+		return mLevelOffsets[level + 1];
+	}
+
+	uint32_t BodySystem::BeltCount() const
+	{
+		return static_cast<uint32_t>(mBelts.size());
+	}
+
+	const AsteroidBelt& BodySystem::Belt(uint32_t index) const
+	{
+		return mBelts[index];
+	}
+
+	const ParticleSystem& BodySystem::Particles() const
+	{
+		return mParticles;
+	}
+
+	SlotHandle BodySystem::SpawnBody(const SpawnedBody& body)
+	{
+		if (body.mParent >= BodyCount())
+		{
+			throw runtime_error("Spawned body has no parent in the catalog");
+		}
+
+		if (body.mElements.mPeriod > 0)
+		{
+			return mSpawned.Spawn(body);
+		}
+
+		// Kepler's third law about the parent alone, as in the N-body seeding
+		double gravitationalParameter = mGravitationalParameters[body.mParent];
+		if (gravitationalParameter <= 0)
+		{
+			throw runtime_error("Spawned body orbits a parent without mass: " + mData[body.mParent].mName);
+		}
+		double semiMajorAxis = body.mElements.mSemiMajorAxis;
+		SpawnedBody orbiting = body;
+		orbiting.mElements.mPeriod = XM_2PI * sqrt(semiMajorAxis * semiMajorAxis * semiMajorAxis / gravitationalParameter);
+		return mSpawned.Spawn(orbiting);
+	}
+
+	bool BodySystem::DestroyBody(const SlotHandle& handle)
+	{
+		return mSpawned.Destroy(handle);
+	}
+
+	void BodySystem::ClearSpawnedBodies()
+	{
+		mSpawned.Clear();
+	}
+
+	const SpawnedBodies& BodySystem::Spawned() const
+	{
+		return mSpawned;
+	}
+
+	SlotHandle BodySystem::LaunchSpacecraft(const Spacecraft& spacecraft)
+	{
+		return mSpacecraft.Launch(spacecraft, mStates);
+	}
+
+	bool BodySystem::DestroySpacecraft(const SlotHandle& handle)
+	{
+		return mSpacecraft.Destroy(handle);
+	}
+
+	void BodySystem::ClearSpacecraft()
+	{
+		mSpacecraft.Clear();
+	}
+
+	const SpacecraftFleet& BodySystem::Fleet() const
+	{
+		return mSpacecraft;
+	}
+
+	void BodySystem::SetParticlesEnabled(bool enabled)
+	{
+		for (uint32_t index = 0; index < mParticles.EmitterCount(); ++index)
+		{
+			mParticles.Emitter(index).mEnabled = enabled;
+		}
+	}
+
+	const XMFLOAT4X4& BodySystem::WorldTransform(uint32_t index) const
+	{
+		return mStates.WorldTransform(index);
+	}
+
+	const XMFLOAT4& BodySystem::Position(uint32_t index) const
+	{
+		return mStates.Position(index);
+	}
+
+	float BodySystem::SemiMajorAxis(uint32_t index) const
+	{
+		return mStates.SemiMajorAxis(index);
+	}
+
+	double BodySystem::OrbitalPeriod(uint32_t index) const
+	{
+		if (mMode == SimulationMode::NBody)
+		{
+			return mOrbitalPeriods[index];
+		}
+
+		double frequency = mStates.OrbitalFrequency(index);
+		return (Parent(index) != InvalidIndex && frequency != 0) ? fabs(1.0 / frequency) : 0.0;
+	}
+
+	float BodySystem::Eccentricity(uint32_t index) const
+	{
+		return mStates.Eccentricity(index);
+	}
+
+	XMFLOAT4X4 BodySystem::OrbitOrientation(uint32_t index) const
+	{
+		return mStates.OrbitOrientation(index);
+	}
+
+	const BodyStateStore& BodySystem::States() const
+	{
+		return mStates;
+	}
+
+	XMFLOAT4X4 BodySystem::WorldTransformAt(uint32_t index, double time) const
+	{
+		XMFLOAT4X4 transform;
+		XMStoreFloat4x4(&transform, mStates.EvaluateWorldTransform(index, time));
+		return transform;
+	}
+
+	void BodySystem::EvaluateKinematics()
+	{
+		if (mThreadPool != nullptr)
+		{
+			mStates.Evaluate(mTime, *mThreadPool, mLevelOffsets);
+		}
+		else
+		{
+			mStates.Evaluate(mTime);
+		}
+	}
+
+	void BodySystem::SavePreviousPositions()
+	{
+		// a body the last evaluation left alone already has its current position saved
+		uint32_t bodyCount = BodyCount();
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			if (mStates.Changed(index))
+			{
+				WorldPosition position = mStates.PrecisePosition(index);
+				mPreviousX[index] = position.mX;
+				mPreviousY[index] = position.mY;
+				mPreviousZ[index] = position.mZ;
+				mRenderStale[index] = 1;
+			}
+		}
+	}
+
+	void BodySystem::ResetPreviousPositions()
+	{
+		uint32_t bodyCount = BodyCount();
+		mPreviousX.resize(bodyCount);
+		mPreviousY.resize(bodyCount);
+		mPreviousZ.resize(bodyCount);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			WorldPosition position = mStates.PrecisePosition(index);
+			mPreviousX[index] = position.mX;
+			mPreviousY[index] = position.mY;
+			mPreviousZ[index] = position.mZ;
+		}
+		mRenderStale.assign(bodyCount, 1);
+	}
+
+	void BodySystem::EvaluatePlayback()
+	{
+		uint32_t bodyCount = BodyCount();
+		mPlaybackX.resize(bodyCount);
+		mPlaybackY.resize(bodyCount);
+		mPlaybackZ.resize(bodyCount);
+		mEphemeris->Evaluate(mTime, mPlaybackX.data(), mPlaybackY.data(), mPlaybackZ.data());
+		mStates.SetPositions(mPlaybackX.data(), mPlaybackY.data(), mPlaybackZ.data());
+	}
+
+	void BodySystem::InitializeBelts(const ConfigData& configData)
+	{
+		const auto& belts = configData.GetBeltData();
+		mBelts.clear();
+		mBelts.resize(belts.size());
+		for (size_t index = 0; index < belts.size(); ++index)
+		{
+			const BeltData& data = belts[index];
+			uint32_t parent = FindBody(data.mParent);
+			if (parent == InvalidIndex)
+			{
+				throw runtime_error("Unknown parent body: " + data.mParent);
+			}
+
+			// distances are measured from the outer edge of the parent, as for the bodies
+			float parentOffset = (mData[parent].mDiameter / 2) * 20;
+			BeltShape shape;
+			shape.mInnerRadius = mConstants.mMeanDistance * data.mInnerDistance + parentOffset;
+			shape.mOuterRadius = mConstants.mMeanDistance * data.mOuterDistance + parentOffset;
+			shape.mInnerPeriod = static_cast<double>(mConstants.mOrbitalPeriod) * data.mOrbitalPeriod;
+			shape.mMinDiameter = mConstants.mDiameter * data.mMinDiameter;
+			shape.mMaxDiameter = mConstants.mDiameter * data.mMaxDiameter;
+			shape.mSizeExponent = data.mSizeExponent;
+			shape.mMaxEccentricity = data.mMaxEccentricity;
+			shape.mMaxInclination = XMConvertToRadians(data.mMaxInclination);
+			shape.mCount = data.mCount;
+			shape.mSeed = data.mSeed;
+			shape.mQuantized = data.mQuantized;
+
+			if (mThreadPool != nullptr)
+			{
+				mBelts[index].Generate(parent, shape, *mThreadPool);
+				mBelts[index].Evaluate(mTime, *mThreadPool);
+			}
+			else
+			{
+				mBelts[index].Generate(parent, shape);
+				mBelts[index].Evaluate(mTime);
+			}
+		}
+	}
+
+	void BodySystem::InitializeEmitters(const ConfigData& configData)
+	{
+		const auto& emitters = configData.GetEmitterData();
+		mParticles = ParticleSystem();
+		mEmitterBodies.clear();
+		mEmitterRoots.clear();
+
+		// room for every particle alive at once at the longest lifetimes, and a step's worth of emission on top
+		double capacity = 0;
+		for (const auto& data : emitters)
+		{
+			uint32_t body = FindBody(data.mParent);
+			if (body == InvalidIndex)
+			{
+				throw runtime_error("Unknown parent body: " + data.mParent);
+			}
+
+			uint32_t root = body;
+			while (Parent(root) != InvalidIndex)
+			{
+				root = Parent(root);
+			}
+
+			ParticleEmitter emitter;
+			emitter.mPosition = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			emitter.mVelocity = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			emitter.mDirection = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			if (data.mStyle == "Wind")
+			{
+				emitter.mRadius = mConstants.mDiameter * mData[body].mDiameter / 2;
+				emitter.mSpread = XM_PI;
+			}
+			else
+			{
+				emitter.mRadius = 0.0f;
+				emitter.mSpread = XMConvertToRadians(data.mSpread);
+			}
+			emitter.mRate = data.mRate;
+			emitter.mLifetime = data.mLifetime;
+			emitter.mLifetimeVariation = data.mLifetimeVariation;
+			emitter.mSpeed = mConstants.mDiameter * data.mSpeed;
+			emitter.mSpeedVariation = data.mSpeedVariation;
+			emitter.mSize = mConstants.mDiameter * data.mSize;
+			emitter.mGrowth = data.mGrowth;
+			emitter.mColor = XMFLOAT4(data.mColor[0], data.mColor[1], data.mColor[2], data.mColor[3]);
+			emitter.mSeed = data.mSeed;
+			emitter.mEnabled = true;
+			mParticles.AddEmitter(emitter);
+			mEmitterBodies.push_back(body);
+			mEmitterRoots.push_back(root);
+
+			capacity += data.mRate * data.mLifetime * (1.0 + data.mLifetimeVariation) + ParticleSystem::EmissionChunkSize;
+		}
+		mParticles.SetCapacity(static_cast<uint32_t>(min(capacity, static_cast<double>(numeric_limits<uint32_t>::max()))));
+	}
+
+	void BodySystem::UpdateParticles(float elapsedSeconds)
+	{
+		if (mParticles.EmitterCount() == 0)
+		{
+			return;
+		}
+
+		for (uint32_t index = 0; index < mParticles.EmitterCount(); ++index)
+		{
+			ParticleEmitter& emitter = mParticles.Emitter(index);
+			uint32_t body = mEmitterBodies[index];
+			XMVECTOR position = XMLoadFloat4(&mStates.Position(body));
+			XMStoreFloat3(&emitter.mPosition, position);
+
+			// particles inherit the motion of their source over the step
+			XMVECTOR velocity = XMVectorZero();
+			if (elapsedSeconds > 0)
+			{
+				// differenced in double so the step is not lost in the size of the position
+				WorldPosition current = mStates.PrecisePosition(body);
+				XMVECTOR displacement = XMVectorSet(static_cast<float>(current.mX - mPreviousX[body]), static_cast<float>(current.mY - mPreviousY[body]), static_cast<float>(current.mZ - mPreviousZ[body]), 0.0f);
+				velocity = XMVectorScale(displacement, 1.0f / elapsedSeconds);
+			}
+			XMStoreFloat3(&emitter.mVelocity, velocity);
+
+			// tails stream away from the root, and a root itself sprays in every direction
+			XMVECTOR away = XMVectorSubtract(position, XMLoadFloat4(&mStates.Position(mEmitterRoots[index])));
+			XMStoreFloat3(&emitter.mDirection, (body == mEmitterRoots[index]) ? XMVectorZero() : XMVector3Normalize(away));
+		}
+
+		if (mThreadPool != nullptr)
+		{
+			mParticles.Update(elapsedSeconds, *mThreadPool);
+		}
+		else
+		{
+			mParticles.Update(elapsedSeconds);
+		}
+	}
+
+	void BodySystem::AdvanceSpacecraft()
+	{
+		if (mThreadPool != nullptr)
+		{
+			mSpacecraft.Advance(mTime, mStates, *mThreadPool);
+		}
+		else
+		{
+			mSpacecraft.Advance(mTime, mStates);
+		}
+	}
+
+	void BodySystem::InitializeGravitationalParameters()
+	{
+		uint32_t bodyCount = BodyCount();
+		mGravitationalParameters.assign(bodyCount, 0.0f);
+		mGravitySemiMajorAxes.assign(bodyCount, 0.0);
+
+		// parents precede children, so every parent's parameter and orbit are final before its children are visited
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			// the catalog's distances are not to scale, and measuring them from the parent's surface crowds satellites
+			// into a thin shell, so under gravity they are spread by Kepler's third law on their catalog periods from the
+			// fastest one, which keeps its scripted orbit
+			uint32_t fastest = InvalidIndex;
+			for (uint32_t child : mChildren[index])
+			{
+				mGravitySemiMajorAxes[child] = mStates.SemiMajorAxis(child);
+				double frequency = fabs(mStates.OrbitalFrequency(child));
+				if (frequency > 0 && (fastest == InvalidIndex || frequency > fabs(mStates.OrbitalFrequency(fastest))))
+				{
+					fastest = child;
+				}
+			}
+
+			double outermost = 0;
+			for (uint32_t child : mChildren[index])
+			{
+				double frequency = fabs(mStates.OrbitalFrequency(child));
+				if (frequency > 0)
+				{
+					mGravitySemiMajorAxes[child] = mStates.SemiMajorAxis(fastest) * pow(fabs(mStates.OrbitalFrequency(fastest)) / frequency, 2.0 / 3.0);
+				}
+				outermost = max(outermost, mGravitySemiMajorAxes[child]);
+			}
+
+			uint32_t parent = Parent(index);
+			if (parent == InvalidIndex)
+			{
+				// Kepler's third law on the fastest scripted orbit, which the spread keeps every other orbit consistent with
+				if (fastest != InvalidIndex)
+				{
+					double semiMajorAxis = mStates.SemiMajorAxis(fastest);
+					double meanMotion = XM_2PI * mStates.OrbitalFrequency(fastest);
+					mGravitationalParameters[index] = static_cast<float>(meanMotion * meanMotion * semiMajorAxis * semiMajorAxis * semiMajorAxis);
+				}
+				continue;
+			}
+
+			double parameter = 0;
+			if (mData[parent].mDiameter > 0)
+			{
+				double diameterRatio = static_cast<double>(mData[index].mDiameter) / mData[parent].mDiameter;
+				parameter = mGravitationalParameters[parent] * diameterRatio * diameterRatio * diameterRatio;
+			}
+
+			// heavy enough to keep every satellite within HillSphereFraction of the Hill radius a (GM / 3 GM_parent)^(1/3)
+			double semiMajorAxis = mGravitySemiMajorAxes[index];
+			if (outermost > 0 && semiMajorAxis > 0)
+			{
+				double ratio = outermost / (HillSphereFraction * semiMajorAxis);
+				parameter = max(parameter, 3.0 * mGravitationalParameters[parent] * ratio * ratio * ratio);
+			}
+
+			// but light enough to stay MutualHillSpacing mutual Hill radii (a1 + a2) / 2 ((m1 + m2) / 3 M)^(1/3) clear of
+			// every sibling whose orbit it does not cross, taking half of each pair's mass; crossing orbits are left to
+			// their phases, as no mass keeps them apart
+			double eccentricity = mData[index].mEccentricity;
+			for (uint32_t sibling : mChildren[parent])
+			{
+				double siblingAxis = mGravitySemiMajorAxes[sibling];
+				double siblingEccentricity = mData[sibling].mEccentricity;
+				bool inside = (siblingAxis < semiMajorAxis);
+				double innerApoapsis = inside ? siblingAxis * (1.0 + siblingEccentricity) : semiMajorAxis * (1.0 + eccentricity);
+				double outerPeriapsis = inside ? semiMajorAxis * (1.0 - eccentricity) : siblingAxis * (1.0 - siblingEccentricity);
+				double gap = outerPeriapsis - innerApoapsis;
+				if (sibling != index && gap > 0)
+				{
+					double ratio = 2.0 * gap / (MutualHillSpacing * (innerApoapsis + outerPeriapsis));
+					parameter = min(parameter, 1.5 * mGravitationalParameters[parent] * ratio * ratio * ratio);
+				}
+			}
+			mGravitationalParameters[index] = static_cast<float>(parameter);
+
+			// satellites the capped mass cannot hold are drawn in together, keeping their spacing
+			if (outermost > 0 && semiMajorAxis > 0 && parameter > 0)
+			{
+				double hillRadius = semiMajorAxis * cbrt(parameter / (3.0 * mGravitationalParameters[parent]));
+				double scale = HillSphereFraction * hillRadius / outermost;
+				for (uint32_t child : mChildren[index])
+				{
+					mGravitySemiMajorAxes[child] *= min(scale, 1.0);
+				}
+			}
+		}
+
+		// resolve the fastest orbit the gravity actually produces
+		double shortestPeriod = 0;
+		mOrbitalPeriods.assign(bodyCount, 0.0);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			uint32_t parent = Parent(index);
+			if (parent != InvalidIndex && mGravitationalParameters[parent] > 0)
+			{
+				double semiMajorAxis = mGravitySemiMajorAxes[index];
+				double pairParameter = static_cast<double>(mGravitationalParameters[parent]) + mGravitationalParameters[index];
+				double period = XM_2PI * sqrt(semiMajorAxis * semiMajorAxis * semiMajorAxis / pairParameter);
+				mOrbitalPeriods[index] = period;
+				shortestPeriod = (shortestPeriod == 0) ? period : min(shortestPeriod, period);
+			}
+		}
+		mShortestPeriod = shortestPeriod;
+	}
+
+	void BodySystem::ResetGravityState()
+	{
+		uint32_t bodyCount = BodyCount();
+		mGravityState.Resize(bodyCount);
+
+		vector<XMFLOAT3> positions(bodyCount, XMFLOAT3(0.0f, 0.0f, 0.0f));
+		vector<XMFLOAT3> velocities(bodyCount, XMFLOAT3(0.0f, 0.0f, 0.0f));
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			XMVECTOR position = XMLoadFloat4(&mStates.Position(index));
+			XMVECTOR velocity = XMVectorZero();
+			uint32_t parent = Parent(index);
+			double meanMotion = XM_2PI * mStates.OrbitalFrequency(index);
+			if (parent != InvalidIndex && meanMotion != 0)
+			{
+				// keep the scripted ellipse's shape and direction, scaled out to the spread orbit, but move at the speed
+				// the pair's gravity supports there; a heavy moon like Charon pulls its parent around in turn
+				double semiMajorAxis = mStates.SemiMajorAxis(index);
+				double scale = mGravitySemiMajorAxes[index] / semiMajorAxis;
+				double scriptedParameter = meanMotion * meanMotion * semiMajorAxis * semiMajorAxis * semiMajorAxis;
+				double pairParameter = static_cast<double>(mGravitationalParameters[parent]) + mGravitationalParameters[index];
+				float speedScale = static_cast<float>(sqrt(pairParameter / (scriptedParameter * scale)));
+				position = XMVectorScale(mStates.EvaluateLocalPosition(index, mTime), static_cast<float>(scale));
+				velocity = XMVectorScale(mStates.EvaluateLocalVelocity(index, mTime), speedScale);
+			}
+			else if (parent != InvalidIndex)
+			{
+				position = mStates.EvaluateLocalPosition(index, mTime);
+			}
+			if (parent != InvalidIndex)
+			{
+				position = XMVectorAdd(position, XMLoadFloat3(&positions[parent]));
+				velocity = XMVectorAdd(velocity, XMLoadFloat3(&velocities[parent]));
+			}
+			XMStoreFloat3(&positions[index], position);
+			XMStoreFloat3(&velocities[index], velocity);
+
+			mGravityState.SetBody(index, positions[index], velocities[index], mGravitationalParameters[index]);
+		}
+
+		mGravityState.RemoveNetMomentum();
+		mIntegrator->Initialize(mGravityState, *mGravitySolver);
+		mInitialEnergy = Energy();
+		mStates.SetPositions(mGravityState.PositionX(), mGravityState.PositionY(), mGravityState.PositionZ());
+	}
+
+	void BodySystem::CreateIntegrator()
+	{
+		if (mIntegration == IntegrationMethod::WisdomHolman)
+		{
+			// the hierarchy the bodies are in now, so a restored checkpoint picks the dynamic one up where it was
+			mIntegrator = make_unique<WisdomHolmanIntegrator>(mDominantParents);
+			mPhysicsTimestep = mShortestPeriod / WisdomHolmanStepsPerOrbit;
+		}
+		else if (mIntegration == IntegrationMethod::BlockTimestep && mShortestPeriod > 0)
+		{
+			// a parent swings around the barycentre with its satellites, so it follows its fastest one; children come
+			// after their parents, so a reverse sweep carries the shortest period up the hierarchy
+			vector<double> periods(mOrbitalPeriods);
+			double longestPeriod = 0;
+			for (uint32_t index = BodyCount(); index > 0; --index)
+			{
+				uint32_t parent = Parent(index - 1);
+				double period = periods[index - 1];
+				if (parent != InvalidIndex && period > 0)
+				{
+					periods[parent] = (periods[parent] > 0) ? min(periods[parent], period) : period;
+				}
+				longestPeriod = max(longestPeriod, period);
+			}
+
+			vector<double> preferredTimesteps(BodyCount());
+			for (uint32_t index = 0; index < BodyCount(); ++index)
+			{
+				preferredTimesteps[index] = ((periods[index] > 0) ? periods[index] : longestPeriod) / PhysicsStepsPerOrbit;
+			}
+			mIntegrator = make_unique<BlockTimestepIntegrator>(preferredTimesteps);
+			mPhysicsTimestep = min(longestPeriod, mShortestPeriod * (1u << BlockTimestepIntegrator::MaxLevel)) / PhysicsStepsPerOrbit;
+		}
+		else
+		{
+			mIntegrator = make_unique<LeapfrogIntegrator>();
+			mPhysicsTimestep = mShortestPeriod / PhysicsStepsPerOrbit;
+		}
+	}
+
+	bool BodySystem::ResetDominantParents()
+	{
+		bool changed = false;
+		mDominantParents.resize(BodyCount());
+		for (uint32_t index = 0; index < BodyCount(); ++index)
+		{
+			if (mDominantParents[index] != Parent(index))
+			{
+				mDominantParents[index] = Parent(index);
+				++mReparentCount;
+				changed = true;
+			}
+		}
+		mReparentCursor = 0;
+		return changed;
+	}
+
+	void BodySystem::UpdateDominantParents()
+	{
+		// the spheres move with the bodies, so they are indexed afresh for every slice
+		uint32_t bodyCount = BodyCount();
+		mHillSpheres.Build(mGravityState, mDominantParents, mShortestPeriod);
+		uint32_t sliceSize = (bodyCount + ReparentInterval - 1) / ReparentInterval;
+		uint32_t end = min(bodyCount, mReparentCursor + sliceSize);
+		for (uint32_t index = mReparentCursor; index < end; ++index)
+		{
+			uint32_t parent = mHillSpheres.FindParent(index, mDominantParents);
+			if (parent != mDominantParents[index])
+			{
+				mIntegrator->Reparent(index, parent, mGravityState);
+				mDominantParents[index] = parent;
+				++mReparentCount;
+			}
+		}
+		mReparentCursor = (end < bodyCount) ? end : 0;
+	}
+}
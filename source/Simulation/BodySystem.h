@@ -0,0 +1,261 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CeledtialBodyData.h"
+#include "BodyStateStore.h"
+#include "AsteroidBelt.h"
+#include "ParticleSystem.h"
+#include "SpawnedBodies.h"
+#include "SpacecraftFleet.h"
+#include "HillSphereIndex.h"
+#include "NBodyState.h"
+#include "GravitySolver.h"
+#include "Integrator.h"
+#include "RenderTransforms.h"
+#include "BodySnapshot.h"
+
+namespace Simulation
+{
+	class ConfigData;
+	class ThreadPool;
+	class Ephemeris;
+
+	enum class SimulationMode
+	{
+		// Scripted orbits evaluated from the absolute simulation time.
+		Kinematic,
+		// Mutual gravity, started from the scripted orbits. The catalog has no masses, so a root gets 4 pi^2 a^3 / P^2
+		// of its fastest child's orbit and every other body its parent's scaled by the cube of their diameter ratio,
+		// raised where its satellites would leave its Hill sphere and capped MutualHillSpacing mutual Hill radii clear of
+		// its neighbours. Each parent's satellites are spread by Kepler's third law on their catalog periods, as the
+		// catalog's distances would not survive gravity; the belts and SemiMajorAxis() keep the scripted distances.
+		NBody,
+		// Positions replayed from the Ephemeris given to SetEphemeris; spin and tilt stay scripted.
+		Playback
+	};
+
+	enum class IntegrationMethod
+	{
+		// PhysicsStepsPerOrbit steps of the shortest orbit.
+		Leapfrog,
+		// Integrates each orbit about its parent exactly and only kicks the perturbations, so WisdomHolmanStepsPerOrbit
+		// steps of the shortest orbit are enough.
+		WisdomHolman,
+		// The leapfrog with PhysicsStepsPerOrbit steps of each body's own orbit, or of its fastest satellite's, so at
+		// high time warp only the moon systems are substepped.
+		BlockTimestep
+	};
+
+	// Render independent state of every body in a ConfigData catalog. Owns the orbital math that used to live in
+	// Rendering::CelestialBody so that it can be stepped without a Direct3D device.
+	//
+	// Bodies are indexed breadth first from the roots (ties broken by ordinal), so every parent has a lower index than
+	// its children, and level L is the contiguous range [LevelBegin(L), LevelEnd(L)) that a thread pool sweeps in
+	// parallel. Only bodies that moved cost anything per frame.
+	class BodySystem final
+	{
+	public:
+		BodySystem();
+		BodySystem(const BodySystem&) = delete;
+		BodySystem& operator=(const BodySystem&) = delete;
+		BodySystem(BodySystem&&) = default;
+		BodySystem& operator=(BodySystem&&) = default;
+		~BodySystem() = default;
+
+		// Generates the catalog's belts over the thread pool, if one is already attached.
+		void Initialize(const ConfigData& configData);
+		// The file holds everything but what Seek drops anyway: the particles, the blend between the last two Updates
+		// and the update intervals. Restoring replaces Initialize and the Seek after it, copies each big array out of the
+		// mapped file in one pass and computes no forces, so the run steps on to the same bits. It keeps the thread
+		// pool, solver and ephemeris already attached, and refuses a file with other record layouts before changing
+		// anything.
+		void SaveCheckpoint(const std::string& path) const;
+		void RestoreCheckpoint(const std::string& path);
+		void SetThreadPool(const std::shared_ptr<ThreadPool>& threadPool);
+
+		// In N-body mode gravity only integrates forward, in substeps of at most PhysicsTimestep(), so a non-positive
+		// step leaves the clock where it is; use Seek to go back. Steps the particles and the spacecraft, and drops
+		// spawned bodies that expired.
+		void Update(float elapsedSeconds);
+		// Costs the same as one Update however far it jumps. Restarts gravity from the scripted orbits at that time, with
+		// every body back under its catalog parent, and clears the particles.
+		void Seek(double time);
+		double SimulationTime() const;
+
+		// Blends the translations of the last two Updates into RenderTransform, alpha = 0 being the earlier one, so a
+		// renderer can draw between fixed simulation steps. Rotations are those of the last Update. The belts, spawned
+		// bodies and spacecraft are evaluated at the blended time rather than stepped.
+		void Interpolate(float alpha);
+		// Simulation time the last Interpolate blended to.
+		double RenderTime() const;
+		// Translation relative to RenderOrigin.
+		const DirectX::XMFLOAT4X4& RenderTransform(std::uint32_t index) const;
+		// World position the last Interpolate blended to.
+		WorldPosition RenderPosition(std::uint32_t index) const;
+		// Whether the last Interpolate or SetRenderOrigin rewrote the body's render transform.
+		bool RenderTransformChanged(std::uint32_t index) const;
+		// A renderer moves the origin to its camera every frame, so what is drawn near it has small float coordinates.
+		// The particles stay in world floats and are drawn shifted by the origin.
+		const WorldPosition& RenderOrigin() const;
+		void SetRenderOrigin(const WorldPosition& origin);
+		// Bodies the last Update and Interpolate touched; BodyStateStore skips bodies without a rate and paused subtrees.
+		std::uint32_t UpdatedBodyCount() const;
+		std::uint32_t InterpolatedBodyCount() const;
+		// Orbits the last Update solved and extrapolated.
+		std::uint32_t SolvedBodyCount() const;
+		std::uint32_t ExtrapolatedBodyCount() const;
+		// See BodyStateStore::SetUpdateIntervals and DetailScheduler. Seek always solves every body.
+		void SetUpdateIntervals(const std::vector<std::uint32_t>& intervals);
+		// Copies what a renderer reads after Interpolate, for a SimulationThread to hand to the render thread. Rewinds the
+		// particles to RenderTime over the thread pool, if there is one.
+		void WriteSnapshot(BodySnapshot& snapshot) const;
+
+		// Stops the scripted spin and orbit of a body and its whole subtree where they are, and resumes them from there.
+		// The subtree still follows the translation of an unpaused ancestor. N-body integration ignores pausing.
+		void SetPaused(std::uint32_t index, bool paused);
+		bool Paused(std::uint32_t index) const;
+
+		SimulationMode Mode() const;
+		void SetMode(SimulationMode mode);
+		IntegrationMethod Integration() const;
+		void SetIntegration(IntegrationMethod integration);
+		double PhysicsTimestep() const;
+
+		// Total energy of the gravity state in units of G, and its change relative to the last Seek or SetMode.
+		double Energy() const;
+		double EnergyDrift() const;
+		float GravitationalParameter(std::uint32_t index) const;
+		const NBodyState& GravityState() const;
+		// DirectSummation unless SetSolver swaps in another, which inherits the thread pool and softening.
+		GravitySolver& Solver();
+		void SetSolver(std::unique_ptr<GravitySolver> solver);
+		// The ephemeris must list the catalog's bodies in index order.
+		void SetEphemeris(const std::shared_ptr<const Ephemeris>& ephemeris);
+		bool HasEphemeris() const;
+
+		std::uint32_t BodyCount() const;
+		std::uint32_t FindBody(const std::string& name) const;
+		const CelestialBodyData& Constants() const;
+		const CelestialBodyData& Data(std::uint32_t index) const;
+		std::uint32_t Parent(std::uint32_t index) const;
+		const std::vector<std::uint32_t>& Children(std::uint32_t index) const;
+		// Lets N-body mode move a body under whichever body's Hill sphere holds it most tightly, for captures and
+		// ejections, into orbits no shorter than the shortest catalog orbit. Every Update checks 1 / ReparentInterval of
+		// the bodies against a HillSphereIndex, and the integrator rebases a body that moved where it is. Turning it off
+		// keeps the dominant parents as they are until the next Seek.
+		void SetDynamicHierarchy(bool enabled);
+		bool DynamicHierarchy() const;
+		// Parent() unless the dynamic hierarchy moved the body since the last Seek.
+		std::uint32_t DominantParent(std::uint32_t index) const;
+		const std::vector<std::uint32_t>& DominantParents() const;
+		// Parent changes since Initialize, including the returns to the catalog parents on Seek.
+		std::uint64_t ReparentCount() const;
+		std::uint32_t LevelCount() const;
+		std::uint32_t LevelBegin(std::uint32_t level) const;
+		std::uint32_t LevelEnd(std::uint32_t level) const;
+		std::uint32_t BeltCount() const;
+		const AsteroidBelt& Belt(std::uint32_t index) const;
+		// Fed by the catalog's emitters, which move with their bodies. Not closed form, so every Update steps them, and a
+		// renderer draws them at RenderTime by rewinding them SimulationTime() - RenderTime().
+		const ParticleSystem& Particles() const;
+		void SetParticlesEnabled(bool enabled);
+		// Up to SpawnCapacity comets, probes or debris on fixed orbits about catalog bodies, which never change after
+		// Initialize. A period of zero is derived from the parent's gravitational parameter. The handle is zeroed if the
+		// body did not fit.
+		SlotHandle SpawnBody(const SpawnedBody& body);
+		bool DestroyBody(const SlotHandle& handle);
+		void ClearSpawnedBodies();
+		const SpawnedBodies& Spawned() const;
+		// See SpacecraftFleet::Launch; the state is taken at SimulationTime(). The spheres of influence follow the
+		// scripted orbits, so the fleet is only exact in SimulationMode::Kinematic.
+		SlotHandle LaunchSpacecraft(const Spacecraft& spacecraft);
+		bool DestroySpacecraft(const SlotHandle& handle);
+		void ClearSpacecraft();
+		const SpacecraftFleet& Fleet() const;
+
+		const DirectX::XMFLOAT4X4& WorldTransform(std::uint32_t index) const;
+		const DirectX::XMFLOAT4& Position(std::uint32_t index) const;
+		float SemiMajorAxis(std::uint32_t index) const;
+		// Period of the orbit about the parent: derived from the gravitational parameters in NBody mode, scripted
+		// otherwise. Zero for roots.
+		double OrbitalPeriod(std::uint32_t index) const;
+		float Eccentricity(std::uint32_t index) const;
+		DirectX::XMFLOAT4X4 OrbitOrientation(std::uint32_t index) const;
+		const BodyStateStore& States() const;
+
+		DirectX::XMFLOAT4X4 WorldTransformAt(std::uint32_t index, double time) const;
+
+		static const std::uint32_t InvalidIndex;
+		static const std::uint32_t PhysicsStepsPerOrbit;
+		static const std::uint32_t WisdomHolmanStepsPerOrbit;
+		static const double HillSphereFraction;
+		static const double MutualHillSpacing;
+		static const std::uint32_t SpawnCapacity;
+		static const std::uint32_t SpacecraftCapacity;
+		static const std::uint32_t ReparentInterval;
+
+	private:
+		void EvaluateKinematics();
+		void SavePreviousPositions();
+		void ResetPreviousPositions();
+		void EvaluatePlayback();
+		void InitializeBodies(std::vector<CelestialBodyData> bodies, const std::vector<std::uint32_t>& parents);
+		void InitializeBelts(const ConfigData& configData);
+		void InitializeEmitters(const ConfigData& configData);
+		void UpdateParticles(float elapsedSeconds);
+		void AdvanceSpacecraft();
+		void InitializeGravitationalParameters();
+		void ResetGravityState();
+		void CreateIntegrator();
+		bool ResetDominantParents();
+		void UpdateDominantParents();
+
+		CelestialBodyData mConstants;
+		std::vector<CelestialBodyData> mData;
+		std::vector<std::vector<std::uint32_t>> mChildren;
+		std::vector<std::uint32_t> mLevelOffsets;
+		std::shared_ptr<ThreadPool> mThreadPool;
+		BodyStateStore mStates;
+		double mTime;
+		double mPreviousTime;
+		double mRenderTime;
+		std::vector<double> mPreviousX;
+		std::vector<double> mPreviousY;
+		std::vector<double> mPreviousZ;
+		RenderTransforms mRender;
+		std::vector<std::uint8_t> mRenderStale;
+		std::uint32_t mInterpolatedCount;
+		std::vector<AsteroidBelt> mBelts;
+		ParticleSystem mParticles;
+		std::vector<std::uint32_t> mEmitterBodies;
+		std::vector<std::uint32_t> mEmitterRoots;
+		SpawnedBodies mSpawned;
+		SpacecraftFleet mSpacecraft;
+
+		SimulationMode mMode;
+		std::vector<float> mGravitationalParameters;
+		IntegrationMethod mIntegration;
+		std::vector<double> mOrbitalPeriods;
+		std::vector<double> mGravitySemiMajorAxes;
+		double mShortestPeriod;
+		double mPhysicsTimestep;
+		double mInitialEnergy;
+		NBodyState mGravityState;
+		std::unique_ptr<GravitySolver> mGravitySolver;
+		std::unique_ptr<Integrator> mIntegrator;
+		bool mDynamicHierarchy;
+		std::vector<std::uint32_t> mDominantParents;
+		HillSphereIndex mHillSpheres;
+		std::uint32_t mReparentCursor;
+		std::uint64_t mReparentCount;
+
+		std::shared_ptr<const Ephemeris> mEphemeris;
+		std::vector<float> mPlaybackX;
+		std::vector<float> mPlaybackY;
+		std::vector<float> mPlaybackZ;
+	};
+}
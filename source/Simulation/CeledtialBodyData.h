@@ -1,7 +1,8 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
-namespace Rendering
+namespace Simulation
 {
 	struct CelestialBodyData
 	{
@@ -16,5 +17,10 @@ namespace Rendering
 		float mReflectance;
 		float mIsLit;
 		std::string mParent;
+		float mEccentricity;
+		float mInclination;
+		float mAscendingNode;
+		float mArgumentOfPeriapsis;
+		float mMeanAnomaly;
 	};
 }
@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "Checkpoint.h"
+#include <cstdio>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const char Checkpoint::Magic[8] = { 'S', 'S', 'C', 'H', 'K', 'P', 'T', '\0' };
+	const uint32_t Checkpoint::FormatVersion = 2;
+	const uint64_t Checkpoint::Alignment = 64;
+
+	namespace
+	{
+		uint64_t Align(uint64_t offset)
+		{
+			return (offset + Checkpoint::Alignment - 1) & ~(Checkpoint::Alignment - 1);
+		}
+
+		uint64_t SectionsOffset(uint64_t sectionCount)
+		{
+			return Align(sizeof(Checkpoint::Header) + sectionCount * sizeof(Checkpoint::SectionEntry));
+		}
+
+		// Forces a closed file's contents out of the operating system's cache onto the disk.
+		bool SyncFile(const string& path)
+		{
+#if defined(_WIN32)
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+			bool synced = FlushFileBuffers(file) != 0;
+			CloseHandle(file);
+#else
+			int file = open(path.c_str(), O_WRONLY);
+			if (file < 0)
+			{
+				return false;
+			}
+			bool synced = fsync(file) == 0;
+			close(file);
+#endif
+			return synced;
+		}
+
+#if !defined(_WIN32)
+		// A rename is only durable once the directory holding the new name is synced too; file systems that cannot sync
+		// a directory say so with EINVAL and have nothing to flush.
+		bool SyncDirectory(const string& path)
+		{
+			size_t separator = path.find_last_of('/');
+			string directory = (separator == string::npos) ? "." : ((separator == 0) ? "/" : path.substr(0, separator));
+			int file = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+			if (file < 0)
+			{
+				return false;
+			}
+			bool synced = (fsync(file) == 0) || (errno == EINVAL);
+			close(file);
+			return synced;
+		}
+#endif
+	}
+
+	Checkpoint::Checkpoint(const string& path) :
+		mFile(path), mHeader(nullptr), mSections(nullptr)
+	{
+		if (mFile.Size() < sizeof(Header))
+		{
+			throw runtime_error("Checkpoint file is truncated: " + path);
+		}
+
+		mHeader = reinterpret_cast<const Header*>(mFile.Data());
+		if (memcmp(mHeader->mMagic, Magic, sizeof(Magic)) != 0)
+		{
+			throw runtime_error("Not a checkpoint file: " + path);
+		}
+		if (mHeader->mVersion != FormatVersion)
+		{
+			throw runtime_error("Unsupported checkpoint version: " + to_string(mHeader->mVersion));
+		}
+		if (mHeader->mFileSize != mFile.Size() || mFile.Size() < SectionsOffset(mHeader->mSectionCount))
+		{
+			throw runtime_error("Checkpoint file is truncated: " + path);
+		}
+		mSections = reinterpret_cast<const SectionEntry*>(mFile.Data() + sizeof(Header));
+
+		for (uint32_t index = 0; index < mHeader->mSectionCount; ++index)
+		{
+			// the records must fit between the table and the end of the file, checked without overflowing
+			const SectionEntry& section = mSections[index];
+			bool placed = (section.mOffset % Alignment == 0) && (section.mOffset >= SectionsOffset(mHeader->mSectionCount)) && (section.mOffset <= mFile.Size());
+			if (section.mRecordSize == 0 || !placed || section.mRecordCount > (mFile.Size() - section.mOffset) / section.mRecordSize)
+			{
+				throw runtime_error("Invalid checkpoint section table: " + path);
+			}
+		}
+	}
+
+	uint32_t Checkpoint::SectionCount() const
+	{
+		return mHeader->mSectionCount;
+	}
+
+	bool Checkpoint::HasSection(uint32_t id) const
+	{
+		return Find(id) != nullptr;
+	}
+
+	uint64_t Checkpoint::RecordCount(uint32_t id) const
+	{
+		const SectionEntry* section = Find(id);
+		return (section != nullptr) ? section->mRecordCount : 0;
+	}
+
+	uint64_t Checkpoint::FileSize() const
+	{
+		return mFile.Size();
+	}
+
+	const Checkpoint::SectionEntry* Checkpoint::Find(uint32_t id) const
+	{
+		// a few dozen entries at most, so a scan beats building a map
+		for (uint32_t index = 0; index < mHeader->mSectionCount; ++index)
+		{
+			if (mSections[index].mId == id)
+			{
+				return &mSections[index];
+			}
+		}
+		return nullptr;
+	}
+
+	void CheckpointWriter::Add(uint32_t id, uint32_t recordSize, uint64_t count, const void* records)
+	{
+		for (const PendingSection& section : mSections)
+		{
+			if (section.mId == id)
+			{
+				throw runtime_error("Checkpoint section added twice: " + to_string(id));
+			}
+		}
+
+		PendingSection section = { id, recordSize, count, records };
+		mSections.push_back(section);
+	}
+
+	uint64_t CheckpointWriter::FileSize() const
+	{
+		uint64_t size = SectionsOffset(mSections.size());
+		for (const PendingSection& section : mSections)
+		{
+			size = Align(size + section.mRecordSize * section.mRecordCount);
+		}
+		return size;
+	}
+
+	void CheckpointWriter::Write(const string& path) const
+	{
+		string temporaryPath = path + ".tmp";
+		{
+			ofstream file(temporaryPath, ios::binary);
+			if (!file.good())
+			{
+				throw runtime_error("Could not open file: " + temporaryPath);
+			}
+
+			Checkpoint::Header header = {};
+			memcpy(header.mMagic, Checkpoint::Magic, sizeof(header.mMagic));
+			header.mVersion = Checkpoint::FormatVersion;
+			header.mSectionCount = static_cast<uint32_t>(mSections.size());
+			header.mFileSize = FileSize();
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+			uint64_t offset = SectionsOffset(mSections.size());
+			for (const PendingSection& pending : mSections)
+			{
+				Checkpoint::SectionEntry section = {};
+				section.mId = pending.mId;
+				section.mRecordSize = pending.mRecordSize;
+				section.mRecordCount = pending.mRecordCount;
+				section.mOffset = offset;
+				file.write(reinterpret_cast<const char*>(&section), sizeof(section));
+				offset = Align(offset + pending.mRecordSize * pending.mRecordCount);
+			}
+
+			const char padding[Checkpoint::Alignment] = {};
+			uint64_t position = sizeof(Checkpoint::Header) + mSections.size() * sizeof(Checkpoint::SectionEntry);
+			for (const PendingSection& pending : mSections)
+			{
+				uint64_t aligned = Align(position);
+				file.write(padding, static_cast<streamsize>(aligned - position));
+				uint64_t size = pending.mRecordSize * pending.mRecordCount;
+				file.write(static_cast<const char*>(pending.mRecords), static_cast<streamsize>(size));
+				position = aligned + size;
+			}
+			file.write(padding, static_cast<streamsize>(Align(position) - position));
+
+			file.close();
+			if (file.fail())
+			{
+				remove(temporaryPath.c_str());
+				throw runtime_error("Could not write file: " + temporaryPath);
+			}
+		}
+
+		// the data must be on disk before the rename can expose it, or a power loss could leave a truncated checkpoint
+		if (!SyncFile(temporaryPath))
+		{
+			remove(temporaryPath.c_str());
+			throw runtime_error("Could not write file: " + temporaryPath);
+		}
+
+#if defined(_WIN32)
+		bool renamed = MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		bool renamed = rename(temporaryPath.c_str(), path.c_str()) == 0;
+#endif
+		if (!renamed)
+		{
+			remove(temporaryPath.c_str());
+			throw runtime_error("Could not replace file: " + path);
+		}
+
+#if !defined(_WIN32)
+		if (!SyncDirectory(path))
+		{
+			throw runtime_error("Could not sync the directory of file: " + path);
+		}
+#endif
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MappedFile.h"
+
+namespace Simulation
+{
+	// Read side of a checkpoint file written by CheckpointWriter: a table of sections, each an array of fixed size
+	// records under a numeric id. What the ids mean is up to whoever saves the state; BodySystem::SaveCheckpoint is the
+	// one that does. Like an Ephemeris the file is memory mapped rather than read, and every section starts on an
+	// Alignment boundary, so Section hands out pointers straight into the mapping that the caller can copy into its own
+	// arrays in one pass, with nothing to parse.
+	//
+	// Section checks the record size written against the type asked for, so a checkpoint from a build whose records
+	// differ is refused rather than misread; the records are plain structs in native layout, and FormatVersion covers
+	// the rest.
+	//
+	// File layout, native little endian: a Header, SectionCount() SectionEntry structs, then each section's records at
+	// its offset, padded with zeros to the next Alignment boundary.
+	class Checkpoint final
+	{
+	public:
+		explicit Checkpoint(const std::string& path);
+		Checkpoint(const Checkpoint&) = delete;
+		Checkpoint& operator=(const Checkpoint&) = delete;
+		Checkpoint(Checkpoint&&) = delete;
+		Checkpoint& operator=(Checkpoint&&) = delete;
+		~Checkpoint() = default;
+
+		std::uint32_t SectionCount() const;
+		bool HasSection(std::uint32_t id) const;
+		// Records in the section, zero if there is none.
+		std::uint64_t RecordCount(std::uint32_t id) const;
+		std::uint64_t FileSize() const;
+
+		// The section's records, which stay valid as long as the Checkpoint; null if it is empty. Throws if the section
+		// is missing or holds records of another size.
+		template <typename T>
+		const T* Section(std::uint32_t id) const;
+
+		static const char Magic[8];
+		static const std::uint32_t FormatVersion;
+		static const std::uint64_t Alignment;
+
+		struct Header
+		{
+			char mMagic[8];
+			std::uint32_t mVersion;
+			std::uint32_t mSectionCount;
+			std::uint64_t mFileSize;
+		};
+
+		struct SectionEntry
+		{
+			std::uint32_t mId;
+			std::uint32_t mRecordSize;
+			std::uint64_t mRecordCount;
+			std::uint64_t mOffset;
+		};
+
+	private:
+		const SectionEntry* Find(std::uint32_t id) const;
+
+		MappedFile mFile;
+
+		const Header* mHeader;
+		const SectionEntry* mSections;
+	};
+
+	// Collects the sections of a checkpoint and writes them as a Checkpoint file. Sections are kept as pointers, not
+	// copies, so a million body state is written straight from the arrays it lives in; they must stay put until Write.
+	//
+	// Write goes through a temporary file next to the target, syncs it to disk and renames it over the target, so a
+	// crash or power loss while saving leaves the previous checkpoint as it was.
+	class CheckpointWriter final
+	{
+	public:
+		CheckpointWriter() = default;
+		CheckpointWriter(const CheckpointWriter&) = delete;
+		CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+		CheckpointWriter(CheckpointWriter&&) = default;
+		CheckpointWriter& operator=(CheckpointWriter&&) = default;
+		~CheckpointWriter() = default;
+
+		// Ids must be unique.
+		template <typename T>
+		void AddSection(std::uint32_t id, const T* records, std::uint64_t count);
+		template <typename T>
+		void AddSection(std::uint32_t id, const std::vector<T>& records);
+
+		// Size of the file Write produces.
+		std::uint64_t FileSize() const;
+		void Write(const std::string& path) const;
+
+	private:
+		struct PendingSection
+		{
+			std::uint32_t mId;
+			std::uint32_t mRecordSize;
+			std::uint64_t mRecordCount;
+			const void* mRecords;
+		};
+
+		void Add(std::uint32_t id, std::uint32_t recordSize, std::uint64_t count, const void* records);
+
+		std::vector<PendingSection> mSections;
+	};
+
+	template <typename T>
+	const T* Checkpoint::Section(std::uint32_t id) const
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Checkpoint records must be trivially copyable");
+		const SectionEntry* section = Find(id);
+		if (section == nullptr)
+		{
+			throw std::runtime_error("Checkpoint has no section " + std::to_string(id));
+		}
+		if (section->mRecordSize != sizeof(T))
+		{
+			throw std::runtime_error("Checkpoint section " + std::to_string(id) + " has records of another layout");
+		}
+		return (section->mRecordCount > 0) ? reinterpret_cast<const T*>(mFile.Data() + section->mOffset) : nullptr;
+	}
+
+	template <typename T>
+	void CheckpointWriter::AddSection(std::uint32_t id, const T* records, std::uint64_t count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Checkpoint records must be trivially copyable");
+		Add(id, static_cast<std::uint32_t>(sizeof(T)), count, records);
+	}
+
+	template <typename T>
+	void CheckpointWriter::AddSection(std::uint32_t id, const std::vector<T>& records)
+	{
+		AddSection(id, records.data(), records.size());
+	}
+}
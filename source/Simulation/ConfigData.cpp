@@ -0,0 +1,248 @@
+#include "pch.h"
+#include "ConfigData.h"
+#include <regex>
+
+namespace Simulation
+{
+	const std::regex ConfigData::CommentPattern = std::regex("^\\s*#.*$");
+	const std::regex ConfigData::SectionTagPattern = std::regex("^\\s*\\[\\s*([A-Za-z0-9_]+)\\s*\\]\\s*$");
+	const std::regex ConfigData::AttributeLinePattern = std::regex("^\\s*([^=]+)=(.*)$");
+	const std::string ConfigData::ConstantsSection = "Constants";
+	const std::string ConfigData::BeltType = "Belt";
+	const std::string ConfigData::EmitterType = "Emitter";
+
+	void ConfigData::LoadConfigData(const std::string& filename)
+	{
+		ConfigDataMapType dataMap;
+		PopulateDataMap(filename, dataMap);
+		PopulateDataObject(dataMap);
+	}
+
+	const CelestialBodyData& ConfigData::GetConstantsData() const
+	{
+		return mConstantsData;
+	}
+
+	const CelestialBodyData& ConfigData::GetCelestialBodyData(const std::string& sectionName) const
+	{
+		for (auto& data : mConfigData)
+		{
+			if (data.mName == sectionName)
+			{
+				return data;
+			}
+		}
+		throw std::runtime_error("Invalid section name");
+	}
+
+	const std::vector<CelestialBodyData>& ConfigData::GetAllData() const
+	{
+		return mConfigData;
+	}
+
+	const std::vector<BeltData>& ConfigData::GetBeltData() const
+	{
+		return mBeltData;
+	}
+
+	const std::vector<EmitterData>& ConfigData::GetEmitterData() const
+	{
+		return mEmitterData;
+	}
+
+	void ConfigData::PopulateDataMap(const std::string& filename, ConfigDataMapType& dataMap)
+	{
+		std::ifstream file;
+		file.open(filename);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Unable to read module config file: " + filename);
+		}
+
+		std::string line;
+		std::string sectionName;
+		while (std::getline(file, line))
+		{
+			std::smatch matches;
+			if (std::regex_search(line, matches, CommentPattern))
+			{
+				continue;
+			}
+			
+			if (std::regex_search(line, matches, SectionTagPattern))
+			{
+				sectionName = matches.str(1);
+			}
+			else if (std::regex_search(line, matches, AttributeLinePattern))
+			{
+				dataMap[sectionName].insert({matches.str(1), matches.str(2)});
+			}
+		}
+		file.close();
+	}
+
+	void ConfigData::PopulateDataObject(const ConfigDataMapType& configDataMap)
+	{
+		for (const auto& sectionEntry : configDataMap)
+		{
+			const auto& section = sectionEntry.second;
+
+			auto type = section.find("Type");
+			if (type != section.end() && type->second == BeltType)
+			{
+				mBeltData.push_back(ParseBelt(sectionEntry.first, section));
+			}
+			else if (type != section.end() && type->second == EmitterType)
+			{
+				mEmitterData.push_back(ParseEmitter(sectionEntry.first, section));
+			}
+			else if (sectionEntry.first == ConstantsSection)
+			{
+				mConstantsData = {
+					sectionEntry.first,
+					static_cast<std::uint32_t>(std::stoul(section.at("Ordinal"))),
+					section.at("Texture"),
+					std::stof(section.at("MeanDistance")),
+					std::stof(section.at("RotationPeriod")),
+					std::stof(section.at("OrbitalPeriod")),
+					std::stof(section.at("AxialTilt")),
+					std::stof(section.at("Diameter")),
+					std::stof(section.at("Albeido")), // reflectance
+					std::stof(section.at("IsLit")),
+					section.at("Parent"),
+					0.0f, 0.0f, 0.0f, 0.0f, 0.0f	// orbital elements are absolute, not scaled by the constants
+				};
+			}
+			else
+			{
+				mConfigData.push_back({
+					sectionEntry.first,
+					static_cast<std::uint32_t>(std::stoul(section.at("Ordinal"))),
+					section.at("Texture"),
+					std::stof(section.at("MeanDistance")),
+					std::stof(section.at("RotationPeriod")),
+					std::stof(section.at("OrbitalPeriod")),
+					std::stof(section.at("AxialTilt")),
+					std::stof(section.at("Diameter")),
+					std::stof(section.at("Albeido")),	// reflectance
+					std::stof(section.at("IsLit")),
+					section.at("Parent"),
+					GetOptionalValue(section, "Eccentricity"),
+					GetOptionalValue(section, "Inclination"),
+					GetOptionalValue(section, "AscendingNode"),
+					GetOptionalValue(section, "ArgumentOfPeriapsis"),
+					GetOptionalValue(section, "MeanAnomaly")
+				});
+			}
+		}
+		std::sort(mConfigData.begin(), mConfigData.end(), [](const CelestialBodyData& a, const CelestialBodyData& b)
+		{
+			return a.mOrdinal < b.mOrdinal;
+		});
+
+		// the sections come out of a hash map, and belts are generated in this order
+		std::sort(mBeltData.begin(), mBeltData.end(), [](const BeltData& a, const BeltData& b)
+		{
+			return a.mName < b.mName;
+		});
+		std::sort(mEmitterData.begin(), mEmitterData.end(), [](const EmitterData& a, const EmitterData& b)
+		{
+			return a.mName < b.mName;
+		});
+	}
+
+	float ConfigData::GetOptionalValue(const std::unordered_map<std::string, std::string>& section, const std::string& key)
+	{
+		// orbital elements default to a circular orbit in the reference plane so older catalogs still load
+		auto entry = section.find(key);
+		return (entry == section.end()) ? 0.0f : std::stof(entry->second);
+	}
+
+	BeltData ConfigData::ParseBelt(const std::string& name, const std::unordered_map<std::string, std::string>& section)
+	{
+		auto optional = [&section](const std::string& key, const std::string& defaultValue)
+		{
+			auto entry = section.find(key);
+			return (entry == section.end()) ? defaultValue : entry->second;
+		};
+
+		BeltData belt = {
+			name,
+			section.at("Parent"),
+			std::stof(section.at("InnerDistance")),
+			std::stof(section.at("OuterDistance")),
+			std::stof(section.at("OrbitalPeriod")),
+			static_cast<std::uint32_t>(std::stoul(section.at("Count"))),
+			std::stof(section.at("MinDiameter")),
+			std::stof(section.at("MaxDiameter")),
+			std::stof(optional("SizeExponent", "2.5")),
+			GetOptionalValue(section, "MaxEccentricity"),
+			GetOptionalValue(section, "MaxInclination"),
+			static_cast<std::uint32_t>(std::stoul(optional("Seed", "0"))),
+			std::stoul(optional("Quantized", "1")) != 0
+		};
+
+		if (belt.mInnerDistance <= 0.0f || belt.mOuterDistance < belt.mInnerDistance)
+		{
+			throw std::runtime_error("Belt distances must satisfy 0 < InnerDistance <= OuterDistance: " + name);
+		}
+		if (belt.mMinDiameter <= 0.0f || belt.mMaxDiameter < belt.mMinDiameter)
+		{
+			throw std::runtime_error("Belt diameters must satisfy 0 < MinDiameter <= MaxDiameter: " + name);
+		}
+		if (belt.mMaxEccentricity < 0.0f || belt.mMaxEccentricity >= 1.0f)
+		{
+			throw std::runtime_error("MaxEccentricity must be in [0, 1): " + name);
+		}
+		return belt;
+	}
+
+	EmitterData ConfigData::ParseEmitter(const std::string& name, const std::unordered_map<std::string, std::string>& section)
+	{
+		auto optional = [&section](const std::string& key, const std::string& defaultValue)
+		{
+			auto entry = section.find(key);
+			return (entry == section.end()) ? defaultValue : entry->second;
+		};
+
+		EmitterData emitter = {
+			name,
+			section.at("Parent"),
+			section.at("Style"),
+			std::stof(section.at("Rate")),
+			std::stof(section.at("Lifetime")),
+			GetOptionalValue(section, "LifetimeVariation"),
+			std::stof(section.at("Speed")),
+			GetOptionalValue(section, "SpeedVariation"),
+			GetOptionalValue(section, "Spread"),
+			std::stof(section.at("Size")),
+			GetOptionalValue(section, "Growth"),
+			{1.0f, 1.0f, 1.0f, 1.0f},
+			static_cast<std::uint32_t>(std::stoul(optional("Seed", "0")))
+		};
+
+		// four components, red to alpha, separated by spaces
+		std::istringstream color(optional("Color", "1 1 1 1"));
+		for (float& component : emitter.mColor)
+		{
+			if (!(color >> component))
+			{
+				throw std::runtime_error("Emitter Color needs four components: " + name);
+			}
+		}
+
+		if (emitter.mStyle != "Wind" && emitter.mStyle != "Tail")
+		{
+			throw std::runtime_error("Emitter Style must be Wind or Tail: " + name);
+		}
+		if (emitter.mRate < 0.0f || emitter.mLifetime <= 0.0f)
+		{
+			throw std::runtime_error("Emitter needs Rate >= 0 and Lifetime > 0: " + name);
+		}
+		if (emitter.mLifetimeVariation < 0.0f || emitter.mLifetimeVariation >= 1.0f || emitter.mSpeedVariation < 0.0f || emitter.mSpeedVariation > 1.0f)
+		{
+			throw std::runtime_error("Emitter LifetimeVariation must be in [0, 1) and SpeedVariation in [0, 1]: " + name);
+		}
+		return emitter;
+	}
+}
\ No newline at end of file
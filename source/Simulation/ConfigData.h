@@ -2,9 +2,12 @@
 
 #include <regex>
 #include <unordered_map>
+#include <vector>
 #include "CeledtialBodyData.h"
+#include "BeltData.h"
+#include "EmitterData.h"
 
-namespace Rendering
+namespace Simulation
 {
 	class ConfigData
 	{
@@ -13,18 +16,27 @@ namespace Rendering
 		const CelestialBodyData& GetConstantsData() const;
 		const CelestialBodyData& GetCelestialBodyData(const std::string& sectionName) const;
 		const std::vector<CelestialBodyData>& GetAllData() const;
+		const std::vector<BeltData>& GetBeltData() const;
+		const std::vector<EmitterData>& GetEmitterData() const;
 	private:
 		typedef std::unordered_map<std::string, std::unordered_map<std::string, std::string>> ConfigDataMapType;
 
 		static void PopulateDataMap(const std::string& filename, ConfigDataMapType& dataMap);
 		void PopulateDataObject(const ConfigDataMapType& configDataMap);
+		static float GetOptionalValue(const std::unordered_map<std::string, std::string>& section, const std::string& key);
+		static BeltData ParseBelt(const std::string& name, const std::unordered_map<std::string, std::string>& section);
+		static EmitterData ParseEmitter(const std::string& name, const std::unordered_map<std::string, std::string>& section);
 
 		std::vector<CelestialBodyData> mConfigData;
+		std::vector<BeltData> mBeltData;
+		std::vector<EmitterData> mEmitterData;
 		CelestialBodyData mConstantsData;
 
 		static const std::regex CommentPattern;
 		static const std::regex SectionTagPattern;
 		static const std::regex AttributeLinePattern;
 		static const std::string ConstantsSection;
+		static const std::string BeltType;
+		static const std::string EmitterType;
 	};
 }
@@ -0,0 +1,183 @@
+#include "pch.h"
+#include "ConicPropagator.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t ConicPropagator::MaxIterations = 100;
+	const double ConicPropagator::Tolerance = 1.0e-12;
+	const double ConicPropagator::SeriesLimit = 1.0e-3;
+
+	namespace
+	{
+		// below this |alpha| the orbit is treated as parabolic for the first guess
+		const double ParabolicLimit = 1.0e-12;
+		// XM_2PI is a float, which would drift a long elliptic flight by its rounding once per period
+		const double FullTurn = 2.0 * 3.14159265358979323846;
+	}
+
+	bool ConicPropagator::Propagate(const double* position, const double* velocity, double timeOfFlight, double gravitationalParameter,
+		double* propagatedPosition, double* propagatedVelocity)
+	{
+		// read everything first, so the state can be propagated in place
+		double x0 = position[0], y0 = position[1], z0 = position[2];
+		double vx0 = velocity[0], vy0 = velocity[1], vz0 = velocity[2];
+		propagatedPosition[0] = x0;
+		propagatedPosition[1] = y0;
+		propagatedPosition[2] = z0;
+		propagatedVelocity[0] = vx0;
+		propagatedVelocity[1] = vy0;
+		propagatedVelocity[2] = vz0;
+
+		double radius = sqrt(x0 * x0 + y0 * y0 + z0 * z0);
+		if (radius <= 0 || gravitationalParameter <= 0)
+		{
+			return false;
+		}
+		if (timeOfFlight == 0)
+		{
+			return true;
+		}
+
+		double rootGravitationalParameter = sqrt(gravitationalParameter);
+		double radialProduct = x0 * vx0 + y0 * vy0 + z0 * vz0;
+		double radialSpeed = radialProduct / rootGravitationalParameter;
+		double alpha = 2.0 / radius - (vx0 * vx0 + vy0 * vy0 + vz0 * vz0) / gravitationalParameter;
+
+		// the scaled time of flight has the radius as its slope in chi, so a root between zero and a bound on the far
+		// side stays between them
+		double time = timeOfFlight;
+		double direction = (time > 0) ? 1.0 : -1.0;
+		double chi;
+		double bound;
+		auto scaledTime = [&](double chi, double& slope)
+		{
+			double chiSquared = chi * chi;
+			double z = alpha * chiSquared;
+			double c, s;
+			Stumpff(z, c, s);
+			slope = chiSquared * c + radialSpeed * chi * (1.0 - z * s) + radius * (1.0 - z * c);
+			return radialSpeed * chiSquared * c + (1.0 - alpha * radius) * chiSquared * chi * s + radius * chi - rootGravitationalParameter * time;
+		};
+		if (alpha > ParabolicLimit)
+		{
+			// a whole period advances chi by 2 pi / sqrt(alpha)
+			double period = FullTurn / (rootGravitationalParameter * alpha * sqrt(alpha));
+			time = fmod(time, period);
+			chi = rootGravitationalParameter * time * alpha;
+			bound = direction * FullTurn / sqrt(alpha);
+		}
+		else
+		{
+			if (alpha < -ParabolicLimit)
+			{
+				double semiMajorAxis = 1.0 / alpha;
+				chi = direction * sqrt(-semiMajorAxis) * log(-2.0 * gravitationalParameter * alpha * time /
+					(radialProduct + direction * sqrt(-gravitationalParameter * semiMajorAxis) * (1.0 - radius * alpha)));
+			}
+			else
+			{
+				chi = rootGravitationalParameter * time / radius;
+			}
+			if (!isfinite(chi) || chi * direction <= 0)
+			{
+				chi = rootGravitationalParameter * time / radius;
+			}
+
+			double slope;
+			bound = chi;
+			for (uint32_t expansion = 0; scaledTime(bound, slope) * direction < 0; ++expansion)
+			{
+				if (expansion == MaxIterations)
+				{
+					return false;
+				}
+				bound *= 2.0;
+			}
+		}
+		double low = min(0.0, bound);
+		double high = max(0.0, bound);
+		if (!(chi > low && chi < high))
+		{
+			chi = 0.5 * (low + high);
+		}
+
+		bool converged = false;
+		for (uint32_t iteration = 0; iteration < MaxIterations && !converged; ++iteration)
+		{
+			double slope;
+			double residual = scaledTime(chi, slope);
+			if (residual == 0)
+			{
+				converged = true;
+				break;
+			}
+
+			if (residual < 0)
+			{
+				low = chi;
+			}
+			else
+			{
+				high = chi;
+			}
+
+			double next = chi - residual / slope;
+			if (!(next > low && next < high))
+			{
+				next = 0.5 * (low + high);
+			}
+			converged = fabs(next - chi) <= Tolerance * max(1.0, fabs(next));
+			chi = next;
+		}
+		if (!converged)
+		{
+			return false;
+		}
+
+		// Lagrange coefficients of the converged chi
+		double chiSquared = chi * chi;
+		double z = alpha * chiSquared;
+		double c, s;
+		Stumpff(z, c, s);
+		double f = 1.0 - chiSquared / radius * c;
+		double g = time - chiSquared * chi * s / rootGravitationalParameter;
+		double x = f * x0 + g * vx0;
+		double y = f * y0 + g * vy0;
+		double zPosition = f * z0 + g * vz0;
+		double propagatedRadius = sqrt(x * x + y * y + zPosition * zPosition);
+		double fDot = rootGravitationalParameter / (propagatedRadius * radius) * chi * (z * s - 1.0);
+		double gDot = 1.0 - chiSquared / propagatedRadius * c;
+
+		propagatedPosition[0] = x;
+		propagatedPosition[1] = y;
+		propagatedPosition[2] = zPosition;
+		propagatedVelocity[0] = fDot * x0 + gDot * vx0;
+		propagatedVelocity[1] = fDot * y0 + gDot * vy0;
+		propagatedVelocity[2] = fDot * z0 + gDot * vz0;
+		return true;
+	}
+
+	void ConicPropagator::Stumpff(double z, double& c, double& s)
+	{
+		if (z > SeriesLimit)
+		{
+			double root = sqrt(z);
+			c = (1.0 - cos(root)) / z;
+			s = (root - sin(root)) / (root * z);
+		}
+		else if (z < -SeriesLimit)
+		{
+			double root = sqrt(-z);
+			c = (cosh(root) - 1.0) / -z;
+			s = (sinh(root) - root) / (root * -z);
+		}
+		else
+		{
+			c = 1.0 / 2.0 - z / 24.0 + z * z / 720.0;
+			s = 1.0 / 6.0 - z / 120.0 + z * z / 5040.0;
+		}
+	}
+}
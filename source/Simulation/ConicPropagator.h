@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Simulation
+{
+	// Moves a two-body state along its conic, whichever kind it is, by solving Kepler's equation in the universal variable
+	// chi (Bate, Mueller and White; Vallado) instead of the eccentric anomaly, so ellipses, parabolas and hyperbolas all
+	// take the same path and nothing breaks when a flyby swings a state from one to the other.
+	//
+	// The time of flight rises monotonically in chi, so the root is bracketed first: by one period's worth of chi once
+	// whole periods are dropped from an elliptic flight, by doubling Vallado's guess otherwise. Newton's method then
+	// starts from that guess and bisects whenever a step would leave the bracket, for at most MaxIterations steps, until
+	// a step is within Tolerance of chi. Work is in double precision, which the parabolic series of the Stumpff
+	// functions needs.
+	class ConicPropagator final
+	{
+	public:
+		// Positions and velocities relative to the attracting body, three components each. The state comes out where
+		// it went in if Newton's method did not converge.
+		static bool Propagate(const double* position, const double* velocity, double timeOfFlight, double gravitationalParameter,
+			double* propagatedPosition, double* propagatedVelocity);
+
+		// C(z) and S(z), by their series near zero where the closed forms cancel.
+		static void Stumpff(double z, double& c, double& s);
+
+		static const std::uint32_t MaxIterations;
+		static const double Tolerance;
+		static const double SeriesLimit;
+
+		ConicPropagator() = delete;
+		ConicPropagator(const ConicPropagator&) = delete;
+		ConicPropagator& operator=(const ConicPropagator&) = delete;
+		ConicPropagator(ConicPropagator&&) = delete;
+		ConicPropagator& operator=(ConicPropagator&&) = delete;
+		~ConicPropagator() = default;
+	};
+}
@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "DetailScheduler.h"
+#include "BodyStateStore.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t DetailScheduler::TierCount = 6;
+	const float DetailScheduler::DefaultMaxError = 0.5f;
+	const double DetailScheduler::NearDistance = 0.01;
+
+	DetailScheduler::DetailScheduler() :
+		mTierCounts(TierCount, 0), mMaxError(DefaultMaxError)
+	{
+	}
+
+	void DetailScheduler::Schedule(const BodyStateStore& states, const WorldPosition& viewpoint, float pixelsPerRadian, double stepSeconds)
+	{
+		uint32_t bodyCount = states.Count();
+		mViewDistances.resize(bodyCount);
+		mSpinLimits.resize(bodyCount);
+		mIntervals.resize(bodyCount);
+		mTiers.resize(bodyCount);
+
+		double errorAngle = mMaxError / static_cast<double>(pixelsPerRadian);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			// distances are to the surface, and a viewpoint on or inside a body is taken to be at the near distance
+			WorldPosition position = states.PrecisePosition(index);
+			double x = position.mX - viewpoint.mX;
+			double y = position.mY - viewpoint.mY;
+			double z = position.mZ - viewpoint.mZ;
+			double radius = states.Scale(index) / 2.0;
+			double distance = max(sqrt(x * x + y * y + z * z) - radius, NearDistance);
+			mViewDistances[index] = distance;
+
+			// the orbit turns the body along with its spin
+			double spinRate = XM_2PI * (abs(states.RotationFrequency(index)) + abs(states.OrbitalFrequency(index)));
+			double limbSpeed = spinRate * radius;
+			mSpinLimits[index] = (limbSpeed > 0) ? (errorAngle * distance / limbSpeed) : numeric_limits<double>::infinity();
+		}
+
+		// children follow their parents, so the bodies of a subtree are judged from the nearest of them
+		for (uint32_t index = bodyCount; index > 0; --index)
+		{
+			uint32_t parent = states.Parent(index - 1);
+			if (parent != BodyStateStore::InvalidIndex)
+			{
+				mViewDistances[parent] = min(mViewDistances[parent], mViewDistances[index - 1]);
+			}
+		}
+
+		uint32_t maxInterval = 1U << (TierCount - 1);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			double meanMotion = XM_2PI * states.OrbitalFrequency(index);
+			double periapsisRatio = 1.0 - states.Eccentricity(index);
+			double acceleration = meanMotion * meanMotion * states.SemiMajorAxis(index) / (periapsisRatio * periapsisRatio);
+			double driftLimit = (acceleration > 0) ? sqrt(2.0 * errorAngle * mViewDistances[index] / acceleration) : numeric_limits<double>::infinity();
+
+			double limit = min(driftLimit, mSpinLimits[index]);
+			double steps = (stepSeconds > 0) ? (limit / stepSeconds) : numeric_limits<double>::infinity();
+			uint32_t interval = 1;
+			while (interval < maxInterval && interval * 2.0 <= steps)
+			{
+				interval *= 2;
+			}
+			mIntervals[index] = interval;
+		}
+
+		// a parent is solved at least as often as any of its children
+		for (uint32_t index = bodyCount; index > 0; --index)
+		{
+			uint32_t parent = states.Parent(index - 1);
+			if (parent != BodyStateStore::InvalidIndex)
+			{
+				mIntervals[parent] = min(mIntervals[parent], mIntervals[index - 1]);
+			}
+		}
+
+		fill(mTierCounts.begin(), mTierCounts.end(), 0U);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			uint32_t tier = 0;
+			while ((1U << tier) < mIntervals[index])
+			{
+				++tier;
+			}
+			mTiers[index] = tier;
+			++mTierCounts[tier];
+		}
+	}
+
+	float DetailScheduler::MaxError() const
+	{
+		return mMaxError;
+	}
+
+	void DetailScheduler::SetMaxError(float pixels)
+	{
+		mMaxError = pixels;
+	}
+
+	const vector<uint32_t>& DetailScheduler::Intervals() const
+	{
+		return mIntervals;
+	}
+
+	uint32_t DetailScheduler::Tier(uint32_t index) const
+	{
+		return mTiers[index];
+	}
+
+	uint32_t DetailScheduler::TierBodyCount(uint32_t tier) const
+	{
+		return mTierCounts[tier];
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "WorldPosition.h"
+
+namespace Simulation
+{
+	class BodyStateStore;
+
+	// Picks how often every body of a BodyStateStore has to be solved for its motion to stay within MaxError pixels of
+	// the truth as seen from a viewpoint, so that only the bodies near the camera pay for a solve at every step.
+	//
+	// Between solves the store carries a body along a straight line, which strays from the orbit by at most half its
+	// largest acceleration times the square of the time since the solve. The largest acceleration of a Kepler orbit is
+	// n^2 a / (1 - e)^2 at periapsis, so with the distance d from the viewpoint and p pixels per radian a body may go
+	// sqrt(2 MaxError d / (a_max p)) without a solve. Its rotation also stands still in between, which moves the limb
+	// by the spin rate times the time times its radius, and caps the time at MaxError d / (omega r p) for a body large
+	// on screen. A parent's translation moves its whole subtree, so it is judged from the nearest of its descendants,
+	// and it is never solved less often than any of them.
+	//
+	// The time is rounded down to a power of two steps: tier t is solved every 2^t steps, up to TierCount - 1. Each
+	// level of the hierarchy stays within MaxError, so a moon's error is at most that of its own orbit plus its planet's.
+	class DetailScheduler final
+	{
+	public:
+		DetailScheduler();
+		DetailScheduler(const DetailScheduler&) = delete;
+		DetailScheduler& operator=(const DetailScheduler&) = delete;
+		DetailScheduler(DetailScheduler&&) = default;
+		DetailScheduler& operator=(DetailScheduler&&) = default;
+		~DetailScheduler() = default;
+
+		// pixelsPerRadian is the viewport height over the vertical field of view, and stepSeconds the simulation time
+		// of one Evaluate.
+		void Schedule(const BodyStateStore& states, const WorldPosition& viewpoint, float pixelsPerRadian, double stepSeconds);
+
+		float MaxError() const;
+		void SetMaxError(float pixels);
+
+		// Update intervals in steps for BodyStateStore::SetUpdateIntervals, and the tier of each body.
+		const std::vector<std::uint32_t>& Intervals() const;
+		std::uint32_t Tier(std::uint32_t index) const;
+		// Bodies the last Schedule put in a tier.
+		std::uint32_t TierBodyCount(std::uint32_t tier) const;
+
+		static const std::uint32_t TierCount;
+		static const float DefaultMaxError;
+		// The closest a surface is taken to be to the viewpoint, the demo camera's near plane distance.
+		static const double NearDistance;
+
+	private:
+		std::vector<double> mViewDistances;
+		std::vector<double> mSpinLimits;
+		std::vector<std::uint32_t> mIntervals;
+		std::vector<std::uint32_t> mTiers;
+		std::vector<std::uint32_t> mTierCounts;
+		float mMaxError;
+	};
+}
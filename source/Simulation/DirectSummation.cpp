@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "DirectSummation.h"
+#include "NBodyState.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t DirectSummation::TileSize = 512;
+	const uint32_t DirectSummation::RowGrainSize = 64;
+
+	namespace
+	{
+		// Adds the pull of sources [begin, end) on four targets to the sums. A body's own lane (r = 0 when unsoftened)
+		// is masked out.
+		inline void XM_CALLCONV AccumulateSources(const NBodyState& state, uint32_t begin, uint32_t end, FXMVECTOR targetX, FXMVECTOR targetY,
+			FXMVECTOR targetZ, GXMVECTOR softeningSquared, XMVECTOR& sumX, XMVECTOR& sumY, XMVECTOR& sumZ)
+		{
+			const float* positionX = state.PositionX();
+			const float* positionY = state.PositionY();
+			const float* positionZ = state.PositionZ();
+			const float* gravitationalParameters = state.GravitationalParameters();
+			XMVECTOR zero = XMVectorZero();
+			for (uint32_t source = begin; source < end; ++source)
+			{
+				XMVECTOR deltaX = XMVectorSubtract(XMVectorReplicatePtr(&positionX[source]), targetX);
+				XMVECTOR deltaY = XMVectorSubtract(XMVectorReplicatePtr(&positionY[source]), targetY);
+				XMVECTOR deltaZ = XMVectorSubtract(XMVectorReplicatePtr(&positionZ[source]), targetZ);
+
+				XMVECTOR distanceSquared = XMVectorMultiplyAdd(deltaX, deltaX, softeningSquared);
+				distanceSquared = XMVectorMultiplyAdd(deltaY, deltaY, distanceSquared);
+				distanceSquared = XMVectorMultiplyAdd(deltaZ, deltaZ, distanceSquared);
+
+				// GM / r^3
+				XMVECTOR inverseDistance = XMVectorReciprocalSqrt(distanceSquared);
+				XMVECTOR inverseDistanceCubed = XMVectorMultiply(XMVectorMultiply(inverseDistance, inverseDistance), inverseDistance);
+				XMVECTOR strength = XMVectorMultiply(XMVectorReplicatePtr(&gravitationalParameters[source]), inverseDistanceCubed);
+				strength = XMVectorSelect(strength, zero, XMVectorLessOrEqual(distanceSquared, zero));
+
+				sumX = XMVectorMultiplyAdd(strength, deltaX, sumX);
+				sumY = XMVectorMultiplyAdd(strength, deltaY, sumY);
+				sumZ = XMVectorMultiplyAdd(strength, deltaZ, sumZ);
+			}
+		}
+	}
+
+	void DirectSummation::ComputeAccelerations(NBodyState& state)
+	{
+		assert(RowGrainSize % NBodyState::BatchSize == 0);
+
+		auto computeRows = [this, &state](uint32_t begin, uint32_t end)
+		{
+			ComputeRows(state, begin, end);
+		};
+
+		if (mThreadPool != nullptr)
+		{
+			mThreadPool->ParallelFor(0, state.Count(), RowGrainSize, computeRows);
+		}
+		else
+		{
+			computeRows(0, state.Count());
+		}
+
+		mInteractions += static_cast<uint64_t>(state.Count()) * state.Count();
+	}
+
+	void DirectSummation::ComputeAccelerations(NBodyState& state, const vector<uint32_t>& targets)
+	{
+		assert(NBodyState::BatchSize == 4);
+
+		auto computeTargets = [this, &state, &targets](uint32_t begin, uint32_t end)
+		{
+			ComputeTargets(state, targets, begin, end);
+		};
+
+		uint32_t targetCount = static_cast<uint32_t>(targets.size());
+		if (mThreadPool != nullptr)
+		{
+			mThreadPool->ParallelFor(0, targetCount, RowGrainSize, computeTargets);
+		}
+		else
+		{
+			computeTargets(0, targetCount);
+		}
+
+		mInteractions += static_cast<uint64_t>(targetCount) * state.Count();
+	}
+
+	void DirectSummation::ComputeRows(NBodyState& state, uint32_t begin, uint32_t end) const
+	{
+		const float* positionX = state.PositionX();
+		const float* positionY = state.PositionY();
+		const float* positionZ = state.PositionZ();
+		float* accelerationX = state.AccelerationX();
+		float* accelerationY = state.AccelerationY();
+		float* accelerationZ = state.AccelerationZ();
+
+		for (uint32_t index = begin; index < end; index += NBodyState::BatchSize)
+		{
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&accelerationX[index]), XMVectorZero());
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&accelerationY[index]), XMVectorZero());
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&accelerationZ[index]), XMVectorZero());
+		}
+
+		XMVECTOR softeningSquared = XMVectorReplicate(mSoftening * mSoftening);
+		uint32_t sourceCount = state.Count();
+		for (uint32_t tileBegin = 0; tileBegin < sourceCount; tileBegin += TileSize)
+		{
+			uint32_t tileEnd = min(sourceCount, tileBegin + TileSize);
+			for (uint32_t index = begin; index < end; index += NBodyState::BatchSize)
+			{
+				XMVECTOR targetX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positionX[index]));
+				XMVECTOR targetY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positionY[index]));
+				XMVECTOR targetZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positionZ[index]));
+				XMVECTOR sumX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&accelerationX[index]));
+				XMVECTOR sumY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&accelerationY[index]));
+				XMVECTOR sumZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&accelerationZ[index]));
+
+				AccumulateSources(state, tileBegin, tileEnd, targetX, targetY, targetZ, softeningSquared, sumX, sumY, sumZ);
+
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&accelerationX[index]), sumX);
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&accelerationY[index]), sumY);
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&accelerationZ[index]), sumZ);
+			}
+		}
+	}
+
+	void DirectSummation::ComputeTargets(NBodyState& state, const vector<uint32_t>& targets, uint32_t begin, uint32_t end) const
+	{
+		const float* positionX = state.PositionX();
+		const float* positionY = state.PositionY();
+		const float* positionZ = state.PositionZ();
+		float* accelerationX = state.AccelerationX();
+		float* accelerationY = state.AccelerationY();
+		float* accelerationZ = state.AccelerationZ();
+
+		XMVECTOR softeningSquared = XMVectorReplicate(mSoftening * mSoftening);
+		for (uint32_t index = begin; index < end; index += NBodyState::BatchSize)
+		{
+			// a short last batch repeats its last target in the spare lanes
+			uint32_t lanes[4];
+			for (uint32_t lane = 0; lane < NBodyState::BatchSize; ++lane)
+			{
+				lanes[lane] = targets[min(index + lane, end - 1)];
+			}
+
+			XMVECTOR targetX = XMVectorSet(positionX[lanes[0]], positionX[lanes[1]], positionX[lanes[2]], positionX[lanes[3]]);
+			XMVECTOR targetY = XMVectorSet(positionY[lanes[0]], positionY[lanes[1]], positionY[lanes[2]], positionY[lanes[3]]);
+			XMVECTOR targetZ = XMVectorSet(positionZ[lanes[0]], positionZ[lanes[1]], positionZ[lanes[2]], positionZ[lanes[3]]);
+			XMVECTOR sumX = XMVectorZero();
+			XMVECTOR sumY = XMVectorZero();
+			XMVECTOR sumZ = XMVectorZero();
+
+			AccumulateSources(state, 0, state.Count(), targetX, targetY, targetZ, softeningSquared, sumX, sumY, sumZ);
+
+			XMFLOAT4 batchX;
+			XMFLOAT4 batchY;
+			XMFLOAT4 batchZ;
+			XMStoreFloat4(&batchX, sumX);
+			XMStoreFloat4(&batchY, sumY);
+			XMStoreFloat4(&batchZ, sumZ);
+			for (uint32_t lane = 0; lane < NBodyState::BatchSize && index + lane < end; ++lane)
+			{
+				accelerationX[lanes[lane]] = (&batchX.x)[lane];
+				accelerationY[lanes[lane]] = (&batchY.x)[lane];
+				accelerationZ[lanes[lane]] = (&batchZ.x)[lane];
+			}
+		}
+	}
+}
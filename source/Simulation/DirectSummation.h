@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "GravitySolver.h"
+
+namespace Simulation
+{
+	// Exact O(N^2) gravity. Target bodies are processed BatchSize at a time in DirectXMath vectors against source tiles
+	// of TileSize bodies, so a tile of source positions stays in L1 while every target batch of a row chunk streams over
+	// it; row chunks of RowGrainSize bodies are spread over the thread pool. A target list is gathered BatchSize bodies
+	// at a time and streams over all sources at once, as it is usually short.
+	class DirectSummation final : public GravitySolver
+	{
+	public:
+		DirectSummation() = default;
+		DirectSummation(const DirectSummation&) = delete;
+		DirectSummation& operator=(const DirectSummation&) = delete;
+		DirectSummation(DirectSummation&&) = delete;
+		DirectSummation& operator=(DirectSummation&&) = delete;
+		~DirectSummation() = default;
+
+		void ComputeAccelerations(NBodyState& state) override;
+		void ComputeAccelerations(NBodyState& state, const std::vector<std::uint32_t>& targets) override;
+
+		static const std::uint32_t TileSize;
+		static const std::uint32_t RowGrainSize;
+
+	private:
+		void ComputeRows(NBodyState& state, std::uint32_t begin, std::uint32_t end) const;
+		void ComputeTargets(NBodyState& state, const std::vector<std::uint32_t>& targets, std::uint32_t begin, std::uint32_t end) const;
+	};
+}
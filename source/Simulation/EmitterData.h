@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace Simulation
+{
+	// A [Section] of CelestialBodies.ini with Type=Emitter, a particle source riding on Parent. Style=Wind sprays from
+	// the whole surface, Style=Tail from the nucleus in a cone pointing away from the root of the parent's hierarchy.
+	// Speed is per second and Size and Speed are scaled by the constants' Diameter; Spread is the cone half angle in
+	// degrees and Growth how much a particle has grown by the end of its life.
+	struct EmitterData
+	{
+		std::string mName;
+		std::string mParent;
+		std::string mStyle;
+		float mRate;
+		float mLifetime;
+		float mLifetimeVariation;
+		float mSpeed;
+		float mSpeedVariation;
+		float mSpread;
+		float mSize;
+		float mGrowth;
+		float mColor[4];
+		std::uint32_t mSeed;
+	};
+}
@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "Ephemeris.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const char Ephemeris::Magic[8] = { 'S', 'S', 'E', 'P', 'H', 'E', 'M', '\0' };
+	const uint32_t Ephemeris::FormatVersion = 1;
+	const uint32_t Ephemeris::InvalidIndex = numeric_limits<uint32_t>::max();
+
+	Ephemeris::Ephemeris(const string& path) :
+		mFile(path), mHeader(nullptr), mBodies(nullptr), mCoefficients(nullptr), mRecordFloats(0)
+	{
+		if (mFile.Size() < sizeof(Header))
+		{
+			throw runtime_error("Ephemeris file is truncated: " + path);
+		}
+
+		mHeader = reinterpret_cast<const Header*>(mFile.Data());
+		if (memcmp(mHeader->mMagic, Magic, sizeof(Magic)) != 0)
+		{
+			throw runtime_error("Not an ephemeris file: " + path);
+		}
+		if (mHeader->mVersion != FormatVersion)
+		{
+			throw runtime_error("Unsupported ephemeris version: " + to_string(mHeader->mVersion));
+		}
+
+		uint64_t coefficientOffset = sizeof(Header) + static_cast<uint64_t>(mHeader->mBodyCount) * sizeof(BodyEntry);
+		if (mFile.Size() < coefficientOffset)
+		{
+			throw runtime_error("Ephemeris file is truncated: " + path);
+		}
+		mBodies = reinterpret_cast<const BodyEntry*>(mFile.Data() + sizeof(Header));
+
+		// offsets of each body's segments within a record, in floats
+		uint64_t recordFloats = 0;
+		mBodyOffsets.resize(mHeader->mBodyCount);
+		for (uint32_t index = 0; index < mHeader->mBodyCount; ++index)
+		{
+			const BodyEntry& body = mBodies[index];
+			if ((body.mParent != InvalidIndex && body.mParent >= index) || body.mSegmentCount == 0)
+			{
+				throw runtime_error("Invalid ephemeris body table: " + path);
+			}
+			mBodyOffsets[index] = static_cast<uint32_t>(recordFloats);
+			recordFloats += static_cast<uint64_t>(body.mSegmentCount) * (mHeader->mDegree + 1) * 3;
+		}
+
+		uint64_t expectedSize = coefficientOffset + recordFloats * mHeader->mRecordCount * sizeof(float);
+		if (mHeader->mRecordCount == 0 || !(mHeader->mRecordLength > 0) || recordFloats > numeric_limits<uint32_t>::max() || mFile.Size() != expectedSize)
+		{
+			throw runtime_error("Ephemeris file is truncated: " + path);
+		}
+		mRecordFloats = static_cast<uint32_t>(recordFloats);
+		mCoefficients = reinterpret_cast<const float*>(mFile.Data() + coefficientOffset);
+	}
+
+	uint32_t Ephemeris::BodyCount() const
+	{
+		return mHeader->mBodyCount;
+	}
+
+	string Ephemeris::BodyName(uint32_t index) const
+	{
+		const char* name = mBodies[index].mName;
+		return string(name, find(name, name + sizeof(mBodies[index].mName), '\0'));
+	}
+
+	uint32_t Ephemeris::Parent(uint32_t index) const
+	{
+		return mBodies[index].mParent;
+	}
+
+	uint32_t Ephemeris::SegmentCount(uint32_t index) const
+	{
+		return mBodies[index].mSegmentCount;
+	}
+
+	uint32_t Ephemeris::Degree() const
+	{
+		return mHeader->mDegree;
+	}
+
+	uint32_t Ephemeris::RecordCount() const
+	{
+		return mHeader->mRecordCount;
+	}
+
+	double Ephemeris::StartTime() const
+	{
+		return mHeader->mStartTime;
+	}
+
+	double Ephemeris::EndTime() const
+	{
+		return mHeader->mStartTime + mHeader->mRecordLength * mHeader->mRecordCount;
+	}
+
+	double Ephemeris::RecordLength() const
+	{
+		return mHeader->mRecordLength;
+	}
+
+	uint64_t Ephemeris::FileSize() const
+	{
+		return mFile.Size();
+	}
+
+	void Ephemeris::Evaluate(double time, float* positionX, float* positionY, float* positionZ) const
+	{
+		EvaluateRelative(time, positionX, positionY, positionZ);
+		for (uint32_t index = 0; index < mHeader->mBodyCount; ++index)
+		{
+			uint32_t parent = mBodies[index].mParent;
+			if (parent != InvalidIndex)
+			{
+				positionX[index] += positionX[parent];
+				positionY[index] += positionY[parent];
+				positionZ[index] += positionZ[parent];
+			}
+		}
+	}
+
+	void Ephemeris::EvaluateRelative(double time, float* positionX, float* positionY, float* positionZ) const
+	{
+		double recordPosition = (time - mHeader->mStartTime) / mHeader->mRecordLength;
+		recordPosition = min(max(recordPosition, 0.0), static_cast<double>(mHeader->mRecordCount));
+		uint32_t record = min(static_cast<uint32_t>(recordPosition), mHeader->mRecordCount - 1);
+		double recordFraction = recordPosition - record;
+
+		const float* recordCoefficients = mCoefficients + static_cast<uint64_t>(record) * mRecordFloats;
+		uint32_t coefficientCount = mHeader->mDegree + 1;
+		for (uint32_t index = 0; index < mHeader->mBodyCount; ++index)
+		{
+			uint32_t segmentCount = mBodies[index].mSegmentCount;
+			double segmentPosition = recordFraction * segmentCount;
+			uint32_t segment = min(static_cast<uint32_t>(segmentPosition), segmentCount - 1);
+			float x = static_cast<float>(2.0 * (segmentPosition - segment) - 1.0);
+
+			// Clenshaw: b_k = c_k + 2x b_k+1 - b_k+2, then p(x) = c_0 + x b_1 - b_2
+			const XMFLOAT3* coefficients = reinterpret_cast<const XMFLOAT3*>(recordCoefficients + mBodyOffsets[index]) + segment * coefficientCount;
+			XMVECTOR twoX = XMVectorReplicate(2.0f * x);
+			XMVECTOR next = XMVectorZero();
+			XMVECTOR nextNext = XMVectorZero();
+			for (uint32_t degree = coefficientCount - 1; degree > 0; --degree)
+			{
+				XMVECTOR current = XMVectorSubtract(XMVectorMultiplyAdd(twoX, next, XMLoadFloat3(&coefficients[degree])), nextNext);
+				nextNext = next;
+				next = current;
+			}
+			XMVECTOR position = XMVectorSubtract(XMVectorMultiplyAdd(XMVectorReplicate(x), next, XMLoadFloat3(&coefficients[0])), nextNext);
+
+			XMFLOAT3 relativePosition;
+			XMStoreFloat3(&relativePosition, position);
+			positionX[index] = relativePosition.x;
+			positionY[index] = relativePosition.y;
+			positionZ[index] = relativePosition.z;
+		}
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+namespace Simulation
+{
+	// Read side of a Chebyshev ephemeris file written by EphemerisBuilder. The file is memory mapped rather than read,
+	// so opening a decade long table costs nothing up front and a seek only touches the pages of one record.
+	//
+	// Time is cut into records of RecordLength() seconds. Each body splits every record into its own power-of-two number
+	// of segments and stores, for each segment, Degree() + 1 Chebyshev coefficients of its position relative to its
+	// parent, so fast moons get short segments without bloating the slow planets. Evaluate sums the relative positions
+	// down the hierarchy, parents first, with a Clenshaw recurrence of a few FMAs per body. Times outside the table are
+	// clamped to its ends.
+	//
+	// File layout, native little endian: a Header, BodyCount() BodyEntry structs, then RecordCount() records of
+	// coefficients as float x, y, z triples, bodies in order, segments in order, coefficients lowest degree first.
+	class Ephemeris final
+	{
+	public:
+		explicit Ephemeris(const std::string& path);
+		Ephemeris(const Ephemeris&) = delete;
+		Ephemeris& operator=(const Ephemeris&) = delete;
+		Ephemeris(Ephemeris&&) = delete;
+		Ephemeris& operator=(Ephemeris&&) = delete;
+		~Ephemeris() = default;
+
+		std::uint32_t BodyCount() const;
+		std::string BodyName(std::uint32_t index) const;
+		std::uint32_t Parent(std::uint32_t index) const;
+		std::uint32_t SegmentCount(std::uint32_t index) const;
+		std::uint32_t Degree() const;
+		std::uint32_t RecordCount() const;
+		double StartTime() const;
+		double EndTime() const;
+		double RecordLength() const;
+		std::uint64_t FileSize() const;
+
+		// World positions of every body at time, written to separate component arrays of BodyCount() floats.
+		void Evaluate(double time, float* positionX, float* positionY, float* positionZ) const;
+		// The same before the sum: every body's fitted position relative to its parent, a root's relative to the origin.
+		void EvaluateRelative(double time, float* positionX, float* positionY, float* positionZ) const;
+
+		static const char Magic[8];
+		static const std::uint32_t FormatVersion;
+		static const std::uint32_t InvalidIndex;
+
+		struct Header
+		{
+			char mMagic[8];
+			std::uint32_t mVersion;
+			std::uint32_t mBodyCount;
+			std::uint32_t mDegree;
+			std::uint32_t mRecordCount;
+			double mStartTime;
+			double mRecordLength;
+		};
+
+		struct BodyEntry
+		{
+			char mName[32];
+			std::uint32_t mParent;
+			std::uint32_t mSegmentCount;
+		};
+
+	private:
+
+		MappedFile mFile;
+
+		const Header* mHeader;
+		const BodyEntry* mBodies;
+		const float* mCoefficients;
+		std::vector<std::uint32_t> mBodyOffsets;
+		std::uint32_t mRecordFloats;
+	};
+}
@@ -0,0 +1,214 @@
+#include "pch.h"
+#include "EphemerisBuilder.h"
+#include "Ephemeris.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t EphemerisBuilder::DefaultDegree = 12;
+	const uint32_t EphemerisBuilder::SegmentsPerOrbit = 4;
+	const uint32_t EphemerisBuilder::MaxSegments = 1 << 16;
+	const double EphemerisBuilder::MaxEccentricity = 0.999;
+
+	EphemerisBuilder::EphemerisBuilder(const vector<string>& names, const vector<uint32_t>& parents, const vector<double>& periods,
+		double startTime, double recordLength, uint32_t degree) :
+		mNames(names), mParents(parents), mSegmentCounts(names.size(), 1), mStartTime(startTime), mRecordLength(recordLength),
+		mDegree(degree), mRecordCount(0)
+	{
+		if (parents.size() != names.size() || periods.size() != names.size())
+		{
+			throw runtime_error("Ephemeris hierarchy does not match the body count");
+		}
+		if (!(recordLength > 0) || degree == 0)
+		{
+			throw runtime_error("Ephemeris record length and degree must be positive");
+		}
+
+		for (uint32_t index = 0; index < mNames.size(); ++index)
+		{
+			if (mNames[index].size() >= sizeof(Ephemeris::BodyEntry::mName))
+			{
+				throw runtime_error("Body name too long for an ephemeris: " + mNames[index]);
+			}
+			if (mParents[index] != Ephemeris::InvalidIndex && mParents[index] >= index)
+			{
+				throw runtime_error("Ephemeris parents must precede their children");
+			}
+
+			double segmentsNeeded = (periods[index] > 0) ? (recordLength * SegmentsPerOrbit / periods[index]) : 1.0;
+			while (mSegmentCounts[index] < segmentsNeeded && mSegmentCounts[index] < MaxSegments)
+			{
+				mSegmentCounts[index] *= 2;
+			}
+		}
+
+		// the nodes of every distinct segment count, as fractions of a record, merged into one ascending sample list
+		mDistinctSegmentCounts = mSegmentCounts;
+		sort(mDistinctSegmentCounts.begin(), mDistinctSegmentCounts.end());
+		mDistinctSegmentCounts.erase(unique(mDistinctSegmentCounts.begin(), mDistinctSegmentCounts.end()), mDistinctSegmentCounts.end());
+
+		uint32_t nodeCount = mDegree + 1;
+		vector<vector<double>> nodeOffsets(mDistinctSegmentCounts.size());
+		for (size_t distinct = 0; distinct < mDistinctSegmentCounts.size(); ++distinct)
+		{
+			uint32_t segmentCount = mDistinctSegmentCounts[distinct];
+			for (uint32_t segment = 0; segment < segmentCount; ++segment)
+			{
+				for (uint32_t node = 0; node < nodeCount; ++node)
+				{
+					double x = cos(XM_PI * (node + 0.5) / nodeCount);
+					nodeOffsets[distinct].push_back((segment + 0.5 * (1.0 + x)) / segmentCount);
+				}
+			}
+			mNodeOffsets.insert(mNodeOffsets.end(), nodeOffsets[distinct].begin(), nodeOffsets[distinct].end());
+		}
+		sort(mNodeOffsets.begin(), mNodeOffsets.end());
+		mNodeOffsets.erase(unique(mNodeOffsets.begin(), mNodeOffsets.end()), mNodeOffsets.end());
+
+		mNodeSamples.resize(mDistinctSegmentCounts.size());
+		for (size_t distinct = 0; distinct < mDistinctSegmentCounts.size(); ++distinct)
+		{
+			for (double offset : nodeOffsets[distinct])
+			{
+				auto sample = lower_bound(mNodeOffsets.begin(), mNodeOffsets.end(), offset);
+				mNodeSamples[distinct].push_back(static_cast<uint32_t>(sample - mNodeOffsets.begin()));
+			}
+		}
+
+		ComputeSampleTimes();
+	}
+
+	uint32_t EphemerisBuilder::RecordCount() const
+	{
+		return mRecordCount;
+	}
+
+	uint32_t EphemerisBuilder::SegmentCount(uint32_t index) const
+	{
+		return mSegmentCounts[index];
+	}
+
+	const vector<double>& EphemerisBuilder::SampleTimes() const
+	{
+		return mSampleTimes;
+	}
+
+	void EphemerisBuilder::AddRecord(const vector<WorldPosition>& positions)
+	{
+		uint32_t bodyCount = static_cast<uint32_t>(mNames.size());
+		if (positions.size() != mSampleTimes.size() * bodyCount)
+		{
+			throw runtime_error("Ephemeris record needs a position for every body at every sample time");
+		}
+
+		// cos(pi j (k + 1/2) / n) for every coefficient j and node k
+		uint32_t nodeCount = mDegree + 1;
+		vector<double> cosines(nodeCount * nodeCount);
+		for (uint32_t degree = 0; degree < nodeCount; ++degree)
+		{
+			for (uint32_t node = 0; node < nodeCount; ++node)
+			{
+				cosines[degree * nodeCount + node] = cos(XM_PI * degree * (node + 0.5) / nodeCount);
+			}
+		}
+
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			size_t distinct = lower_bound(mDistinctSegmentCounts.begin(), mDistinctSegmentCounts.end(), mSegmentCounts[index]) - mDistinctSegmentCounts.begin();
+			const vector<uint32_t>& nodeSamples = mNodeSamples[distinct];
+			uint32_t parent = mParents[index];
+
+			for (uint32_t segment = 0; segment < mSegmentCounts[index]; ++segment)
+			{
+				for (uint32_t degree = 0; degree < nodeCount; ++degree)
+				{
+					double sum[3] = { 0, 0, 0 };
+					for (uint32_t node = 0; node < nodeCount; ++node)
+					{
+						uint32_t sample = nodeSamples[segment * nodeCount + node];
+						const WorldPosition& position = positions[sample * bodyCount + index];
+						double relative[3] = { position.mX, position.mY, position.mZ };
+						if (parent != Ephemeris::InvalidIndex)
+						{
+							const WorldPosition& parentPosition = positions[sample * bodyCount + parent];
+							relative[0] -= parentPosition.mX;
+							relative[1] -= parentPosition.mY;
+							relative[2] -= parentPosition.mZ;
+						}
+
+						double weight = cosines[degree * nodeCount + node];
+						sum[0] += weight * relative[0];
+						sum[1] += weight * relative[1];
+						sum[2] += weight * relative[2];
+					}
+
+					double scale = ((degree == 0) ? 1.0 : 2.0) / nodeCount;
+					mCoefficients.push_back(static_cast<float>(sum[0] * scale));
+					mCoefficients.push_back(static_cast<float>(sum[1] * scale));
+					mCoefficients.push_back(static_cast<float>(sum[2] * scale));
+				}
+			}
+		}
+
+		++mRecordCount;
+		ComputeSampleTimes();
+	}
+
+	void EphemerisBuilder::Write(const string& path) const
+	{
+		if (mRecordCount == 0)
+		{
+			throw runtime_error("Ephemeris has no records");
+		}
+
+		ofstream file(path, ios::binary);
+		if (!file.good())
+		{
+			throw runtime_error("Could not open file: " + path);
+		}
+
+		Ephemeris::Header header = {};
+		memcpy(header.mMagic, Ephemeris::Magic, sizeof(header.mMagic));
+		header.mVersion = Ephemeris::FormatVersion;
+		header.mBodyCount = static_cast<uint32_t>(mNames.size());
+		header.mDegree = mDegree;
+		header.mRecordCount = mRecordCount;
+		header.mStartTime = mStartTime;
+		header.mRecordLength = mRecordLength;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		for (uint32_t index = 0; index < mNames.size(); ++index)
+		{
+			Ephemeris::BodyEntry body = {};
+			memcpy(body.mName, mNames[index].c_str(), mNames[index].size());
+			body.mParent = mParents[index];
+			body.mSegmentCount = mSegmentCounts[index];
+			file.write(reinterpret_cast<const char*>(&body), sizeof(body));
+		}
+
+		file.write(reinterpret_cast<const char*>(mCoefficients.data()), mCoefficients.size() * sizeof(float));
+		if (!file.good())
+		{
+			throw runtime_error("Could not write file: " + path);
+		}
+	}
+
+	double EphemerisBuilder::PeriapsisPeriod(double period, double eccentricity)
+	{
+		double e = min(max(eccentricity, 0.0), MaxEccentricity);
+		double oneMinusSquare = 1.0 - e * e;
+		return period * oneMinusSquare * sqrt(oneMinusSquare) / ((1.0 + e) * (1.0 + e));
+	}
+
+	void EphemerisBuilder::ComputeSampleTimes()
+	{
+		double recordStart = mStartTime + mRecordCount * mRecordLength;
+		mSampleTimes.resize(mNodeOffsets.size());
+		for (size_t sample = 0; sample < mNodeOffsets.size(); ++sample)
+		{
+			mSampleTimes[sample] = recordStart + mNodeOffsets[sample] * mRecordLength;
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "WorldPosition.h"
+
+namespace Simulation
+{
+	// Fits a propagator run into the piecewise Chebyshev tables read by Ephemeris, in the style of the JPL development
+	// ephemerides. The caller asks for the sample times of each record, advances its propagator to them in order and
+	// hands back the world positions; each body's segments are interpolated at the Degree + 1 Chebyshev nodes of the
+	// first kind, which is within a small factor of the best polynomial fit and needs no solve, only a cosine transform.
+	// World positions are taken in double, as a moon far from the origin would lose most of its orbit to float rounding
+	// before its parent's position was even subtracted.
+	//
+	// A body gets enough power-of-two segments per record for SegmentsPerOrbit segments per period, where the period
+	// given for it should be the shortest motion its parent-relative position shows: its own orbit, or a satellite's if
+	// that pulls it around faster. An eccentric orbit sweeps most of its angle around periapsis, so its period should
+	// first go through PeriapsisPeriod, or a comet gets the segments of a circle and misses its turn by a wide margin.
+	class EphemerisBuilder final
+	{
+	public:
+		// parents[i] must precede body i; periods[i] of 0 means the body only needs a single segment per record.
+		EphemerisBuilder(const std::vector<std::string>& names, const std::vector<std::uint32_t>& parents, const std::vector<double>& periods,
+			double startTime, double recordLength, std::uint32_t degree = DefaultDegree);
+		EphemerisBuilder(const EphemerisBuilder&) = delete;
+		EphemerisBuilder& operator=(const EphemerisBuilder&) = delete;
+		EphemerisBuilder(EphemerisBuilder&&) = default;
+		EphemerisBuilder& operator=(EphemerisBuilder&&) = default;
+		~EphemerisBuilder() = default;
+
+		std::uint32_t RecordCount() const;
+		std::uint32_t SegmentCount(std::uint32_t index) const;
+
+		// Ascending times at which the next record needs world positions.
+		const std::vector<double>& SampleTimes() const;
+		// Fits the next record from world positions of every body, sample major, in SampleTimes() order.
+		void AddRecord(const std::vector<WorldPosition>& positions);
+
+		void Write(const std::string& path) const;
+
+		// Period of the circular orbit that turns as fast as one of the given period and eccentricity does at periapsis,
+		// where its angular rate is (1 + e)^2 / (1 - e^2)^(3/2) times the mean motion.
+		static double PeriapsisPeriod(double period, double eccentricity);
+
+		static const std::uint32_t DefaultDegree;
+		static const std::uint32_t SegmentsPerOrbit;
+		static const std::uint32_t MaxSegments;
+		// PeriapsisPeriod clamps to this, as a parabola has no period to scale
+		static const double MaxEccentricity;
+
+	private:
+		void ComputeSampleTimes();
+
+		std::vector<std::string> mNames;
+		std::vector<std::uint32_t> mParents;
+		std::vector<std::uint32_t> mSegmentCounts;
+		double mStartTime;
+		double mRecordLength;
+		std::uint32_t mDegree;
+
+		// for each distinct segment count, the sample index of every node of every segment
+		std::vector<std::uint32_t> mDistinctSegmentCounts;
+		std::vector<std::vector<std::uint32_t>> mNodeSamples;
+		std::vector<double> mNodeOffsets;
+		std::vector<double> mSampleTimes;
+		std::vector<float> mCoefficients;
+		std::uint32_t mRecordCount;
+	};
+}
@@ -0,0 +1,545 @@
+#include "pch.h"
+#include "EventFinder.h"
+#include "BodySystem.h"
+#include "BodyStateStore.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t EventFinder::TimeChunkCount = 64;
+	const uint32_t EventFinder::SearchGrainSize = 4;
+	const uint32_t EventFinder::PeakIterations = 64;
+	const double EventFinder::ContactStrideFraction = 0.25;
+
+	namespace
+	{
+		const double GoldenSection = 0.3819660112501051;
+
+		bool EarlierEvent(const OrbitalEvent& first, const OrbitalEvent& second)
+		{
+			if (first.mStart != second.mStart)
+			{
+				return first.mStart < second.mStart;
+			}
+			if (first.mType != second.mType)
+			{
+				return first.mType < second.mType;
+			}
+			if (first.mBody != second.mBody)
+			{
+				return first.mBody < second.mBody;
+			}
+			return first.mOther < second.mOther;
+		}
+	}
+
+	EventFinder::EventFinder(const BodySystem& bodySystem) :
+		mBodySystem(&bodySystem), mQuery(), mEvaluationCount(0)
+	{
+	}
+
+	vector<OrbitalEvent> EventFinder::Find(const EventQuery& query)
+	{
+		Prepare(query);
+		uint32_t taskCount = static_cast<uint32_t>(mTasks.size());
+		for (uint32_t task = 0; task < taskCount; ++task)
+		{
+			Search(task);
+		}
+		return Collect();
+	}
+
+	vector<OrbitalEvent> EventFinder::Find(const EventQuery& query, ThreadPool& threadPool)
+	{
+		Prepare(query);
+		auto search = [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t task = begin; task < end; ++task)
+			{
+				Search(task);
+			}
+		};
+		threadPool.ParallelFor(0, static_cast<uint32_t>(mTasks.size()), SearchGrainSize, search);
+		return Collect();
+	}
+
+	uint32_t EventFinder::FunctionCount() const
+	{
+		return static_cast<uint32_t>(mFunctions.size());
+	}
+
+	uint64_t EventFinder::EvaluationCount() const
+	{
+		return mEvaluationCount;
+	}
+
+	void EventFinder::Prepare(const EventQuery& query)
+	{
+		if (mBodySystem->Mode() != SimulationMode::Kinematic)
+		{
+			throw runtime_error("Events can only be searched on scripted orbits");
+		}
+		if (!(query.mEnd > query.mBegin))
+		{
+			throw runtime_error("Event window must end after it begins");
+		}
+		if (!(query.mTolerance > 0))
+		{
+			throw runtime_error("Event tolerance must be positive");
+		}
+		if (query.mCloseApproaches && !(query.mCloseApproachDistance > 0))
+		{
+			throw runtime_error("Close approach distance must be positive");
+		}
+
+		mQuery = query;
+		mFunctions.clear();
+		uint32_t bodyCount = mBodySystem->BodyCount();
+		for (uint32_t body = 0; body < bodyCount; ++body)
+		{
+			if (mBodySystem->Parent(body) == BodySystem::InvalidIndex)
+			{
+				continue;
+			}
+
+			for (uint32_t other = 0; other < bodyCount; ++other)
+			{
+				if (other == body || mBodySystem->Parent(other) == BodySystem::InvalidIndex || Root(other) != Root(body))
+				{
+					continue;
+				}
+
+				bool related = (mBodySystem->Parent(body) == other || mBodySystem->Parent(other) == body);
+				if (related ? mQuery.mEclipses : mQuery.mTransits)
+				{
+					OrbitalEventType type = OrbitalEventType::Transit;
+					if (mBodySystem->Parent(body) == other)
+					{
+						type = OrbitalEventType::SolarEclipse;
+					}
+					else if (mBodySystem->Parent(other) == body)
+					{
+						type = OrbitalEventType::LunarEclipse;
+					}
+					AddFunction(type, body, other, 0.0f);
+				}
+
+				// a satellite always stays near its parent, so only unrelated pairs can approach
+				if (mQuery.mCloseApproaches && other > body && !related)
+				{
+					AddFunction(OrbitalEventType::CloseApproach, body, other, mQuery.mCloseApproachDistance);
+				}
+			}
+		}
+
+		mTasks.resize(mFunctions.size() * TimeChunkCount);
+		mEvaluationCount = 0;
+	}
+
+	void EventFinder::AddFunction(OrbitalEventType type, uint32_t body, uint32_t other, float threshold)
+	{
+		Function function;
+		function.mType = type;
+		function.mBody = body;
+		function.mOther = other;
+		function.mSource = Root(body);
+		function.mBodyOrbits = PathOrbits(body, function.mSource);
+		function.mOtherOrbits = PathOrbits(other, body);
+		function.mOffsetOrbitCount = static_cast<uint32_t>(PathOrbits(body, other).size());
+		function.mBodyRadius = Radius(body);
+		// transits are seen from the observer's centre
+		function.mOtherRadius = (type == OrbitalEventType::Transit) ? 0.0f : Radius(other);
+		function.mSourceRadius = Radius(function.mSource);
+		function.mThreshold = threshold;
+
+		double relativeSpeed = SpeedBound(body, other);
+		double contactScale = threshold;
+		if (type == OrbitalEventType::CloseApproach)
+		{
+			function.mRateBound = relativeSpeed;
+		}
+		else
+		{
+			// The target's distance from the shadow axis changes with their relative motion and with the axis turning
+			// about the source, and the cone radius at the target with the distance along the axis and its slope.
+			double along = DistanceBound(body, other);
+			double sourceDistance = max(RootDistanceBound(body), static_cast<double>(function.mSourceRadius + function.mBodyRadius));
+			double axisRate = SpeedBound(body, function.mSource) / sourceDistance;
+			double slope = (function.mSourceRadius + function.mBodyRadius) / sourceDistance;
+			function.mRateBound = (1.0 + slope) * (relativeSpeed + along * axisRate) + along * slope * axisRate;
+			contactScale = function.mBodyRadius + function.mOtherRadius;
+		}
+
+		// bodies that never move relative to each other still need a finite stride
+		if (!(function.mRateBound > 0))
+		{
+			function.mRateBound = numeric_limits<float>::min();
+		}
+		function.mMinimumStride = max(ContactStrideFraction * contactScale / function.mRateBound, mQuery.mTolerance);
+		mFunctions.push_back(move(function));
+	}
+
+	void EventFinder::Search(uint32_t taskIndex)
+	{
+		const Function& function = mFunctions[taskIndex / TimeChunkCount];
+		uint32_t chunk = taskIndex % TimeChunkCount;
+		double chunkDuration = (mQuery.mEnd - mQuery.mBegin) / TimeChunkCount;
+		double begin = mQuery.mBegin + chunk * chunkDuration;
+		double end = (chunk + 1 == TimeChunkCount) ? mQuery.mEnd : begin + chunkDuration;
+
+		Task& task = mTasks[taskIndex];
+		task.mFound.clear();
+		task.mEvaluationCount = 0;
+
+		float distance;
+		bool umbral;
+		double time = begin;
+		float separation = Separation(function, time, distance, umbral);
+		++task.mEvaluationCount;
+
+		Found found = {};
+		bool inside = (separation < 0);
+		if (inside)
+		{
+			found.mEvent.mStart = begin;
+			found.mClippedStart = true;
+		}
+
+		while (time < end)
+		{
+			// no sign change can hide within |g| / L, and the minimum keeps the stride from vanishing at a contact
+			double stride = max(fabs(separation) / function.mRateBound, function.mMinimumStride);
+			double next = min(time + stride, end);
+			float nextSeparation = Separation(function, next, distance, umbral);
+			++task.mEvaluationCount;
+
+			if ((nextSeparation < 0) != inside)
+			{
+				if (inside)
+				{
+					found.mEvent.mEnd = Refine(function, time, separation, next, nextSeparation, task.mEvaluationCount);
+					Close(function, found, task.mEvaluationCount);
+					task.mFound.push_back(found);
+				}
+				else
+				{
+					found = {};
+					found.mEvent.mStart = Refine(function, next, nextSeparation, time, separation, task.mEvaluationCount);
+				}
+				inside = !inside;
+			}
+
+			time = next;
+			separation = nextSeparation;
+		}
+
+		if (inside)
+		{
+			found.mEvent.mEnd = end;
+			found.mClippedEnd = true;
+			Close(function, found, task.mEvaluationCount);
+			task.mFound.push_back(found);
+		}
+	}
+
+	vector<OrbitalEvent> EventFinder::Collect()
+	{
+		vector<Found> joined;
+		uint32_t taskCount = static_cast<uint32_t>(mTasks.size());
+		for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+		{
+			Task& task = mTasks[taskIndex];
+			mEvaluationCount += task.mEvaluationCount;
+
+			// tasks run chunk by chunk within a function, so a cut event continues in the next task's first event
+			bool continues = (taskIndex % TimeChunkCount != 0);
+			for (const Found& found : task.mFound)
+			{
+				if (continues && found.mClippedStart && !joined.empty() && joined.back().mClippedEnd && joined.back().mEvent.mEnd == found.mEvent.mStart)
+				{
+					Found& previous = joined.back();
+					previous.mEvent.mEnd = found.mEvent.mEnd;
+					previous.mClippedEnd = found.mClippedEnd;
+					if (found.mPeakSeparation < previous.mPeakSeparation)
+					{
+						previous.mEvent.mPeak = found.mEvent.mPeak;
+						previous.mEvent.mDistance = found.mEvent.mDistance;
+						previous.mEvent.mUmbral = found.mEvent.mUmbral;
+						previous.mPeakSeparation = found.mPeakSeparation;
+					}
+				}
+				else
+				{
+					joined.push_back(found);
+				}
+				continues = false;
+			}
+		}
+
+		vector<OrbitalEvent> events;
+		events.reserve(joined.size());
+		for (const Found& found : joined)
+		{
+			events.push_back(found.mEvent);
+		}
+		sort(events.begin(), events.end(), EarlierEvent);
+		return events;
+	}
+
+	float EventFinder::Separation(const Function& function, double time, float& distance, bool& umbral) const
+	{
+		// both vectors are sums of orbits about parents: the body's up to the root, and the path from the body to the other
+		const BodyStateStore& states = mBodySystem->States();
+		bool closeApproach = (function.mType == OrbitalEventType::CloseApproach);
+		uint32_t bodyOrbitCount = closeApproach ? function.mOffsetOrbitCount : static_cast<uint32_t>(function.mBodyOrbits.size());
+		XMVECTOR axis = XMVectorZero();
+		XMVECTOR offset = XMVectorZero();
+		for (uint32_t orbit = 0; orbit < bodyOrbitCount; ++orbit)
+		{
+			XMVECTOR position = states.EvaluateLocalPosition(function.mBodyOrbits[orbit], time);
+			axis = XMVectorAdd(axis, position);
+			if (orbit < function.mOffsetOrbitCount)
+			{
+				offset = XMVectorSubtract(offset, position);
+			}
+		}
+		for (uint32_t orbit : function.mOtherOrbits)
+		{
+			offset = XMVectorAdd(offset, states.EvaluateLocalPosition(orbit, time));
+		}
+		umbral = false;
+
+		if (closeApproach)
+		{
+			distance = XMVectorGetX(XMVector3Length(offset));
+			return distance - function.mThreshold;
+		}
+
+		float sourceDistance = XMVectorGetX(XMVector3Length(axis));
+		axis = XMVectorScale(axis, 1.0f / sourceDistance);
+		float along = XMVectorGetX(XMVector3Dot(offset, axis));
+		if (along <= 0)
+		{
+			// on the lit side the function is just the gap between the spheres, which meets the cone at along = 0
+			distance = XMVectorGetX(XMVector3Length(offset));
+			return distance - function.mOtherRadius - function.mBodyRadius;
+		}
+
+		distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(offset, XMVectorScale(axis, along))));
+		float penumbra = function.mBodyRadius + along * (function.mSourceRadius + function.mBodyRadius) / sourceDistance;
+		float umbra = function.mBodyRadius - along * (function.mSourceRadius - function.mBodyRadius) / sourceDistance;
+		umbral = (distance - function.mOtherRadius < fabs(umbra));
+		return distance - function.mOtherRadius - penumbra;
+	}
+
+	double EventFinder::Refine(const Function& function, double inside, float insideSeparation, double outside, float outsideSeparation, uint64_t& evaluationCount) const
+	{
+		// Illinois variant of regula falsi: the end that survives twice in a row has its value halved, so both ends close in
+		float distance;
+		bool umbral;
+		int kept = 0;
+		while (fabs(outside - inside) > mQuery.mTolerance)
+		{
+			double time = (inside * outsideSeparation - outside * insideSeparation) / (outsideSeparation - insideSeparation);
+			if (!(time > min(inside, outside) && time < max(inside, outside)))
+			{
+				time = 0.5 * (inside + outside);
+			}
+
+			float separation = Separation(function, time, distance, umbral);
+			++evaluationCount;
+			if (separation < 0)
+			{
+				inside = time;
+				insideSeparation = separation;
+				outsideSeparation *= (kept < 0) ? 0.5f : 1.0f;
+				kept = min(kept, 0) - 1;
+			}
+			else
+			{
+				outside = time;
+				outsideSeparation = separation;
+				insideSeparation *= (kept > 0) ? 0.5f : 1.0f;
+				kept = max(kept, 0) + 1;
+			}
+		}
+		return 0.5 * (inside + outside);
+	}
+
+	void EventFinder::Close(const Function& function, Found& found, uint64_t& evaluationCount) const
+	{
+		// Brent's minimisation: parabolic steps through the best three points, golden section steps when those misbehave
+		float distance;
+		bool umbral;
+		double tolerance = 0.5 * mQuery.mTolerance;
+		double lower = found.mEvent.mStart;
+		double upper = found.mEvent.mEnd;
+		double best = lower + GoldenSection * (upper - lower);
+		double second = best;
+		double third = best;
+		float bestSeparation = Separation(function, best, distance, umbral);
+		float secondSeparation = bestSeparation;
+		float thirdSeparation = bestSeparation;
+		double step = 0;
+		double previousStep = 0;
+		++evaluationCount;
+
+		for (uint32_t iteration = 0; iteration < PeakIterations; ++iteration)
+		{
+			double middle = 0.5 * (lower + upper);
+			if (fabs(best - middle) <= 2 * tolerance - 0.5 * (upper - lower))
+			{
+				break;
+			}
+
+			bool parabolic = false;
+			if (fabs(previousStep) > tolerance)
+			{
+				double r = (best - second) * (bestSeparation - thirdSeparation);
+				double q = (best - third) * (bestSeparation - secondSeparation);
+				double p = (best - third) * q - (best - second) * r;
+				q = 2 * (q - r);
+				p = (q > 0) ? -p : p;
+				q = fabs(q);
+				if (fabs(p) < fabs(0.5 * q * previousStep) && p > q * (lower - best) && p < q * (upper - best))
+				{
+					previousStep = step;
+					step = p / q;
+					parabolic = true;
+					double time = best + step;
+					if (time - lower < 2 * tolerance || upper - time < 2 * tolerance)
+					{
+						step = (middle >= best) ? tolerance : -tolerance;
+					}
+				}
+			}
+			if (!parabolic)
+			{
+				previousStep = (best >= middle) ? lower - best : upper - best;
+				step = GoldenSection * previousStep;
+			}
+
+			double time = (fabs(step) >= tolerance) ? best + step : best + ((step >= 0) ? tolerance : -tolerance);
+			float separation = Separation(function, time, distance, umbral);
+			++evaluationCount;
+			if (separation <= bestSeparation)
+			{
+				(time >= best) ? (lower = best) : (upper = best);
+				third = second;
+				thirdSeparation = secondSeparation;
+				second = best;
+				secondSeparation = bestSeparation;
+				best = time;
+				bestSeparation = separation;
+			}
+			else
+			{
+				(time < best) ? (lower = time) : (upper = time);
+				if (separation <= secondSeparation || second == best)
+				{
+					third = second;
+					thirdSeparation = secondSeparation;
+					second = time;
+					secondSeparation = separation;
+				}
+				else if (separation <= thirdSeparation || third == best || third == second)
+				{
+					third = time;
+					thirdSeparation = separation;
+				}
+			}
+		}
+
+		OrbitalEvent& event = found.mEvent;
+		event.mType = function.mType;
+		event.mBody = function.mBody;
+		event.mOther = function.mOther;
+		event.mPeak = best;
+		found.mPeakSeparation = Separation(function, best, event.mDistance, event.mUmbral);
+		++evaluationCount;
+	}
+
+	uint32_t EventFinder::Root(uint32_t index) const
+	{
+		while (mBodySystem->Parent(index) != BodySystem::InvalidIndex)
+		{
+			index = mBodySystem->Parent(index);
+		}
+		return index;
+	}
+
+	float EventFinder::Radius(uint32_t index) const
+	{
+		return mBodySystem->Constants().mDiameter * mBodySystem->Data(index).mDiameter / 2;
+	}
+
+	vector<uint32_t> EventFinder::PathOrbits(uint32_t first, uint32_t second) const
+	{
+		vector<uint32_t> orbits;
+		for (uint32_t index = first; index != BodySystem::InvalidIndex; index = mBodySystem->Parent(index))
+		{
+			uint32_t ancestor = second;
+			while (ancestor != BodySystem::InvalidIndex && ancestor != index)
+			{
+				ancestor = mBodySystem->Parent(ancestor);
+			}
+			if (ancestor == index)
+			{
+				break;
+			}
+			orbits.push_back(index);
+		}
+		return orbits;
+	}
+
+	double EventFinder::SpeedBound(uint32_t first, uint32_t second) const
+	{
+		// every orbit on the path between the bodies can add at most its periapsis speed
+		const BodyStateStore& states = mBodySystem->States();
+		vector<uint32_t> orbits = PathOrbits(first, second);
+		vector<uint32_t> otherOrbits = PathOrbits(second, first);
+		orbits.insert(orbits.end(), otherOrbits.begin(), otherOrbits.end());
+
+		double bound = 0;
+		for (uint32_t index : orbits)
+		{
+			double eccentricity = states.Eccentricity(index);
+			bound += XM_2PI * fabs(states.OrbitalFrequency(index)) * states.SemiMajorAxis(index) * sqrt((1 + eccentricity) / (1 - eccentricity));
+		}
+		return bound;
+	}
+
+	double EventFinder::DistanceBound(uint32_t first, uint32_t second) const
+	{
+		const BodyStateStore& states = mBodySystem->States();
+		vector<uint32_t> orbits = PathOrbits(first, second);
+		vector<uint32_t> otherOrbits = PathOrbits(second, first);
+		orbits.insert(orbits.end(), otherOrbits.begin(), otherOrbits.end());
+
+		double bound = 0;
+		for (uint32_t index : orbits)
+		{
+			bound += states.SemiMajorAxis(index) * (1 + states.Eccentricity(index));
+		}
+		return bound;
+	}
+
+	double EventFinder::RootDistanceBound(uint32_t index) const
+	{
+		// the orbit that reaches farthest, at its periapsis, less every other orbit on the way at its apoapsis
+		const BodyStateStore& states = mBodySystem->States();
+		double reach = DistanceBound(index, Root(index));
+		double bound = 0;
+		for (uint32_t orbit : PathOrbits(index, Root(index)))
+		{
+			double semiMajorAxis = states.SemiMajorAxis(orbit);
+			double eccentricity = states.Eccentricity(orbit);
+			double apoapsis = semiMajorAxis * (1 + eccentricity);
+			bound = max(bound, semiMajorAxis * (1 - eccentricity) - (reach - apoapsis));
+		}
+		return bound;
+	}
+}
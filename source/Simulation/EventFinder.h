@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Simulation
+{
+	class BodySystem;
+	class ThreadPool;
+
+	enum class OrbitalEventType
+	{
+		// mBody, a satellite, casts its shadow on mOther, its parent
+		SolarEclipse,
+		// mOther, a satellite, passes through the shadow of mBody, its parent
+		LunarEclipse,
+		// mBody crosses the disk of the root as seen from the centre of mOther
+		Transit,
+		// mBody and mOther come within the query's distance of each other
+		CloseApproach
+	};
+
+	// Times are simulation seconds, clipped to the query window when an event is under way at either end. mDistance is
+	// the closest centre to centre distance for a close approach, and otherwise the closest the centre of mOther came to
+	// the line from the root through mBody. mUmbral marks an eclipse that reached the umbra (or antumbra) and a transit
+	// that passed wholly inside the root's disk.
+	struct OrbitalEvent
+	{
+		OrbitalEventType mType;
+		std::uint32_t mBody;
+		std::uint32_t mOther;
+		double mStart;
+		double mPeak;
+		double mEnd;
+		float mDistance;
+		bool mUmbral;
+	};
+
+	// mTolerance is the accuracy of the event times, in simulation seconds.
+	struct EventQuery
+	{
+		double mBegin;
+		double mEnd;
+		bool mEclipses;
+		bool mTransits;
+		bool mCloseApproaches;
+		float mCloseApproachDistance;
+		double mTolerance;
+	};
+
+	// Searches the scripted orbits of a BodySystem for eclipses, transits and close approaches. Bodies are spheres of
+	// their catalog diameter and the light source of every body is the root it orbits. Each event is the interval where
+	// a separation function of two bodies is negative, scanned in strides its bounded rate of change cannot cross zero in.
+	class EventFinder final
+	{
+	public:
+		explicit EventFinder(const BodySystem& bodySystem);
+		EventFinder(const EventFinder&) = delete;
+		EventFinder& operator=(const EventFinder&) = delete;
+		EventFinder(EventFinder&&) = default;
+		EventFinder& operator=(EventFinder&&) = default;
+		~EventFinder() = default;
+
+		// Sorted by start time, and the same on any number of threads. Paused bodies stay where they are, and N-body or
+		// playback runs are refused, as their trajectories are not closed form.
+		std::vector<OrbitalEvent> Find(const EventQuery& query);
+		std::vector<OrbitalEvent> Find(const EventQuery& query, ThreadPool& threadPool);
+
+		// Number of pair functions the last Find searched and of the separations it evaluated.
+		std::uint32_t FunctionCount() const;
+		std::uint64_t EvaluationCount() const;
+
+		static const std::uint32_t TimeChunkCount;
+		static const std::uint32_t SearchGrainSize;
+		static const std::uint32_t PeakIterations;
+		static const double ContactStrideFraction;
+
+	private:
+		// mBodyOrbits runs from mBody up to the root, and its first mOffsetOrbitCount entries together with mOtherOrbits
+		// are the path between the two bodies.
+		struct Function
+		{
+			OrbitalEventType mType;
+			std::uint32_t mBody;
+			std::uint32_t mOther;
+			std::uint32_t mSource;
+			std::vector<std::uint32_t> mBodyOrbits;
+			std::vector<std::uint32_t> mOtherOrbits;
+			std::uint32_t mOffsetOrbitCount;
+			float mBodyRadius;
+			float mOtherRadius;
+			float mSourceRadius;
+			float mThreshold;
+			double mRateBound;
+			double mMinimumStride;
+		};
+
+		struct Found
+		{
+			OrbitalEvent mEvent;
+			float mPeakSeparation;
+			bool mClippedStart;
+			bool mClippedEnd;
+		};
+
+		struct Task
+		{
+			std::vector<Found> mFound;
+			std::uint64_t mEvaluationCount;
+		};
+
+		void Prepare(const EventQuery& query);
+		void AddFunction(OrbitalEventType type, std::uint32_t body, std::uint32_t other, float threshold);
+		void Search(std::uint32_t task);
+		std::vector<OrbitalEvent> Collect();
+
+		float Separation(const Function& function, double time, float& distance, bool& umbral) const;
+		double Refine(const Function& function, double inside, float insideSeparation, double outside, float outsideSeparation, std::uint64_t& evaluationCount) const;
+		void Close(const Function& function, Found& found, std::uint64_t& evaluationCount) const;
+
+		std::uint32_t Root(std::uint32_t index) const;
+		float Radius(std::uint32_t index) const;
+		// The first body and its ancestors up to, but not including, the closest one it shares with the second.
+		std::vector<std::uint32_t> PathOrbits(std::uint32_t first, std::uint32_t second) const;
+		// Bounds over the hierarchy between two bodies: the fastest they can move apart, and how far apart they can get.
+		double SpeedBound(std::uint32_t first, std::uint32_t second) const;
+		double DistanceBound(std::uint32_t first, std::uint32_t second) const;
+		// How close a body can come to the root it orbits.
+		double RootDistanceBound(std::uint32_t index) const;
+
+		const BodySystem* mBodySystem;
+		EventQuery mQuery;
+		std::vector<Function> mFunctions;
+		std::vector<Task> mTasks;
+		std::uint64_t mEvaluationCount;
+	};
+}
@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "FixedTimestep.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace Simulation
+{
+	const nanoseconds FixedTimestep::DefaultStepSize = duration_cast<nanoseconds>(duration<double>(1.0 / 60.0));
+	const uint32_t FixedTimestep::DefaultMaxStepsPerUpdate = 8;
+
+	FixedTimestep::FixedTimestep(nanoseconds stepSize, uint32_t maxStepsPerUpdate) :
+		mStepSize(0), mMaxStepsPerUpdate(0), mAccumulatedTime(0), mDroppedTime(0)
+	{
+		SetStepSize(stepSize);
+		SetMaxStepsPerUpdate(maxStepsPerUpdate);
+	}
+
+	nanoseconds FixedTimestep::StepSize() const
+	{
+		return mStepSize;
+	}
+
+	void FixedTimestep::SetStepSize(nanoseconds stepSize)
+	{
+		if (stepSize.count() <= 0)
+		{
+			throw runtime_error("Step size must be positive");
+		}
+		mStepSize = stepSize;
+		mAccumulatedTime = nanoseconds(0);
+	}
+
+	double FixedTimestep::StepSeconds() const
+	{
+		return duration_cast<duration<double>>(mStepSize).count();
+	}
+
+	uint32_t FixedTimestep::MaxStepsPerUpdate() const
+	{
+		return mMaxStepsPerUpdate;
+	}
+
+	void FixedTimestep::SetMaxStepsPerUpdate(uint32_t maxStepsPerUpdate)
+	{
+		if (maxStepsPerUpdate == 0)
+		{
+			throw runtime_error("At least one step per update must be allowed");
+		}
+		mMaxStepsPerUpdate = maxStepsPerUpdate;
+	}
+
+	uint32_t FixedTimestep::Advance(nanoseconds elapsedTime)
+	{
+		mAccumulatedTime += max(elapsedTime, nanoseconds(0));
+
+		int64_t stepCount = mAccumulatedTime / mStepSize;
+		if (stepCount > static_cast<int64_t>(mMaxStepsPerUpdate))
+		{
+			// keep the fraction so Alpha stays continuous, drop the whole steps beyond the cap
+			nanoseconds droppedTime = (stepCount - mMaxStepsPerUpdate) * mStepSize;
+			mDroppedTime += droppedTime;
+			mAccumulatedTime -= droppedTime;
+			stepCount = mMaxStepsPerUpdate;
+		}
+
+		mAccumulatedTime -= stepCount * mStepSize;
+		return static_cast<uint32_t>(stepCount);
+	}
+
+	float FixedTimestep::Alpha() const
+	{
+		return static_cast<float>(static_cast<double>(mAccumulatedTime.count()) / mStepSize.count());
+	}
+
+	nanoseconds FixedTimestep::DroppedTime() const
+	{
+		return mDroppedTime;
+	}
+
+	void FixedTimestep::Reset()
+	{
+		mAccumulatedTime = nanoseconds(0);
+		mDroppedTime = nanoseconds(0);
+	}
+}
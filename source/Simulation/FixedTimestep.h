@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace Simulation
+{
+	// Accumulates real elapsed time and hands it out as whole simulation steps of a fixed size, so the simulation takes
+	// the same steps no matter how the frames divide the time. A frame may get several steps or none; what is left over
+	// is carried to the next frame and exposed as Alpha(), the fraction of a step to interpolate the drawn state by.
+	// Time is counted in integer nanoseconds so the step count never drifts with rounding.
+	//
+	// A frame never gets more than MaxStepsPerUpdate() steps. When the simulation cannot keep up, the time beyond that is
+	// dropped instead of carried, so it slows down rather than falling further behind every frame.
+	class FixedTimestep final
+	{
+	public:
+		explicit FixedTimestep(std::chrono::nanoseconds stepSize = DefaultStepSize, std::uint32_t maxStepsPerUpdate = DefaultMaxStepsPerUpdate);
+		FixedTimestep(const FixedTimestep&) = delete;
+		FixedTimestep& operator=(const FixedTimestep&) = delete;
+		FixedTimestep(FixedTimestep&&) = default;
+		FixedTimestep& operator=(FixedTimestep&&) = default;
+		~FixedTimestep() = default;
+
+		std::chrono::nanoseconds StepSize() const;
+		void SetStepSize(std::chrono::nanoseconds stepSize);
+		double StepSeconds() const;
+		std::uint32_t MaxStepsPerUpdate() const;
+		void SetMaxStepsPerUpdate(std::uint32_t maxStepsPerUpdate);
+
+		// Adds a frame's elapsed time and returns the number of steps to take for it.
+		std::uint32_t Advance(std::chrono::nanoseconds elapsedTime);
+		// Fraction of a step accumulated but not yet taken, in [0, 1).
+		float Alpha() const;
+		// Time dropped by the step cap since the last Reset.
+		std::chrono::nanoseconds DroppedTime() const;
+		void Reset();
+
+		static const std::chrono::nanoseconds DefaultStepSize;
+		static const std::uint32_t DefaultMaxStepsPerUpdate;
+
+	private:
+		std::chrono::nanoseconds mStepSize;
+		std::uint32_t mMaxStepsPerUpdate;
+		std::chrono::nanoseconds mAccumulatedTime;
+		std::chrono::nanoseconds mDroppedTime;
+	};
+}
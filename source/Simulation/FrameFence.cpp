@@ -0,0 +1,43 @@
+#include "pch.h"
+#include "FrameFence.h"
+
+using namespace std;
+
+namespace Simulation
+{
+	FrameFence::FrameFence() :
+		mValue(0)
+	{
+	}
+
+	uint64_t FrameFence::CompletedValue() const
+	{
+		return mValue.load(memory_order_acquire);
+	}
+
+	void FrameFence::Signal(uint64_t value)
+	{
+		{
+			// taking the lock orders the store against a waiter that has checked the value but not yet gone to sleep
+			lock_guard<mutex> lock(mMutex);
+			mValue.store(value, memory_order_release);
+		}
+		mSignaled.notify_all();
+	}
+
+	void FrameFence::Wait(uint64_t value)
+	{
+		if (mValue.load(memory_order_acquire) >= value)
+		{
+			return;
+		}
+
+		unique_lock<mutex> lock(mMutex);
+		mSignaled.wait(lock, [this, value] { return (mValue.load(memory_order_acquire) >= value); });
+	}
+
+	void FrameFence::Reset(uint64_t value)
+	{
+		mValue.store(value, memory_order_release);
+	}
+}
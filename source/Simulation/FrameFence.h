@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace Simulation
+{
+	// Monotonic counter that one thread Signals as it completes numbered frames and another Waits on until a given frame
+	// is complete, in the manner of a GPU fence. Signal publishes everything written before it to whoever Waits for that
+	// value. Checking a completed value never locks; only a Wait that has to block and the Signal that wakes it do.
+	class FrameFence final
+	{
+	public:
+		FrameFence();
+		FrameFence(const FrameFence&) = delete;
+		FrameFence& operator=(const FrameFence&) = delete;
+		FrameFence(FrameFence&&) = delete;
+		FrameFence& operator=(FrameFence&&) = delete;
+		~FrameFence() = default;
+
+		std::uint64_t CompletedValue() const;
+		void Signal(std::uint64_t value);
+		void Wait(std::uint64_t value);
+		// Sets the value without waking anyone, for restarting a pipeline nobody waits on.
+		void Reset(std::uint64_t value);
+
+	private:
+		std::atomic<std::uint64_t> mValue;
+		std::mutex mMutex;
+		std::condition_variable mSignaled;
+	};
+}
@@ -0,0 +1,594 @@
+#include "pch.h"
+#include "GravityShard.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t GravityShard::GroupSize = 16;
+	const uint32_t GravityShard::GroupFanout = 8;
+
+	namespace
+	{
+		const uint32_t MortonBitsPerAxis = 21;
+		const uint32_t BoxFloats = 6;
+
+		// spreads the low 21 bits of value three bits apart
+		uint64_t SpreadBits(uint32_t value)
+		{
+			uint64_t bits = value & 0x1FFFFFull;
+			bits = (bits | bits << 32) & 0x1F00000000FFFFull;
+			bits = (bits | bits << 16) & 0x1F0000FF0000FFull;
+			bits = (bits | bits << 8) & 0x100F00F00F00F00Full;
+			bits = (bits | bits << 4) & 0x10C30C30C30C30C3ull;
+			bits = (bits | bits << 2) & 0x1249249249249249ull;
+			return bits;
+		}
+
+		template <typename Value>
+		void Append(vector<uint8_t>& bytes, const Value* values, size_t count)
+		{
+			size_t offset = bytes.size();
+			bytes.resize(offset + count * sizeof(Value));
+			memcpy(bytes.data() + offset, values, count * sizeof(Value));
+		}
+	}
+
+	GravityShard::GravityShard(const string& segmentName, uint32_t rank) :
+		mHeader(nullptr), mStatistics(nullptr), mBodies(nullptr), mRank(rank), mShardCount(0)
+	{
+		mSegment.Open(segmentName);
+		if (mSegment.Size() < sizeof(ShardedGravity::Header))
+		{
+			throw runtime_error("Shard segment is truncated: " + segmentName);
+		}
+
+		mHeader = reinterpret_cast<ShardedGravity::Header*>(mSegment.Data());
+		if (memcmp(mHeader->mMagic, ShardedGravity::Magic, sizeof(ShardedGravity::Magic)) != 0)
+		{
+			throw runtime_error("Not a shard segment: " + segmentName);
+		}
+		if (mHeader->mVersion != ShardedGravity::FormatVersion)
+		{
+			throw runtime_error("Unsupported shard segment version: " + to_string(mHeader->mVersion));
+		}
+
+		mShardCount = mHeader->mShardCount;
+		uint64_t ringsEnd = mHeader->mRingsOffset + static_cast<uint64_t>(mShardCount) * mShardCount * mHeader->mRingStride;
+		if (rank >= mShardCount || mSegment.Size() < ringsEnd)
+		{
+			throw runtime_error("Invalid shard segment: " + segmentName);
+		}
+		mStatistics = reinterpret_cast<ShardedGravity::ShardStatistics*>(mSegment.Data() + mHeader->mStatisticsOffset) + rank;
+		mBodies = reinterpret_cast<ShardedGravity::Body*>(mSegment.Data() + mHeader->mBodiesOffset);
+
+		mOutgoingRings.resize(mShardCount);
+		mIncomingRings.resize(mShardCount);
+		for (uint32_t peer = 0; peer < mShardCount; ++peer)
+		{
+			if (peer != rank)
+			{
+				uint8_t* rings = mSegment.Data() + mHeader->mRingsOffset;
+				mOutgoingRings[peer] = SharedRingBuffer(rings + (static_cast<uint64_t>(rank) * mShardCount + peer) * mHeader->mRingStride, mHeader->mRingStride);
+				mIncomingRings[peer] = SharedRingBuffer(rings + (static_cast<uint64_t>(peer) * mShardCount + rank) * mHeader->mRingStride, mHeader->mRingStride);
+			}
+		}
+		mOutgoing.resize(mShardCount);
+		mIncoming.resize(mShardCount);
+		mSent.resize(mShardCount);
+		mReceived.resize(mShardCount);
+		mIncomingSizes.resize(mShardCount);
+
+		mSolver.SetSoftening(mHeader->mSoftening);
+		mSolver.SetOpeningAngle(mHeader->mOpeningAngle);
+	}
+
+	void GravityShard::Run()
+	{
+		try
+		{
+			Partition();
+			ComputeAccelerations();
+
+			// the statistics cover the steps, as the single process benchmarks do
+			mSolver.ResetInteractions();
+			*mStatistics = ShardedGravity::ShardStatistics();
+			Barrier();
+
+			auto startTime = high_resolution_clock::now();
+			float halfStep = static_cast<float>(mHeader->mTimestep * 0.5);
+			float timestep = static_cast<float>(mHeader->mTimestep);
+			for (uint64_t step = 1; step <= mHeader->mStepCount; ++step)
+			{
+				Kick(halfStep);
+				Drift(timestep);
+				if (step % mHeader->mRepartitionInterval == 0 && step < mHeader->mStepCount)
+				{
+					// every shard must have published before any reads, and read before any publishes again
+					Publish();
+					Barrier();
+					Partition();
+					Barrier();
+				}
+				ComputeAccelerations();
+				Kick(halfStep);
+			}
+			auto endTime = high_resolution_clock::now();
+
+			mStatistics->mInteractions = mSolver.Interactions();
+			mStatistics->mStepSeconds = duration_cast<duration<double>>(endTime - startTime).count();
+			Publish();
+		}
+		catch (...)
+		{
+			mHeader->mAbort.store(1, memory_order_release);
+			throw;
+		}
+	}
+
+	void GravityShard::Partition()
+	{
+		uint32_t bodyCount = mHeader->mBodyCount;
+		float minimum[3] = { numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::max() };
+		float maximum[3] = { -numeric_limits<float>::max(), -numeric_limits<float>::max(), -numeric_limits<float>::max() };
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = min(minimum[axis], mBodies[index].mPosition[axis]);
+				maximum[axis] = max(maximum[axis], mBodies[index].mPosition[axis]);
+			}
+		}
+
+		// a cube, so the curve is not stretched along the longest axis
+		float extent = max(max(maximum[0] - minimum[0], maximum[1] - minimum[1]), maximum[2] - minimum[2]);
+		float scale = (extent > 0) ? static_cast<float>((1u << MortonBitsPerAxis) - 1) / extent : 0.0f;
+		mKeys.resize(bodyCount);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			uint64_t key = 0;
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				float cell = min((mBodies[index].mPosition[axis] - minimum[axis]) * scale, static_cast<float>((1u << MortonBitsPerAxis) - 1));
+				key |= SpreadBits(static_cast<uint32_t>(max(cell, 0.0f))) << axis;
+			}
+			mKeys[index] = make_pair(key, index);
+		}
+
+		// only this shard's slice of the order is needed, and only it is sorted
+		auto begin = mKeys.begin() + static_cast<size_t>(static_cast<uint64_t>(bodyCount) * mRank / mShardCount);
+		auto end = mKeys.begin() + static_cast<size_t>(static_cast<uint64_t>(bodyCount) * (mRank + 1) / mShardCount);
+		nth_element(mKeys.begin(), begin, mKeys.end());
+		if (end != mKeys.end())
+		{
+			nth_element(begin, end, mKeys.end());
+		}
+		sort(begin, end);
+
+		uint32_t count = static_cast<uint32_t>(end - begin);
+		mIndices.resize(count);
+		mPositionX.resize(count);
+		mPositionY.resize(count);
+		mPositionZ.resize(count);
+		mVelocityX.resize(count);
+		mVelocityY.resize(count);
+		mVelocityZ.resize(count);
+		mAccelerationX.assign(count, 0.0f);
+		mAccelerationY.assign(count, 0.0f);
+		mAccelerationZ.assign(count, 0.0f);
+		mGravitationalParameters.resize(count);
+		mTargets.resize(count);
+		for (uint32_t local = 0; local < count; ++local)
+		{
+			uint32_t index = begin[local].second;
+			const ShardedGravity::Body& body = mBodies[index];
+			mIndices[local] = index;
+			mPositionX[local] = body.mPosition[0];
+			mPositionY[local] = body.mPosition[1];
+			mPositionZ[local] = body.mPosition[2];
+			mVelocityX[local] = body.mVelocity[0];
+			mVelocityY[local] = body.mVelocity[1];
+			mVelocityZ[local] = body.mVelocity[2];
+			mGravitationalParameters[local] = body.mGravitationalParameter;
+			mTargets[local] = local;
+		}
+	}
+
+	void GravityShard::Publish()
+	{
+		for (uint32_t local = 0; local < static_cast<uint32_t>(mIndices.size()); ++local)
+		{
+			ShardedGravity::Body& body = mBodies[mIndices[local]];
+			body.mPosition[0] = mPositionX[local];
+			body.mPosition[1] = mPositionY[local];
+			body.mPosition[2] = mPositionZ[local];
+			body.mVelocity[0] = mVelocityX[local];
+			body.mVelocity[1] = mVelocityY[local];
+			body.mVelocity[2] = mVelocityZ[local];
+			body.mAcceleration[0] = mAccelerationX[local];
+			body.mAcceleration[1] = mAccelerationY[local];
+			body.mAcceleration[2] = mAccelerationZ[local];
+		}
+	}
+
+	void GravityShard::ComputeAccelerations()
+	{
+		BuildGroups();
+
+		// bounding boxes first, as what a peer needs depends on where its bodies are
+		const Group& root = mGroups.back().front();
+		BeginMessages();
+		for (uint32_t peer = 0; peer < mShardCount; ++peer)
+		{
+			if (peer != mRank)
+			{
+				Append(mOutgoing[peer], root.mMin, 3);
+				Append(mOutgoing[peer], root.mMax, 3);
+			}
+		}
+		Exchange();
+
+		mBoxes.assign(static_cast<size_t>(mShardCount) * BoxFloats, 0.0f);
+		for (uint32_t peer = 0; peer < mShardCount; ++peer)
+		{
+			if (peer != mRank)
+			{
+				if (mIncoming[peer].size() != BoxFloats * sizeof(float))
+				{
+					throw runtime_error("Malformed shard bounds");
+				}
+				memcpy(&mBoxes[peer * BoxFloats], mIncoming[peer].data(), BoxFloats * sizeof(float));
+			}
+		}
+
+		BeginMessages();
+		for (uint32_t peer = 0; peer < mShardCount; ++peer)
+		{
+			if (peer != mRank)
+			{
+				QueueEssentialBodies(peer, &mBoxes[peer * BoxFloats]);
+			}
+		}
+		Exchange();
+
+		// own bodies first, then each peer's summaries and halo bodies in rank order
+		uint32_t ownCount = static_cast<uint32_t>(mIndices.size());
+		uint64_t totalCount = ownCount;
+		for (uint32_t peer = 0; peer < mShardCount; ++peer)
+		{
+			if (peer != mRank)
+			{
+				uint32_t counts[2];
+				if (mIncoming[peer].size() < sizeof(counts))
+				{
+					throw runtime_error("Malformed shard message");
+				}
+				memcpy(counts, mIncoming[peer].data(), sizeof(counts));
+				if (mIncoming[peer].size() != sizeof(counts) + (static_cast<uint64_t>(counts[0]) + counts[1]) * 4 * sizeof(float))
+				{
+					throw runtime_error("Malformed shard message");
+				}
+				mStatistics->mSummaries += counts[0];
+				mStatistics->mHaloBodies += counts[1];
+				totalCount += static_cast<uint64_t>(counts[0]) + counts[1];
+			}
+		}
+		if (totalCount > numeric_limits<uint32_t>::max())
+		{
+			throw runtime_error("Too many bodies in one shard");
+		}
+
+		mState.Resize(static_cast<uint32_t>(totalCount));
+		for (uint32_t local = 0; local < ownCount; ++local)
+		{
+			mState.SetBody(local, XMFLOAT3(mPositionX[local], mPositionY[local], mPositionZ[local]), XMFLOAT3(0.0f, 0.0f, 0.0f), mGravitationalParameters[local]);
+		}
+		uint32_t next = ownCount;
+		for (uint32_t peer = 0; peer < mShardCount; ++peer)
+		{
+			if (peer != mRank)
+			{
+				uint32_t counts[2];
+				memcpy(counts, mIncoming[peer].data(), sizeof(counts));
+				const float* records = reinterpret_cast<const float*>(mIncoming[peer].data() + sizeof(counts));
+				for (uint32_t record = 0; record < counts[0] + counts[1]; ++record, ++next)
+				{
+					const float* values = records + record * 4;
+					mState.SetBody(next, XMFLOAT3(values[0], values[1], values[2]), XMFLOAT3(0.0f, 0.0f, 0.0f), values[3]);
+				}
+			}
+		}
+
+		mSolver.ComputeAccelerations(mState, mTargets);
+		copy(mState.AccelerationX(), mState.AccelerationX() + ownCount, mAccelerationX.begin());
+		copy(mState.AccelerationY(), mState.AccelerationY() + ownCount, mAccelerationY.begin());
+		copy(mState.AccelerationZ(), mState.AccelerationZ() + ownCount, mAccelerationZ.begin());
+	}
+
+	void GravityShard::BuildGroups()
+	{
+		// the opening radius is infinite at theta 0, so nothing is ever summarized
+		float openingAngle = mHeader->mOpeningAngle;
+		auto finish = [openingAngle](Group& group)
+		{
+			if (group.mGravitationalParameter > 0)
+			{
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					group.mCenterOfMass[axis] /= group.mGravitationalParameter;
+				}
+			}
+			else
+			{
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					group.mCenterOfMass[axis] = 0.5f * (group.mMin[axis] + group.mMax[axis]);
+				}
+			}
+
+			float size = 0;
+			float offsetSquared = 0;
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				size = max(size, group.mMax[axis] - group.mMin[axis]);
+				float offset = group.mCenterOfMass[axis] - 0.5f * (group.mMin[axis] + group.mMax[axis]);
+				offsetSquared += offset * offset;
+			}
+			float radius = (openingAngle > 0) ? size / openingAngle + sqrt(offsetSquared) : numeric_limits<float>::infinity();
+			group.mOpeningRadiusSquared = radius * radius;
+		};
+
+		uint32_t ownCount = static_cast<uint32_t>(mIndices.size());
+		uint32_t groupCount = max((ownCount + GroupSize - 1) / GroupSize, 1U);
+		mGroups.resize(1);
+		mGroups[0].resize(groupCount);
+		for (uint32_t index = 0; index < groupCount; ++index)
+		{
+			Group& group = mGroups[0][index];
+			group = Group{ { numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::max() },
+				{ -numeric_limits<float>::max(), -numeric_limits<float>::max(), -numeric_limits<float>::max() }, { 0, 0, 0 }, 0, 0 };
+			for (uint32_t local = index * GroupSize; local < min((index + 1) * GroupSize, ownCount); ++local)
+			{
+				float position[3] = { mPositionX[local], mPositionY[local], mPositionZ[local] };
+				float parameter = mGravitationalParameters[local];
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					group.mMin[axis] = min(group.mMin[axis], position[axis]);
+					group.mMax[axis] = max(group.mMax[axis], position[axis]);
+					group.mCenterOfMass[axis] += parameter * position[axis];
+				}
+				group.mGravitationalParameter += parameter;
+			}
+			finish(group);
+		}
+
+		while (mGroups.back().size() > 1)
+		{
+			const vector<Group>& children = mGroups.back();
+			vector<Group> parents((children.size() + GroupFanout - 1) / GroupFanout);
+			for (uint32_t index = 0; index < static_cast<uint32_t>(parents.size()); ++index)
+			{
+				Group& group = parents[index];
+				group = Group{ { numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::max() },
+					{ -numeric_limits<float>::max(), -numeric_limits<float>::max(), -numeric_limits<float>::max() }, { 0, 0, 0 }, 0, 0 };
+				for (uint32_t child = index * GroupFanout; child < min((index + 1) * GroupFanout, static_cast<uint32_t>(children.size())); ++child)
+				{
+					const Group& childGroup = children[child];
+					for (uint32_t axis = 0; axis < 3; ++axis)
+					{
+						group.mMin[axis] = min(group.mMin[axis], childGroup.mMin[axis]);
+						group.mMax[axis] = max(group.mMax[axis], childGroup.mMax[axis]);
+						group.mCenterOfMass[axis] += childGroup.mGravitationalParameter * childGroup.mCenterOfMass[axis];
+					}
+					group.mGravitationalParameter += childGroup.mGravitationalParameter;
+				}
+				finish(group);
+			}
+			mGroups.push_back(move(parents));
+		}
+	}
+
+	void GravityShard::QueueEssentialBodies(uint32_t peer, const float* box)
+	{
+		// counts are patched in once the walk is done
+		vector<uint8_t>& message = mOutgoing[peer];
+		size_t countsOffset = message.size();
+		uint32_t counts[2] = { 0, 0 };
+		Append(message, counts, 2);
+
+		// a peer without bodies has an inverted box and needs nothing
+		bool empty = box[0] > box[3] || box[1] > box[4] || box[2] > box[5];
+		mPendingGroups.clear();
+		if (!empty)
+		{
+			mPendingGroups.push_back(make_pair(static_cast<uint32_t>(mGroups.size() - 1), 0U));
+		}
+		while (!mPendingGroups.empty())
+		{
+			uint32_t level = mPendingGroups.back().first;
+			uint32_t index = mPendingGroups.back().second;
+			mPendingGroups.pop_back();
+			const Group& group = mGroups[level][index];
+			if (!(group.mGravitationalParameter > 0))
+			{
+				continue;
+			}
+
+			float distanceSquared = 0;
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				float gap = max(max(box[axis] - group.mCenterOfMass[axis], group.mCenterOfMass[axis] - box[axis + 3]), 0.0f);
+				distanceSquared += gap * gap;
+			}
+
+			if (distanceSquared > group.mOpeningRadiusSquared)
+			{
+				float record[4] = { group.mCenterOfMass[0], group.mCenterOfMass[1], group.mCenterOfMass[2], group.mGravitationalParameter };
+				Append(message, record, 4);
+				++counts[0];
+			}
+			else if (level == 0)
+			{
+				uint32_t ownCount = static_cast<uint32_t>(mIndices.size());
+				for (uint32_t local = index * GroupSize; local < min((index + 1) * GroupSize, ownCount); ++local)
+				{
+					if (mGravitationalParameters[local] > 0)
+					{
+						float record[4] = { mPositionX[local], mPositionY[local], mPositionZ[local], mGravitationalParameters[local] };
+						Append(message, record, 4);
+						++counts[1];
+					}
+				}
+			}
+			else
+			{
+				// pushed last child first, so they are visited in order
+				uint32_t childCount = static_cast<uint32_t>(mGroups[level - 1].size());
+				for (uint32_t child = min((index + 1) * GroupFanout, childCount); child > index * GroupFanout; --child)
+				{
+					mPendingGroups.push_back(make_pair(level - 1, child - 1));
+				}
+			}
+		}
+		memcpy(message.data() + countsOffset, counts, sizeof(counts));
+	}
+
+	void GravityShard::Kick(float timestep)
+	{
+		for (size_t local = 0; local < mIndices.size(); ++local)
+		{
+			mVelocityX[local] += mAccelerationX[local] * timestep;
+			mVelocityY[local] += mAccelerationY[local] * timestep;
+			mVelocityZ[local] += mAccelerationZ[local] * timestep;
+		}
+	}
+
+	void GravityShard::Drift(float timestep)
+	{
+		for (size_t local = 0; local < mIndices.size(); ++local)
+		{
+			mPositionX[local] += mVelocityX[local] * timestep;
+			mPositionY[local] += mVelocityY[local] * timestep;
+			mPositionZ[local] += mVelocityZ[local] * timestep;
+		}
+	}
+
+	void GravityShard::BeginMessages()
+	{
+		// room for the length prefix, written by Exchange
+		for (uint32_t peer = 0; peer < mShardCount; ++peer)
+		{
+			mOutgoing[peer].assign(sizeof(uint64_t), 0);
+		}
+	}
+
+	void GravityShard::Exchange()
+	{
+		auto startTime = high_resolution_clock::now();
+		uint32_t pending = 0;
+		for (uint32_t peer = 0; peer < mShardCount; ++peer)
+		{
+			if (peer != mRank)
+			{
+				uint64_t size = mOutgoing[peer].size() - sizeof(uint64_t);
+				memcpy(mOutgoing[peer].data(), &size, sizeof(size));
+				mSent[peer] = 0;
+				mReceived[peer] = 0;
+				mIncomingSizes[peer] = 0;
+				pending += 2;
+			}
+		}
+
+		while (pending > 0)
+		{
+			bool progress = false;
+			for (uint32_t peer = 0; peer < mShardCount; ++peer)
+			{
+				if (peer == mRank)
+				{
+					continue;
+				}
+
+				vector<uint8_t>& outgoing = mOutgoing[peer];
+				if (mSent[peer] < outgoing.size())
+				{
+					uint64_t written = mOutgoingRings[peer].Write(outgoing.data() + mSent[peer], outgoing.size() - mSent[peer]);
+					mSent[peer] += written;
+					progress = progress || written > 0;
+					if (mSent[peer] == outgoing.size())
+					{
+						--pending;
+					}
+				}
+
+				// the length prefix, then the message it announces
+				uint64_t prefix = sizeof(uint64_t);
+				if (mReceived[peer] < prefix)
+				{
+					uint64_t read = mIncomingRings[peer].Read(reinterpret_cast<uint8_t*>(&mIncomingSizes[peer]) + mReceived[peer], prefix - mReceived[peer]);
+					mReceived[peer] += read;
+					progress = progress || read > 0;
+					if (mReceived[peer] == prefix)
+					{
+						mIncoming[peer].resize(static_cast<size_t>(mIncomingSizes[peer]));
+					}
+				}
+				uint64_t total = prefix + mIncomingSizes[peer];
+				if (mReceived[peer] >= prefix && mReceived[peer] < total)
+				{
+					uint64_t read = mIncomingRings[peer].Read(mIncoming[peer].data() + (mReceived[peer] - prefix), total - mReceived[peer]);
+					mReceived[peer] += read;
+					progress = progress || read > 0;
+				}
+				if (mReceived[peer] == total && mReceived[peer] >= prefix)
+				{
+					// counted once, then pushed past the total
+					mReceived[peer] = numeric_limits<uint64_t>::max();
+					--pending;
+				}
+			}
+
+			if (!progress)
+			{
+				CheckAbort();
+				this_thread::yield();
+			}
+		}
+
+		for (uint32_t peer = 0; peer < mShardCount; ++peer)
+		{
+			if (peer != mRank)
+			{
+				mStatistics->mExchangedBytes += mOutgoing[peer].size();
+			}
+		}
+		mStatistics->mExchangeSeconds += duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+	}
+
+	void GravityShard::Barrier()
+	{
+		uint32_t generation = mHeader->mGeneration.load(memory_order_acquire);
+		if (mHeader->mArrived.fetch_add(1, memory_order_acq_rel) + 1 == mShardCount)
+		{
+			mHeader->mArrived.store(0, memory_order_relaxed);
+			mHeader->mGeneration.fetch_add(1, memory_order_release);
+			return;
+		}
+
+		while (mHeader->mGeneration.load(memory_order_acquire) == generation)
+		{
+			CheckAbort();
+			this_thread::yield();
+		}
+	}
+
+	void GravityShard::CheckAbort() const
+	{
+		if (mHeader->mAbort.load(memory_order_acquire) != 0)
+		{
+			throw runtime_error("Another gravity shard failed");
+		}
+	}
+}
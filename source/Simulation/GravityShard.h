@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BarnesHut.h"
+#include "NBodyState.h"
+#include "SharedMemory.h"
+#include "SharedRingBuffer.h"
+#include "ShardedGravity.h"
+
+namespace Simulation
+{
+	// One worker process of a ShardedGravity run. Every shard computes the same Morton keys of the whole state, over its
+	// bounding cube, and takes its own equal slice of the sorted keys, ties broken by body index, so the domains are
+	// compact, balanced and agreed on without a word exchanged. Every RepartitionInterval steps the shards publish their
+	// bodies to the segment and cut the slices again, between two barriers.
+	//
+	// The owned bodies are grouped GroupSize at a time in Morton order, and those groups GroupFanout at a time up to a
+	// single root, each with its bounding box and monopole. A force computation first trades bounding boxes with every
+	// other shard, then sends each the locally essential part of its domain: walking down from the root, a group that
+	// lies farther from the peer's whole box than size / theta + offset (the same bmax criterion as BarnesHut) goes as a
+	// summary, its total GM at its centre of mass, and the bodies of a leaf group too close for that go as halo bodies.
+	// The shard then builds one BarnesHut tree over its own bodies, followed by what every peer sent in rank order, and
+	// computes the accelerations of its own bodies only. Summaries carry the monopole, like the tree's own nodes, so the
+	// sharded forces are as accurate as a single tree with the same opening angle.
+	//
+	// Each exchange queues one length prefixed message per peer and pumps every outgoing and incoming ring in turn until
+	// all are through, yielding when none moved, so messages of any size flow through rings of any capacity. Leapfrog
+	// kicks and drifts only touch owned bodies, and nothing depends on timing, so the result is the same on every run.
+	class GravityShard final
+	{
+	public:
+		GravityShard(const std::string& segmentName, std::uint32_t rank);
+		GravityShard(const GravityShard&) = delete;
+		GravityShard& operator=(const GravityShard&) = delete;
+		GravityShard(GravityShard&&) = delete;
+		GravityShard& operator=(GravityShard&&) = delete;
+		~GravityShard() = default;
+
+		// Steps the whole run and publishes the result; failing marks the run aborted for the other shards.
+		void Run();
+
+		static const std::uint32_t GroupSize;
+		static const std::uint32_t GroupFanout;
+
+	private:
+		struct Group
+		{
+			float mMin[3];
+			float mMax[3];
+			float mCenterOfMass[3];
+			float mGravitationalParameter;
+			float mOpeningRadiusSquared;
+		};
+
+		void Partition();
+		void Publish();
+		void ComputeAccelerations();
+		void BuildGroups();
+		void QueueEssentialBodies(std::uint32_t peer, const float* box);
+		void Kick(float timestep);
+		void Drift(float timestep);
+
+		void BeginMessages();
+		void Exchange();
+		void Barrier();
+		void CheckAbort() const;
+
+		SharedMemory mSegment;
+		ShardedGravity::Header* mHeader;
+		ShardedGravity::ShardStatistics* mStatistics;
+		ShardedGravity::Body* mBodies;
+		std::uint32_t mRank;
+		std::uint32_t mShardCount;
+
+		// by peer rank, unused for this shard's own
+		std::vector<SharedRingBuffer> mOutgoingRings;
+		std::vector<SharedRingBuffer> mIncomingRings;
+		std::vector<std::vector<std::uint8_t>> mOutgoing;
+		std::vector<std::vector<std::uint8_t>> mIncoming;
+		std::vector<std::uint64_t> mSent;
+		std::vector<std::uint64_t> mReceived;
+		std::vector<std::uint64_t> mIncomingSizes;
+
+		// owned bodies in Morton order, with their index in the whole state
+		std::vector<std::pair<std::uint64_t, std::uint32_t>> mKeys;
+		std::vector<std::uint32_t> mIndices;
+		std::vector<float> mPositionX;
+		std::vector<float> mPositionY;
+		std::vector<float> mPositionZ;
+		std::vector<float> mVelocityX;
+		std::vector<float> mVelocityY;
+		std::vector<float> mVelocityZ;
+		std::vector<float> mAccelerationX;
+		std::vector<float> mAccelerationY;
+		std::vector<float> mAccelerationZ;
+		std::vector<float> mGravitationalParameters;
+
+		// levels of groups, leaves first; level l + 1 group g has children [g * GroupFanout, (g + 1) * GroupFanout)
+		std::vector<std::vector<Group>> mGroups;
+		// level and index of the groups still to visit
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> mPendingGroups;
+		std::vector<float> mBoxes;
+
+		NBodyState mState;
+		BarnesHut mSolver;
+		std::vector<std::uint32_t> mTargets;
+	};
+}
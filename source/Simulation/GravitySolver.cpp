@@ -0,0 +1,37 @@
+#include "pch.h"
+#include "GravitySolver.h"
+
+using namespace std;
+
+namespace Simulation
+{
+	GravitySolver::GravitySolver() :
+		mSoftening(0.0f), mInteractions(0)
+	{
+	}
+
+	void GravitySolver::SetThreadPool(const shared_ptr<ThreadPool>& threadPool)
+	{
+		mThreadPool = threadPool;
+	}
+
+	float GravitySolver::Softening() const
+	{
+		return mSoftening;
+	}
+
+	void GravitySolver::SetSoftening(float softening)
+	{
+		mSoftening = softening;
+	}
+
+	uint64_t GravitySolver::Interactions() const
+	{
+		return mInteractions;
+	}
+
+	void GravitySolver::ResetInteractions()
+	{
+		mInteractions = 0;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Simulation
+{
+	class NBodyState;
+	class ThreadPool;
+
+	// Computes the gravitational acceleration of every body in an NBodyState from all the others. Pairwise forces use
+	// Plummer softening, a = GM r / (|r|^2 + softening^2)^(3/2), so close encounters stay finite.
+	class GravitySolver
+	{
+	public:
+		GravitySolver();
+		GravitySolver(const GravitySolver&) = delete;
+		GravitySolver& operator=(const GravitySolver&) = delete;
+		GravitySolver(GravitySolver&&) = delete;
+		GravitySolver& operator=(GravitySolver&&) = delete;
+		virtual ~GravitySolver() = default;
+
+		void SetThreadPool(const std::shared_ptr<ThreadPool>& threadPool);
+		float Softening() const;
+		void SetSoftening(float softening);
+
+		virtual void ComputeAccelerations(NBodyState& state) = 0;
+
+		// Accelerations of the listed bodies only, against every body, for integrators that step bodies individually.
+		// The accelerations of the other bodies are left as they were.
+		virtual void ComputeAccelerations(NBodyState& state, const std::vector<std::uint32_t>& targets) = 0;
+
+		// Body-body interactions evaluated since the last ResetInteractions, for throughput reports.
+		std::uint64_t Interactions() const;
+		void ResetInteractions();
+
+	protected:
+		std::shared_ptr<ThreadPool> mThreadPool;
+		float mSoftening;
+		std::uint64_t mInteractions;
+	};
+}
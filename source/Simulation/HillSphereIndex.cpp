@@ -0,0 +1,266 @@
+#include "pch.h"
+#include "HillSphereIndex.h"
+#include "NBodyState.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t HillSphereIndex::InvalidIndex = numeric_limits<uint32_t>::max();
+	const double HillSphereIndex::ExitMargin = 0.01;
+
+	namespace
+	{
+		const double Pi = 3.14159265358979323846;
+	}
+
+	HillSphereIndex::HillSphereIndex() :
+		mBaseCellSize(0), mShortestPeriod(0), mBucketMask(0)
+	{
+	}
+
+	void HillSphereIndex::Build(const NBodyState& state, const vector<uint32_t>& parents, double shortestPeriod)
+	{
+		uint32_t count = static_cast<uint32_t>(parents.size());
+		if (state.Count() != count)
+		{
+			throw runtime_error("Hill sphere hierarchy does not match the body count");
+		}
+
+		mX.assign(state.PositionX(), state.PositionX() + count);
+		mY.assign(state.PositionY(), state.PositionY() + count);
+		mZ.assign(state.PositionZ(), state.PositionZ() + count);
+		mVelocityX.assign(state.VelocityX(), state.VelocityX() + count);
+		mVelocityY.assign(state.VelocityY(), state.VelocityY() + count);
+		mVelocityZ.assign(state.VelocityZ(), state.VelocityZ() + count);
+		mGravitationalParameters.resize(count);
+		for (uint32_t body = 0; body < count; ++body)
+		{
+			mGravitationalParameters[body] = state.GravitationalParameter(body);
+		}
+		mShortestPeriod = shortestPeriod;
+		mHillRadii.assign(count, numeric_limits<double>::infinity());
+		double smallestRadius = numeric_limits<double>::infinity();
+		for (uint32_t body = 0; body < count; ++body)
+		{
+			uint32_t parent = parents[body];
+			if (parent == InvalidIndex)
+			{
+				continue;
+			}
+
+			double radius = 0;
+			if (mGravitationalParameters[parent] > 0)
+			{
+				double offsetX = mX[body] - mX[parent];
+				double offsetY = mY[body] - mY[parent];
+				double offsetZ = mZ[body] - mZ[parent];
+				double distance = sqrt(offsetX * offsetX + offsetY * offsetY + offsetZ * offsetZ);
+				radius = distance * cbrt(mGravitationalParameters[body] / (3.0 * mGravitationalParameters[parent]));
+			}
+			mHillRadii[body] = radius;
+			if (radius > 0)
+			{
+				smallestRadius = min(smallestRadius, radius);
+			}
+		}
+
+		// cells are at least as wide as a sphere reaches before its body lets go, so the 27 around a body cover it
+		mBaseCellSize = smallestRadius * (1.0 + ExitMargin);
+		mBodyLevels.assign(count, InvalidIndex);
+		mLevels.clear();
+		uint32_t indexedCount = 0;
+		for (uint32_t body = 0; body < count; ++body)
+		{
+			double radius = mHillRadii[body];
+			if (radius > 0 && radius < numeric_limits<double>::infinity())
+			{
+				uint32_t level = static_cast<uint32_t>(max(0.0, ceil(log2(radius * (1.0 + ExitMargin) / mBaseCellSize))));
+				if (radius * (1.0 + ExitMargin) > ldexp(mBaseCellSize, static_cast<int>(level)))
+				{
+					++level;
+				}
+				mBodyLevels[body] = level;
+				mLevels.push_back(level);
+				++indexedCount;
+			}
+		}
+		sort(mLevels.begin(), mLevels.end());
+		mLevels.erase(unique(mLevels.begin(), mLevels.end()), mLevels.end());
+		mLevelCellSizes.resize(mLevels.size());
+		mLevelParameters.assign(mLevels.size(), 0.0);
+		for (size_t level = 0; level < mLevels.size(); ++level)
+		{
+			mLevelCellSizes[level] = ldexp(mBaseCellSize, static_cast<int>(mLevels[level]));
+		}
+		for (uint32_t body = 0; body < count; ++body)
+		{
+			if (mHillRadii[body] > 0 && mHillRadii[body] < numeric_limits<double>::infinity())
+			{
+				size_t level = lower_bound(mLevels.begin(), mLevels.end(), mBodyLevels[body]) - mLevels.begin();
+				mLevelParameters[level] = max(mLevelParameters[level], mGravitationalParameters[body]);
+			}
+		}
+
+		uint64_t bucketCount = 1;
+		while (bucketCount < 2ull * indexedCount)
+		{
+			bucketCount <<= 1;
+		}
+		mBucketMask = bucketCount - 1;
+
+		// counting sort of the spheres by the bucket of their centre's cell; the running sum leaves every start at the
+		// end of its bucket, and filling from the back moves it to the beginning with the bucket in index order
+		mBucketStarts.assign(static_cast<size_t>(bucketCount + 1), 0);
+		mBodyBuckets.assign(count, 0);
+		for (uint32_t body = 0; body < count; ++body)
+		{
+			if (mHillRadii[body] > 0 && mHillRadii[body] < numeric_limits<double>::infinity())
+			{
+				double cellSize = ldexp(mBaseCellSize, static_cast<int>(mBodyLevels[body]));
+				mBodyBuckets[body] = Bucket(mBodyLevels[body], static_cast<int64_t>(floor(mX[body] / cellSize)), static_cast<int64_t>(floor(mY[body] / cellSize)),
+					static_cast<int64_t>(floor(mZ[body] / cellSize)));
+				++mBucketStarts[static_cast<size_t>(mBodyBuckets[body])];
+			}
+		}
+		for (size_t bucket = 1; bucket < bucketCount; ++bucket)
+		{
+			mBucketStarts[bucket] += mBucketStarts[bucket - 1];
+		}
+		mBucketStarts[static_cast<size_t>(bucketCount)] = indexedCount;
+
+		mBucketBodies.resize(indexedCount);
+		for (uint32_t body = count; body > 0; --body)
+		{
+			uint32_t index = body - 1;
+			if (mHillRadii[index] > 0 && mHillRadii[index] < numeric_limits<double>::infinity())
+			{
+				mBucketBodies[--mBucketStarts[static_cast<size_t>(mBodyBuckets[index])]] = index;
+			}
+		}
+	}
+
+	uint32_t HillSphereIndex::FindParent(uint32_t body, const vector<uint32_t>& parents) const
+	{
+		uint32_t current = parents[body];
+		uint32_t currentLevel = (current != InvalidIndex) ? mBodyLevels[current] : InvalidIndex;
+		uint32_t best = InvalidIndex;
+		double bestRadius = numeric_limits<double>::infinity();
+		for (size_t levelIndex = 0; levelIndex < mLevels.size(); ++levelIndex)
+		{
+			// a level's spheres are larger than half its cells, less the exit margin
+			uint32_t level = mLevels[levelIndex];
+			double cellSize = mLevelCellSizes[levelIndex];
+			if (cellSize * 0.5 / (1.0 + ExitMargin) >= bestRadius)
+			{
+				break;
+			}
+			if (mLevelParameters[levelIndex] <= mGravitationalParameters[body] && level != currentLevel)
+			{
+				continue;
+			}
+
+			int64_t cellX = static_cast<int64_t>(floor(mX[body] / cellSize));
+			int64_t cellY = static_cast<int64_t>(floor(mY[body] / cellSize));
+			int64_t cellZ = static_cast<int64_t>(floor(mZ[body] / cellSize));
+			for (int64_t offsetZ = -1; offsetZ <= 1; ++offsetZ)
+			{
+				for (int64_t offsetY = -1; offsetY <= 1; ++offsetY)
+				{
+					for (int64_t offsetX = -1; offsetX <= 1; ++offsetX)
+					{
+						size_t bucket = static_cast<size_t>(Bucket(level, cellX + offsetX, cellY + offsetY, cellZ + offsetZ));
+						for (uint32_t entry = mBucketStarts[bucket]; entry < mBucketStarts[bucket + 1]; ++entry)
+						{
+							uint32_t candidate = mBucketBodies[entry];
+							double radius = mHillRadii[candidate];
+							if (candidate == body || mBodyLevels[candidate] != level || radius >= bestRadius)
+							{
+								continue;
+							}
+
+							double reach = (candidate == current) ? radius * (1.0 + ExitMargin) : radius;
+							double offsetToX = mX[body] - mX[candidate];
+							double offsetToY = mY[body] - mY[candidate];
+							double offsetToZ = mZ[body] - mZ[candidate];
+							if (offsetToX * offsetToX + offsetToY * offsetToY + offsetToZ * offsetToZ >= reach * reach)
+							{
+								continue;
+							}
+
+							// the current parent keeps the body even if the catalog made it the lighter of the two, or it is
+							// on its way out
+							if (candidate != current)
+							{
+								double distance = sqrt(offsetToX * offsetToX + offsetToY * offsetToY + offsetToZ * offsetToZ);
+								double speedX = mVelocityX[body] - mVelocityX[candidate];
+								double speedY = mVelocityY[body] - mVelocityY[candidate];
+								double speedZ = mVelocityZ[body] - mVelocityZ[candidate];
+								double parameter = mGravitationalParameters[candidate] + mGravitationalParameters[body];
+								double energy = 0.5 * (speedX * speedX + speedY * speedY + speedZ * speedZ) - parameter / distance;
+								if (mGravitationalParameters[candidate] <= mGravitationalParameters[body] || energy >= 0 || Orbits(candidate, body, parents))
+								{
+									continue;
+								}
+
+								// P = 2 pi sqrt(a^3 / mu) with a = -mu / 2E
+								double semiMajorAxis = -parameter / (2.0 * energy);
+								if (2.0 * Pi * sqrt(semiMajorAxis * semiMajorAxis * semiMajorAxis / parameter) < mShortestPeriod)
+								{
+									continue;
+								}
+							}
+
+							best = candidate;
+							bestRadius = radius;
+						}
+					}
+				}
+			}
+		}
+
+		if (best == InvalidIndex && current != InvalidIndex)
+		{
+			best = current;
+			while (parents[best] != InvalidIndex)
+			{
+				best = parents[best];
+			}
+		}
+		return best;
+	}
+
+	double HillSphereIndex::HillRadius(uint32_t body) const
+	{
+		return mHillRadii[body];
+	}
+
+	uint32_t HillSphereIndex::LevelCount() const
+	{
+		return static_cast<uint32_t>(mLevels.size());
+	}
+
+	bool HillSphereIndex::Orbits(uint32_t body, uint32_t ancestor, const vector<uint32_t>& parents) const
+	{
+		for (uint32_t parent = parents[body]; parent != InvalidIndex; parent = parents[parent])
+		{
+			if (parent == ancestor)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uint64_t HillSphereIndex::Bucket(uint32_t level, int64_t cellX, int64_t cellY, int64_t cellZ) const
+	{
+		// large odd multipliers spread neighbouring cells and levels over the whole table
+		uint64_t hash = static_cast<uint64_t>(cellX) * 0x9E3779B97F4A7C15ull;
+		hash ^= static_cast<uint64_t>(cellY) * 0xC2B2AE3D27D4EB4Full;
+		hash ^= static_cast<uint64_t>(cellZ) * 0x165667B19E3779F9ull;
+		hash ^= level * 0x27D4EB2F165667C5ull;
+		hash ^= hash >> 29;
+		return hash & mBucketMask;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Simulation
+{
+	class NBodyState;
+
+	// Finds the dominant parent of bodies that move freely: the body whose Hill sphere d (GM / 3 GM_parent)^(1/3), d
+	// being its distance to its own parent, holds them most tightly. Build hashes the spheres into one grid per power of
+	// two of radius, so a query only visits the 27 cells around the body on each occupied level.
+	class HillSphereIndex final
+	{
+	public:
+		HillSphereIndex();
+		HillSphereIndex(const HillSphereIndex&) = delete;
+		HillSphereIndex& operator=(const HillSphereIndex&) = delete;
+		HillSphereIndex(HillSphereIndex&&) = default;
+		HillSphereIndex& operator=(HillSphereIndex&&) = default;
+		~HillSphereIndex() = default;
+
+		// Takes the spheres of every body of the state about parents[i], or InvalidIndex for a root, and the shortest
+		// orbit a body may be captured into.
+		void Build(const NBodyState& state, const std::vector<std::uint32_t>& parents, double shortestPeriod);
+		// The parent the body should have, given the hierarchy as it is now; the spheres are those of the last Build. A
+		// body in no sphere stays under the root of its current tree, and only moves under a heavier body that does not
+		// orbit it, once bound to it on an orbit no shorter than the shortest period given to Build.
+		std::uint32_t FindParent(std::uint32_t body, const std::vector<std::uint32_t>& parents) const;
+
+		// Infinite for roots and zero for bodies without mass.
+		double HillRadius(std::uint32_t body) const;
+		std::uint32_t LevelCount() const;
+
+		static const std::uint32_t InvalidIndex;
+		// Fraction of the radius further out a body leaves its parent's sphere than it enters.
+		static const double ExitMargin;
+
+	private:
+		bool Orbits(std::uint32_t body, std::uint32_t ancestor, const std::vector<std::uint32_t>& parents) const;
+		std::uint64_t Bucket(std::uint32_t level, std::int64_t cellX, std::int64_t cellY, std::int64_t cellZ) const;
+
+		std::vector<double> mX;
+		std::vector<double> mY;
+		std::vector<double> mZ;
+		std::vector<double> mVelocityX;
+		std::vector<double> mVelocityY;
+		std::vector<double> mVelocityZ;
+		std::vector<double> mGravitationalParameters;
+		std::vector<double> mHillRadii;
+		std::vector<std::uint32_t> mBodyLevels;
+		// occupied levels in increasing order, with their cell size and heaviest body
+		std::vector<std::uint32_t> mLevels;
+		std::vector<double> mLevelCellSizes;
+		std::vector<double> mLevelParameters;
+		double mBaseCellSize;
+		double mShortestPeriod;
+
+		// bodies of bucket b are mBucketBodies[mBucketStarts[b], mBucketStarts[b + 1])
+		std::uint64_t mBucketMask;
+		std::vector<std::uint32_t> mBucketStarts;
+		std::vector<std::uint32_t> mBucketBodies;
+		std::vector<std::uint64_t> mBodyBuckets;
+	};
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Simulation
+{
+	class NBodyState;
+	class GravitySolver;
+
+	// Advances an NBodyState under the accelerations of a GravitySolver. Initialize must be called whenever the state is
+	// replaced from outside so integrators that carry accelerations or coordinates between steps can rebuild them.
+	//
+	// Reparent moves a body under another parent, or none for the largest index, without changing its absolute position or
+	// velocity. Only integrators that advance bodies relative to a parent have anything to rebase; the others integrate
+	// absolute coordinates and ignore it.
+	//
+	// A checkpoint saves the state, accelerations included, along with whatever SaveState appends, and RestoreState takes
+	// both back in place of Initialize, so a restored run carries on from the same bits without a force computation.
+	// Integrators that keep nothing between steps beyond the state append nothing.
+	class Integrator
+	{
+	public:
+		Integrator() = default;
+		Integrator(const Integrator&) = delete;
+		Integrator& operator=(const Integrator&) = delete;
+		Integrator(Integrator&&) = delete;
+		Integrator& operator=(Integrator&&) = delete;
+		virtual ~Integrator() = default;
+
+		virtual void Initialize(NBodyState& state, GravitySolver& solver) = 0;
+		virtual void Step(NBodyState& state, GravitySolver& solver, double timestep) = 0;
+		virtual void Reparent(std::uint32_t, std::uint32_t, const NBodyState&) {}
+		virtual void SaveState(std::vector<double>&) const {}
+		virtual void RestoreState(NBodyState&, const double*, std::uint64_t) {}
+	};
+}
@@ -0,0 +1,61 @@
+#include "pch.h"
+#include "KeplerSolver.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t KeplerSolver::MaxIterations = 8;
+	const float KeplerSolver::Tolerance = 1.0e-6f;
+
+	XMVECTOR XM_CALLCONV KeplerSolver::SolveEccentricAnomaly(FXMVECTOR meanAnomaly, FXMVECTOR eccentricity)
+	{
+		// sign(sin M) is sign(M) on [-pi, pi)
+		XMVECTOR offset = XMVectorScale(eccentricity, 0.85f);
+		XMVECTOR eccentricAnomaly = XMVectorAdd(meanAnomaly, XMVectorSelect(XMVectorNegate(offset), offset, XMVectorGreaterOrEqual(meanAnomaly, XMVectorZero())));
+
+		XMVECTOR one = XMVectorSplatOne();
+		XMVECTOR tolerance = XMVectorReplicate(Tolerance);
+		for (uint32_t iteration = 0; iteration < MaxIterations; ++iteration)
+		{
+			XMVECTOR sinE;
+			XMVECTOR cosE;
+			XMVectorSinCos(&sinE, &cosE, eccentricAnomaly);
+
+			// f(E) = E - e sin(E) - M, f'(E) = 1 - e cos(E)
+			XMVECTOR residual = XMVectorSubtract(XMVectorNegativeMultiplySubtract(eccentricity, sinE, eccentricAnomaly), meanAnomaly);
+			XMVECTOR slope = XMVectorNegativeMultiplySubtract(eccentricity, cosE, one);
+			XMVECTOR step = XMVectorDivide(residual, slope);
+			eccentricAnomaly = XMVectorSubtract(eccentricAnomaly, step);
+
+			if (XMVector4LessOrEqual(XMVectorAbs(step), tolerance))
+			{
+				break;
+			}
+		}
+
+		return eccentricAnomaly;
+	}
+
+	float KeplerSolver::SolveEccentricAnomaly(float meanAnomaly, float eccentricity)
+	{
+		return XMVectorGetX(SolveEccentricAnomaly(XMVectorReplicate(meanAnomaly), XMVectorReplicate(eccentricity)));
+	}
+
+	void KeplerSolver::SolveEccentricAnomalies(const float* meanAnomalies, const float* eccentricities, float* eccentricAnomalies, uint32_t count)
+	{
+		uint32_t index = 0;
+		for (; index + 4 <= count; index += 4)
+		{
+			XMVECTOR meanAnomaly = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&meanAnomalies[index]));
+			XMVECTOR eccentricity = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&eccentricities[index]));
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&eccentricAnomalies[index]), SolveEccentricAnomaly(meanAnomaly, eccentricity));
+		}
+
+		for (; index < count; ++index)
+		{
+			eccentricAnomalies[index] = SolveEccentricAnomaly(meanAnomalies[index], eccentricities[index]);
+		}
+	}
+}
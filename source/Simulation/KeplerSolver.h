@@ -0,0 +1,31 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+
+namespace Simulation
+{
+	// Solves Kepler's equation M = E - e sin(E) for elliptic orbits (0 <= e < 1), four bodies per DirectXMath vector.
+	//
+	// Newton's method starts from Danby's guess E0 = M + 0.85 e sign(sin M), which converges for every eccentricity,
+	// and runs at most MaxIterations times; a batch stops as soon as all of its lanes are within Tolerance, so the
+	// near circular orbits of most catalogs cost one or two iterations.
+	class KeplerSolver final
+	{
+	public:
+		// meanAnomaly must be wrapped to [-pi, pi); the result lies in the same range.
+		static DirectX::XMVECTOR XM_CALLCONV SolveEccentricAnomaly(DirectX::FXMVECTOR meanAnomaly, DirectX::FXMVECTOR eccentricity);
+		static float SolveEccentricAnomaly(float meanAnomaly, float eccentricity);
+		static void SolveEccentricAnomalies(const float* meanAnomalies, const float* eccentricities, float* eccentricAnomalies, std::uint32_t count);
+
+		static const std::uint32_t MaxIterations;
+		static const float Tolerance;
+
+		KeplerSolver() = delete;
+		KeplerSolver(const KeplerSolver&) = delete;
+		KeplerSolver& operator=(const KeplerSolver&) = delete;
+		KeplerSolver(KeplerSolver&&) = delete;
+		KeplerSolver& operator=(KeplerSolver&&) = delete;
+		~KeplerSolver() = default;
+	};
+}
@@ -0,0 +1,211 @@
+#include "pch.h"
+#include "LambertSolver.h"
+#include "ConicPropagator.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t LambertSolver::MaxIterations = 40;
+	const uint32_t LambertSolver::MaxBracketExpansions = 32;
+	const double LambertSolver::Tolerance = 1.0e-10;
+
+	namespace
+	{
+		// XM_PI is a float, which would shift every transfer angle by its rounding
+		const double Pi = 3.14159265358979323846;
+		const double EllipticLimit = 4.0 * Pi * Pi;
+
+		// Scaled time of flight sqrt(mu) t of the orbit through z, false where y < 0 and no orbit fits, which only
+		// happens below the root.
+		bool ScaledTime(double z, double a, double radiusSum, double& time, double& y, double& c, double& s)
+		{
+			ConicPropagator::Stumpff(z, c, s);
+			y = radiusSum + a * (z * s - 1.0) / sqrt(c);
+			if (y < 0)
+			{
+				return false;
+			}
+
+			double x = sqrt(y / c);
+			time = x * x * x * s + a * sqrt(y);
+			return true;
+		}
+
+		double ScaledTimeSlope(double z, double a, double y, double c, double s)
+		{
+			if (fabs(z) > ConicPropagator::SeriesLimit)
+			{
+				double ratio = y / c;
+				return ratio * sqrt(ratio) * ((c - 1.5 * s / c) / (2.0 * z) + 0.75 * s * s / c) + a / 8.0 * (3.0 * s / c * sqrt(y) + a * sqrt(c / y));
+			}
+
+			return sqrt(2.0) / 40.0 * y * sqrt(y) + a / 8.0 * (sqrt(y) + a * sqrt(1.0 / (2.0 * y)));
+		}
+	}
+
+	void LambertSolver::Solve(Batch& batch, double gravitationalParameter, bool prograde)
+	{
+		double a[BatchSize];
+		double departureRadius[BatchSize];
+		double arrivalRadius[BatchSize];
+		double target[BatchSize];
+		double z[BatchSize];
+		double low[BatchSize];
+		double high[BatchSize];
+		double y[BatchSize];
+		bool active[BatchSize];
+
+		double rootGravitationalParameter = sqrt(gravitationalParameter);
+		for (uint32_t lane = 0; lane < BatchSize; ++lane)
+		{
+			batch.mSolved[lane] = false;
+			active[lane] = false;
+
+			double x1 = batch.mDepartureX[lane], y1 = batch.mDepartureY[lane], z1 = batch.mDepartureZ[lane];
+			double x2 = batch.mArrivalX[lane], y2 = batch.mArrivalY[lane], z2 = batch.mArrivalZ[lane];
+			departureRadius[lane] = sqrt(x1 * x1 + y1 * y1 + z1 * z1);
+			arrivalRadius[lane] = sqrt(x2 * x2 + y2 * y2 + z2 * z2);
+			if (departureRadius[lane] <= 0 || arrivalRadius[lane] <= 0 || !(batch.mTimeOfFlight[lane] > 0) || gravitationalParameter <= 0)
+			{
+				continue;
+			}
+
+			// the y component of r1 x r2 tells which way round the short arc turns
+			double cosAngle = (x1 * x2 + y1 * y2 + z1 * z2) / (departureRadius[lane] * arrivalRadius[lane]);
+			cosAngle = max(-1.0, min(1.0, cosAngle));
+			double angle = acos(cosAngle);
+			double north = z1 * x2 - x1 * z2;
+			if (prograde ? (north < 0) : (north > 0))
+			{
+				angle = 2.0 * Pi - angle;
+			}
+
+			double sinAngle = sin(angle);
+			if (fabs(sinAngle) < 1.0e-9 || cosAngle >= 1.0)
+			{
+				continue;
+			}
+			a[lane] = sinAngle * sqrt(departureRadius[lane] * arrivalRadius[lane] / (1.0 - cosAngle));
+			target[lane] = rootGravitationalParameter * batch.mTimeOfFlight[lane];
+
+			// the time of flight runs to infinity at the top of the elliptic range, and the bottom is pushed down into
+			// the hyperbolas until it falls short of the target or leaves the range where an orbit fits
+			double radiusSum = departureRadius[lane] + arrivalRadius[lane];
+			double time, laneY, c, s;
+			high[lane] = EllipticLimit;
+			low[lane] = -EllipticLimit;
+			uint32_t expansion = 0;
+			while (ScaledTime(low[lane], a[lane], radiusSum, time, laneY, c, s) && time > target[lane] && expansion < MaxBracketExpansions)
+			{
+				high[lane] = low[lane];
+				low[lane] *= 2.0;
+				++expansion;
+			}
+			if (expansion == MaxBracketExpansions)
+			{
+				continue;
+			}
+
+			z[lane] = (low[lane] < 0 && high[lane] > 0) ? 0.0 : 0.5 * (low[lane] + high[lane]);
+			active[lane] = true;
+		}
+
+		for (uint32_t iteration = 0; iteration < MaxIterations; ++iteration)
+		{
+			bool anyActive = false;
+			for (uint32_t lane = 0; lane < BatchSize; ++lane)
+			{
+				if (!active[lane])
+				{
+					continue;
+				}
+
+				double radiusSum = departureRadius[lane] + arrivalRadius[lane];
+				double time, c, s;
+				if (!ScaledTime(z[lane], a[lane], radiusSum, time, y[lane], c, s))
+				{
+					low[lane] = z[lane];
+					z[lane] = 0.5 * (low[lane] + high[lane]);
+					anyActive = true;
+					continue;
+				}
+
+				double residual = time - target[lane];
+				if (fabs(residual) <= Tolerance * target[lane])
+				{
+					active[lane] = false;
+					batch.mSolved[lane] = true;
+					continue;
+				}
+
+				if (residual < 0)
+				{
+					low[lane] = z[lane];
+				}
+				else
+				{
+					high[lane] = z[lane];
+				}
+
+				double slope = ScaledTimeSlope(z[lane], a[lane], y[lane], c, s);
+				double next = z[lane] - residual / slope;
+				z[lane] = (slope > 0 && next > low[lane] && next < high[lane]) ? next : 0.5 * (low[lane] + high[lane]);
+				anyActive = true;
+			}
+
+			if (!anyActive)
+			{
+				break;
+			}
+		}
+
+		// Lagrange coefficients of the converged orbit
+		for (uint32_t lane = 0; lane < BatchSize; ++lane)
+		{
+			if (!batch.mSolved[lane])
+			{
+				batch.mDepartureVelocityX[lane] = batch.mDepartureVelocityY[lane] = batch.mDepartureVelocityZ[lane] = 0;
+				batch.mArrivalVelocityX[lane] = batch.mArrivalVelocityY[lane] = batch.mArrivalVelocityZ[lane] = 0;
+				continue;
+			}
+
+			double f = 1.0 - y[lane] / departureRadius[lane];
+			double g = a[lane] * sqrt(y[lane] / gravitationalParameter);
+			double gDot = 1.0 - y[lane] / arrivalRadius[lane];
+			batch.mDepartureVelocityX[lane] = (batch.mArrivalX[lane] - f * batch.mDepartureX[lane]) / g;
+			batch.mDepartureVelocityY[lane] = (batch.mArrivalY[lane] - f * batch.mDepartureY[lane]) / g;
+			batch.mDepartureVelocityZ[lane] = (batch.mArrivalZ[lane] - f * batch.mDepartureZ[lane]) / g;
+			batch.mArrivalVelocityX[lane] = (gDot * batch.mArrivalX[lane] - batch.mDepartureX[lane]) / g;
+			batch.mArrivalVelocityY[lane] = (gDot * batch.mArrivalY[lane] - batch.mDepartureY[lane]) / g;
+			batch.mArrivalVelocityZ[lane] = (gDot * batch.mArrivalZ[lane] - batch.mDepartureZ[lane]) / g;
+		}
+	}
+
+	bool LambertSolver::Solve(const double* departure, const double* arrival, double timeOfFlight, double gravitationalParameter, bool prograde,
+		double* departureVelocity, double* arrivalVelocity)
+	{
+		// the spare lanes repeat the problem rather than solve garbage
+		Batch batch;
+		for (uint32_t lane = 0; lane < BatchSize; ++lane)
+		{
+			batch.mDepartureX[lane] = departure[0];
+			batch.mDepartureY[lane] = departure[1];
+			batch.mDepartureZ[lane] = departure[2];
+			batch.mArrivalX[lane] = arrival[0];
+			batch.mArrivalY[lane] = arrival[1];
+			batch.mArrivalZ[lane] = arrival[2];
+			batch.mTimeOfFlight[lane] = timeOfFlight;
+		}
+
+		Solve(batch, gravitationalParameter, prograde);
+		departureVelocity[0] = batch.mDepartureVelocityX[0];
+		departureVelocity[1] = batch.mDepartureVelocityY[0];
+		departureVelocity[2] = batch.mDepartureVelocityZ[0];
+		arrivalVelocity[0] = batch.mArrivalVelocityX[0];
+		arrivalVelocity[1] = batch.mArrivalVelocityY[0];
+		arrivalVelocity[2] = batch.mArrivalVelocityZ[0];
+		return batch.mSolved[0];
+	}
+}
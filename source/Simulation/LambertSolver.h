@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Simulation
+{
+	// Solves Lambert's problem, the two-body orbit that leaves one position and reaches another after a given time, for
+	// transfers of less than one revolution, BatchSize problems at a time.
+	//
+	// The universal variable formulation (Bate, Mueller and White; Curtis) writes the time of flight as a function of
+	// z = alpha chi^2, which grows monotonically from the hyperbolas at negative z through the parabola at zero to the
+	// ellipses up to z = 4 pi^2. Each lane brackets its root, then takes Newton steps, falling back to bisection whenever
+	// a step leaves the bracket, until the time of flight is within Tolerance of the one asked for or MaxIterations run
+	// out. The lanes of a batch share the iteration loop in structure of arrays form and stop together once all of them
+	// converged. Work is in double precision: near the parabola the time of flight loses too many digits in float.
+	//
+	// Prograde transfers turn counterclockwise seen from +y, the world's north. Transfers of exactly pi radians have no
+	// defined plane and are reported as unsolved, as are ones whose bracket cannot be found.
+	class LambertSolver final
+	{
+	public:
+		static const std::uint32_t BatchSize = 4;
+
+		// Positions relative to the central body go in, the velocities at both ends come out.
+		struct Batch
+		{
+			double mDepartureX[BatchSize];
+			double mDepartureY[BatchSize];
+			double mDepartureZ[BatchSize];
+			double mArrivalX[BatchSize];
+			double mArrivalY[BatchSize];
+			double mArrivalZ[BatchSize];
+			double mTimeOfFlight[BatchSize];
+			double mDepartureVelocityX[BatchSize];
+			double mDepartureVelocityY[BatchSize];
+			double mDepartureVelocityZ[BatchSize];
+			double mArrivalVelocityX[BatchSize];
+			double mArrivalVelocityY[BatchSize];
+			double mArrivalVelocityZ[BatchSize];
+			bool mSolved[BatchSize];
+		};
+
+		static void Solve(Batch& batch, double gravitationalParameter, bool prograde);
+		// Three components each.
+		static bool Solve(const double* departure, const double* arrival, double timeOfFlight, double gravitationalParameter, bool prograde,
+			double* departureVelocity, double* arrivalVelocity);
+
+		static const std::uint32_t MaxIterations;
+		static const std::uint32_t MaxBracketExpansions;
+		static const double Tolerance;
+
+		LambertSolver() = delete;
+		LambertSolver(const LambertSolver&) = delete;
+		LambertSolver& operator=(const LambertSolver&) = delete;
+		LambertSolver(LambertSolver&&) = delete;
+		LambertSolver& operator=(LambertSolver&&) = delete;
+		~LambertSolver() = default;
+	};
+}
@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "LeapfrogIntegrator.h"
+#include "NBodyState.h"
+#include "GravitySolver.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	namespace
+	{
+		// values += scale * rates over whole batches, padding included
+		inline void XM_CALLCONV MultiplyAdd(float* values, const float* rates, FXMVECTOR scale, uint32_t paddedCount)
+		{
+			for (uint32_t index = 0; index < paddedCount; index += NBodyState::BatchSize)
+			{
+				XMVECTOR value = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&values[index]));
+				XMVECTOR rate = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&rates[index]));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&values[index]), XMVectorMultiplyAdd(rate, scale, value));
+			}
+		}
+
+		// the same with Kahan summation, carrying what each sum rounded off into the next increment
+		inline void XM_CALLCONV CompensatedMultiplyAdd(float* values, float* carries, const float* rates, FXMVECTOR scale, uint32_t paddedCount)
+		{
+			for (uint32_t index = 0; index < paddedCount; index += NBodyState::BatchSize)
+			{
+				XMVECTOR value = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&values[index]));
+				XMVECTOR carry = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&carries[index]));
+				XMVECTOR rate = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&rates[index]));
+				XMVECTOR increment = XMVectorSubtract(XMVectorMultiply(rate, scale), carry);
+				XMVECTOR sum = XMVectorAdd(value, increment);
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&carries[index]), XMVectorSubtract(XMVectorSubtract(sum, value), increment));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&values[index]), sum);
+			}
+		}
+	}
+
+	void LeapfrogIntegrator::Initialize(NBodyState& state, GravitySolver& solver)
+	{
+		mCarries.assign(3ull * state.PaddedCount(), 0.0f);
+		solver.ComputeAccelerations(state);
+	}
+
+	void LeapfrogIntegrator::Step(NBodyState& state, GravitySolver& solver, double timestep)
+	{
+		float halfStep = static_cast<float>(timestep * 0.5);
+		Kick(state, halfStep);
+		Drift(state, static_cast<float>(timestep), mCarries);
+		solver.ComputeAccelerations(state);
+		Kick(state, halfStep);
+	}
+
+	void LeapfrogIntegrator::SaveState(vector<double>& values) const
+	{
+		values.insert(values.end(), mCarries.begin(), mCarries.end());
+	}
+
+	void LeapfrogIntegrator::RestoreState(NBodyState& state, const double* values, uint64_t count)
+	{
+		if (count != 3ull * state.PaddedCount())
+		{
+			throw runtime_error("Leapfrog state does not match the body count");
+		}
+		mCarries.assign(values, values + count);
+	}
+
+	void LeapfrogIntegrator::Kick(NBodyState& state, float timestep)
+	{
+		XMVECTOR scale = XMVectorReplicate(timestep);
+		MultiplyAdd(state.VelocityX(), state.AccelerationX(), scale, state.PaddedCount());
+		MultiplyAdd(state.VelocityY(), state.AccelerationY(), scale, state.PaddedCount());
+		MultiplyAdd(state.VelocityZ(), state.AccelerationZ(), scale, state.PaddedCount());
+	}
+
+	void LeapfrogIntegrator::Drift(NBodyState& state, float timestep, vector<float>& carries)
+	{
+		XMVECTOR scale = XMVectorReplicate(timestep);
+		uint32_t paddedCount = state.PaddedCount();
+		CompensatedMultiplyAdd(state.PositionX(), &carries[0], state.VelocityX(), scale, paddedCount);
+		CompensatedMultiplyAdd(state.PositionY(), &carries[paddedCount], state.VelocityY(), scale, paddedCount);
+		CompensatedMultiplyAdd(state.PositionZ(), &carries[2 * paddedCount], state.VelocityZ(), scale, paddedCount);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Integrator.h"
+
+namespace Simulation
+{
+	// Second order symplectic kick-drift-kick leapfrog (velocity Verlet). The accelerations left in the state by one step
+	// are the opening kick of the next, so each step costs a single force evaluation.
+	//
+	// Positions are float, and a moon far out in the scene moves by less than a float step of its distance in a small
+	// timestep, so a plain drift would round away a steady fraction of every step and lose the moon from its planet
+	// within centuries. The drift is compensated instead: the part of each increment that rounding dropped is carried
+	// into the next one, which is the single precision state's only error kept between steps, so it goes to checkpoints.
+	class LeapfrogIntegrator final : public Integrator
+	{
+	public:
+		LeapfrogIntegrator() = default;
+		LeapfrogIntegrator(const LeapfrogIntegrator&) = delete;
+		LeapfrogIntegrator& operator=(const LeapfrogIntegrator&) = delete;
+		LeapfrogIntegrator(LeapfrogIntegrator&&) = delete;
+		LeapfrogIntegrator& operator=(LeapfrogIntegrator&&) = delete;
+		~LeapfrogIntegrator() = default;
+
+		void Initialize(NBodyState& state, GravitySolver& solver) override;
+		void Step(NBodyState& state, GravitySolver& solver, double timestep) override;
+		void SaveState(std::vector<double>& values) const override;
+		void RestoreState(NBodyState& state, const double* values, std::uint64_t count) override;
+
+		static void Kick(NBodyState& state, float timestep);
+		// Kahan summed drift; carries holds the X, Y and Z rounding carries of PaddedCount bodies one after another and
+		// starts out zero.
+		static void Drift(NBodyState& state, float timestep, std::vector<float>& carries);
+
+	private:
+		std::vector<float> mCarries;
+	};
+}
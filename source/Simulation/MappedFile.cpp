@@ -0,0 +1,118 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace Simulation
+{
+	MappedFile::MappedFile(const string& path) :
+		mData(nullptr), mSize(0), mFileHandle(nullptr), mMappingHandle(nullptr)
+	{
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw runtime_error("Could not open file: " + path);
+		}
+		mFileHandle = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			Unmap();
+			throw runtime_error("Could not map file: " + path);
+		}
+		mSize = static_cast<uint64_t>(size.QuadPart);
+
+		mMappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mMappingHandle != nullptr)
+		{
+			mData = static_cast<const uint8_t*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (mData == nullptr)
+		{
+			Unmap();
+			throw runtime_error("Could not map file: " + path);
+		}
+#else
+		int file = open(path.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			throw runtime_error("Could not open file: " + path);
+		}
+
+		// the mapping outlives the descriptor
+		struct stat status;
+		void* data = MAP_FAILED;
+		if (fstat(file, &status) == 0 && status.st_size > 0)
+		{
+			mSize = static_cast<uint64_t>(status.st_size);
+			data = mmap(nullptr, static_cast<size_t>(mSize), PROT_READ, MAP_SHARED, file, 0);
+		}
+		close(file);
+		if (data == MAP_FAILED)
+		{
+			mSize = 0;
+			throw runtime_error("Could not map file: " + path);
+		}
+		mData = static_cast<const uint8_t*>(data);
+#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Unmap();
+	}
+
+	const uint8_t* MappedFile::Data() const
+	{
+		return mData;
+	}
+
+	uint64_t MappedFile::Size() const
+	{
+		return mSize;
+	}
+
+	void MappedFile::Unmap()
+	{
+#if defined(_WIN32)
+		if (mData != nullptr)
+		{
+			UnmapViewOfFile(mData);
+		}
+		if (mMappingHandle != nullptr)
+		{
+			CloseHandle(mMappingHandle);
+		}
+		if (mFileHandle != nullptr)
+		{
+			CloseHandle(mFileHandle);
+		}
+#else
+		if (mData != nullptr)
+		{
+			munmap(const_cast<uint8_t*>(mData), static_cast<size_t>(mSize));
+		}
+#endif
+		mData = nullptr;
+		mSize = 0;
+		mFileHandle = nullptr;
+		mMappingHandle = nullptr;
+	}
+}
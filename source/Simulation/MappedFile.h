@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Simulation
+{
+	// A whole file mapped read only into memory, for the file formats that hand out pointers straight into their data
+	// rather than reading it. Pages are only read as they are touched. Throws if the file cannot be opened, is empty or
+	// cannot be mapped.
+	class MappedFile final
+	{
+	public:
+		explicit MappedFile(const std::string& path);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+		MappedFile& operator=(MappedFile&&) = delete;
+		~MappedFile();
+
+		const std::uint8_t* Data() const;
+		std::uint64_t Size() const;
+
+	private:
+		void Unmap();
+
+		const std::uint8_t* mData;
+		std::uint64_t mSize;
+		void* mFileHandle;
+		void* mMappingHandle;
+	};
+}
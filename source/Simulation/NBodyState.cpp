@@ -0,0 +1,227 @@
+#include "pch.h"
+#include "NBodyState.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t NBodyState::BatchSize = 4;
+
+	NBodyState::NBodyState() :
+		mCount(0)
+	{
+	}
+
+	void NBodyState::Resize(uint32_t count)
+	{
+		mCount = count;
+
+		uint32_t paddedCount = ((count + BatchSize - 1) / BatchSize) * BatchSize;
+		mPositionX.assign(paddedCount, 0.0f);
+		mPositionY.assign(paddedCount, 0.0f);
+		mPositionZ.assign(paddedCount, 0.0f);
+		mVelocityX.assign(paddedCount, 0.0f);
+		mVelocityY.assign(paddedCount, 0.0f);
+		mVelocityZ.assign(paddedCount, 0.0f);
+		mAccelerationX.assign(paddedCount, 0.0f);
+		mAccelerationY.assign(paddedCount, 0.0f);
+		mAccelerationZ.assign(paddedCount, 0.0f);
+		mGravitationalParameters.assign(paddedCount, 0.0f);
+	}
+
+	void NBodyState::SetBody(uint32_t index, const XMFLOAT3& position, const XMFLOAT3& velocity, float gravitationalParameter)
+	{
+		assert(index < mCount);
+
+		mPositionX[index] = position.x;
+		mPositionY[index] = position.y;
+		mPositionZ[index] = position.z;
+		mVelocityX[index] = velocity.x;
+		mVelocityY[index] = velocity.y;
+		mVelocityZ[index] = velocity.z;
+		mGravitationalParameters[index] = gravitationalParameter;
+	}
+
+	uint32_t NBodyState::Count() const
+	{
+		return mCount;
+	}
+
+	uint32_t NBodyState::PaddedCount() const
+	{
+		return static_cast<uint32_t>(mPositionX.size());
+	}
+
+	XMFLOAT3 NBodyState::Position(uint32_t index) const
+	{
+		return XMFLOAT3(mPositionX[index], mPositionY[index], mPositionZ[index]);
+	}
+
+	XMFLOAT3 NBodyState::Velocity(uint32_t index) const
+	{
+		return XMFLOAT3(mVelocityX[index], mVelocityY[index], mVelocityZ[index]);
+	}
+
+	float NBodyState::GravitationalParameter(uint32_t index) const
+	{
+		return mGravitationalParameters[index];
+	}
+
+	void NBodyState::RemoveNetMomentum()
+	{
+		double totalMass = 0;
+		double momentumX = 0;
+		double momentumY = 0;
+		double momentumZ = 0;
+		for (uint32_t index = 0; index < mCount; ++index)
+		{
+			double mass = mGravitationalParameters[index];
+			totalMass += mass;
+			momentumX += mass * mVelocityX[index];
+			momentumY += mass * mVelocityY[index];
+			momentumZ += mass * mVelocityZ[index];
+		}
+
+		if (totalMass > 0)
+		{
+			float velocityX = static_cast<float>(momentumX / totalMass);
+			float velocityY = static_cast<float>(momentumY / totalMass);
+			float velocityZ = static_cast<float>(momentumZ / totalMass);
+			for (uint32_t index = 0; index < mCount; ++index)
+			{
+				mVelocityX[index] -= velocityX;
+				mVelocityY[index] -= velocityY;
+				mVelocityZ[index] -= velocityZ;
+			}
+		}
+	}
+
+	double NBodyState::KineticEnergy() const
+	{
+		double energy = 0;
+		for (uint32_t index = 0; index < mCount; ++index)
+		{
+			double speedSquared = static_cast<double>(mVelocityX[index]) * mVelocityX[index] +
+				static_cast<double>(mVelocityY[index]) * mVelocityY[index] + static_cast<double>(mVelocityZ[index]) * mVelocityZ[index];
+			energy += 0.5 * mGravitationalParameters[index] * speedSquared;
+		}
+		return energy;
+	}
+
+	double NBodyState::PotentialEnergy(float softening) const
+	{
+		double softeningSquared = static_cast<double>(softening) * softening;
+		double energy = 0;
+		for (uint32_t first = 0; first < mCount; ++first)
+		{
+			for (uint32_t second = first + 1; second < mCount; ++second)
+			{
+				double deltaX = static_cast<double>(mPositionX[second]) - mPositionX[first];
+				double deltaY = static_cast<double>(mPositionY[second]) - mPositionY[first];
+				double deltaZ = static_cast<double>(mPositionZ[second]) - mPositionZ[first];
+				double distance = sqrt(deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ + softeningSquared);
+				if (distance > 0)
+				{
+					energy -= static_cast<double>(mGravitationalParameters[first]) * mGravitationalParameters[second] / distance;
+				}
+			}
+		}
+		return energy;
+	}
+
+	float* NBodyState::PositionX()
+	{
+		return mPositionX.data();
+	}
+
+	float* NBodyState::PositionY()
+	{
+		return mPositionY.data();
+	}
+
+	float* NBodyState::PositionZ()
+	{
+		return mPositionZ.data();
+	}
+
+	float* NBodyState::VelocityX()
+	{
+		return mVelocityX.data();
+	}
+
+	float* NBodyState::VelocityY()
+	{
+		return mVelocityY.data();
+	}
+
+	float* NBodyState::VelocityZ()
+	{
+		return mVelocityZ.data();
+	}
+
+	float* NBodyState::AccelerationX()
+	{
+		return mAccelerationX.data();
+	}
+
+	float* NBodyState::AccelerationY()
+	{
+		return mAccelerationY.data();
+	}
+
+	float* NBodyState::AccelerationZ()
+	{
+		return mAccelerationZ.data();
+	}
+
+	const float* NBodyState::PositionX() const
+	{
+		return mPositionX.data();
+	}
+
+	const float* NBodyState::PositionY() const
+	{
+		return mPositionY.data();
+	}
+
+	const float* NBodyState::PositionZ() const
+	{
+		return mPositionZ.data();
+	}
+
+	const float* NBodyState::VelocityX() const
+	{
+		return mVelocityX.data();
+	}
+
+	const float* NBodyState::VelocityY() const
+	{
+		return mVelocityY.data();
+	}
+
+	const float* NBodyState::VelocityZ() const
+	{
+		return mVelocityZ.data();
+	}
+
+	const float* NBodyState::AccelerationX() const
+	{
+		return mAccelerationX.data();
+	}
+
+	const float* NBodyState::AccelerationY() const
+	{
+		return mAccelerationY.data();
+	}
+
+	const float* NBodyState::AccelerationZ() const
+	{
+		return mAccelerationZ.data();
+	}
+
+	const float* NBodyState::GravitationalParameters() const
+	{
+		return mGravitationalParameters.data();
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+namespace Simulation
+{
+	// Structure of arrays phase space for the gravity integrators: position, velocity, acceleration and gravitational
+	// parameter (G * mass) of every body, each component in its own array so the force kernels can load BatchSize
+	// bodies per vector. Arrays are padded to a whole number of batches with massless bodies at the origin.
+	class NBodyState final
+	{
+	public:
+		NBodyState();
+		NBodyState(const NBodyState&) = delete;
+		NBodyState& operator=(const NBodyState&) = delete;
+		NBodyState(NBodyState&&) = default;
+		NBodyState& operator=(NBodyState&&) = default;
+		~NBodyState() = default;
+
+		void Resize(std::uint32_t count);
+		void SetBody(std::uint32_t index, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& velocity, float gravitationalParameter);
+
+		std::uint32_t Count() const;
+		std::uint32_t PaddedCount() const;
+
+		DirectX::XMFLOAT3 Position(std::uint32_t index) const;
+		DirectX::XMFLOAT3 Velocity(std::uint32_t index) const;
+		float GravitationalParameter(std::uint32_t index) const;
+
+		// Shifts every velocity so that the total momentum is zero and the system does not drift as a whole.
+		void RemoveNetMomentum();
+		// Energies in units of G, as the state only knows G * mass. The potential uses the same Plummer softening as the
+		// solvers so that the total is the quantity the integrators conserve.
+		double KineticEnergy() const;
+		double PotentialEnergy(float softening) const;
+
+		float* PositionX();
+		float* PositionY();
+		float* PositionZ();
+		float* VelocityX();
+		float* VelocityY();
+		float* VelocityZ();
+		float* AccelerationX();
+		float* AccelerationY();
+		float* AccelerationZ();
+		const float* PositionX() const;
+		const float* PositionY() const;
+		const float* PositionZ() const;
+		const float* VelocityX() const;
+		const float* VelocityY() const;
+		const float* VelocityZ() const;
+		const float* AccelerationX() const;
+		const float* AccelerationY() const;
+		const float* AccelerationZ() const;
+		const float* GravitationalParameters() const;
+
+		static const std::uint32_t BatchSize;
+
+	private:
+		std::vector<float> mPositionX;
+		std::vector<float> mPositionY;
+		std::vector<float> mPositionZ;
+		std::vector<float> mVelocityX;
+		std::vector<float> mVelocityY;
+		std::vector<float> mVelocityZ;
+		std::vector<float> mAccelerationX;
+		std::vector<float> mAccelerationY;
+		std::vector<float> mAccelerationZ;
+		std::vector<float> mGravitationalParameters;
+		std::uint32_t mCount;
+	};
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+namespace Simulation
+{
+	// Classical elements of an elliptic orbit about the parent body. Angles are in radians and measured in the
+	// reference plane of the parent (the x/z plane of the world, y up); the mean anomaly is the value at time zero.
+	struct OrbitalElements
+	{
+		float mSemiMajorAxis;
+		float mEccentricity;
+		float mInclination;
+		float mLongitudeOfAscendingNode;
+		float mArgumentOfPeriapsis;
+		float mMeanAnomaly;
+		double mPeriod;
+	};
+}
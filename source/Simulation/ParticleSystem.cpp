@@ -0,0 +1,400 @@
+#include "pch.h"
+#include "ParticleSystem.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t ParticleSystem::BatchSize = 4;
+	const uint32_t ParticleSystem::UpdateGrainSize = 16384;
+	const uint32_t ParticleSystem::EmissionChunkSize = 1024;
+	const uint32_t ParticleSystem::BytesPerParticle = static_cast<uint32_t>(9 * sizeof(float) + sizeof(uint32_t));
+
+	namespace
+	{
+		// SplitMix64, which is cheap to seed per chunk and, unlike the standard distributions, the same everywhere
+		class ChunkGenerator final
+		{
+		public:
+			explicit ChunkGenerator(uint64_t seed) :
+				mState(seed)
+			{
+			}
+
+			uint64_t Next()
+			{
+				uint64_t value = (mState += 0x9E3779B97F4A7C15ull);
+				value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+				value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+				return value ^ (value >> 31);
+			}
+
+			// in [0, 1)
+			float Uniform()
+			{
+				return (Next() >> 40) * (1.0f / 16777216.0f);
+			}
+
+			// in [-1, 1)
+			float Signed()
+			{
+				return 2.0f * Uniform() - 1.0f;
+			}
+
+		private:
+			uint64_t mState;
+		};
+
+		uint64_t ChunkSeed(uint32_t seed, uint32_t emitter, uint64_t step, uint32_t chunk)
+		{
+			ChunkGenerator mixer((static_cast<uint64_t>(seed) << 32) | emitter);
+			ChunkGenerator stepMixer(mixer.Next() ^ step);
+			return stepMixer.Next() ^ chunk;
+		}
+	}
+
+	ParticleSystem::ParticleSystem() :
+		mCount(0), mCapacity(0), mStep(0), mEmittedCount(0), mDroppedCount(0)
+	{
+	}
+
+	void ParticleSystem::SetCapacity(uint32_t capacity)
+	{
+		mCapacity = capacity;
+		uint32_t paddedCapacity = ((capacity + BatchSize - 1) / BatchSize) * BatchSize;
+		mPositionX.assign(paddedCapacity, 0.0f);
+		mPositionY.assign(paddedCapacity, 0.0f);
+		mPositionZ.assign(paddedCapacity, 0.0f);
+		mVelocityX.assign(paddedCapacity, 0.0f);
+		mVelocityY.assign(paddedCapacity, 0.0f);
+		mVelocityZ.assign(paddedCapacity, 0.0f);
+		mAges.assign(paddedCapacity, 0.0f);
+		mAgingRates.assign(paddedCapacity, 0.0f);
+		mSizes.assign(paddedCapacity, 0.0f);
+		mOwners.assign(paddedCapacity, 0);
+		mEmissionTasks.reserve(mEmitters.size() + capacity / EmissionChunkSize + 1);
+		Clear();
+	}
+
+	void ParticleSystem::Clear()
+	{
+		mCount = 0;
+		mStep = 0;
+		fill(mEmissionBacklog.begin(), mEmissionBacklog.end(), 0.0f);
+	}
+
+	uint32_t ParticleSystem::AddEmitter(const ParticleEmitter& emitter)
+	{
+		mEmitters.push_back(emitter);
+		mEmissionBacklog.push_back(0.0f);
+		mEmissionTasks.reserve(mEmitters.size() + mCapacity / EmissionChunkSize + 1);
+		return static_cast<uint32_t>(mEmitters.size() - 1);
+	}
+
+	uint32_t ParticleSystem::EmitterCount() const
+	{
+		return static_cast<uint32_t>(mEmitters.size());
+	}
+
+	ParticleEmitter& ParticleSystem::Emitter(uint32_t index)
+	{
+		return mEmitters[index];
+	}
+
+	const ParticleEmitter& ParticleSystem::Emitter(uint32_t index) const
+	{
+		return mEmitters[index];
+	}
+
+	void ParticleSystem::Update(float elapsedSeconds)
+	{
+		Integrate(0, PaddedCount(), elapsedSeconds);
+		Retire();
+		ScheduleEmission(elapsedSeconds);
+
+		for (const auto& task : mEmissionTasks)
+		{
+			uint32_t count = PlacedCount(task);
+			if (count > 0)
+			{
+				Emit(task, static_cast<uint32_t>(task.mFirst), count, elapsedSeconds);
+			}
+		}
+		FinishEmission();
+		++mStep;
+	}
+
+	void ParticleSystem::Update(float elapsedSeconds, ThreadPool& threadPool)
+	{
+		assert(UpdateGrainSize % BatchSize == 0);
+
+		auto integrate = [this, elapsedSeconds](uint32_t begin, uint32_t end)
+		{
+			Integrate(begin, end, elapsedSeconds);
+		};
+		threadPool.ParallelFor(0, PaddedCount(), UpdateGrainSize, integrate);
+
+		// swapping dead particles out is cheap next to the update, but inherently serial
+		Retire();
+		ScheduleEmission(elapsedSeconds);
+
+		// every chunk was given its slots by ScheduleEmission, so the same chunks are dropped on any number of threads
+		auto emit = [this, elapsedSeconds](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t index = begin; index < end; ++index)
+			{
+				const EmissionTask& task = mEmissionTasks[index];
+				uint32_t count = PlacedCount(task);
+				if (count > 0)
+				{
+					Emit(task, static_cast<uint32_t>(task.mFirst), count, elapsedSeconds);
+				}
+			}
+		};
+		threadPool.ParallelFor(0, static_cast<uint32_t>(mEmissionTasks.size()), 1, emit);
+		FinishEmission();
+		++mStep;
+	}
+
+	uint32_t ParticleSystem::Count() const
+	{
+		return mCount;
+	}
+
+	uint32_t ParticleSystem::Capacity() const
+	{
+		return mCapacity;
+	}
+
+	uint64_t ParticleSystem::EmittedCount() const
+	{
+		return mEmittedCount;
+	}
+
+	uint64_t ParticleSystem::DroppedCount() const
+	{
+		return mDroppedCount;
+	}
+
+	void ParticleSystem::WriteVertices(ParticleColorVertex* vertices, float rewindSeconds) const
+	{
+		WriteRange(vertices, 0, mCount, rewindSeconds);
+	}
+
+	void ParticleSystem::WriteVertices(ParticleColorVertex* vertices, float rewindSeconds, ThreadPool& threadPool) const
+	{
+		auto write = [this, vertices, rewindSeconds](uint32_t begin, uint32_t end)
+		{
+			WriteRange(vertices, begin, end, rewindSeconds);
+		};
+		threadPool.ParallelFor(0, mCount, UpdateGrainSize, write);
+	}
+
+	void ParticleSystem::WriteVertices(ParticleSizeVertex* vertices, float rewindSeconds) const
+	{
+		WriteRange(vertices, 0, mCount, rewindSeconds);
+	}
+
+	void ParticleSystem::WriteVertices(ParticleSizeVertex* vertices, float rewindSeconds, ThreadPool& threadPool) const
+	{
+		auto write = [this, vertices, rewindSeconds](uint32_t begin, uint32_t end)
+		{
+			WriteRange(vertices, begin, end, rewindSeconds);
+		};
+		threadPool.ParallelFor(0, mCount, UpdateGrainSize, write);
+	}
+
+	void ParticleSystem::Integrate(uint32_t begin, uint32_t end, float elapsedSeconds)
+	{
+		assert(begin % BatchSize == 0);
+
+		XMVECTOR timestep = XMVectorReplicate(elapsedSeconds);
+		for (uint32_t index = begin; index < end; index += BatchSize)
+		{
+			XMFLOAT4* positionX = reinterpret_cast<XMFLOAT4*>(&mPositionX[index]);
+			XMFLOAT4* positionY = reinterpret_cast<XMFLOAT4*>(&mPositionY[index]);
+			XMFLOAT4* positionZ = reinterpret_cast<XMFLOAT4*>(&mPositionZ[index]);
+			XMFLOAT4* ages = reinterpret_cast<XMFLOAT4*>(&mAges[index]);
+
+			XMStoreFloat4(positionX, XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mVelocityX[index])), timestep, XMLoadFloat4(positionX)));
+			XMStoreFloat4(positionY, XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mVelocityY[index])), timestep, XMLoadFloat4(positionY)));
+			XMStoreFloat4(positionZ, XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mVelocityZ[index])), timestep, XMLoadFloat4(positionZ)));
+			XMStoreFloat4(ages, XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mAgingRates[index])), timestep, XMLoadFloat4(ages)));
+		}
+	}
+
+	void ParticleSystem::Retire()
+	{
+		XMVECTOR one = XMVectorSplatOne();
+		uint32_t index = 0;
+		while (index < mCount)
+		{
+			// most batches have nothing to retire
+			if (index % BatchSize == 0 && index + BatchSize <= mCount &&
+				XMVector4Less(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mAges[index])), one))
+			{
+				index += BatchSize;
+				continue;
+			}
+
+			if (mAges[index] < 1.0f)
+			{
+				++index;
+				continue;
+			}
+
+			// the last particle takes the dead one's slot and is checked in turn
+			--mCount;
+			Move(mCount, index);
+		}
+	}
+
+	void ParticleSystem::ScheduleEmission(float elapsedSeconds)
+	{
+		// chunks take consecutive slots after the live particles in schedule order, an exclusive prefix sum of their counts
+		mEmissionTasks.clear();
+		uint64_t first = mCount;
+		for (uint32_t emitter = 0; emitter < mEmitters.size(); ++emitter)
+		{
+			if (!mEmitters[emitter].mEnabled)
+			{
+				mEmissionBacklog[emitter] = 0.0f;
+				continue;
+			}
+
+			// fractions of a particle carry over, so low rates still emit at the right average
+			float backlog = mEmissionBacklog[emitter] + mEmitters[emitter].mRate * elapsedSeconds;
+			uint32_t count = static_cast<uint32_t>(backlog);
+			mEmissionBacklog[emitter] = backlog - count;
+
+			for (uint32_t chunk = 0; count > 0; ++chunk)
+			{
+				uint32_t chunkCount = min(count, EmissionChunkSize);
+				mEmissionTasks.push_back({emitter, chunk, chunkCount, first});
+				first += chunkCount;
+				count -= chunkCount;
+			}
+		}
+	}
+
+	uint32_t ParticleSystem::PlacedCount(const EmissionTask& task) const
+	{
+		return (task.mFirst < mCapacity) ? static_cast<uint32_t>(min<uint64_t>(task.mCount, mCapacity - task.mFirst)) : 0;
+	}
+
+	void ParticleSystem::FinishEmission()
+	{
+		for (const auto& task : mEmissionTasks)
+		{
+			uint32_t count = PlacedCount(task);
+			mEmittedCount += count;
+			mDroppedCount += task.mCount - count;
+			mCount += count;
+		}
+	}
+
+	void ParticleSystem::Emit(const EmissionTask& task, uint32_t first, uint32_t count, float elapsedSeconds)
+	{
+		const ParticleEmitter& emitter = mEmitters[task.mEmitter];
+		ChunkGenerator generator(ChunkSeed(emitter.mSeed, task.mEmitter, mStep, task.mChunk));
+
+		// directions are drawn uniformly over the cap of the cone about the axis
+		XMVECTOR axis = XMLoadFloat3(&emitter.mDirection);
+		float spread = min(emitter.mSpread, XM_PI);
+		if (XMVector3Equal(axis, XMVectorZero()))
+		{
+			axis = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+			spread = XM_PI;
+		}
+		axis = XMVector3Normalize(axis);
+		XMVECTOR reference = (fabs(XMVectorGetY(axis)) < 0.9f) ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+		XMVECTOR tangent = XMVector3Normalize(XMVector3Cross(reference, axis));
+		XMVECTOR bitangent = XMVector3Cross(axis, tangent);
+		float capHeight = 1.0f - cos(spread);
+
+		XMVECTOR source = XMLoadFloat3(&emitter.mPosition);
+		XMVECTOR sourceVelocity = XMLoadFloat3(&emitter.mVelocity);
+		for (uint32_t offset = 0; offset < count; ++offset)
+		{
+			float cosPolar = 1.0f - capHeight * generator.Uniform();
+			float sinPolar = sqrt(max(0.0f, 1.0f - cosPolar * cosPolar));
+			float sinAzimuth;
+			float cosAzimuth;
+			XMScalarSinCos(&sinAzimuth, &cosAzimuth, XM_2PI * generator.Uniform());
+			XMVECTOR direction = XMVectorScale(axis, cosPolar);
+			direction = XMVectorAdd(direction, XMVectorScale(tangent, sinPolar * cosAzimuth));
+			direction = XMVectorAdd(direction, XMVectorScale(bitangent, sinPolar * sinAzimuth));
+
+			float speed = emitter.mSpeed * (1.0f + emitter.mSpeedVariation * generator.Signed());
+			float lifetime = emitter.mLifetime * (1.0f + emitter.mLifetimeVariation * generator.Signed());
+
+			// emission is spread over the step rather than released in one shell at its end
+			float age = elapsedSeconds * generator.Uniform();
+			XMVECTOR velocity = XMVectorMultiplyAdd(direction, XMVectorReplicate(speed), sourceVelocity);
+			XMVECTOR position = XMVectorMultiplyAdd(direction, XMVectorReplicate(emitter.mRadius), source);
+			position = XMVectorMultiplyAdd(velocity, XMVectorReplicate(age), position);
+
+			XMFLOAT3 storedPosition;
+			XMFLOAT3 storedVelocity;
+			XMStoreFloat3(&storedPosition, position);
+			XMStoreFloat3(&storedVelocity, velocity);
+
+			uint32_t index = first + offset;
+			mPositionX[index] = storedPosition.x;
+			mPositionY[index] = storedPosition.y;
+			mPositionZ[index] = storedPosition.z;
+			mVelocityX[index] = storedVelocity.x;
+			mVelocityY[index] = storedVelocity.y;
+			mVelocityZ[index] = storedVelocity.z;
+			mAgingRates[index] = 1.0f / lifetime;
+			mAges[index] = age * mAgingRates[index];
+			mSizes[index] = emitter.mSize;
+			mOwners[index] = task.mEmitter;
+		}
+	}
+
+	void ParticleSystem::Move(uint32_t source, uint32_t destination)
+	{
+		mPositionX[destination] = mPositionX[source];
+		mPositionY[destination] = mPositionY[source];
+		mPositionZ[destination] = mPositionZ[source];
+		mVelocityX[destination] = mVelocityX[source];
+		mVelocityY[destination] = mVelocityY[source];
+		mVelocityZ[destination] = mVelocityZ[source];
+		mAges[destination] = mAges[source];
+		mAgingRates[destination] = mAgingRates[source];
+		mSizes[destination] = mSizes[source];
+		mOwners[destination] = mOwners[source];
+	}
+
+	void ParticleSystem::WriteRange(ParticleColorVertex* vertices, uint32_t begin, uint32_t end, float rewindSeconds) const
+	{
+		for (uint32_t index = begin; index < end; ++index)
+		{
+			const XMFLOAT4& color = mEmitters[mOwners[index]].mColor;
+			ParticleColorVertex& vertex = vertices[index];
+			vertex.mPosition = XMFLOAT4(mPositionX[index] - mVelocityX[index] * rewindSeconds, mPositionY[index] - mVelocityY[index] * rewindSeconds,
+				mPositionZ[index] - mVelocityZ[index] * rewindSeconds, 1.0f);
+			vertex.mColor = XMFLOAT4(color.x, color.y, color.z, color.w * (1.0f - mAges[index]));
+		}
+	}
+
+	void ParticleSystem::WriteRange(ParticleSizeVertex* vertices, uint32_t begin, uint32_t end, float rewindSeconds) const
+	{
+		for (uint32_t index = begin; index < end; ++index)
+		{
+			float size = mSizes[index] * (1.0f + mEmitters[mOwners[index]].mGrowth * mAges[index]);
+			ParticleSizeVertex& vertex = vertices[index];
+			vertex.mPosition = XMFLOAT4(mPositionX[index] - mVelocityX[index] * rewindSeconds, mPositionY[index] - mVelocityY[index] * rewindSeconds,
+				mPositionZ[index] - mVelocityZ[index] * rewindSeconds, 1.0f);
+			vertex.mSize = XMFLOAT2(size, size);
+		}
+	}
+
+	uint32_t ParticleSystem::PaddedCount() const
+	{
+		return ((mCount + BatchSize - 1) / BatchSize) * BatchSize;
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+namespace Simulation
+{
+	class ThreadPool;
+
+	// A particle source that its owner moves every step. Particles leave a sphere of mRadius about mPosition along a
+	// direction at most mSpread (radians) from mDirection, or in any direction when mSpread is pi or mDirection is zero,
+	// at mSpeed on top of mVelocity. Variations are fractions of the value either way.
+	struct ParticleEmitter
+	{
+		DirectX::XMFLOAT3 mPosition;
+		DirectX::XMFLOAT3 mVelocity;
+		DirectX::XMFLOAT3 mDirection;
+		float mRadius;
+		float mSpread;
+		float mRate;
+		float mLifetime;
+		float mLifetimeVariation;
+		float mSpeed;
+		float mSpeedVariation;
+		float mSize;
+		float mGrowth;
+		DirectX::XMFLOAT4 mColor;
+		std::uint32_t mSeed;
+		bool mEnabled;
+	};
+
+	// Same layout as Library::VertexPositionColor.
+	struct ParticleColorVertex
+	{
+		DirectX::XMFLOAT4 mPosition;
+		DirectX::XMFLOAT4 mColor;
+	};
+
+	// Same layout as Library::VertexPositionSize.
+	struct ParticleSizeVertex
+	{
+		DirectX::XMFLOAT4 mPosition;
+		DirectX::XMFLOAT2 mSize;
+	};
+
+	// Pool of short lived, non interacting particles in structure of arrays form. Every array is allocated once by
+	// SetCapacity, and the live particles are always the first Count(), so nothing is allocated or freed per step:
+	// dead particles are swapped out for the last live one, and emission appends at the end.
+	//
+	// Update moves and ages the live particles BatchSize at a time, over the thread pool in grains of UpdateGrainSize,
+	// then retires the dead ones and emits. Emission is split into chunks of at most EmissionChunkSize particles, each
+	// given a contiguous range of the pool up front and filled without synchronisation. Each chunk draws from a generator
+	// seeded by its emitter, step and chunk index, so the pool is the same on any number of threads. Particles past the
+	// pool's capacity are dropped and counted.
+	//
+	// Ages are kept as the elapsed fraction of a particle's lifetime. WriteVertices fills a packed vertex stream in place,
+	// fading the emitter's colour out over the particle's life and growing its size by mGrowth.
+	class ParticleSystem final
+	{
+	public:
+		ParticleSystem();
+		ParticleSystem(const ParticleSystem&) = delete;
+		ParticleSystem& operator=(const ParticleSystem&) = delete;
+		ParticleSystem(ParticleSystem&&) = default;
+		ParticleSystem& operator=(ParticleSystem&&) = default;
+		~ParticleSystem() = default;
+
+		// Reallocates the pool and removes every particle.
+		void SetCapacity(std::uint32_t capacity);
+		void Clear();
+
+		std::uint32_t AddEmitter(const ParticleEmitter& emitter);
+		std::uint32_t EmitterCount() const;
+		ParticleEmitter& Emitter(std::uint32_t index);
+		const ParticleEmitter& Emitter(std::uint32_t index) const;
+
+		void Update(float elapsedSeconds);
+		void Update(float elapsedSeconds, ThreadPool& threadPool);
+
+		std::uint32_t Count() const;
+		std::uint32_t Capacity() const;
+		std::uint64_t EmittedCount() const;
+		std::uint64_t DroppedCount() const;
+
+		// Writes Count() vertices with the particles moved back by rewindSeconds, so they can be drawn at the time a
+		// renderer blends the bodies to.
+		void WriteVertices(ParticleColorVertex* vertices, float rewindSeconds) const;
+		void WriteVertices(ParticleColorVertex* vertices, float rewindSeconds, ThreadPool& threadPool) const;
+		void WriteVertices(ParticleSizeVertex* vertices, float rewindSeconds) const;
+		void WriteVertices(ParticleSizeVertex* vertices, float rewindSeconds, ThreadPool& threadPool) const;
+
+		static const std::uint32_t BatchSize;
+		static const std::uint32_t UpdateGrainSize;
+		static const std::uint32_t EmissionChunkSize;
+		static const std::uint32_t BytesPerParticle;
+
+	private:
+		struct EmissionTask
+		{
+			std::uint32_t mEmitter;
+			std::uint32_t mChunk;
+			std::uint32_t mCount;
+			// the pool slot of the chunk's first particle, past the capacity when the pool is full
+			std::uint64_t mFirst;
+		};
+
+		void Integrate(std::uint32_t begin, std::uint32_t end, float elapsedSeconds);
+		void Retire();
+		void ScheduleEmission(float elapsedSeconds);
+		std::uint32_t PlacedCount(const EmissionTask& task) const;
+		void Emit(const EmissionTask& task, std::uint32_t first, std::uint32_t count, float elapsedSeconds);
+		void FinishEmission();
+		void Move(std::uint32_t source, std::uint32_t destination);
+		void WriteRange(ParticleColorVertex* vertices, std::uint32_t begin, std::uint32_t end, float rewindSeconds) const;
+		void WriteRange(ParticleSizeVertex* vertices, std::uint32_t begin, std::uint32_t end, float rewindSeconds) const;
+		std::uint32_t PaddedCount() const;
+
+		std::vector<float> mPositionX;
+		std::vector<float> mPositionY;
+		std::vector<float> mPositionZ;
+		std::vector<float> mVelocityX;
+		std::vector<float> mVelocityY;
+		std::vector<float> mVelocityZ;
+		std::vector<float> mAges;
+		std::vector<float> mAgingRates;
+		std::vector<float> mSizes;
+		std::vector<std::uint32_t> mOwners;
+		std::uint32_t mCount;
+		std::uint32_t mCapacity;
+
+		std::vector<ParticleEmitter> mEmitters;
+		std::vector<float> mEmissionBacklog;
+		std::vector<EmissionTask> mEmissionTasks;
+		std::uint64_t mStep;
+		std::uint64_t mEmittedCount;
+		std::uint64_t mDroppedCount;
+	};
+}
@@ -0,0 +1,100 @@
+#include "pch.h"
+#include "RenderTransforms.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t RenderTransforms::RebaseBatchSize = 4;
+
+	RenderTransforms::RenderTransforms() :
+		mOrigin(), mCount(0)
+	{
+	}
+
+	void RenderTransforms::Resize(uint32_t count)
+	{
+		// padding lanes are never changed, so the rebase leaves them alone
+		mCount = count;
+		uint32_t paddedCount = ((count + RebaseBatchSize - 1) / RebaseBatchSize) * RebaseBatchSize;
+		mPositionX.resize(paddedCount);
+		mPositionY.resize(paddedCount);
+		mPositionZ.resize(paddedCount);
+		mTransforms.resize(count);
+		mChanged.assign(paddedCount, 0);
+	}
+
+	uint32_t RenderTransforms::Count() const
+	{
+		return mCount;
+	}
+
+	void RenderTransforms::Set(uint32_t index, const XMFLOAT4X4& transform, const WorldPosition& position)
+	{
+		mTransforms[index] = transform;
+		mPositionX[index] = position.mX;
+		mPositionY[index] = position.mY;
+		mPositionZ[index] = position.mZ;
+		mChanged[index] = 1;
+	}
+
+	void RenderTransforms::Rebase()
+	{
+		// the difference is taken in double so only the offset from the origin is rounded
+		XMFLOAT4 relativeX, relativeY, relativeZ;
+		for (uint32_t index = 0; index < mCount; index += RebaseBatchSize)
+		{
+			for (uint32_t lane = 0; lane < RebaseBatchSize; ++lane)
+			{
+				(&relativeX.x)[lane] = static_cast<float>(mPositionX[index + lane] - mOrigin.mX);
+				(&relativeY.x)[lane] = static_cast<float>(mPositionY[index + lane] - mOrigin.mY);
+				(&relativeZ.x)[lane] = static_cast<float>(mPositionZ[index + lane] - mOrigin.mZ);
+			}
+
+			for (uint32_t lane = 0; lane < RebaseBatchSize; ++lane)
+			{
+				if (mChanged[index + lane] != 0)
+				{
+					XMFLOAT4X4& transform = mTransforms[index + lane];
+					transform._41 = (&relativeX.x)[lane];
+					transform._42 = (&relativeY.x)[lane];
+					transform._43 = (&relativeZ.x)[lane];
+				}
+			}
+		}
+	}
+
+	void RenderTransforms::ClearChanged()
+	{
+		fill(mChanged.begin(), mChanged.end(), static_cast<uint8_t>(0));
+	}
+
+	const XMFLOAT4X4& RenderTransforms::Transform(uint32_t index) const
+	{
+		return mTransforms[index];
+	}
+
+	WorldPosition RenderTransforms::Position(uint32_t index) const
+	{
+		WorldPosition position = { mPositionX[index], mPositionY[index], mPositionZ[index] };
+		return position;
+	}
+
+	bool RenderTransforms::Changed(uint32_t index) const
+	{
+		return (mChanged[index] != 0);
+	}
+
+	const WorldPosition& RenderTransforms::Origin() const
+	{
+		return mOrigin;
+	}
+
+	void RenderTransforms::SetOrigin(const WorldPosition& origin)
+	{
+		mOrigin = origin;
+		fill(mChanged.begin(), mChanged.begin() + mCount, static_cast<uint8_t>(1));
+		Rebase();
+	}
+}
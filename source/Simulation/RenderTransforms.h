@@ -0,0 +1,53 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "WorldPosition.h"
+
+namespace Simulation
+{
+	// World transforms of every body as drawn, with translations relative to a render origin that a renderer moves to
+	// its camera every frame, so that what is drawn near the camera has small float coordinates however far it is from
+	// the world origin. Translations are held in double precision and rebased on the origin RebaseBatchSize bodies at a
+	// time: subtracted in double and only then rounded to float, in straight lane loops over structure of arrays that
+	// compile to vector instructions. Rebase only touches the bodies Set since the last ClearChanged, and moving the
+	// origin rebases every body. Copies reuse the destination's arrays, so they stop allocating once they have grown.
+	class RenderTransforms final
+	{
+	public:
+		RenderTransforms();
+		RenderTransforms(const RenderTransforms&) = default;
+		RenderTransforms& operator=(const RenderTransforms&) = default;
+		RenderTransforms(RenderTransforms&&) = default;
+		RenderTransforms& operator=(RenderTransforms&&) = default;
+		~RenderTransforms() = default;
+
+		void Resize(std::uint32_t count);
+		std::uint32_t Count() const;
+
+		// Takes a body's world transform with its translation replaced by position, for the next Rebase.
+		void Set(std::uint32_t index, const DirectX::XMFLOAT4X4& transform, const WorldPosition& position);
+		void Rebase();
+		void ClearChanged();
+
+		// Translation relative to Origin.
+		const DirectX::XMFLOAT4X4& Transform(std::uint32_t index) const;
+		WorldPosition Position(std::uint32_t index) const;
+		// Whether the body was Set since the last ClearChanged, or the origin moved.
+		bool Changed(std::uint32_t index) const;
+		const WorldPosition& Origin() const;
+		void SetOrigin(const WorldPosition& origin);
+
+		static const std::uint32_t RebaseBatchSize;
+
+	private:
+		std::vector<double> mPositionX;
+		std::vector<double> mPositionY;
+		std::vector<double> mPositionZ;
+		std::vector<DirectX::XMFLOAT4X4> mTransforms;
+		std::vector<std::uint8_t> mChanged;
+		WorldPosition mOrigin;
+		std::uint32_t mCount;
+	};
+}
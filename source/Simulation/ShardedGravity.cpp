@@ -0,0 +1,246 @@
+#include "pch.h"
+#include "ShardedGravity.h"
+#include "GravityShard.h"
+#include "NBodyState.h"
+#include "SharedMemory.h"
+#include "SharedRingBuffer.h"
+#include "WorkerProcess.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const char* const ShardedGravity::WorkerOption = "--shard-worker";
+	const char ShardedGravity::Magic[8] = { 'S', 'S', 'S', 'H', 'A', 'R', 'D', '\0' };
+	const uint32_t ShardedGravity::FormatVersion = 1;
+	const uint64_t ShardedGravity::RingCapacity = 1 << 18;
+	const uint32_t ShardedGravity::DefaultRepartitionInterval = 8;
+	const uint32_t ShardedGravity::PollMilliseconds = 1;
+
+	namespace
+	{
+		const uint64_t CacheLineSize = 64;
+
+		uint64_t AlignToCacheLine(uint64_t offset)
+		{
+			return (offset + CacheLineSize - 1) & ~(CacheLineSize - 1);
+		}
+	}
+
+	ShardedGravity::ShardedGravity() :
+		mShardCount(1), mSoftening(0.0f), mOpeningAngle(BarnesHut::DefaultOpeningAngle), mRepartitionInterval(DefaultRepartitionInterval),
+		mRunCount(0), mInteractions(0), mHaloBodyCount(0), mSummaryCount(0), mExchangedBytes(0), mStepSeconds(0), mExchangeSeconds(0)
+	{
+	}
+
+	uint32_t ShardedGravity::ShardCount() const
+	{
+		return mShardCount;
+	}
+
+	void ShardedGravity::SetShardCount(uint32_t shardCount)
+	{
+		mShardCount = max(shardCount, 1U);
+	}
+
+	float ShardedGravity::Softening() const
+	{
+		return mSoftening;
+	}
+
+	void ShardedGravity::SetSoftening(float softening)
+	{
+		mSoftening = softening;
+	}
+
+	float ShardedGravity::OpeningAngle() const
+	{
+		return mOpeningAngle;
+	}
+
+	void ShardedGravity::SetOpeningAngle(float openingAngle)
+	{
+		mOpeningAngle = max(openingAngle, 0.0f);
+	}
+
+	uint32_t ShardedGravity::RepartitionInterval() const
+	{
+		return mRepartitionInterval;
+	}
+
+	void ShardedGravity::SetRepartitionInterval(uint32_t repartitionInterval)
+	{
+		mRepartitionInterval = max(repartitionInterval, 1U);
+	}
+
+	void ShardedGravity::SetWorkerExecutable(const string& executable)
+	{
+		mWorkerExecutable = executable;
+	}
+
+	void ShardedGravity::Run(NBodyState& state, double timestep, uint64_t stepCount)
+	{
+		uint32_t bodyCount = state.Count();
+		uint32_t shardCount = min(mShardCount, max(bodyCount, 1U));
+		uint64_t ringStride = AlignToCacheLine(SharedRingBuffer::RequiredSize(RingCapacity));
+		uint64_t statisticsOffset = AlignToCacheLine(sizeof(Header));
+		uint64_t bodiesOffset = AlignToCacheLine(statisticsOffset + shardCount * sizeof(ShardStatistics));
+		uint64_t ringsOffset = AlignToCacheLine(bodiesOffset + static_cast<uint64_t>(bodyCount) * sizeof(Body));
+		uint64_t size = ringsOffset + static_cast<uint64_t>(shardCount) * shardCount * ringStride;
+
+		// unique to this process and run, short enough for every platform's limit on names
+		SharedMemory segment;
+		segment.Create("SimShards-" + to_string(WorkerProcess::CurrentProcessId()) + "-" + to_string(mRunCount++), size);
+		uint8_t* data = segment.Data();
+
+		Header* header = new (data) Header();
+		memcpy(header->mMagic, Magic, sizeof(Magic));
+		header->mVersion = FormatVersion;
+		header->mShardCount = shardCount;
+		header->mBodyCount = bodyCount;
+		header->mRepartitionInterval = mRepartitionInterval;
+		header->mStepCount = stepCount;
+		header->mTimestep = timestep;
+		header->mSoftening = mSoftening;
+		header->mOpeningAngle = mOpeningAngle;
+		header->mStatisticsOffset = statisticsOffset;
+		header->mBodiesOffset = bodiesOffset;
+		header->mRingsOffset = ringsOffset;
+		header->mRingStride = ringStride;
+		header->mAbort.store(0);
+		header->mArrived.store(0);
+		header->mGeneration.store(0);
+
+		ShardStatistics* statistics = reinterpret_cast<ShardStatistics*>(data + statisticsOffset);
+		Body* bodies = reinterpret_cast<Body*>(data + bodiesOffset);
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			Body& body = bodies[index];
+			body.mPosition[0] = state.PositionX()[index];
+			body.mPosition[1] = state.PositionY()[index];
+			body.mPosition[2] = state.PositionZ()[index];
+			body.mVelocity[0] = state.VelocityX()[index];
+			body.mVelocity[1] = state.VelocityY()[index];
+			body.mVelocity[2] = state.VelocityZ()[index];
+			body.mGravitationalParameter = state.GravitationalParameters()[index];
+		}
+		for (uint32_t source = 0; source < shardCount; ++source)
+		{
+			for (uint32_t target = 0; target < shardCount; ++target)
+			{
+				if (source != target)
+				{
+					SharedRingBuffer::Initialize(data + ringsOffset + (static_cast<uint64_t>(source) * shardCount + target) * ringStride, RingCapacity);
+				}
+			}
+		}
+
+		// workers still running when this throws are killed with their WorkerProcess
+		string executable = mWorkerExecutable.empty() ? WorkerProcess::CurrentExecutable() : mWorkerExecutable;
+		vector<unique_ptr<WorkerProcess>> workers;
+		bool failed = false;
+		try
+		{
+			for (uint32_t rank = 0; rank < shardCount; ++rank)
+			{
+				workers.push_back(make_unique<WorkerProcess>(executable, vector<string>{ WorkerOption, segment.Name(), to_string(rank) }));
+			}
+
+			uint32_t running = shardCount;
+			vector<uint8_t> exited(shardCount, 0);
+			while (running > 0)
+			{
+				for (uint32_t rank = 0; rank < shardCount; ++rank)
+				{
+					int exitCode = 0;
+					if (exited[rank] == 0 && workers[rank]->TryWait(exitCode))
+					{
+						exited[rank] = 1;
+						--running;
+						if (exitCode != 0)
+						{
+							failed = true;
+							header->mAbort.store(1, memory_order_release);
+						}
+					}
+				}
+				if (running > 0)
+				{
+					this_thread::sleep_for(chrono::milliseconds(PollMilliseconds));
+				}
+			}
+		}
+		catch (...)
+		{
+			header->mAbort.store(1, memory_order_release);
+			throw;
+		}
+		if (failed)
+		{
+			throw runtime_error("A gravity shard failed");
+		}
+
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			const Body& body = bodies[index];
+			state.SetBody(index, XMFLOAT3(body.mPosition[0], body.mPosition[1], body.mPosition[2]), XMFLOAT3(body.mVelocity[0], body.mVelocity[1], body.mVelocity[2]),
+				body.mGravitationalParameter);
+			state.AccelerationX()[index] = body.mAcceleration[0];
+			state.AccelerationY()[index] = body.mAcceleration[1];
+			state.AccelerationZ()[index] = body.mAcceleration[2];
+		}
+
+		mInteractions = 0;
+		mHaloBodyCount = 0;
+		mSummaryCount = 0;
+		mExchangedBytes = 0;
+		mStepSeconds = 0;
+		mExchangeSeconds = 0;
+		for (uint32_t rank = 0; rank < shardCount; ++rank)
+		{
+			mInteractions += statistics[rank].mInteractions;
+			mHaloBodyCount += statistics[rank].mHaloBodies;
+			mSummaryCount += statistics[rank].mSummaries;
+			mExchangedBytes += statistics[rank].mExchangedBytes;
+			mStepSeconds = max(mStepSeconds, statistics[rank].mStepSeconds);
+			mExchangeSeconds = max(mExchangeSeconds, statistics[rank].mExchangeSeconds);
+		}
+	}
+
+	uint64_t ShardedGravity::Interactions() const
+	{
+		return mInteractions;
+	}
+
+	uint64_t ShardedGravity::HaloBodyCount() const
+	{
+		return mHaloBodyCount;
+	}
+
+	uint64_t ShardedGravity::SummaryCount() const
+	{
+		return mSummaryCount;
+	}
+
+	uint64_t ShardedGravity::ExchangedBytes() const
+	{
+		return mExchangedBytes;
+	}
+
+	double ShardedGravity::StepSeconds() const
+	{
+		return mStepSeconds;
+	}
+
+	double ShardedGravity::ExchangeSeconds() const
+	{
+		return mExchangeSeconds;
+	}
+
+	void ShardedGravity::RunWorker(const string& segmentName, uint32_t rank)
+	{
+		GravityShard shard(segmentName, rank);
+		shard.Run();
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Simulation
+{
+	class NBodyState;
+
+	// Leapfrog integration of an NBodyState under its own gravity, split across worker processes on one machine for runs
+	// too large for one process. Run copies the state into a SharedMemory segment, starts ShardCount() copies of the
+	// worker executable with WorkerOption, the segment name and their rank, waits for them and copies the state back;
+	// the executable hands those arguments to RunWorker, which steps one GravityShard. No D3D device or network is
+	// involved, and only the shards' results come back, so the segment carries no more than the bodies and the queues.
+	// Every Run starts the workers afresh, so it only pays for Runs of many steps of many bodies; BodySystem does not
+	// use it, as its N-body mode integrates a few bodies per Update with the solver and integrator it was given.
+	//
+	// The segment holds a Header, one ShardStatistics per shard, a Body per body, and a SharedRingBuffer of RingCapacity
+	// bytes from every shard to every other, each starting on a cache line. Bodies is both the initial state the shards
+	// partition and the place they publish theirs, when they repartition and when they finish; the rings carry everything
+	// exchanged in between. The shards' answer depends only on the state, the settings and the shard count, never on how
+	// the processes happen to be scheduled, so a run repeated with the same shard count gives the same bits.
+	class ShardedGravity final
+	{
+	public:
+		ShardedGravity();
+		ShardedGravity(const ShardedGravity&) = delete;
+		ShardedGravity& operator=(const ShardedGravity&) = delete;
+		ShardedGravity(ShardedGravity&&) = delete;
+		ShardedGravity& operator=(ShardedGravity&&) = delete;
+		~ShardedGravity() = default;
+
+		std::uint32_t ShardCount() const;
+		void SetShardCount(std::uint32_t shardCount);
+		float Softening() const;
+		void SetSoftening(float softening);
+		// Opening angle of both the shards' own Barnes-Hut trees and the summaries they send each other.
+		float OpeningAngle() const;
+		void SetOpeningAngle(float openingAngle);
+		// Steps between repartitions; the bodies drift out of their domains in between.
+		std::uint32_t RepartitionInterval() const;
+		void SetRepartitionInterval(std::uint32_t repartitionInterval);
+		// The program started as a worker, which must pass the arguments after WorkerOption to RunWorker; the running
+		// executable unless set.
+		void SetWorkerExecutable(const std::string& executable);
+
+		// Integrates stepCount steps of timestep and leaves the state and accelerations at the end in state.
+		void Run(NBodyState& state, double timestep, std::uint64_t stepCount);
+
+		// Totals of the last Run over every shard and step.
+		std::uint64_t Interactions() const;
+		std::uint64_t HaloBodyCount() const;
+		std::uint64_t SummaryCount() const;
+		std::uint64_t ExchangedBytes() const;
+		// Wall time of the slowest shard's steps, process start and setup excluded, and the longest any shard spent
+		// exchanging or waiting on the others.
+		double StepSeconds() const;
+		double ExchangeSeconds() const;
+
+		static void RunWorker(const std::string& segmentName, std::uint32_t rank);
+
+		static const char* const WorkerOption;
+		static const char Magic[8];
+		static const std::uint32_t FormatVersion;
+		static const std::uint64_t RingCapacity;
+		static const std::uint32_t DefaultRepartitionInterval;
+		static const std::uint32_t PollMilliseconds;
+
+		struct Header
+		{
+			char mMagic[8];
+			std::uint32_t mVersion;
+			std::uint32_t mShardCount;
+			std::uint32_t mBodyCount;
+			std::uint32_t mRepartitionInterval;
+			std::uint64_t mStepCount;
+			double mTimestep;
+			float mSoftening;
+			float mOpeningAngle;
+			std::uint64_t mStatisticsOffset;
+			std::uint64_t mBodiesOffset;
+			std::uint64_t mRingsOffset;
+			std::uint64_t mRingStride;
+			// set by whoever fails first, so nobody waits on it forever
+			std::atomic<std::uint32_t> mAbort;
+			// barrier: arrivals of the current generation
+			std::atomic<std::uint32_t> mArrived;
+			std::atomic<std::uint32_t> mGeneration;
+		};
+
+		struct ShardStatistics
+		{
+			std::uint64_t mInteractions;
+			std::uint64_t mHaloBodies;
+			std::uint64_t mSummaries;
+			std::uint64_t mExchangedBytes;
+			double mStepSeconds;
+			double mExchangeSeconds;
+		};
+
+		struct Body
+		{
+			float mPosition[3];
+			float mVelocity[3];
+			float mAcceleration[3];
+			float mGravitationalParameter;
+		};
+
+	private:
+		std::uint32_t mShardCount;
+		float mSoftening;
+		float mOpeningAngle;
+		std::uint32_t mRepartitionInterval;
+		std::string mWorkerExecutable;
+		std::uint32_t mRunCount;
+
+		std::uint64_t mInteractions;
+		std::uint64_t mHaloBodyCount;
+		std::uint64_t mSummaryCount;
+		std::uint64_t mExchangedBytes;
+		double mStepSeconds;
+		double mExchangeSeconds;
+	};
+}
@@ -0,0 +1,193 @@
+#include "pch.h"
+#include "SharedMemory.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	namespace
+	{
+#if defined(_WIN32)
+		// session local, so no privilege is needed to create it
+		string SystemName(const string& name)
+		{
+			return "Local\\" + name;
+		}
+#else
+		string SystemName(const string& name)
+		{
+			return "/" + name;
+		}
+#endif
+	}
+
+	SharedMemory::SharedMemory() :
+		mData(nullptr), mSize(0), mMappingHandle(nullptr), mOwner(false)
+	{
+	}
+
+	SharedMemory::~SharedMemory()
+	{
+		Close();
+	}
+
+	void SharedMemory::Create(const string& name, uint64_t size)
+	{
+		Close();
+		if (size == 0)
+		{
+			throw runtime_error("Shared memory must not be empty: " + name);
+		}
+
+#if defined(_WIN32)
+		HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32),
+			static_cast<DWORD>(size & 0xFFFFFFFFull), SystemName(name).c_str());
+		if (mapping == nullptr)
+		{
+			throw runtime_error("Could not create shared memory: " + name);
+		}
+		if (GetLastError() == ERROR_ALREADY_EXISTS)
+		{
+			CloseHandle(mapping);
+			throw runtime_error("Shared memory already exists: " + name);
+		}
+		mMappingHandle = mapping;
+
+		mData = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+		if (mData == nullptr)
+		{
+			Close();
+			throw runtime_error("Could not map shared memory: " + name);
+		}
+#else
+		int file = shm_open(SystemName(name).c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+		if (file < 0)
+		{
+			throw runtime_error("Could not create shared memory: " + name);
+		}
+
+		// the object is unlinked as soon as it cannot be used, so a failure leaves nothing behind
+		void* data = MAP_FAILED;
+		if (ftruncate(file, static_cast<off_t>(size)) == 0)
+		{
+			data = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+		}
+		close(file);
+		if (data == MAP_FAILED)
+		{
+			shm_unlink(SystemName(name).c_str());
+			throw runtime_error("Could not map shared memory: " + name);
+		}
+		mData = static_cast<uint8_t*>(data);
+#endif
+		mSize = size;
+		mName = name;
+		mOwner = true;
+	}
+
+	void SharedMemory::Open(const string& name)
+	{
+		Close();
+
+#if defined(_WIN32)
+		HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, SystemName(name).c_str());
+		if (mapping == nullptr)
+		{
+			throw runtime_error("Could not open shared memory: " + name);
+		}
+		mMappingHandle = mapping;
+
+		mData = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+		MEMORY_BASIC_INFORMATION region;
+		if (mData == nullptr || VirtualQuery(mData, &region, sizeof(region)) == 0)
+		{
+			Close();
+			throw runtime_error("Could not map shared memory: " + name);
+		}
+		// whole pages, which may run past the size the creator asked for
+		mSize = static_cast<uint64_t>(region.RegionSize);
+#else
+		int file = shm_open(SystemName(name).c_str(), O_RDWR, 0);
+		if (file < 0)
+		{
+			throw runtime_error("Could not open shared memory: " + name);
+		}
+
+		struct stat status;
+		void* data = MAP_FAILED;
+		if (fstat(file, &status) == 0 && status.st_size > 0)
+		{
+			mSize = static_cast<uint64_t>(status.st_size);
+			data = mmap(nullptr, static_cast<size_t>(mSize), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+		}
+		close(file);
+		if (data == MAP_FAILED)
+		{
+			mSize = 0;
+			throw runtime_error("Could not map shared memory: " + name);
+		}
+		mData = static_cast<uint8_t*>(data);
+#endif
+		mName = name;
+		mOwner = false;
+	}
+
+	void SharedMemory::Close()
+	{
+#if defined(_WIN32)
+		if (mData != nullptr)
+		{
+			UnmapViewOfFile(mData);
+		}
+		if (mMappingHandle != nullptr)
+		{
+			CloseHandle(mMappingHandle);
+		}
+#else
+		if (mData != nullptr)
+		{
+			munmap(mData, static_cast<size_t>(mSize));
+		}
+		if (mOwner)
+		{
+			shm_unlink(SystemName(mName).c_str());
+		}
+#endif
+		mData = nullptr;
+		mSize = 0;
+		mMappingHandle = nullptr;
+		mName.clear();
+		mOwner = false;
+	}
+
+	uint8_t* SharedMemory::Data() const
+	{
+		return mData;
+	}
+
+	uint64_t SharedMemory::Size() const
+	{
+		return mSize;
+	}
+
+	const string& SharedMemory::Name() const
+	{
+		return mName;
+	}
+}
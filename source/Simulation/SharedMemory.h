@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Simulation
+{
+	// A named block of memory shared between the processes of one machine: a pagefile backed section on Windows and a
+	// POSIX shared memory object elsewhere. Create makes a new zero filled block under a name no other block has, and
+	// Open maps the block another process created, whole. The creator owns the name: on POSIX it is unlinked when the
+	// creator closes, and on Windows the section goes away with the last process that has it open.
+	class SharedMemory final
+	{
+	public:
+		SharedMemory();
+		SharedMemory(const SharedMemory&) = delete;
+		SharedMemory& operator=(const SharedMemory&) = delete;
+		SharedMemory(SharedMemory&&) = delete;
+		SharedMemory& operator=(SharedMemory&&) = delete;
+		~SharedMemory();
+
+		void Create(const std::string& name, std::uint64_t size);
+		void Open(const std::string& name);
+		void Close();
+
+		std::uint8_t* Data() const;
+		std::uint64_t Size() const;
+		const std::string& Name() const;
+
+	private:
+		std::uint8_t* mData;
+		std::uint64_t mSize;
+		void* mMappingHandle;
+		std::string mName;
+		bool mOwner;
+	};
+}
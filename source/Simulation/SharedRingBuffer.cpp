@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "SharedRingBuffer.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	SharedRingBuffer::SharedRingBuffer() :
+		mHeader(nullptr), mData(nullptr), mMask(0)
+	{
+	}
+
+	SharedRingBuffer::SharedRingBuffer(void* memory, uint64_t size) :
+		mHeader(static_cast<Header*>(memory)), mData(static_cast<uint8_t*>(memory) + sizeof(Header)), mMask(0)
+	{
+		uint64_t capacity = mHeader->mCapacity;
+		if (capacity == 0 || (capacity & (capacity - 1)) != 0 || RequiredSize(capacity) > size)
+		{
+			throw runtime_error("Invalid shared ring buffer");
+		}
+		mMask = capacity - 1;
+	}
+
+	uint64_t SharedRingBuffer::RequiredSize(uint64_t capacity)
+	{
+		return sizeof(Header) + capacity;
+	}
+
+	void SharedRingBuffer::Initialize(void* memory, uint64_t capacity)
+	{
+		if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+		{
+			throw runtime_error("Ring buffer capacity must be a power of two");
+		}
+
+		Header* header = new (memory) Header();
+		header->mHead.store(0, memory_order_relaxed);
+		header->mTail.store(0, memory_order_relaxed);
+		header->mCapacity = capacity;
+	}
+
+	uint64_t SharedRingBuffer::Write(const void* data, uint64_t size)
+	{
+		uint64_t head = mHeader->mHead.load(memory_order_relaxed);
+		uint64_t tail = mHeader->mTail.load(memory_order_acquire);
+		uint64_t count = min(size, mMask + 1 - (head - tail));
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		// at most two runs, the second from the start of the buffer once the first reaches its end
+		uint64_t start = head & mMask;
+		uint64_t first = min(count, mMask + 1 - start);
+		memcpy(mData + start, data, static_cast<size_t>(first));
+		memcpy(mData, static_cast<const uint8_t*>(data) + first, static_cast<size_t>(count - first));
+		mHeader->mHead.store(head + count, memory_order_release);
+		return count;
+	}
+
+	uint64_t SharedRingBuffer::Read(void* data, uint64_t size)
+	{
+		uint64_t tail = mHeader->mTail.load(memory_order_relaxed);
+		uint64_t head = mHeader->mHead.load(memory_order_acquire);
+		uint64_t count = min(size, head - tail);
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		uint64_t start = tail & mMask;
+		uint64_t first = min(count, mMask + 1 - start);
+		memcpy(data, mData + start, static_cast<size_t>(first));
+		memcpy(static_cast<uint8_t*>(data) + first, mData, static_cast<size_t>(count - first));
+		mHeader->mTail.store(tail + count, memory_order_release);
+		return count;
+	}
+
+	uint64_t SharedRingBuffer::Capacity() const
+	{
+		return mMask + 1;
+	}
+}
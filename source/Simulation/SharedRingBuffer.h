@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Simulation
+{
+	// Single producer, single consumer byte queue laid out in memory that two processes share. The head and tail only
+	// ever grow and each sits on its own cache line: the producer copies bytes in and then publishes them by storing the
+	// head with release order, and the consumer hands the space back the same way through the tail, so neither side
+	// takes a lock or makes a system call. The capacity is a power of two so positions wrap with a mask.
+	//
+	// Write and Read move as many bytes as fit and return how many, rather than blocking, so a process exchanging with
+	// several peers keeps every queue moving and a message larger than the queue cannot deadlock two writers waiting on
+	// each other. The buffer itself is a view; Initialize sets up the memory once, before either side attaches.
+	class SharedRingBuffer final
+	{
+	public:
+		SharedRingBuffer();
+		SharedRingBuffer(void* memory, std::uint64_t size);
+		SharedRingBuffer(const SharedRingBuffer&) = default;
+		SharedRingBuffer& operator=(const SharedRingBuffer&) = default;
+		SharedRingBuffer(SharedRingBuffer&&) = default;
+		SharedRingBuffer& operator=(SharedRingBuffer&&) = default;
+		~SharedRingBuffer() = default;
+
+		// Bytes of shared memory a buffer of the given capacity, a power of two, occupies.
+		static std::uint64_t RequiredSize(std::uint64_t capacity);
+		static void Initialize(void* memory, std::uint64_t capacity);
+
+		std::uint64_t Write(const void* data, std::uint64_t size);
+		std::uint64_t Read(void* data, std::uint64_t size);
+
+		std::uint64_t Capacity() const;
+
+	private:
+		struct Header
+		{
+			alignas(64) std::atomic<std::uint64_t> mHead;
+			alignas(64) std::atomic<std::uint64_t> mTail;
+			alignas(64) std::uint64_t mCapacity;
+		};
+
+		Header* mHeader;
+		std::uint8_t* mData;
+		std::uint64_t mMask;
+	};
+}
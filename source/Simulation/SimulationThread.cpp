@@ -0,0 +1,326 @@
+#include "pch.h"
+#include "SimulationThread.h"
+#include "BodySystem.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace Simulation
+{
+	SimulationThread::SimulationThread(BodySystem& bodySystem, nanoseconds stepSize) :
+		mBodySystem(&bodySystem), mTimestep(stepSize), mPipeline(), mPublishedCount(0), mAdvancing(false), mPendingFrames(), mPendingTime(0), mPendingAdvance(false),
+		mTickedFrame(0), mTakenFrame(0), mPipelineDepth(0), mRunningDepth(0), mRunning(false), mStopping(false), mIdleFrame(0), mStartFrame(0),
+		mAcquiredFrame(0), mFenceWaitTime(0)
+	{
+	}
+
+	SimulationThread::~SimulationThread()
+	{
+		Stop();
+	}
+
+	void SimulationThread::Start()
+	{
+		lock_guard<mutex> lock(mMutex);
+		if (mRunning)
+		{
+			return;
+		}
+
+		mRunning = true;
+		mRunningDepth = mPipelineDepth;
+		mTakenFrame = mTickedFrame;
+		mStartFrame = mTickedFrame;
+		mSimulatedFrames.Reset(mTickedFrame);
+		mThread = thread(&SimulationThread::Run, this);
+	}
+
+	void SimulationThread::Stop()
+	{
+		{
+			lock_guard<mutex> lock(mMutex);
+			if (!mRunning)
+			{
+				return;
+			}
+			mStopping = true;
+		}
+		mWake.notify_one();
+		mThread.join();
+
+		// time and commands the thread did not get to are picked up by the next Tick
+		uint64_t frame;
+		{
+			lock_guard<mutex> lock(mMutex);
+			mRunning = false;
+			mStopping = false;
+			frame = mTakenFrame;
+		}
+
+		// the renderer goes back to the triple buffer, which has to catch up on what the pipeline published
+		if (mRunningDepth > 0)
+		{
+			Publish(frame, true);
+		}
+	}
+
+	bool SimulationThread::Running() const
+	{
+		lock_guard<mutex> lock(mMutex);
+		return mRunning;
+	}
+
+	uint32_t SimulationThread::PipelineDepth() const
+	{
+		return mPipelineDepth;
+	}
+
+	void SimulationThread::SetPipelineDepth(uint32_t depth)
+	{
+		if (depth > MaxPipelineDepth)
+		{
+			throw runtime_error("Pipeline depth out of range");
+		}
+
+		mPipelineDepth = depth;
+	}
+
+	void SimulationThread::Post(function<void(BodySystem&)> command)
+	{
+		lock_guard<mutex> lock(mMutex);
+		mCommands.push_back(move(command));
+	}
+
+	bool SimulationThread::Advancing() const
+	{
+		return mAdvancing;
+	}
+
+	void SimulationThread::SetAdvancing(bool advancing)
+	{
+		mAdvancing = advancing;
+	}
+
+	double SimulationThread::StepSeconds() const
+	{
+		return mTimestep.StepSeconds();
+	}
+
+	void SimulationThread::Tick(nanoseconds elapsedTime)
+	{
+		// Start, Stop and Tick all come from the same thread, so the frame count and depth can be read unlocked here
+		uint64_t frame = mTickedFrame + 1;
+		if (mRunning && mRunningDepth > 0)
+		{
+			// a frame record is only reused once the frame that last held it is simulated
+			if (frame > PipelineCapacity)
+			{
+				mSimulatedFrames.Wait(frame - PipelineCapacity);
+			}
+		}
+
+		// time only counts in frames ticked while advancing, whenever the simulation gets to them
+		unique_lock<mutex> lock(mMutex);
+		mTickedFrame = frame;
+		if (mAdvancing)
+		{
+			mPendingTime += elapsedTime;
+			mPendingAdvance = true;
+		}
+
+		if (!mRunning)
+		{
+			// only the caller steps while the thread is not running, so the command list can be swapped out and run unlocked
+			nanoseconds pendingTime = mPendingTime;
+			bool advancing = mPendingAdvance;
+			mPendingTime = nanoseconds(0);
+			mPendingAdvance = false;
+			mTakenFrame = frame;
+			mRunningCommands.swap(mCommands);
+			lock.unlock();
+			Publish(frame, Advance(pendingTime, advancing, mRunningCommands));
+			return;
+		}
+
+		if (mRunningDepth > 0)
+		{
+			PendingFrame& pendingFrame = mPendingFrames[frame % PipelineCapacity];
+			pendingFrame.mElapsedTime = mPendingTime;
+			pendingFrame.mAdvancing = mPendingAdvance;
+			mPendingTime = nanoseconds(0);
+			mPendingAdvance = false;
+			pendingFrame.mCommands.swap(mCommands);
+		}
+		lock.unlock();
+		mWake.notify_one();
+	}
+
+	bool SimulationThread::Acquire(BodySnapshot& snapshot)
+	{
+		mFenceWaitTime = nanoseconds(0);
+		if (mRunning && mRunningDepth > 0)
+		{
+			// nothing is drawn from the pipeline until it has filled
+			uint64_t frame = mTickedFrame - min<uint64_t>(mTickedFrame, mRunningDepth);
+			if (frame <= mStartFrame || frame <= mAcquiredFrame)
+			{
+				return false;
+			}
+
+			steady_clock::time_point waitStart = steady_clock::now();
+			mSimulatedFrames.Wait(frame);
+			mFenceWaitTime = duration_cast<nanoseconds>(steady_clock::now() - waitStart);
+
+			// a frame in which nothing changed leaves its slot alone, and what is drawn already matches it
+			mAcquiredFrame = frame;
+			BodySnapshot& published = mPipeline[frame % PipelineCapacity];
+			if (published.mFrame != frame)
+			{
+				return false;
+			}
+
+			swap(snapshot, published);
+			return true;
+		}
+
+		if (!mSnapshots.Acquire())
+		{
+			// with nothing left to take, what is drawn is as current as the last frame that changed nothing
+			mAcquiredFrame = max(mAcquiredFrame, mIdleFrame.load(memory_order_acquire));
+			return false;
+		}
+
+		swap(snapshot, mSnapshots.Front());
+		mAcquiredFrame = max(snapshot.mFrame, mIdleFrame.load(memory_order_acquire));
+		return true;
+	}
+
+	uint64_t SimulationThread::PublishedCount() const
+	{
+		return mPublishedCount.load(memory_order_relaxed);
+	}
+
+	uint32_t SimulationThread::Latency() const
+	{
+		return static_cast<uint32_t>(mTickedFrame - min(mAcquiredFrame, mTickedFrame));
+	}
+
+	nanoseconds SimulationThread::FenceWaitTime() const
+	{
+		return mFenceWaitTime;
+	}
+
+	void SimulationThread::Run()
+	{
+		unique_lock<mutex> lock(mMutex);
+		if (mRunningDepth > 0)
+		{
+			RunPipelined(lock);
+		}
+		else
+		{
+			RunLatest(lock);
+		}
+	}
+
+	void SimulationThread::RunPipelined(unique_lock<mutex>& lock)
+	{
+		// every frame ticked is simulated, even once stopping, so that none the renderer waits on goes missing
+		for (;;)
+		{
+			mWake.wait(lock, [this] { return (mTakenFrame < mTickedFrame || mStopping); });
+			if (mTakenFrame == mTickedFrame)
+			{
+				break;
+			}
+
+			uint64_t frame = ++mTakenFrame;
+			PendingFrame& pendingFrame = mPendingFrames[frame % PipelineCapacity];
+			nanoseconds elapsedTime = pendingFrame.mElapsedTime;
+			bool advancing = pendingFrame.mAdvancing;
+			mRunningCommands.swap(pendingFrame.mCommands);
+			lock.unlock();
+			PublishFrame(frame, Advance(elapsedTime, advancing, mRunningCommands));
+			lock.lock();
+		}
+	}
+
+	void SimulationThread::RunLatest(unique_lock<mutex>& lock)
+	{
+		// frames ticked while the last advance ran are merged into the next one
+		for (;;)
+		{
+			mWake.wait(lock, [this] { return (mTakenFrame < mTickedFrame || mStopping); });
+			if (mStopping)
+			{
+				break;
+			}
+
+			uint64_t frame = mTickedFrame;
+			mTakenFrame = frame;
+			nanoseconds pendingTime = mPendingTime;
+			bool advancing = mPendingAdvance;
+			mPendingTime = nanoseconds(0);
+			mPendingAdvance = false;
+			mRunningCommands.swap(mCommands);
+			lock.unlock();
+			Publish(frame, Advance(pendingTime, advancing, mRunningCommands));
+			lock.lock();
+		}
+	}
+
+	bool SimulationThread::Advance(nanoseconds elapsedTime, bool advancing, CommandList& commands)
+	{
+		bool changed = !commands.empty();
+		for (auto& command : commands)
+		{
+			command(*mBodySystem);
+		}
+		commands.clear();
+
+		if (advancing)
+		{
+			uint32_t stepCount = mTimestep.Advance(elapsedTime);
+			for (uint32_t step = 0; step < stepCount; ++step)
+			{
+				mBodySystem->Update(static_cast<float>(mTimestep.StepSeconds()));
+			}
+			changed = true;
+		}
+
+		if (changed)
+		{
+			mBodySystem->Interpolate(mTimestep.Alpha());
+		}
+		return changed;
+	}
+
+	void SimulationThread::Publish(uint64_t frame, bool changed)
+	{
+		if (!changed)
+		{
+			mIdleFrame.store(frame, memory_order_release);
+			return;
+		}
+
+		BodySnapshot& snapshot = mSnapshots.Back();
+		mBodySystem->WriteSnapshot(snapshot);
+		snapshot.mSequence = mPublishedCount.load(memory_order_relaxed) + 1;
+		snapshot.mFrame = frame;
+		mSnapshots.Publish();
+		mPublishedCount.store(snapshot.mSequence, memory_order_relaxed);
+	}
+
+	void SimulationThread::PublishFrame(uint64_t frame, bool changed)
+	{
+		if (changed)
+		{
+			BodySnapshot& snapshot = mPipeline[frame % PipelineCapacity];
+			mBodySystem->WriteSnapshot(snapshot);
+			snapshot.mSequence = mPublishedCount.load(memory_order_relaxed) + 1;
+			snapshot.mFrame = frame;
+			mPublishedCount.store(snapshot.mSequence, memory_order_relaxed);
+		}
+		mSimulatedFrames.Signal(frame);
+	}
+}
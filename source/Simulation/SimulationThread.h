@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BodySnapshot.h"
+#include "FixedTimestep.h"
+#include "FrameFence.h"
+#include "TripleBuffer.h"
+
+namespace Simulation
+{
+	class BodySystem;
+
+	// Steps a BodySystem in fixed steps and publishes a BodySystem snapshot after each advance, either inline on the
+	// caller's thread or, once Started, on a thread of its own so that simulating one frame overlaps drawing another.
+	// Every Tick is a frame, and every snapshot records the frame whose time it was stepped to.
+	//
+	// With a pipeline depth of 0 snapshots go through a TripleBuffer, so neither publishing nor Acquire ever waits: the
+	// renderer always draws the newest complete snapshot and the simulation never stalls on a slow frame, but frames the
+	// simulation falls behind on are merged into one advance and the latency floats.
+	//
+	// With a depth of 1 or 2 the thread simulates every frame on its own, into a ring of PipelineCapacity snapshots,
+	// and Signals a FrameFence with the frame's number when its snapshot is complete. Acquire after Tick of frame N
+	// Waits on the fence for frame N - depth and draws that, so the renderer is always exactly depth frames behind and
+	// blocks only when the simulation of a frame takes longer than depth frames of drawing. The first depth frames after
+	// Start draw nothing new while the pipeline fills, and Stop lets the thread finish every frame already ticked.
+	//
+	// While the thread runs, the BodySystem belongs to it. Everything else that changes it is Posted as a command, which
+	// runs on the simulation thread before the advance of the next frame ticked; commands and Tick are the only things
+	// that take a lock, and only long enough to queue. The simulation advances by the same total time whichever thread
+	// steps it.
+	class SimulationThread final
+	{
+	public:
+		SimulationThread(BodySystem& bodySystem, std::chrono::nanoseconds stepSize = FixedTimestep::DefaultStepSize);
+		SimulationThread(const SimulationThread&) = delete;
+		SimulationThread& operator=(const SimulationThread&) = delete;
+		SimulationThread(SimulationThread&&) = delete;
+		SimulationThread& operator=(SimulationThread&&) = delete;
+		~SimulationThread();
+
+		void Start();
+		void Stop();
+		bool Running() const;
+		std::uint32_t PipelineDepth() const;
+		// Takes effect at the next Start.
+		void SetPipelineDepth(std::uint32_t depth);
+
+		void Post(std::function<void(BodySystem&)> command);
+		// Whether the frames ticked from now on step the simulation; commands still run and publish while they do not.
+		bool Advancing() const;
+		void SetAdvancing(bool advancing);
+		double StepSeconds() const;
+
+		// Adds a frame and its elapsed time. Advances inline when the thread is not running, and wakes it otherwise.
+		void Tick(std::chrono::nanoseconds elapsedTime);
+		// Swaps the snapshot to draw this frame into snapshot, whose old contents are recycled. Returns false when
+		// nothing new is due.
+		bool Acquire(BodySnapshot& snapshot);
+		std::uint64_t PublishedCount() const;
+		// Frames between the last Tick and the frame of the last snapshot acquired.
+		std::uint32_t Latency() const;
+		// How long the last Acquire waited on the fence.
+		std::chrono::nanoseconds FenceWaitTime() const;
+
+		static const std::uint32_t MaxPipelineDepth = 2;
+		static const std::uint32_t PipelineCapacity = MaxPipelineDepth + 1;
+
+	private:
+		typedef std::vector<std::function<void(BodySystem&)>> CommandList;
+
+		struct PendingFrame
+		{
+			std::chrono::nanoseconds mElapsedTime;
+			bool mAdvancing;
+			CommandList mCommands;
+		};
+
+		void Run();
+		void RunPipelined(std::unique_lock<std::mutex>& lock);
+		void RunLatest(std::unique_lock<std::mutex>& lock);
+		bool Advance(std::chrono::nanoseconds elapsedTime, bool advancing, CommandList& commands);
+		void Publish(std::uint64_t frame, bool changed);
+		void PublishFrame(std::uint64_t frame, bool changed);
+
+		BodySystem* mBodySystem;
+		FixedTimestep mTimestep;
+		TripleBuffer<BodySnapshot> mSnapshots;
+		std::array<BodySnapshot, PipelineCapacity> mPipeline;
+		FrameFence mSimulatedFrames;
+		std::atomic<std::uint64_t> mPublishedCount;
+		bool mAdvancing;
+
+		std::thread mThread;
+		mutable std::mutex mMutex;
+		std::condition_variable mWake;
+		CommandList mCommands;
+		CommandList mRunningCommands;
+		std::array<PendingFrame, PipelineCapacity> mPendingFrames;
+		std::chrono::nanoseconds mPendingTime;
+		bool mPendingAdvance;
+		std::uint64_t mTickedFrame;
+		std::uint64_t mTakenFrame;
+		std::uint32_t mPipelineDepth;
+		std::uint32_t mRunningDepth;
+		bool mRunning;
+		bool mStopping;
+
+		std::atomic<std::uint64_t> mIdleFrame;
+		std::uint64_t mStartFrame;
+		std::uint64_t mAcquiredFrame;
+		std::chrono::nanoseconds mFenceWaitTime;
+	};
+}
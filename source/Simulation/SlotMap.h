@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Simulation
+{
+	// Names an element of a SlotMap. The generation changes every time the slot is freed, so a handle to an erased
+	// element never finds whatever took its slot later. Generations start at one, so a zeroed handle finds nothing.
+	struct SlotHandle
+	{
+		std::uint32_t mIndex;
+		std::uint32_t mGeneration;
+	};
+
+	inline bool operator==(const SlotHandle& left, const SlotHandle& right)
+	{
+		return (left.mIndex == right.mIndex) && (left.mGeneration == right.mGeneration);
+	}
+
+	inline bool operator!=(const SlotHandle& left, const SlotHandle& right)
+	{
+		return !(left == right);
+	}
+
+	// Values addressed by stable handles, stored densely for iteration. Insert and Erase are O(1): a new value is
+	// appended and takes a slot off the free list, and an erased one is replaced by the last value, whose slot is then
+	// pointed at its new place. Values therefore move on Erase and pointers to them do not survive it, while handles do.
+	// Nothing reallocates as long as Size() stays within Reserve.
+	template <typename T>
+	class SlotMap final
+	{
+	public:
+		typedef typename std::vector<T>::iterator Iterator;
+		typedef typename std::vector<T>::const_iterator ConstIterator;
+
+		SlotMap();
+		SlotMap(const SlotMap&) = default;
+		SlotMap& operator=(const SlotMap&) = default;
+		SlotMap(SlotMap&&) = default;
+		SlotMap& operator=(SlotMap&&) = default;
+		~SlotMap() = default;
+
+		void Reserve(std::uint32_t capacity);
+		std::uint32_t Capacity() const;
+		std::uint32_t Size() const;
+		bool Empty() const;
+
+		SlotHandle Insert(const T& value);
+		SlotHandle Insert(T&& value);
+		template <typename... Args>
+		SlotHandle Emplace(Args&&... args);
+		// Returns false if the handle was already stale.
+		bool Erase(const SlotHandle& handle);
+		void Clear();
+
+		bool Contains(const SlotHandle& handle) const;
+		// Null for a stale handle.
+		T* Find(const SlotHandle& handle);
+		const T* Find(const SlotHandle& handle) const;
+		T& operator[](const SlotHandle& handle);
+		const T& operator[](const SlotHandle& handle) const;
+
+		// Dense order, which Erase changes.
+		T& At(std::uint32_t denseIndex);
+		const T& At(std::uint32_t denseIndex) const;
+		SlotHandle HandleAt(std::uint32_t denseIndex) const;
+		// Dense position of a live handle.
+		std::uint32_t DenseIndex(const SlotHandle& handle) const;
+
+		Iterator begin();
+		Iterator end();
+		ConstIterator begin() const;
+		ConstIterator end() const;
+
+	private:
+		// mDense is the value's dense index while the slot is live, and the next free slot while it is not.
+		struct Slot
+		{
+			std::uint32_t mDense;
+			std::uint32_t mGeneration;
+		};
+
+		std::uint32_t AllocateSlot();
+		void FreeSlot(std::uint32_t slot);
+
+		static const std::uint32_t InvalidIndex = std::numeric_limits<std::uint32_t>::max();
+
+		std::vector<T> mValues;
+		std::vector<std::uint32_t> mDenseSlots;
+		std::vector<Slot> mSlots;
+		std::uint32_t mFreeHead;
+	};
+
+	template <typename T>
+	SlotMap<T>::SlotMap() :
+		mFreeHead(InvalidIndex)
+	{
+	}
+
+	template <typename T>
+	void SlotMap<T>::Reserve(std::uint32_t capacity)
+	{
+		mValues.reserve(capacity);
+		mDenseSlots.reserve(capacity);
+		mSlots.reserve(capacity);
+	}
+
+	template <typename T>
+	std::uint32_t SlotMap<T>::Capacity() const
+	{
+		return static_cast<std::uint32_t>(mValues.capacity());
+	}
+
+	template <typename T>
+	std::uint32_t SlotMap<T>::Size() const
+	{
+		return static_cast<std::uint32_t>(mValues.size());
+	}
+
+	template <typename T>
+	bool SlotMap<T>::Empty() const
+	{
+		return mValues.empty();
+	}
+
+	template <typename T>
+	SlotHandle SlotMap<T>::Insert(const T& value)
+	{
+		return Emplace(value);
+	}
+
+	template <typename T>
+	SlotHandle SlotMap<T>::Insert(T&& value)
+	{
+		return Emplace(std::move(value));
+	}
+
+	template <typename T>
+	template <typename... Args>
+	SlotHandle SlotMap<T>::Emplace(Args&&... args)
+	{
+		// the value goes in first, so a throwing constructor leaves the map as it was
+		mValues.emplace_back(std::forward<Args>(args)...);
+		std::uint32_t slot = AllocateSlot();
+		mSlots[slot].mDense = static_cast<std::uint32_t>(mDenseSlots.size());
+		mDenseSlots.push_back(slot);
+
+		SlotHandle handle = {slot, mSlots[slot].mGeneration};
+		return handle;
+	}
+
+	template <typename T>
+	bool SlotMap<T>::Erase(const SlotHandle& handle)
+	{
+		if (!Contains(handle))
+		{
+			return false;
+		}
+
+		std::uint32_t dense = mSlots[handle.mIndex].mDense;
+		std::uint32_t last = static_cast<std::uint32_t>(mValues.size() - 1);
+		if (dense != last)
+		{
+			mValues[dense] = std::move(mValues[last]);
+			mDenseSlots[dense] = mDenseSlots[last];
+			mSlots[mDenseSlots[dense]].mDense = dense;
+		}
+		mValues.pop_back();
+		mDenseSlots.pop_back();
+		FreeSlot(handle.mIndex);
+		return true;
+	}
+
+	template <typename T>
+	void SlotMap<T>::Clear()
+	{
+		for (std::uint32_t slot : mDenseSlots)
+		{
+			FreeSlot(slot);
+		}
+		mValues.clear();
+		mDenseSlots.clear();
+	}
+
+	template <typename T>
+	bool SlotMap<T>::Contains(const SlotHandle& handle) const
+	{
+		return (handle.mIndex < mSlots.size()) && (mSlots[handle.mIndex].mGeneration == handle.mGeneration);
+	}
+
+	template <typename T>
+	T* SlotMap<T>::Find(const SlotHandle& handle)
+	{
+		return Contains(handle) ? &mValues[mSlots[handle.mIndex].mDense] : nullptr;
+	}
+
+	template <typename T>
+	const T* SlotMap<T>::Find(const SlotHandle& handle) const
+	{
+		return Contains(handle) ? &mValues[mSlots[handle.mIndex].mDense] : nullptr;
+	}
+
+	template <typename T>
+	T& SlotMap<T>::operator[](const SlotHandle& handle)
+	{
+		assert(Contains(handle));
+		return mValues[mSlots[handle.mIndex].mDense];
+	}
+
+	template <typename T>
+	const T& SlotMap<T>::operator[](const SlotHandle& handle) const
+	{
+		assert(Contains(handle));
+		return mValues[mSlots[handle.mIndex].mDense];
+	}
+
+	template <typename T>
+	T& SlotMap<T>::At(std::uint32_t denseIndex)
+	{
+		return mValues[denseIndex];
+	}
+
+	template <typename T>
+	const T& SlotMap<T>::At(std::uint32_t denseIndex) const
+	{
+		return mValues[denseIndex];
+	}
+
+	template <typename T>
+	SlotHandle SlotMap<T>::HandleAt(std::uint32_t denseIndex) const
+	{
+		std::uint32_t slot = mDenseSlots[denseIndex];
+		SlotHandle handle = {slot, mSlots[slot].mGeneration};
+		return handle;
+	}
+
+	template <typename T>
+	std::uint32_t SlotMap<T>::DenseIndex(const SlotHandle& handle) const
+	{
+		assert(Contains(handle));
+		return mSlots[handle.mIndex].mDense;
+	}
+
+	template <typename T>
+	typename SlotMap<T>::Iterator SlotMap<T>::begin()
+	{
+		return mValues.begin();
+	}
+
+	template <typename T>
+	typename SlotMap<T>::Iterator SlotMap<T>::end()
+	{
+		return mValues.end();
+	}
+
+	template <typename T>
+	typename SlotMap<T>::ConstIterator SlotMap<T>::begin() const
+	{
+		return mValues.begin();
+	}
+
+	template <typename T>
+	typename SlotMap<T>::ConstIterator SlotMap<T>::end() const
+	{
+		return mValues.end();
+	}
+
+	template <typename T>
+	std::uint32_t SlotMap<T>::AllocateSlot()
+	{
+		if (mFreeHead == InvalidIndex)
+		{
+			Slot slot = {InvalidIndex, 1};
+			mSlots.push_back(slot);
+			return static_cast<std::uint32_t>(mSlots.size() - 1);
+		}
+
+		std::uint32_t slot = mFreeHead;
+		mFreeHead = mSlots[slot].mDense;
+		return slot;
+	}
+
+	template <typename T>
+	void SlotMap<T>::FreeSlot(std::uint32_t slot)
+	{
+		// generation zero is never handed out, so it is skipped on wrapping around
+		std::uint32_t generation = mSlots[slot].mGeneration + 1;
+		mSlots[slot].mGeneration = (generation == 0) ? 1 : generation;
+		mSlots[slot].mDense = mFreeHead;
+		mFreeHead = slot;
+	}
+}
@@ -0,0 +1,698 @@
+#include "pch.h"
+#include "SpacecraftFleet.h"
+#include "BodyStateStore.h"
+#include "ConicPropagator.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t SpacecraftFleet::AdvanceGrainSize = 256;
+	const uint32_t SpacecraftFleet::EvaluationGrainSize = 1024;
+	const uint32_t SpacecraftFleet::MaxGridSamples = 256;
+	const uint32_t SpacecraftFleet::MaxCrossingSamples = 65536;
+	const uint32_t SpacecraftFleet::MaxTransitionsPerAdvance = 64;
+	const uint32_t SpacecraftFleet::MaxCrossingIterations = 60;
+	const double SpacecraftFleet::CrossingTolerance = 1.0e-9;
+	const double SpacecraftFleet::ExitMargin = 0.01;
+	const double SpacecraftFleet::BoundaryTolerance = 1.0e-6;
+
+	namespace
+	{
+		// Laplace's exponent of the mass ratio
+		const double SphereOfInfluenceExponent = 2.0 / 5.0;
+		const double FullTurn = 2.0 * 3.14159265358979323846;
+
+		double Length(double x, double y, double z)
+		{
+			return sqrt(x * x + y * y + z * z);
+		}
+
+		// How long a gap surely stays open when it closes no faster than speed plus acceleration times the time taken,
+		// the root of speed t + acceleration t^2 / 2 = gap; infinite for a gap that cannot close at all.
+		double SafeLead(double gap, double speed, double acceleration)
+		{
+			if (!(gap > 0))
+			{
+				return 0.0;
+			}
+			return 2.0 * gap / (speed + sqrt(speed * speed + 2.0 * acceleration * gap));
+		}
+
+		// How long a craft at offset from a sphere's centre, moving at relativeVelocity, surely stays outside radius. The
+		// relative path strays from the straight line by at most acceleration t^2 / 2, so the craft stays out at least
+		// until that deviation covers the gap to the line's closest approach, or until it closes at closingSpeed.
+		double ApproachLead(const double* offset, const double* relativeVelocity, double radius, double acceleration, double closingSpeed)
+		{
+			double distance = Length(offset[0], offset[1], offset[2]);
+			double gap = distance - radius;
+			if (!(gap > 0))
+			{
+				return 0.0;
+			}
+
+			double speed = Length(relativeVelocity[0], relativeVelocity[1], relativeVelocity[2]);
+			double along = -(offset[0] * relativeVelocity[0] + offset[1] * relativeVelocity[1] + offset[2] * relativeVelocity[2]);
+			double closestTime = (along > 0) ? (along / (speed * speed)) : 0.0;
+			double closest = Length(offset[0] + relativeVelocity[0] * closestTime, offset[1] + relativeVelocity[1] * closestTime,
+				offset[2] + relativeVelocity[2] * closestTime);
+
+			// up to the line's closest approach it is at least distance - speed t away, and from then on at least closest
+			double lead = max(SafeLead(gap, closingSpeed, 0.0), SafeLead(gap, speed, acceleration));
+			double pastClosest = SafeLead(closest - radius, 0.0, acceleration);
+			if (pastClosest >= closestTime)
+			{
+				lead = max(lead, pastClosest);
+			}
+			return lead;
+		}
+	}
+
+	SpacecraftFleet::SpacecraftFleet() :
+		mCapacity(0), mDroppedCount(0), mCappedCount(0), mTime(0), mAdvanceBegin(0), mAdvanceEnd(0)
+	{
+	}
+
+	void SpacecraftFleet::SetBodies(const BodyStateStore& states, const vector<float>& gravitationalParameters, double time)
+	{
+		uint32_t bodyCount = states.Count();
+		mBodyParents.resize(bodyCount);
+		mGravitationalParameters.assign(gravitationalParameters.begin(), gravitationalParameters.end());
+		mSpheresOfInfluence.assign(bodyCount, 0.0);
+		mEntryRadii.assign(bodyCount, 0.0);
+		mExitRadii.assign(bodyCount, 0.0);
+		mInnerReaches.assign(bodyCount, 0.0);
+		mOuterReaches.assign(bodyCount, 0.0);
+		mPeriapsisSpeeds.assign(bodyCount, 0.0);
+		mPeriapsisAccelerations.assign(bodyCount, 0.0);
+		mCrossingIntervals.assign(bodyCount, 0.0);
+		mCapturingChildren.assign(bodyCount, vector<uint32_t>());
+		mSampleIntervals.assign(bodyCount, 0.0);
+		mGrids.assign(bodyCount, SampleGrid());
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			uint32_t parent = states.Parent(index);
+			mBodyParents[index] = parent;
+			if (parent == BodyStateStore::InvalidIndex)
+			{
+				mSpheresOfInfluence[index] = numeric_limits<double>::infinity();
+				mExitRadii[index] = numeric_limits<double>::infinity();
+				continue;
+			}
+
+			double gravitationalParameter = mGravitationalParameters[index];
+			double parentGravitationalParameter = mGravitationalParameters[parent];
+			if (gravitationalParameter <= 0 || parentGravitationalParameter <= 0)
+			{
+				continue;
+			}
+
+			double semiMajorAxis = states.SemiMajorAxis(index);
+			double eccentricity = states.Eccentricity(index);
+			double sphereOfInfluence = semiMajorAxis * pow(gravitationalParameter / parentGravitationalParameter, SphereOfInfluenceExponent);
+			double periapsis = semiMajorAxis * (1.0 - eccentricity);
+			mSpheresOfInfluence[index] = sphereOfInfluence;
+			mEntryRadii[index] = sphereOfInfluence * (1.0 + BoundaryTolerance);
+			mExitRadii[index] = sphereOfInfluence * (1.0 + ExitMargin) * (1.0 - BoundaryTolerance);
+			mInnerReaches[index] = periapsis - sphereOfInfluence;
+			mOuterReaches[index] = semiMajorAxis * (1.0 + eccentricity) + sphereOfInfluence;
+			mCapturingChildren[parent].push_back(index);
+
+			// a bound craft about the parent moves no faster than the escape speed at the body's periapsis there
+			double meanMotion = FullTurn * fabs(states.OrbitalFrequency(index));
+			double periapsisSpeed = meanMotion * semiMajorAxis * sqrt((1.0 + eccentricity) / (1.0 - eccentricity));
+			double escapeSpeed = sqrt(2.0 * parentGravitationalParameter / periapsis);
+			mPeriapsisSpeeds[index] = periapsisSpeed;
+			mPeriapsisAccelerations[index] = meanMotion * meanMotion * semiMajorAxis * semiMajorAxis * semiMajorAxis / (periapsis * periapsis);
+			mCrossingIntervals[index] = sphereOfInfluence / (periapsisSpeed + escapeSpeed);
+		}
+
+		// a grid serves leaving the body's own sphere as well as entering its children's
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			double interval = mCrossingIntervals[index];
+			for (uint32_t child : mCapturingChildren[index])
+			{
+				interval = (interval > 0) ? min(interval, mCrossingIntervals[child]) : mCrossingIntervals[child];
+			}
+			mSampleIntervals[index] = interval;
+		}
+
+		mCraft.Clear();
+		mTime = time;
+		mAdvanceBegin = time;
+		mAdvanceEnd = time;
+	}
+
+	void SpacecraftFleet::SetCapacity(uint32_t capacity)
+	{
+		mCraft = SlotMap<Spacecraft>();
+		mCraft.Reserve(capacity);
+		mCapacity = capacity;
+		mDroppedCount = 0;
+		mCappedCount = 0;
+		mInstances.clear();
+		mInstances.reserve(capacity);
+		mParents.clear();
+		mParents.reserve(capacity);
+	}
+
+	uint32_t SpacecraftFleet::Capacity() const
+	{
+		return mCapacity;
+	}
+
+	uint32_t SpacecraftFleet::Count() const
+	{
+		return mCraft.Size();
+	}
+
+	uint64_t SpacecraftFleet::DroppedCount() const
+	{
+		return mDroppedCount;
+	}
+
+	double SpacecraftFleet::Time() const
+	{
+		return mTime;
+	}
+
+	SlotHandle SpacecraftFleet::Launch(const Spacecraft& spacecraft, const BodyStateStore& states)
+	{
+		if (spacecraft.mParent >= mBodyParents.size())
+		{
+			throw runtime_error("Spacecraft has no parent in the catalog");
+		}
+
+		if (mCraft.Size() >= mCapacity)
+		{
+			++mDroppedCount;
+			SlotHandle handle = {0, 0};
+			return handle;
+		}
+
+		Spacecraft launched = spacecraft;
+		launched.mEpoch = mTime;
+		Settle(launched, states);
+		launched.mTransitions = 0;
+		if (mGravitationalParameters[launched.mParent] <= 0)
+		{
+			throw runtime_error("Spacecraft launched about a body without mass");
+		}
+		return mCraft.Insert(launched);
+	}
+
+	bool SpacecraftFleet::Destroy(const SlotHandle& handle)
+	{
+		return mCraft.Erase(handle);
+	}
+
+	void SpacecraftFleet::Clear()
+	{
+		mCraft.Clear();
+	}
+
+	const Spacecraft* SpacecraftFleet::Find(const SlotHandle& handle) const
+	{
+		return mCraft.Find(handle);
+	}
+
+	const Spacecraft& SpacecraftFleet::CraftAt(uint32_t denseIndex) const
+	{
+		return mCraft.At(denseIndex);
+	}
+
+	SlotHandle SpacecraftFleet::Restore(const Spacecraft& spacecraft)
+	{
+		if (spacecraft.mParent >= mBodyParents.size() || mGravitationalParameters[spacecraft.mParent] <= 0)
+		{
+			throw runtime_error("Spacecraft has no parent in the catalog");
+		}
+
+		if (mCraft.Size() >= mCapacity)
+		{
+			++mDroppedCount;
+			SlotHandle handle = {0, 0};
+			return handle;
+		}
+		return mCraft.Insert(spacecraft);
+	}
+
+	void SpacecraftFleet::Advance(double time, const BodyStateStore& states)
+	{
+		if (time != mTime && mCraft.Size() > 0)
+		{
+			BuildGrids(mTime, time, states);
+			mCapped.assign(mCraft.Size(), 0);
+			AdvanceRange(0, mCraft.Size(), states);
+			mCappedCount += count(mCapped.begin(), mCapped.end(), static_cast<uint8_t>(1));
+		}
+		mTime = time;
+	}
+
+	void SpacecraftFleet::Advance(double time, const BodyStateStore& states, ThreadPool& threadPool)
+	{
+		if (time != mTime && mCraft.Size() > 0)
+		{
+			BuildGrids(mTime, time, states);
+			auto advanceRange = [this, &states](uint32_t begin, uint32_t end)
+			{
+				AdvanceRange(begin, end, states);
+			};
+			mCapped.assign(mCraft.Size(), 0);
+			threadPool.ParallelFor(0, mCraft.Size(), AdvanceGrainSize, advanceRange);
+			mCappedCount += count(mCapped.begin(), mCapped.end(), static_cast<uint8_t>(1));
+		}
+		mTime = time;
+	}
+
+	void SpacecraftFleet::Evaluate(double time)
+	{
+		mInstances.resize(mCraft.Size());
+		mParents.resize(mCraft.Size());
+		EvaluateRange(0, mCraft.Size(), time);
+	}
+
+	void SpacecraftFleet::Evaluate(double time, ThreadPool& threadPool)
+	{
+		mInstances.resize(mCraft.Size());
+		mParents.resize(mCraft.Size());
+		auto evaluateRange = [this, time](uint32_t begin, uint32_t end)
+		{
+			EvaluateRange(begin, end, time);
+		};
+		threadPool.ParallelFor(0, mCraft.Size(), EvaluationGrainSize, evaluateRange);
+	}
+
+	const vector<XMFLOAT4>& SpacecraftFleet::Instances() const
+	{
+		return mInstances;
+	}
+
+	const vector<uint32_t>& SpacecraftFleet::Parents() const
+	{
+		return mParents;
+	}
+
+	double SpacecraftFleet::SphereOfInfluence(uint32_t body) const
+	{
+		return mSpheresOfInfluence[body];
+	}
+
+	uint32_t SpacecraftFleet::SampleCount(uint32_t body) const
+	{
+		return mGrids[body].mSampleCount;
+	}
+
+	uint64_t SpacecraftFleet::TransitionCount() const
+	{
+		uint64_t transitionCount = 0;
+		for (const Spacecraft& spacecraft : mCraft)
+		{
+			transitionCount += spacecraft.mTransitions;
+		}
+		return transitionCount;
+	}
+
+	uint64_t SpacecraftFleet::CappedCount() const
+	{
+		return mCappedCount;
+	}
+
+	void SpacecraftFleet::BuildGrids(double begin, double end, const BodyStateStore& states)
+	{
+		mAdvanceBegin = begin;
+		mAdvanceEnd = end;
+		double span = end - begin;
+		for (uint32_t body = 0; body < mGrids.size(); ++body)
+		{
+			SampleGrid& grid = mGrids[body];
+			double interval = mSampleIntervals[body];
+			double sampleCount = (interval > 0) ? ceil(fabs(span) / interval) : 1.0;
+			grid.mSampleCount = static_cast<uint32_t>(max(1.0, min(sampleCount, static_cast<double>(MaxGridSamples))));
+
+			const vector<uint32_t>& children = mCapturingChildren[body];
+			uint32_t stride = grid.mSampleCount + 1;
+			grid.mChildX.resize(children.size() * stride);
+			grid.mChildY.resize(children.size() * stride);
+			grid.mChildZ.resize(children.size() * stride);
+			grid.mChildVelocityX.resize(children.size() * stride);
+			grid.mChildVelocityY.resize(children.size() * stride);
+			grid.mChildVelocityZ.resize(children.size() * stride);
+			for (uint32_t child = 0; child < children.size(); ++child)
+			{
+				for (uint32_t sample = 0; sample < stride; ++sample)
+				{
+					double time = begin + span * sample / grid.mSampleCount;
+					XMFLOAT3 position;
+					XMFLOAT3 velocity;
+					XMStoreFloat3(&position, states.EvaluateLocalPosition(children[child], time));
+					// a frozen body stands still, whatever velocity its orbit has at the frozen time
+					XMStoreFloat3(&velocity, states.Frozen(children[child]) ? XMVectorZero() : states.EvaluateLocalVelocity(children[child], time));
+					grid.mChildX[child * stride + sample] = position.x;
+					grid.mChildY[child * stride + sample] = position.y;
+					grid.mChildZ[child * stride + sample] = position.z;
+					grid.mChildVelocityX[child * stride + sample] = velocity.x;
+					grid.mChildVelocityY[child * stride + sample] = velocity.y;
+					grid.mChildVelocityZ[child * stride + sample] = velocity.z;
+				}
+			}
+		}
+	}
+
+	void SpacecraftFleet::AdvanceRange(uint32_t begin, uint32_t end, const BodyStateStore& states)
+	{
+		CrossingScratch scratch;
+		for (uint32_t index = begin; index < end; ++index)
+		{
+			Spacecraft& spacecraft = mCraft.At(index);
+			double start = mAdvanceBegin;
+			uint32_t transition = 0;
+			uint32_t samplesLeft = MaxCrossingSamples;
+			Crossing crossing;
+			CrossingSearch search = CrossingSearch::None;
+			for (; transition < MaxTransitionsPerAdvance; ++transition)
+			{
+				search = FindCrossing(spacecraft, start, states, scratch, samplesLeft, crossing);
+				if (search != CrossingSearch::Found)
+				{
+					break;
+				}
+
+				// a moon's sphere may reach past its planet's, so a craft leaving one can already be outside the next
+				Rebase(spacecraft, crossing.mNewParent, crossing.mTime, states);
+				Settle(spacecraft, states);
+				start = crossing.mTime;
+			}
+
+			// stopping at the cap is only worth counting if there was more to search
+			if (transition == MaxTransitionsPerAdvance)
+			{
+				search = FindCrossing(spacecraft, start, states, scratch, samplesLeft, crossing);
+			}
+			if (search == CrossingSearch::Exhausted || (transition == MaxTransitionsPerAdvance && search == CrossingSearch::Found))
+			{
+				mCapped[index] = 1;
+			}
+		}
+	}
+
+	SpacecraftFleet::CrossingSearch SpacecraftFleet::FindCrossing(const Spacecraft& spacecraft, double begin, const BodyStateStore& states, CrossingScratch& scratch,
+		uint32_t& samplesLeft, Crossing& crossing) const
+	{
+		// The closest and farthest the conic comes to the parent, from its angular momentum and energy, rule out the
+		// spheres it never reaches. Event 0 is leaving the parent's sphere, event n entering its n-th child's.
+		uint32_t parent = spacecraft.mParent;
+		const vector<uint32_t>& children = mCapturingChildren[parent];
+		double gravitationalParameter = mGravitationalParameters[parent];
+		const double* position = spacecraft.mPosition;
+		const double* velocity = spacecraft.mVelocity;
+		double momentumX = position[1] * velocity[2] - position[2] * velocity[1];
+		double momentumY = position[2] * velocity[0] - position[0] * velocity[2];
+		double momentumZ = position[0] * velocity[1] - position[1] * velocity[0];
+		double semiLatusRectum = (momentumX * momentumX + momentumY * momentumY + momentumZ * momentumZ) / gravitationalParameter;
+		double energy = 0.5 * (velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2]) -
+			gravitationalParameter / Length(position[0], position[1], position[2]);
+		double eccentricity = sqrt(max(0.0, 1.0 + 2.0 * energy * semiLatusRectum / gravitationalParameter));
+		double periapsis = semiLatusRectum / (1.0 + eccentricity);
+		double apoapsis = (eccentricity < 1.0) ? semiLatusRectum / (1.0 - eccentricity) : numeric_limits<double>::infinity();
+		double fastestSpeed = (periapsis > 0) ? sqrt(semiLatusRectum * gravitationalParameter) / periapsis : numeric_limits<double>::infinity();
+		double strongestAcceleration = (periapsis > 0) ? gravitationalParameter / (periapsis * periapsis) : numeric_limits<double>::infinity();
+
+		uint32_t eventCount = static_cast<uint32_t>(children.size()) + 1;
+		scratch.mReachable.resize(eventCount);
+		scratch.mReachable[0] = (apoapsis > mExitRadii[parent]) ? 1 : 0;
+		bool anyReachable = (scratch.mReachable[0] != 0);
+		for (uint32_t child = 0; child < children.size(); ++child)
+		{
+			uint32_t body = children[child];
+			bool reachable = (periapsis <= mOuterReaches[body] && apoapsis >= mInnerReaches[body]);
+			scratch.mReachable[child + 1] = reachable ? 1 : 0;
+			anyReachable = anyReachable || reachable;
+		}
+		if (!anyReachable)
+		{
+			return CrossingSearch::None;
+		}
+
+		// Distances past each reachable boundary, positive once crossed, and how long from the sample every boundary
+		// surely stays uncrossed. Samples on the grid use its child states, others evaluate them directly.
+		const SampleGrid& grid = mGrids[parent];
+		uint32_t stride = grid.mSampleCount + 1;
+		scratch.mDistances.resize(eventCount * 2);
+		double* previous = scratch.mDistances.data();
+		double* current = previous + eventCount;
+		auto sampleDistances = [&](double time, uint32_t sample, double* sampled)
+		{
+			double propagatedPosition[3];
+			double propagatedVelocity[3];
+			ConicPropagator::Propagate(position, velocity, time - spacecraft.mEpoch, gravitationalParameter, propagatedPosition, propagatedVelocity);
+			double x = propagatedPosition[0], y = propagatedPosition[1], z = propagatedPosition[2];
+			double speed = Length(propagatedVelocity[0], propagatedVelocity[1], propagatedVelocity[2]);
+			double distance = Length(x, y, z);
+			sampled[0] = distance - mExitRadii[parent];
+
+			// The craft moves out no faster than its periapsis speed, nor than its speed now plus the pull at periapsis.
+			// Leads run to the spheres themselves, so they stay open when a craft nears the crossings just inside them.
+			double lead = numeric_limits<double>::infinity();
+			if (scratch.mReachable[0] != 0)
+			{
+				double gap = mSpheresOfInfluence[parent] * (1.0 + ExitMargin) - distance;
+				lead = max(SafeLead(gap, fastestSpeed, 0.0), SafeLead(gap, speed, strongestAcceleration));
+			}
+
+			for (uint32_t child = 0; child < children.size(); ++child)
+			{
+				if (scratch.mReachable[child + 1] == 0)
+				{
+					sampled[child + 1] = -numeric_limits<double>::infinity();
+					continue;
+				}
+
+				uint32_t body = children[child];
+				double childPosition[3];
+				double childVelocity[3];
+				if (sample < stride)
+				{
+					uint32_t offset = child * stride + sample;
+					childPosition[0] = grid.mChildX[offset];
+					childPosition[1] = grid.mChildY[offset];
+					childPosition[2] = grid.mChildZ[offset];
+					childVelocity[0] = grid.mChildVelocityX[offset];
+					childVelocity[1] = grid.mChildVelocityY[offset];
+					childVelocity[2] = grid.mChildVelocityZ[offset];
+				}
+				else
+				{
+					XMFLOAT3 evaluatedPosition;
+					XMFLOAT3 evaluatedVelocity;
+					XMStoreFloat3(&evaluatedPosition, states.EvaluateLocalPosition(body, time));
+					XMStoreFloat3(&evaluatedVelocity, states.Frozen(body) ? XMVectorZero() : states.EvaluateLocalVelocity(body, time));
+					childPosition[0] = evaluatedPosition.x;
+					childPosition[1] = evaluatedPosition.y;
+					childPosition[2] = evaluatedPosition.z;
+					childVelocity[0] = evaluatedVelocity.x;
+					childVelocity[1] = evaluatedVelocity.y;
+					childVelocity[2] = evaluatedVelocity.z;
+				}
+
+				double offset[3] = { x - childPosition[0], y - childPosition[1], z - childPosition[2] };
+				double relativeVelocity[3] = { propagatedVelocity[0] - childVelocity[0], propagatedVelocity[1] - childVelocity[1], propagatedVelocity[2] - childVelocity[2] };
+				sampled[child + 1] = mEntryRadii[body] - Length(offset[0], offset[1], offset[2]);
+				lead = min(lead, ApproachLead(offset, relativeVelocity, mSpheresOfInfluence[body], strongestAcceleration + mPeriapsisAccelerations[body],
+					fastestSpeed + mPeriapsisSpeeds[body]));
+			}
+			return lead;
+		};
+
+		double span = mAdvanceEnd - mAdvanceBegin;
+		double direction = (span > 0) ? 1.0 : -1.0;
+		double previousTime = begin;
+		double lead = sampleDistances(begin, stride, previous);
+
+		// a craft an earlier Advance left past a boundary crosses it at once
+		for (uint32_t event = 0; event < eventCount; ++event)
+		{
+			if (previous[event] > 0)
+			{
+				crossing.mNewParent = (event == 0) ? mBodyParents[parent] : children[event - 1];
+				crossing.mTime = begin;
+				return CrossingSearch::Found;
+			}
+		}
+
+		while ((mAdvanceEnd - previousTime) * direction > 0)
+		{
+			// no boundary can be crossed before the lead of the previous sample runs out, so the step never goes past it
+			if (samplesLeft == 0)
+			{
+				return CrossingSearch::Exhausted;
+			}
+			--samplesLeft;
+			double target = previousTime + direction * lead;
+
+			// the last grid sample short of the target, or the target itself when none lies past the previous time
+			uint32_t sample = stride;
+			double time = target;
+			if ((target - mAdvanceEnd) * direction >= 0)
+			{
+				sample = grid.mSampleCount;
+				time = mAdvanceEnd;
+			}
+			else
+			{
+				double gridSample = floor((target - mAdvanceBegin) / span * grid.mSampleCount);
+				double gridTime = mAdvanceBegin + span * gridSample / grid.mSampleCount;
+				if ((gridTime - previousTime) * direction > 0)
+				{
+					sample = static_cast<uint32_t>(gridSample);
+					time = gridTime;
+				}
+			}
+
+			double currentLead = sampleDistances(time, sample, current);
+			bool crossed = false;
+			double earliest = time;
+			for (uint32_t event = 0; event < eventCount; ++event)
+			{
+				if (!(previous[event] <= 0 && current[event] > 0))
+				{
+					continue;
+				}
+
+				// false position with the Illinois halving, keeping the crossed side
+				double before = previousTime;
+				double after = time;
+				double beforeDistance = previous[event];
+				double afterDistance = current[event];
+				double tolerance = CrossingTolerance * fabs(time - previousTime);
+				int32_t retainedSide = 0;
+				for (uint32_t iteration = 0; iteration < MaxCrossingIterations && fabs(after - before) > tolerance; ++iteration)
+				{
+					double guess = before - beforeDistance * (after - before) / (afterDistance - beforeDistance);
+					double distance = Distance(spacecraft, event, guess, states);
+					if (distance > 0)
+					{
+						after = guess;
+						afterDistance = distance;
+						beforeDistance *= (retainedSide == -1) ? 0.5 : 1.0;
+						retainedSide = -1;
+					}
+					else
+					{
+						before = guess;
+						beforeDistance = distance;
+						afterDistance *= (retainedSide == 1) ? 0.5 : 1.0;
+						retainedSide = 1;
+					}
+				}
+
+				if (!crossed || (after - earliest) / span < 0)
+				{
+					crossed = true;
+					earliest = after;
+					crossing.mNewParent = (event == 0) ? mBodyParents[parent] : children[event - 1];
+				}
+			}
+
+			if (crossed)
+			{
+				crossing.mTime = earliest;
+				return CrossingSearch::Found;
+			}
+
+			swap(previous, current);
+			previousTime = time;
+			lead = currentLead;
+		}
+		return CrossingSearch::None;
+	}
+
+	double SpacecraftFleet::Distance(const Spacecraft& spacecraft, uint32_t event, double time, const BodyStateStore& states) const
+	{
+		uint32_t parent = spacecraft.mParent;
+		double position[3];
+		double velocity[3];
+		ConicPropagator::Propagate(spacecraft.mPosition, spacecraft.mVelocity, time - spacecraft.mEpoch, mGravitationalParameters[parent], position, velocity);
+		if (event == 0)
+		{
+			return Length(position[0], position[1], position[2]) - mExitRadii[parent];
+		}
+
+		uint32_t child = mCapturingChildren[parent][event - 1];
+		XMFLOAT3 childPosition;
+		XMStoreFloat3(&childPosition, states.EvaluateLocalPosition(child, time));
+		return mEntryRadii[child] - Length(position[0] - childPosition.x, position[1] - childPosition.y, position[2] - childPosition.z);
+	}
+
+	void SpacecraftFleet::Rebase(Spacecraft& spacecraft, uint32_t newParent, double time, const BodyStateStore& states) const
+	{
+		double position[3];
+		double velocity[3];
+		uint32_t parent = spacecraft.mParent;
+		ConicPropagator::Propagate(spacecraft.mPosition, spacecraft.mVelocity, time - spacecraft.mEpoch, mGravitationalParameters[parent], position, velocity);
+
+		// leaving adds the old parent's state about its own parent, entering takes off the new parent's
+		bool leaving = (newParent == mBodyParents[parent]);
+		uint32_t frame = leaving ? parent : newParent;
+		double sign = leaving ? 1.0 : -1.0;
+		XMFLOAT3 framePosition;
+		XMFLOAT3 frameVelocity;
+		XMStoreFloat3(&framePosition, states.EvaluateLocalPosition(frame, time));
+		XMStoreFloat3(&frameVelocity, states.Frozen(frame) ? XMVectorZero() : states.EvaluateLocalVelocity(frame, time));
+		spacecraft.mPosition[0] = position[0] + sign * framePosition.x;
+		spacecraft.mPosition[1] = position[1] + sign * framePosition.y;
+		spacecraft.mPosition[2] = position[2] + sign * framePosition.z;
+		spacecraft.mVelocity[0] = velocity[0] + sign * frameVelocity.x;
+		spacecraft.mVelocity[1] = velocity[1] + sign * frameVelocity.y;
+		spacecraft.mVelocity[2] = velocity[2] + sign * frameVelocity.z;
+		spacecraft.mParent = newParent;
+		spacecraft.mEpoch = time;
+		++spacecraft.mTransitions;
+	}
+
+	void SpacecraftFleet::Settle(Spacecraft& spacecraft, const BodyStateStore& states) const
+	{
+		// up while outside the parent's sphere, then down into any child's that holds the craft; each body is visited
+		// at most once on the way up and once on the way down
+		for (uint32_t step = 0; step < 2 * mBodyParents.size(); ++step)
+		{
+			uint32_t parent = spacecraft.mParent;
+			if (Length(spacecraft.mPosition[0], spacecraft.mPosition[1], spacecraft.mPosition[2]) > mExitRadii[parent])
+			{
+				Rebase(spacecraft, mBodyParents[parent], spacecraft.mEpoch, states);
+				continue;
+			}
+
+			uint32_t event = 1;
+			for (; event <= mCapturingChildren[parent].size(); ++event)
+			{
+				if (Distance(spacecraft, event, spacecraft.mEpoch, states) > 0)
+				{
+					break;
+				}
+			}
+			if (event > mCapturingChildren[parent].size())
+			{
+				return;
+			}
+			Rebase(spacecraft, mCapturingChildren[parent][event - 1], spacecraft.mEpoch, states);
+		}
+	}
+
+	void SpacecraftFleet::EvaluateRange(uint32_t begin, uint32_t end, double time)
+	{
+		for (uint32_t index = begin; index < end; ++index)
+		{
+			const Spacecraft& spacecraft = mCraft.At(index);
+			double position[3];
+			double velocity[3];
+			ConicPropagator::Propagate(spacecraft.mPosition, spacecraft.mVelocity, time - spacecraft.mEpoch, mGravitationalParameters[spacecraft.mParent],
+				position, velocity);
+			mInstances[index] = XMFLOAT4(static_cast<float>(position[0]), static_cast<float>(position[1]), static_cast<float>(position[2]), spacecraft.mSize);
+			mParents[index] = spacecraft.mParent;
+		}
+	}
+}
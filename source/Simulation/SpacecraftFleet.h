@@ -0,0 +1,166 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "SlotMap.h"
+
+namespace Simulation
+{
+	class BodyStateStore;
+	class ThreadPool;
+
+	// A massless craft on a conic about mParent: its position and velocity relative to the parent, in world units and
+	// per simulation second, at simulation time mEpoch. mTransitions counts the spheres of influence it entered or left.
+	struct Spacecraft
+	{
+		std::uint32_t mParent;
+		double mEpoch;
+		double mPosition[3];
+		double mVelocity[3];
+		float mSize;
+		std::uint32_t mTransitions;
+	};
+
+	// Thousands of spacecraft flown on patched conics through the body hierarchy of a BodyStateStore. Each craft follows
+	// the conic about the body whose sphere of influence a (m / M)^(2/5) it is in, and Advance finds where it crosses
+	// into another by sampling ahead no further than it surely cannot reach one. Like SpawnedBodies, craft live in a
+	// SlotMap reserved up front by SetCapacity.
+	class SpacecraftFleet final
+	{
+	public:
+		SpacecraftFleet();
+		SpacecraftFleet(const SpacecraftFleet&) = delete;
+		SpacecraftFleet& operator=(const SpacecraftFleet&) = delete;
+		SpacecraftFleet(SpacecraftFleet&&) = default;
+		SpacecraftFleet& operator=(SpacecraftFleet&&) = default;
+		~SpacecraftFleet() = default;
+
+		// Takes the hierarchy and masses of the bodies, and the time the fleet starts at. Removes every craft.
+		void SetBodies(const BodyStateStore& states, const std::vector<float>& gravitationalParameters, double time);
+		void SetCapacity(std::uint32_t capacity);
+		std::uint32_t Capacity() const;
+		std::uint32_t Count() const;
+		std::uint64_t DroppedCount() const;
+		double Time() const;
+
+		// The craft's state is taken at Time() whatever its mEpoch, and it starts about the innermost sphere of influence
+		// that holds it, which need not be mParent's. Past the capacity the handle is zeroed and the craft counted as
+		// dropped.
+		SlotHandle Launch(const Spacecraft& spacecraft, const BodyStateStore& states);
+		bool Destroy(const SlotHandle& handle);
+		void Clear();
+		const Spacecraft* Find(const SlotHandle& handle) const;
+		// The craft in dense order, and Restore puts one saved from there back as it was, epoch, parent and transitions
+		// included, rather than launching it anew.
+		const Spacecraft& CraftAt(std::uint32_t denseIndex) const;
+		SlotHandle Restore(const Spacecraft& spacecraft);
+
+		// Moves every craft from Time() to the given time, which may be earlier, over AdvanceGrainSize craft at a time on
+		// the thread pool.
+		void Advance(double time, const BodyStateStore& states);
+		void Advance(double time, const BodyStateStore& states, ThreadPool& threadPool);
+		// Writes one instance per craft in dense order, its position relative to its parent with the size in w, next to
+		// Parents() in the same order.
+		void Evaluate(double time);
+		void Evaluate(double time, ThreadPool& threadPool);
+		const std::vector<DirectX::XMFLOAT4>& Instances() const;
+		const std::vector<std::uint32_t>& Parents() const;
+
+		// Radius of the body's sphere of influence, infinite for roots and zero for bodies without mass.
+		double SphereOfInfluence(std::uint32_t body) const;
+		std::uint32_t SampleCount(std::uint32_t body) const;
+		std::uint64_t TransitionCount() const;
+		// Advances that stopped a craft at MaxTransitionsPerAdvance with crossings left, or at MaxCrossingSamples short of
+		// the end, leaving it on the conic of its last change until the next Advance.
+		std::uint64_t CappedCount() const;
+
+		static const std::uint32_t AdvanceGrainSize;
+		static const std::uint32_t EvaluationGrainSize;
+		static const std::uint32_t MaxGridSamples;
+		static const std::uint32_t MaxCrossingSamples;
+		static const std::uint32_t MaxTransitionsPerAdvance;
+		static const std::uint32_t MaxCrossingIterations;
+		static const double CrossingTolerance;
+		static const double ExitMargin;
+		// Fraction of a sphere's radius short of it where a crossing counts, so a craft nearing the sphere reaches the
+		// crossing in a bounded number of samples.
+		static const double BoundaryTolerance;
+
+	private:
+		// The sample times of an Advance about one body, and its capturing children's positions and velocities at each,
+		// child-major.
+		struct SampleGrid
+		{
+			std::uint32_t mSampleCount;
+			std::vector<double> mChildX;
+			std::vector<double> mChildY;
+			std::vector<double> mChildZ;
+			std::vector<double> mChildVelocityX;
+			std::vector<double> mChildVelocityY;
+			std::vector<double> mChildVelocityZ;
+		};
+
+		enum class CrossingSearch
+		{
+			Found,
+			None,
+			// the samples ran out before the end of the Advance
+			Exhausted
+		};
+
+		struct Crossing
+		{
+			double mTime;
+			std::uint32_t mNewParent;
+		};
+
+		// Per thread, so that searching does not allocate per craft.
+		struct CrossingScratch
+		{
+			std::vector<double> mDistances;
+			std::vector<std::uint8_t> mReachable;
+		};
+
+		void BuildGrids(double begin, double end, const BodyStateStore& states);
+		void AdvanceRange(std::uint32_t begin, std::uint32_t end, const BodyStateStore& states);
+		// Searches from begin to the end of the Advance, taking samples out of samplesLeft.
+		CrossingSearch FindCrossing(const Spacecraft& spacecraft, double begin, const BodyStateStore& states, CrossingScratch& scratch, std::uint32_t& samplesLeft,
+			Crossing& crossing) const;
+		double Distance(const Spacecraft& spacecraft, std::uint32_t event, double time, const BodyStateStore& states) const;
+		void Rebase(Spacecraft& spacecraft, std::uint32_t newParent, double time, const BodyStateStore& states) const;
+		void Settle(Spacecraft& spacecraft, const BodyStateStore& states) const;
+		void EvaluateRange(std::uint32_t begin, std::uint32_t end, double time);
+
+		SlotMap<Spacecraft> mCraft;
+		std::uint32_t mCapacity;
+		std::uint64_t mDroppedCount;
+		std::uint64_t mCappedCount;
+		double mTime;
+		double mAdvanceBegin;
+		double mAdvanceEnd;
+
+		std::vector<std::uint32_t> mBodyParents;
+		std::vector<double> mGravitationalParameters;
+		std::vector<double> mSpheresOfInfluence;
+		// where a craft counts as entering and leaving the sphere, BoundaryTolerance inside the sphere and its ExitMargin
+		std::vector<double> mEntryRadii;
+		std::vector<double> mExitRadii;
+		// how close to and far from its parent the body's sphere reaches
+		std::vector<double> mInnerReaches;
+		std::vector<double> mOuterReaches;
+		std::vector<double> mPeriapsisSpeeds;
+		// the strongest pull of the body's own orbit, at its periapsis
+		std::vector<double> mPeriapsisAccelerations;
+		std::vector<double> mCrossingIntervals;
+		// children massive enough to capture a craft, and the spacing of the grid about the body
+		std::vector<std::vector<std::uint32_t>> mCapturingChildren;
+		std::vector<double> mSampleIntervals;
+		std::vector<SampleGrid> mGrids;
+		// by dense index, whether the last Advance stopped the craft at MaxTransitionsPerAdvance or MaxCrossingSamples
+		std::vector<std::uint8_t> mCapped;
+
+		std::vector<DirectX::XMFLOAT4> mInstances;
+		std::vector<std::uint32_t> mParents;
+	};
+}
@@ -0,0 +1,156 @@
+#include "pch.h"
+#include "SpawnedBodies.h"
+#include "BodyStateStore.h"
+#include "KeplerSolver.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t SpawnedBodies::EvaluationGrainSize = 1024;
+
+	SpawnedBodies::SpawnedBodies() :
+		mCapacity(0), mDroppedCount(0)
+	{
+	}
+
+	void SpawnedBodies::SetCapacity(uint32_t capacity)
+	{
+		mOrbits = SlotMap<Orbit>();
+		mOrbits.Reserve(capacity);
+		mCapacity = capacity;
+		mDroppedCount = 0;
+		mInstances.clear();
+		mInstances.reserve(capacity);
+		mParents.clear();
+		mParents.reserve(capacity);
+	}
+
+	uint32_t SpawnedBodies::Capacity() const
+	{
+		return mCapacity;
+	}
+
+	uint32_t SpawnedBodies::Count() const
+	{
+		return mOrbits.Size();
+	}
+
+	uint64_t SpawnedBodies::DroppedCount() const
+	{
+		return mDroppedCount;
+	}
+
+	SlotHandle SpawnedBodies::Spawn(const SpawnedBody& body)
+	{
+		if (mOrbits.Size() >= mCapacity)
+		{
+			++mDroppedCount;
+			SlotHandle handle = {0, 0};
+			return handle;
+		}
+
+		if (body.mElements.mPeriod <= 0 || body.mElements.mEccentricity < 0.0f || body.mElements.mEccentricity >= 1.0f)
+		{
+			throw runtime_error("Spawned bodies need a closed orbit with a period");
+		}
+
+		Orbit orbit;
+		orbit.mBody = body;
+		orbit.mMeanAnomaly = body.mElements.mMeanAnomaly / XM_2PI;
+		orbit.mFrequency = 1.0 / body.mElements.mPeriod;
+		BodyStateStore::PerifocalAxes(body.mElements, orbit.mPeriapsisAxis, orbit.mSemiLatusAxis);
+		return mOrbits.Insert(orbit);
+	}
+
+	bool SpawnedBodies::Destroy(const SlotHandle& handle)
+	{
+		return mOrbits.Erase(handle);
+	}
+
+	void SpawnedBodies::Clear()
+	{
+		mOrbits.Clear();
+	}
+
+	const SpawnedBody* SpawnedBodies::Find(const SlotHandle& handle) const
+	{
+		const Orbit* orbit = mOrbits.Find(handle);
+		return (orbit != nullptr) ? &orbit->mBody : nullptr;
+	}
+
+	const SpawnedBody& SpawnedBodies::BodyAt(uint32_t denseIndex) const
+	{
+		return mOrbits.At(denseIndex).mBody;
+	}
+
+	uint32_t SpawnedBodies::RemoveExpired(double time)
+	{
+		// erasing moves the last body into the hole, so the sweep runs backwards over what it has already seen
+		uint32_t removedCount = 0;
+		for (uint32_t index = mOrbits.Size(); index > 0; --index)
+		{
+			if (mOrbits.At(index - 1).mBody.mExpiry <= time)
+			{
+				mOrbits.Erase(mOrbits.HandleAt(index - 1));
+				++removedCount;
+			}
+		}
+		return removedCount;
+	}
+
+	void SpawnedBodies::Evaluate(double time)
+	{
+		mInstances.resize(mOrbits.Size());
+		mParents.resize(mOrbits.Size());
+		EvaluateRange(0, mOrbits.Size(), time);
+	}
+
+	void SpawnedBodies::Evaluate(double time, ThreadPool& threadPool)
+	{
+		mInstances.resize(mOrbits.Size());
+		mParents.resize(mOrbits.Size());
+		auto evaluateRange = [this, time](uint32_t begin, uint32_t end)
+		{
+			EvaluateRange(begin, end, time);
+		};
+		threadPool.ParallelFor(0, mOrbits.Size(), EvaluationGrainSize, evaluateRange);
+	}
+
+	const vector<XMFLOAT4>& SpawnedBodies::Instances() const
+	{
+		return mInstances;
+	}
+
+	const vector<uint32_t>& SpawnedBodies::Parents() const
+	{
+		return mParents;
+	}
+
+	void SpawnedBodies::EvaluateRange(uint32_t begin, uint32_t end, double time)
+	{
+		for (uint32_t index = begin; index < end; ++index)
+		{
+			const Orbit& orbit = mOrbits.At(index);
+			const OrbitalElements& elements = orbit.mBody.mElements;
+
+			// whole turns are dropped in double precision, as for the bodies
+			double turns = orbit.mMeanAnomaly + orbit.mFrequency * time;
+			turns -= floor(turns + 0.5);
+
+			float eccentricAnomaly = KeplerSolver::SolveEccentricAnomaly(static_cast<float>(turns * XM_2PI), elements.mEccentricity);
+			float sinEccentricAnomaly, cosEccentricAnomaly;
+			XMScalarSinCos(&sinEccentricAnomaly, &cosEccentricAnomaly, eccentricAnomaly);
+
+			float periapsisDistance = elements.mSemiMajorAxis * (cosEccentricAnomaly - elements.mEccentricity);
+			float semiLatusDistance = elements.mSemiMajorAxis * sqrt(1.0f - elements.mEccentricity * elements.mEccentricity) * sinEccentricAnomaly;
+			XMVECTOR position = XMVectorAdd(XMVectorScale(XMLoadFloat3(&orbit.mPeriapsisAxis), periapsisDistance),
+				XMVectorScale(XMLoadFloat3(&orbit.mSemiLatusAxis), semiLatusDistance));
+
+			XMStoreFloat4(&mInstances[index], XMVectorSetW(position, orbit.mBody.mDiameter));
+			mParents[index] = orbit.mBody.mParent;
+		}
+	}
+}
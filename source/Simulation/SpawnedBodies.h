@@ -0,0 +1,84 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "OrbitalElements.h"
+#include "SlotMap.h"
+
+namespace Simulation
+{
+	class ThreadPool;
+
+	// A small body added at runtime: a massless orbit about a catalog body, in world units, and the simulation time it
+	// is removed at (infinity to keep it).
+	struct SpawnedBody
+	{
+		std::uint32_t mParent;
+		OrbitalElements mElements;
+		float mDiameter;
+		double mExpiry;
+	};
+
+	// Comets, probes and debris created and destroyed while the simulation runs. Like the asteroids of an AsteroidBelt
+	// they are massless and closed form, so they are evaluated rather than stepped, but they live in a SlotMap: Spawn
+	// and Destroy are O(1), and the handle Spawn returns stays valid, and only finds its own body, until Destroy or
+	// expiry removes it.
+	//
+	// Storage is reserved up front by SetCapacity, so spawning never reallocates; Spawn past the capacity returns a
+	// zeroed handle and counts the body as dropped. Evaluate writes one instance per body in dense order, the position
+	// relative to its parent with the diameter in w, next to Parents() in the same order.
+	class SpawnedBodies final
+	{
+	public:
+		SpawnedBodies();
+		SpawnedBodies(const SpawnedBodies&) = delete;
+		SpawnedBodies& operator=(const SpawnedBodies&) = delete;
+		SpawnedBodies(SpawnedBodies&&) = default;
+		SpawnedBodies& operator=(SpawnedBodies&&) = default;
+		~SpawnedBodies() = default;
+
+		// Removes every body.
+		void SetCapacity(std::uint32_t capacity);
+		std::uint32_t Capacity() const;
+		std::uint32_t Count() const;
+		std::uint64_t DroppedCount() const;
+
+		// The elements must have a period; the mean anomaly is the one at time zero.
+		SlotHandle Spawn(const SpawnedBody& body);
+		bool Destroy(const SlotHandle& handle);
+		void Clear();
+		// Null once the body is gone.
+		const SpawnedBody* Find(const SlotHandle& handle) const;
+		// The bodies in dense order, the order Evaluate writes them in.
+		const SpawnedBody& BodyAt(std::uint32_t denseIndex) const;
+		// Removes bodies whose expiry is at or before the time, and returns how many.
+		std::uint32_t RemoveExpired(double time);
+
+		void Evaluate(double time);
+		void Evaluate(double time, ThreadPool& threadPool);
+		const std::vector<DirectX::XMFLOAT4>& Instances() const;
+		const std::vector<std::uint32_t>& Parents() const;
+
+		static const std::uint32_t EvaluationGrainSize;
+
+	private:
+		// mMeanAnomaly and mFrequency are in turns, as in AsteroidBelt
+		struct Orbit
+		{
+			SpawnedBody mBody;
+			double mMeanAnomaly;
+			double mFrequency;
+			DirectX::XMFLOAT3 mPeriapsisAxis;
+			DirectX::XMFLOAT3 mSemiLatusAxis;
+		};
+
+		void EvaluateRange(std::uint32_t begin, std::uint32_t end, double time);
+
+		SlotMap<Orbit> mOrbits;
+		std::uint32_t mCapacity;
+		std::uint64_t mDroppedCount;
+		std::vector<DirectX::XMFLOAT4> mInstances;
+		std::vector<std::uint32_t> mParents;
+	};
+}
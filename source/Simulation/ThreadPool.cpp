@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+namespace Simulation
+{
+	ThreadPool::ThreadPool(uint32_t threadCount) :
+		mGeneration(0), mActiveWorkers(0), mShutdown(false), mFunction(nullptr), mContext(nullptr),
+		mBegin(0), mEnd(0), mGrainSize(1), mNextChunk(0), mChunkCount(0)
+	{
+		// the calling thread always takes part, so only the remaining threads are spawned
+		for (uint32_t index = 1; index < threadCount; ++index)
+		{
+			mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			lock_guard<mutex> lock(mMutex);
+			mShutdown = true;
+		}
+		mWorkAvailable.notify_all();
+
+		for (auto& worker : mWorkers)
+		{
+			worker.join();
+		}
+	}
+
+	uint32_t ThreadPool::ThreadCount() const
+	{
+		return static_cast<uint32_t>(mWorkers.size()) + 1;
+	}
+
+	uint32_t ThreadPool::DefaultThreadCount()
+	{
+		uint32_t hardwareThreads = thread::hardware_concurrency();
+		return (hardwareThreads == 0) ? 1 : hardwareThreads;
+	}
+
+	void ThreadPool::Run(uint32_t begin, uint32_t end, uint32_t grainSize, ChunkFunction function, void* context)
+	{
+		assert(grainSize > 0);
+		if (begin >= end)
+		{
+			return;
+		}
+
+		uint32_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+		if (chunkCount == 1 || mWorkers.empty())
+		{
+			function(context, begin, end);
+			return;
+		}
+
+		{
+			lock_guard<mutex> lock(mMutex);
+			mFunction = function;
+			mContext = context;
+			mBegin = begin;
+			mEnd = end;
+			mGrainSize = grainSize;
+			mChunkCount = chunkCount;
+			mNextChunk.store(0, memory_order_relaxed);
+			mActiveWorkers = static_cast<uint32_t>(mWorkers.size());
+			++mGeneration;
+		}
+		mWorkAvailable.notify_all();
+
+		RunChunks();
+
+		unique_lock<mutex> lock(mMutex);
+		mWorkCompleted.wait(lock, [this] { return mActiveWorkers == 0; });
+	}
+
+	void ThreadPool::RunChunks()
+	{
+		for (uint32_t chunk = mNextChunk.fetch_add(1); chunk < mChunkCount; chunk = mNextChunk.fetch_add(1))
+		{
+			uint32_t chunkBegin = mBegin + chunk * mGrainSize;
+			uint32_t chunkEnd = min(mEnd, chunkBegin + mGrainSize);
+			mFunction(mContext, chunkBegin, chunkEnd);
+		}
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		uint64_t generation = 0;
+		while (true)
+		{
+			{
+				unique_lock<mutex> lock(mMutex);
+				mWorkAvailable.wait(lock, [&] { return mShutdown || mGeneration != generation; });
+				if (mShutdown)
+				{
+					return;
+				}
+				generation = mGeneration;
+			}
+
+			RunChunks();
+
+			bool isLastWorker;
+			{
+				lock_guard<mutex> lock(mMutex);
+				isLastWorker = (--mActiveWorkers == 0);
+			}
+			if (isLastWorker)
+			{
+				mWorkCompleted.notify_one();
+			}
+		}
+	}
+}
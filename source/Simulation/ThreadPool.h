@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Simulation
+{
+	// Fixed set of worker threads that execute one data parallel loop at a time. The calling thread works on the loop
+	// alongside the workers and ParallelFor returns once every chunk has completed, so a loop behaves like a plain for
+	// loop with a barrier at the end. Submitting a loop does not allocate.
+	class ThreadPool final
+	{
+	public:
+		explicit ThreadPool(std::uint32_t threadCount = DefaultThreadCount());
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) = delete;
+		ThreadPool& operator=(ThreadPool&&) = delete;
+		~ThreadPool();
+
+		// Number of threads that execute chunks, including the caller of ParallelFor.
+		std::uint32_t ThreadCount() const;
+
+		// Invokes body(chunkBegin, chunkEnd) over [begin, end) split into chunks of grainSize. Chunk boundaries are
+		// begin + k * grainSize, so aligned grains keep SIMD batches and cache lines whole.
+		template <typename Body>
+		void ParallelFor(std::uint32_t begin, std::uint32_t end, std::uint32_t grainSize, Body& body);
+
+		static std::uint32_t DefaultThreadCount();
+
+	private:
+		typedef void (*ChunkFunction)(void* context, std::uint32_t begin, std::uint32_t end);
+
+		template <typename Body>
+		static void InvokeChunk(void* context, std::uint32_t begin, std::uint32_t end);
+
+		void Run(std::uint32_t begin, std::uint32_t end, std::uint32_t grainSize, ChunkFunction function, void* context);
+		void RunChunks();
+		void WorkerLoop();
+
+		std::vector<std::thread> mWorkers;
+		std::mutex mMutex;
+		std::condition_variable mWorkAvailable;
+		std::condition_variable mWorkCompleted;
+		std::uint64_t mGeneration;
+		std::uint32_t mActiveWorkers;
+		bool mShutdown;
+
+		ChunkFunction mFunction;
+		void* mContext;
+		std::uint32_t mBegin;
+		std::uint32_t mEnd;
+		std::uint32_t mGrainSize;
+		std::atomic<std::uint32_t> mNextChunk;
+		std::uint32_t mChunkCount;
+	};
+
+	template <typename Body>
+	void ThreadPool::ParallelFor(std::uint32_t begin, std::uint32_t end, std::uint32_t grainSize, Body& body)
+	{
+		Run(begin, end, grainSize, &InvokeChunk<Body>, &body);
+	}
+
+	template <typename Body>
+	void ThreadPool::InvokeChunk(void* context, std::uint32_t begin, std::uint32_t end)
+	{
+		(*static_cast<Body*>(context))(begin, end);
+	}
+}
@@ -0,0 +1,220 @@
+#include "pch.h"
+#include "TransferPlanner.h"
+#include "BodySystem.h"
+#include "LambertSolver.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t TransferPlanner::RowGrainSize = 4;
+
+	namespace
+	{
+		void SpreadTimes(double begin, double end, uint32_t count, vector<double>& times)
+		{
+			times.resize(count);
+			double spacing = (count > 1) ? (end - begin) / (count - 1) : 0.0;
+			for (uint32_t index = 0; index < count; ++index)
+			{
+				times[index] = begin + spacing * index;
+			}
+		}
+
+		float DeltaV(double x, double y, double z)
+		{
+			return static_cast<float>(sqrt(x * x + y * y + z * z));
+		}
+	}
+
+	TransferPlanner::TransferPlanner(const BodySystem& bodySystem) :
+		mBodySystem(&bodySystem), mQuery(), mCentralBody(BodySystem::InvalidIndex), mGravitationalParameter(0)
+	{
+	}
+
+	PorkchopGrid TransferPlanner::Porkchop(const PorkchopQuery& query)
+	{
+		PorkchopGrid grid;
+		Prepare(query, grid);
+		for (uint32_t row = 0; row < grid.mDepartureCount; ++row)
+		{
+			SolveRow(row, grid);
+		}
+		FindBest(grid);
+		return grid;
+	}
+
+	PorkchopGrid TransferPlanner::Porkchop(const PorkchopQuery& query, ThreadPool& threadPool)
+	{
+		PorkchopGrid grid;
+		Prepare(query, grid);
+		auto solveRows = [this, &grid](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t row = begin; row < end; ++row)
+			{
+				SolveRow(row, grid);
+			}
+		};
+		threadPool.ParallelFor(0, grid.mDepartureCount, RowGrainSize, solveRows);
+		FindBest(grid);
+		return grid;
+	}
+
+	uint32_t TransferPlanner::CentralBody(uint32_t departure, uint32_t arrival) const
+	{
+		for (uint32_t ancestor = mBodySystem->Parent(departure); ancestor != BodySystem::InvalidIndex; ancestor = mBodySystem->Parent(ancestor))
+		{
+			for (uint32_t other = arrival; other != BodySystem::InvalidIndex; other = mBodySystem->Parent(other))
+			{
+				if (other == ancestor)
+				{
+					return ancestor;
+				}
+			}
+		}
+		return BodySystem::InvalidIndex;
+	}
+
+	void TransferPlanner::Prepare(const PorkchopQuery& query, PorkchopGrid& grid)
+	{
+		if (mBodySystem->Mode() != SimulationMode::Kinematic)
+		{
+			throw runtime_error("Transfers can only be planned on scripted orbits");
+		}
+
+		if (query.mDeparture >= mBodySystem->BodyCount() || query.mArrival >= mBodySystem->BodyCount() || query.mDeparture == query.mArrival)
+		{
+			throw runtime_error("Transfers need two different bodies");
+		}
+
+		if (query.mDepartureCount == 0 || query.mArrivalCount == 0 || query.mDepartureEnd < query.mDepartureBegin || query.mArrivalEnd < query.mArrivalBegin)
+		{
+			throw runtime_error("Transfer windows must have times and must not end before they begin");
+		}
+
+		// neither body may be the central one, or it would have no orbit about it
+		uint32_t centralBody = CentralBody(query.mDeparture, query.mArrival);
+		if (centralBody == BodySystem::InvalidIndex || centralBody == query.mArrival || CentralBody(query.mArrival, query.mDeparture) == query.mDeparture)
+		{
+			throw runtime_error("Transfers need two bodies orbiting a common ancestor: " + mBodySystem->Data(query.mDeparture).mName + " and " +
+				mBodySystem->Data(query.mArrival).mName);
+		}
+
+		mQuery = query;
+		mCentralBody = centralBody;
+		mGravitationalParameter = mBodySystem->GravitationalParameter(centralBody);
+
+		grid.mCentralBody = centralBody;
+		grid.mDepartureCount = query.mDepartureCount;
+		grid.mArrivalCount = query.mArrivalCount;
+		SpreadTimes(query.mDepartureBegin, query.mDepartureEnd, query.mDepartureCount, grid.mDepartureTimes);
+		SpreadTimes(query.mArrivalBegin, query.mArrivalEnd, query.mArrivalCount, grid.mArrivalTimes);
+		size_t cellCount = static_cast<size_t>(query.mDepartureCount) * query.mArrivalCount;
+		grid.mDepartureDeltaV.assign(cellCount, numeric_limits<float>::infinity());
+		grid.mArrivalDeltaV.assign(cellCount, numeric_limits<float>::infinity());
+		grid.mBestCell = 0;
+		grid.mSolvedCount = 0;
+
+		EvaluateStates(query.mDeparture, grid.mDepartureTimes, mDepartureStates);
+		EvaluateStates(query.mArrival, grid.mArrivalTimes, mArrivalStates);
+	}
+
+	void TransferPlanner::EvaluateStates(uint32_t body, const vector<double>& times, States& states) const
+	{
+		size_t count = times.size();
+		states.mPositionX.assign(count, 0.0);
+		states.mPositionY.assign(count, 0.0);
+		states.mPositionZ.assign(count, 0.0);
+		states.mVelocityX.assign(count, 0.0);
+		states.mVelocityY.assign(count, 0.0);
+		states.mVelocityZ.assign(count, 0.0);
+
+		// children only inherit translations, so the offsets and velocities up the hierarchy simply add; a paused body
+		// stands still, whatever velocity its orbit has at the time it was frozen
+		const BodyStateStore& store = mBodySystem->States();
+		for (uint32_t orbit = body; orbit != mCentralBody; orbit = store.Parent(orbit))
+		{
+			bool frozen = store.Frozen(orbit);
+			for (size_t index = 0; index < count; ++index)
+			{
+				XMFLOAT3 position;
+				XMFLOAT3 velocity;
+				XMStoreFloat3(&position, store.EvaluateLocalPosition(orbit, times[index]));
+				XMStoreFloat3(&velocity, frozen ? XMVectorZero() : store.EvaluateLocalVelocity(orbit, times[index]));
+				states.mPositionX[index] += position.x;
+				states.mPositionY[index] += position.y;
+				states.mPositionZ[index] += position.z;
+				states.mVelocityX[index] += velocity.x;
+				states.mVelocityY[index] += velocity.y;
+				states.mVelocityZ[index] += velocity.z;
+			}
+		}
+	}
+
+	void TransferPlanner::SolveRow(uint32_t row, PorkchopGrid& grid) const
+	{
+		const uint32_t batchSize = LambertSolver::BatchSize;
+		double departureTime = grid.mDepartureTimes[row];
+		size_t rowOffset = static_cast<size_t>(row) * grid.mArrivalCount;
+		LambertSolver::Batch batch;
+		for (uint32_t lane = 0; lane < batchSize; ++lane)
+		{
+			batch.mDepartureX[lane] = mDepartureStates.mPositionX[row];
+			batch.mDepartureY[lane] = mDepartureStates.mPositionY[row];
+			batch.mDepartureZ[lane] = mDepartureStates.mPositionZ[row];
+		}
+
+		for (uint32_t column = 0; column < grid.mArrivalCount; column += batchSize)
+		{
+			// a short last batch repeats its last cell
+			for (uint32_t lane = 0; lane < batchSize; ++lane)
+			{
+				uint32_t arrival = min(column + lane, grid.mArrivalCount - 1);
+				batch.mArrivalX[lane] = mArrivalStates.mPositionX[arrival];
+				batch.mArrivalY[lane] = mArrivalStates.mPositionY[arrival];
+				batch.mArrivalZ[lane] = mArrivalStates.mPositionZ[arrival];
+				batch.mTimeOfFlight[lane] = grid.mArrivalTimes[arrival] - departureTime;
+			}
+
+			LambertSolver::Solve(batch, mGravitationalParameter, !mQuery.mRetrograde);
+
+			uint32_t laneCount = min(batchSize, grid.mArrivalCount - column);
+			for (uint32_t lane = 0; lane < laneCount; ++lane)
+			{
+				if (!batch.mSolved[lane])
+				{
+					continue;
+				}
+
+				uint32_t arrival = column + lane;
+				grid.mDepartureDeltaV[rowOffset + arrival] = DeltaV(batch.mDepartureVelocityX[lane] - mDepartureStates.mVelocityX[row],
+					batch.mDepartureVelocityY[lane] - mDepartureStates.mVelocityY[row], batch.mDepartureVelocityZ[lane] - mDepartureStates.mVelocityZ[row]);
+				grid.mArrivalDeltaV[rowOffset + arrival] = DeltaV(mArrivalStates.mVelocityX[arrival] - batch.mArrivalVelocityX[lane],
+					mArrivalStates.mVelocityY[arrival] - batch.mArrivalVelocityY[lane], mArrivalStates.mVelocityZ[arrival] - batch.mArrivalVelocityZ[lane]);
+			}
+		}
+	}
+
+	void TransferPlanner::FindBest(PorkchopGrid& grid) const
+	{
+		float best = numeric_limits<float>::infinity();
+		size_t cellCount = grid.mDepartureDeltaV.size();
+		for (size_t cell = 0; cell < cellCount; ++cell)
+		{
+			float total = grid.mDepartureDeltaV[cell] + grid.mArrivalDeltaV[cell];
+			if (total == numeric_limits<float>::infinity())
+			{
+				continue;
+			}
+
+			++grid.mSolvedCount;
+			if (total < best)
+			{
+				best = total;
+				grid.mBestCell = static_cast<uint32_t>(cell);
+			}
+		}
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Simulation
+{
+	class BodySystem;
+	class ThreadPool;
+
+	// Departure and arrival times run evenly over their windows, both ends included; a count of one takes the start.
+	struct PorkchopQuery
+	{
+		std::uint32_t mDeparture;
+		std::uint32_t mArrival;
+		double mDepartureBegin;
+		double mDepartureEnd;
+		std::uint32_t mDepartureCount;
+		double mArrivalBegin;
+		double mArrivalEnd;
+		std::uint32_t mArrivalCount;
+		bool mRetrograde;
+	};
+
+	// Delta-v in world units per simulation second, one row of arrivals per departure time, so a cell is at
+	// departure * mArrivalCount + arrival. mDepartureDeltaV leaves the departure body's orbit and mArrivalDeltaV matches
+	// the arrival body's; both are infinite where the arrival is not after the departure or no transfer was found.
+	// mBestCell has the lowest sum of the two.
+	struct PorkchopGrid
+	{
+		std::uint32_t mCentralBody;
+		std::uint32_t mDepartureCount;
+		std::uint32_t mArrivalCount;
+		std::vector<double> mDepartureTimes;
+		std::vector<double> mArrivalTimes;
+		std::vector<float> mDepartureDeltaV;
+		std::vector<float> mArrivalDeltaV;
+		std::uint32_t mBestCell;
+		std::uint64_t mSolvedCount;
+	};
+
+	// Fills porkchop plots of transfers between two bodies of a BodySystem, one LambertSolver solve per cell under the
+	// gravity of the body both orbit.
+	//
+	// The bodies' states come from the scripted orbits, summed from BodyStateStore::EvaluateLocalPosition and
+	// EvaluateLocalVelocity along the path up to that central body, so a transfer from a moon is planned from where
+	// the moon is rather than its planet. They are evaluated once per departure and once per arrival time, not once per
+	// cell. A body cannot transfer to one of its own ancestors or satellites, and N-body or playback runs are refused:
+	// their trajectories are not closed form.
+	//
+	// Rows are solved LambertSolver::BatchSize cells at a time and spread over the thread pool RowGrainSize rows per
+	// task. Every row only writes its own cells, so the grid is the same on any number of threads.
+	class TransferPlanner final
+	{
+	public:
+		explicit TransferPlanner(const BodySystem& bodySystem);
+		TransferPlanner(const TransferPlanner&) = delete;
+		TransferPlanner& operator=(const TransferPlanner&) = delete;
+		TransferPlanner(TransferPlanner&&) = default;
+		TransferPlanner& operator=(TransferPlanner&&) = default;
+		~TransferPlanner() = default;
+
+		PorkchopGrid Porkchop(const PorkchopQuery& query);
+		PorkchopGrid Porkchop(const PorkchopQuery& query, ThreadPool& threadPool);
+
+		// The nearest common ancestor of the two bodies, or BodySystem::InvalidIndex if they have none.
+		std::uint32_t CentralBody(std::uint32_t departure, std::uint32_t arrival) const;
+
+		static const std::uint32_t RowGrainSize;
+
+	private:
+		// Positions and velocities relative to the central body, in double, structure of arrays.
+		struct States
+		{
+			std::vector<double> mPositionX;
+			std::vector<double> mPositionY;
+			std::vector<double> mPositionZ;
+			std::vector<double> mVelocityX;
+			std::vector<double> mVelocityY;
+			std::vector<double> mVelocityZ;
+		};
+
+		void Prepare(const PorkchopQuery& query, PorkchopGrid& grid);
+		void EvaluateStates(std::uint32_t body, const std::vector<double>& times, States& states) const;
+		void SolveRow(std::uint32_t row, PorkchopGrid& grid) const;
+		void FindBest(PorkchopGrid& grid) const;
+
+		const BodySystem* mBodySystem;
+		PorkchopQuery mQuery;
+		std::uint32_t mCentralBody;
+		double mGravitationalParameter;
+		States mDepartureStates;
+		States mArrivalStates;
+	};
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Simulation
+{
+	// Hands whole values of T from one producer thread to one consumer thread without either ever waiting on the other.
+	// The producer fills Back() and Publish()es it; the consumer Acquire()s the latest published value into Front(). The
+	// three slots are only ever traded by an atomic exchange of the middle one, so the producer always has a slot of its
+	// own to write while the consumer keeps reading the one it holds, and values the consumer was too slow for are
+	// simply overwritten. Slots are reused rather than reallocated, so a T that keeps its capacity when refilled stops
+	// allocating after the first few frames.
+	template <typename T>
+	class TripleBuffer final
+	{
+	public:
+		TripleBuffer() :
+			mBack(0), mMiddle(1), mFront(2)
+		{
+		}
+
+		TripleBuffer(const TripleBuffer&) = delete;
+		TripleBuffer& operator=(const TripleBuffer&) = delete;
+		TripleBuffer(TripleBuffer&&) = delete;
+		TripleBuffer& operator=(TripleBuffer&&) = delete;
+		~TripleBuffer() = default;
+
+		// Producer side.
+		T& Back()
+		{
+			return mSlots[mBack];
+		}
+
+		void Publish()
+		{
+			// release the writes to the back slot, and acquire the consumer's reads of the slot it handed back
+			std::uint32_t previous = mMiddle.exchange(mBack | FreshFlag, std::memory_order_acq_rel);
+			mBack = previous & IndexMask;
+		}
+
+		// Consumer side. Returns false, leaving Front() as it was, when nothing was published since the last Acquire.
+		bool Acquire()
+		{
+			if ((mMiddle.load(std::memory_order_relaxed) & FreshFlag) == 0)
+			{
+				return false;
+			}
+
+			std::uint32_t previous = mMiddle.exchange(mFront, std::memory_order_acq_rel);
+			mFront = previous & IndexMask;
+			return true;
+		}
+
+		T& Front()
+		{
+			return mSlots[mFront];
+		}
+
+		const T& Front() const
+		{
+			return mSlots[mFront];
+		}
+
+	private:
+		static const std::uint32_t IndexMask = 3;
+		static const std::uint32_t FreshFlag = 4;
+
+		std::array<T, 3> mSlots;
+		std::uint32_t mBack;
+		std::atomic<std::uint32_t> mMiddle;
+		std::uint32_t mFront;
+	};
+}
@@ -0,0 +1,473 @@
+#include "pch.h"
+#include "WisdomHolmanIntegrator.h"
+#include "NBodyState.h"
+#include "GravitySolver.h"
+#include "KeplerSolver.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	const uint32_t WisdomHolmanIntegrator::InvalidIndex = numeric_limits<uint32_t>::max();
+	const uint32_t WisdomHolmanIntegrator::MaxKeplerIterations = 16;
+	const float WisdomHolmanIntegrator::MaxKeplerResidual = 1.0e-4f;
+	const uint32_t WisdomHolmanIntegrator::MaxUniversalIterations = 50;
+
+	namespace
+	{
+		inline XMVECTOR LoadBatch(const double* values)
+		{
+			return XMVectorSet(static_cast<float>(values[0]), static_cast<float>(values[1]), static_cast<float>(values[2]), static_cast<float>(values[3]));
+		}
+	}
+
+	WisdomHolmanIntegrator::WisdomHolmanIntegrator(const vector<uint32_t>& parents) :
+		mParents(parents)
+	{
+		SortParentsFirst();
+	}
+
+	void WisdomHolmanIntegrator::Initialize(NBodyState& state, GravitySolver& solver)
+	{
+		if (state.Count() != mParents.size())
+		{
+			throw runtime_error("Wisdom-Holman hierarchy does not match the body count");
+		}
+
+		uint32_t paddedCount = state.PaddedCount();
+		mKeplerParameters.assign(paddedCount, 0.0f);
+		mRelativeX.assign(paddedCount, 0.0);
+		mRelativeY.assign(paddedCount, 0.0);
+		mRelativeZ.assign(paddedCount, 0.0);
+		mRelativeVelocityX.assign(paddedCount, 0.0);
+		mRelativeVelocityY.assign(paddedCount, 0.0);
+		mRelativeVelocityZ.assign(paddedCount, 0.0);
+
+		for (uint32_t index = 0; index < state.Count(); ++index)
+		{
+			XMFLOAT3 bodyPosition = state.Position(index);
+			XMFLOAT3 bodyVelocity = state.Velocity(index);
+			XMVECTOR position = XMLoadFloat3(&bodyPosition);
+			XMVECTOR velocity = XMLoadFloat3(&bodyVelocity);
+			uint32_t parent = mParents[index];
+			if (parent != InvalidIndex)
+			{
+				XMFLOAT3 parentPosition = state.Position(parent);
+				XMFLOAT3 parentVelocity = state.Velocity(parent);
+				position = XMVectorSubtract(position, XMLoadFloat3(&parentPosition));
+				velocity = XMVectorSubtract(velocity, XMLoadFloat3(&parentVelocity));
+				mKeplerParameters[index] = state.GravitationalParameter(parent) + state.GravitationalParameter(index);
+			}
+
+			mRelativeX[index] = XMVectorGetX(position);
+			mRelativeY[index] = XMVectorGetY(position);
+			mRelativeZ[index] = XMVectorGetZ(position);
+			mRelativeVelocityX[index] = XMVectorGetX(velocity);
+			mRelativeVelocityY[index] = XMVectorGetY(velocity);
+			mRelativeVelocityZ[index] = XMVectorGetZ(velocity);
+		}
+
+		solver.ComputeAccelerations(state);
+	}
+
+	void WisdomHolmanIntegrator::Step(NBodyState& state, GravitySolver& solver, double timestep)
+	{
+		float halfStep = static_cast<float>(timestep * 0.5);
+		Kick(state, halfStep);
+		DriftKepler(mRelativeX.data(), mRelativeY.data(), mRelativeZ.data(), mRelativeVelocityX.data(), mRelativeVelocityY.data(),
+			mRelativeVelocityZ.data(), mKeplerParameters.data(), static_cast<uint32_t>(mKeplerParameters.size()), static_cast<float>(timestep));
+		UpdateAbsoluteState(state);
+		solver.ComputeAccelerations(state);
+		Kick(state, halfStep);
+		UpdateAbsoluteState(state);
+	}
+
+	void WisdomHolmanIntegrator::SaveState(vector<double>& values) const
+	{
+		for (const vector<double>* component : { &mRelativeX, &mRelativeY, &mRelativeZ, &mRelativeVelocityX, &mRelativeVelocityY, &mRelativeVelocityZ })
+		{
+			values.insert(values.end(), component->begin(), component->end());
+		}
+	}
+
+	void WisdomHolmanIntegrator::RestoreState(NBodyState& state, const double* values, uint64_t count)
+	{
+		uint32_t paddedCount = state.PaddedCount();
+		if (state.Count() != mParents.size() || count != 6ull * paddedCount)
+		{
+			throw runtime_error("Wisdom-Holman state does not match the body count");
+		}
+
+		mKeplerParameters.assign(paddedCount, 0.0f);
+		for (uint32_t index = 0; index < state.Count(); ++index)
+		{
+			uint32_t parent = mParents[index];
+			if (parent != InvalidIndex)
+			{
+				mKeplerParameters[index] = state.GravitationalParameter(parent) + state.GravitationalParameter(index);
+			}
+		}
+
+		for (vector<double>* component : { &mRelativeX, &mRelativeY, &mRelativeZ, &mRelativeVelocityX, &mRelativeVelocityY, &mRelativeVelocityZ })
+		{
+			component->assign(values, values + paddedCount);
+			values += paddedCount;
+		}
+	}
+
+	void WisdomHolmanIntegrator::Reparent(uint32_t index, uint32_t parent, const NBodyState& state)
+	{
+		if (parent == mParents[index])
+		{
+			return;
+		}
+
+		// absolute coordinates summed up the chains in double, so the body does not move by the float state's rounding
+		auto absolute = [this](uint32_t body, double* position, double* velocity)
+		{
+			position[0] = position[1] = position[2] = 0;
+			velocity[0] = velocity[1] = velocity[2] = 0;
+			for (; body != InvalidIndex; body = mParents[body])
+			{
+				position[0] += mRelativeX[body];
+				position[1] += mRelativeY[body];
+				position[2] += mRelativeZ[body];
+				velocity[0] += mRelativeVelocityX[body];
+				velocity[1] += mRelativeVelocityY[body];
+				velocity[2] += mRelativeVelocityZ[body];
+			}
+		};
+
+		double position[3];
+		double velocity[3];
+		absolute(index, position, velocity);
+		double parentPosition[3] = { 0, 0, 0 };
+		double parentVelocity[3] = { 0, 0, 0 };
+		if (parent != InvalidIndex)
+		{
+			absolute(parent, parentPosition, parentVelocity);
+		}
+
+		uint32_t previousParent = mParents[index];
+		mParents[index] = parent;
+		try
+		{
+			SortParentsFirst();
+		}
+		catch (...)
+		{
+			mParents[index] = previousParent;
+			throw;
+		}
+
+		mRelativeX[index] = position[0] - parentPosition[0];
+		mRelativeY[index] = position[1] - parentPosition[1];
+		mRelativeZ[index] = position[2] - parentPosition[2];
+		mRelativeVelocityX[index] = velocity[0] - parentVelocity[0];
+		mRelativeVelocityY[index] = velocity[1] - parentVelocity[1];
+		mRelativeVelocityZ[index] = velocity[2] - parentVelocity[2];
+		mKeplerParameters[index] = (parent != InvalidIndex) ? state.GravitationalParameter(parent) + state.GravitationalParameter(index) : 0.0f;
+	}
+
+	uint32_t WisdomHolmanIntegrator::Parent(uint32_t index) const
+	{
+		return mParents[index];
+	}
+
+	void WisdomHolmanIntegrator::DriftKepler(double* x, double* y, double* z, double* velocityX, double* velocityY, double* velocityZ,
+		const float* mu, uint32_t paddedCount, float timestep)
+	{
+		assert(paddedCount % NBodyState::BatchSize == 0);
+
+		XMVECTOR zero = XMVectorZero();
+		XMVECTOR one = XMVectorSplatOne();
+		XMVECTOR two = XMVectorReplicate(2.0f);
+		XMVECTOR dt = XMVectorReplicate(timestep);
+		for (uint32_t index = 0; index < paddedCount; index += NBodyState::BatchSize)
+		{
+			XMVECTOR positionX = LoadBatch(&x[index]);
+			XMVECTOR positionY = LoadBatch(&y[index]);
+			XMVECTOR positionZ = LoadBatch(&z[index]);
+			XMVECTOR speedX = LoadBatch(&velocityX[index]);
+			XMVECTOR speedY = LoadBatch(&velocityY[index]);
+			XMVECTOR speedZ = LoadBatch(&velocityZ[index]);
+			XMVECTOR parameter = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mu[index]));
+
+			XMVECTOR radius = XMVectorMultiply(positionX, positionX);
+			radius = XMVectorSqrt(XMVectorMultiplyAdd(positionZ, positionZ, XMVectorMultiplyAdd(positionY, positionY, radius)));
+			XMVECTOR speedSquared = XMVectorMultiply(speedX, speedX);
+			speedSquared = XMVectorMultiplyAdd(speedZ, speedZ, XMVectorMultiplyAdd(speedY, speedY, speedSquared));
+			XMVECTOR radialSpeed = XMVectorMultiply(positionX, speedX);
+			radialSpeed = XMVectorMultiplyAdd(positionZ, speedZ, XMVectorMultiplyAdd(positionY, speedY, radialSpeed));
+
+			// 1 / a from the vis-viva energy; only bound lanes take the vector path, the others are redone below
+			XMVECTOR isBound = XMVectorAndInt(XMVectorGreater(parameter, zero), XMVectorGreater(radius, zero));
+			XMVECTOR safeParameter = XMVectorSelect(one, parameter, isBound);
+			XMVECTOR safeRadius = XMVectorSelect(one, radius, isBound);
+			XMVECTOR inverseSemiMajorAxis = XMVectorSubtract(XMVectorDivide(two, safeRadius), XMVectorDivide(speedSquared, safeParameter));
+			isBound = XMVectorAndInt(isBound, XMVectorGreater(inverseSemiMajorAxis, zero));
+			inverseSemiMajorAxis = XMVectorSelect(one, inverseSemiMajorAxis, isBound);
+
+			// e cos E0 and e sin E0
+			XMVECTOR meanMotion = XMVectorSqrt(XMVectorMultiply(safeParameter, XMVectorMultiply(inverseSemiMajorAxis, XMVectorMultiply(inverseSemiMajorAxis, inverseSemiMajorAxis))));
+			XMVECTOR cosineTerm = XMVectorNegativeMultiplySubtract(safeRadius, inverseSemiMajorAxis, one);
+			XMVECTOR sineTerm = XMVectorMultiply(radialSpeed, XMVectorSqrt(XMVectorDivide(inverseSemiMajorAxis, safeParameter)));
+			XMVECTOR eccentricity = XMVectorSqrt(XMVectorMultiplyAdd(cosineTerm, cosineTerm, XMVectorMultiply(sineTerm, sineTerm)));
+			isBound = XMVectorAndInt(isBound, XMVectorLess(eccentricity, one));
+			eccentricity = XMVectorSelect(zero, eccentricity, isBound);
+
+			// Newton on the change of eccentric anomaly dE - e cos E0 sin dE + e sin E0 (1 - cos dE) = n dt, solved for dE
+			// itself rather than as a difference of anomalies so short steps of slow orbits keep their precision; sin and
+			// 1 - cos come from the half angle for the same reason
+			XMVECTOR meanAnomaly = XMVectorModAngles(XMVectorMultiply(meanMotion, dt));
+			XMVECTOR delta = meanAnomaly;
+			XMVECTOR sine = zero;
+			XMVECTOR oneMinusCosine = zero;
+			XMVECTOR residual = zero;
+			for (uint32_t iteration = 0; iteration < MaxKeplerIterations; ++iteration)
+			{
+				XMVECTOR halfSine;
+				XMVECTOR halfCosine;
+				XMVectorSinCos(&halfSine, &halfCosine, XMVectorScale(delta, 0.5f));
+				sine = XMVectorScale(XMVectorMultiply(halfSine, halfCosine), 2.0f);
+				oneMinusCosine = XMVectorScale(XMVectorMultiply(halfSine, halfSine), 2.0f);
+
+				residual = XMVectorSubtract(XMVectorMultiplyAdd(sineTerm, oneMinusCosine, XMVectorNegativeMultiplySubtract(cosineTerm, sine, delta)), meanAnomaly);
+				XMVECTOR slope = XMVectorMultiplyAdd(sineTerm, sine, XMVectorNegativeMultiplySubtract(cosineTerm, XMVectorSubtract(one, oneMinusCosine), one));
+				XMVECTOR step = XMVectorDivide(residual, slope);
+				delta = XMVectorSubtract(delta, step);
+				if (XMVector4LessOrEqual(XMVectorAbs(step), XMVectorScale(XMVectorMax(XMVectorAbs(delta), one), KeplerSolver::Tolerance)))
+				{
+					break;
+				}
+			}
+
+			// lanes Newton could not settle are redone below too
+			isBound = XMVectorAndInt(isBound, XMVectorLessOrEqual(XMVectorAbs(residual), XMVectorReplicate(MaxKeplerResidual)));
+
+			XMVECTOR halfSine;
+			XMVECTOR halfCosine;
+			XMVectorSinCos(&halfSine, &halfCosine, XMVectorScale(delta, 0.5f));
+			sine = XMVectorScale(XMVectorMultiply(halfSine, halfCosine), 2.0f);
+			oneMinusCosine = XMVectorScale(XMVectorMultiply(halfSine, halfSine), 2.0f);
+
+			// Danby's f and g functions as increments, f - 1, g, f' and g' - 1, which stay accurate in single precision when
+			// added to the double precision state; g = (r0 / a sin dE + e sin E0 (1 - cos dE)) / n needs no elapsed anomaly
+			XMVECTOR semiMajorAxis = XMVectorReciprocal(inverseSemiMajorAxis);
+			XMVECTOR newRadius = XMVectorMultiply(semiMajorAxis, XMVectorAdd(XMVectorSubtract(one, cosineTerm),
+				XMVectorAdd(XMVectorMultiply(cosineTerm, oneMinusCosine), XMVectorMultiply(sineTerm, sine))));
+			XMVECTOR fMinusOne = XMVectorNegate(XMVectorDivide(XMVectorMultiply(semiMajorAxis, oneMinusCosine), safeRadius));
+			XMVECTOR g = XMVectorDivide(XMVectorMultiplyAdd(XMVectorMultiply(safeRadius, inverseSemiMajorAxis), sine, XMVectorMultiply(sineTerm, oneMinusCosine)), meanMotion);
+			XMVECTOR fDot = XMVectorNegate(XMVectorDivide(XMVectorMultiply(XMVectorMultiply(semiMajorAxis, semiMajorAxis), XMVectorMultiply(meanMotion, sine)),
+				XMVectorMultiply(newRadius, safeRadius)));
+			XMVECTOR gDotMinusOne = XMVectorNegate(XMVectorDivide(XMVectorMultiply(semiMajorAxis, oneMinusCosine), newRadius));
+
+			XMFLOAT4A increments[7];
+			XMStoreFloat4A(&increments[0], XMVectorMultiplyAdd(fMinusOne, positionX, XMVectorMultiply(g, speedX)));
+			XMStoreFloat4A(&increments[1], XMVectorMultiplyAdd(fMinusOne, positionY, XMVectorMultiply(g, speedY)));
+			XMStoreFloat4A(&increments[2], XMVectorMultiplyAdd(fMinusOne, positionZ, XMVectorMultiply(g, speedZ)));
+			XMStoreFloat4A(&increments[3], XMVectorMultiplyAdd(fDot, positionX, XMVectorMultiply(gDotMinusOne, speedX)));
+			XMStoreFloat4A(&increments[4], XMVectorMultiplyAdd(fDot, positionY, XMVectorMultiply(gDotMinusOne, speedY)));
+			XMStoreFloat4A(&increments[5], XMVectorMultiplyAdd(fDot, positionZ, XMVectorMultiply(gDotMinusOne, speedZ)));
+			XMStoreFloat4A(&increments[6], isBound);
+
+			const uint32_t* lanesBound = reinterpret_cast<const uint32_t*>(&increments[6].x);
+			for (uint32_t lane = 0; lane < NBodyState::BatchSize; ++lane)
+			{
+				uint32_t body = index + lane;
+				if (lanesBound[lane] != 0)
+				{
+					x[body] += (&increments[0].x)[lane];
+					y[body] += (&increments[1].x)[lane];
+					z[body] += (&increments[2].x)[lane];
+					velocityX[body] += (&increments[3].x)[lane];
+					velocityY[body] += (&increments[4].x)[lane];
+					velocityZ[body] += (&increments[5].x)[lane];
+				}
+				else
+				{
+					DriftUniversal(x[body], y[body], z[body], velocityX[body], velocityY[body], velocityZ[body], mu[body], timestep);
+				}
+			}
+		}
+	}
+
+	void WisdomHolmanIntegrator::DriftUniversal(double& x, double& y, double& z, double& velocityX, double& velocityY, double& velocityZ, float mu, float timestep)
+	{
+		double radius = sqrt(x * x + y * y + z * z);
+		if (mu <= 0.0f || radius <= 0)
+		{
+			x += velocityX * timestep;
+			y += velocityY * timestep;
+			z += velocityZ * timestep;
+			return;
+		}
+
+		double rootMu = sqrt(static_cast<double>(mu));
+		double speedSquared = velocityX * velocityX + velocityY * velocityY + velocityZ * velocityZ;
+		double radialSpeed = (x * velocityX + y * velocityY + z * velocityZ) / rootMu;
+		double alpha = 2.0 / radius - speedSquared / mu;
+
+		// Newton on the universal anomaly chi, with the Stumpff functions c2 and c3 of psi = alpha chi^2
+		double chi = rootMu * timestep / radius;
+		double c2 = 0.5;
+		double c3 = 1.0 / 6.0;
+		double newRadius = radius;
+		for (uint32_t iteration = 0; iteration < MaxUniversalIterations; ++iteration)
+		{
+			double psi = alpha * chi * chi;
+			if (psi > 1.0e-6)
+			{
+				double root = sqrt(psi);
+				c2 = (1.0 - cos(root)) / psi;
+				c3 = (root - sin(root)) / (psi * root);
+			}
+			else if (psi < -1.0e-6)
+			{
+				double root = sqrt(-psi);
+				c2 = (1.0 - cosh(root)) / psi;
+				c3 = (sinh(root) - root) / (-psi * root);
+			}
+			else
+			{
+				c2 = 0.5 - psi / 24.0;
+				c3 = 1.0 / 6.0 - psi / 120.0;
+			}
+
+			double chiSquared = chi * chi;
+			double elapsed = chiSquared * chi * c3 + radialSpeed * chiSquared * c2 + radius * chi * (1.0 - psi * c3);
+			newRadius = chiSquared * c2 + radialSpeed * chi * (1.0 - psi * c3) + radius * (1.0 - psi * c2);
+			double step = (rootMu * timestep - elapsed) / newRadius;
+			chi += step;
+			if (fabs(step) <= 1.0e-12 * max(fabs(chi), 1.0))
+			{
+				break;
+			}
+		}
+
+		double chiSquared = chi * chi;
+		double psi = alpha * chiSquared;
+		double f = 1.0 - chiSquared * c2 / radius;
+		double g = timestep - chiSquared * chi * c3 / rootMu;
+		double fDot = rootMu * chi * (psi * c3 - 1.0) / (newRadius * radius);
+		double gDot = 1.0 - chiSquared * c2 / newRadius;
+
+		double positionX = f * x + g * velocityX;
+		double positionY = f * y + g * velocityY;
+		double positionZ = f * z + g * velocityZ;
+		velocityX = fDot * x + gDot * velocityX;
+		velocityY = fDot * y + gDot * velocityY;
+		velocityZ = fDot * z + gDot * velocityZ;
+		x = positionX;
+		y = positionY;
+		z = positionZ;
+	}
+
+	void WisdomHolmanIntegrator::SortParentsFirst()
+	{
+		uint32_t count = static_cast<uint32_t>(mParents.size());
+		vector<uint32_t> childStarts(count + 1, 0);
+		for (uint32_t index = 0; index < count; ++index)
+		{
+			if (mParents[index] != InvalidIndex)
+			{
+				if (mParents[index] >= count)
+				{
+					throw runtime_error("Wisdom-Holman parent out of range");
+				}
+				++childStarts[mParents[index] + 1];
+			}
+		}
+		for (uint32_t index = 0; index < count; ++index)
+		{
+			childStarts[index + 1] += childStarts[index];
+		}
+
+		vector<uint32_t> children(childStarts[count]);
+		vector<uint32_t> cursors(childStarts.begin(), childStarts.end() - 1);
+		mOrder.clear();
+		mOrder.reserve(count);
+		for (uint32_t index = 0; index < count; ++index)
+		{
+			if (mParents[index] == InvalidIndex)
+			{
+				mOrder.push_back(index);
+			}
+			else
+			{
+				children[cursors[mParents[index]]++] = index;
+			}
+		}
+
+		// breadth first from the roots; a body on a cycle is never reached
+		for (size_t next = 0; next < mOrder.size(); ++next)
+		{
+			uint32_t body = mOrder[next];
+			mOrder.insert(mOrder.end(), children.begin() + childStarts[body], children.begin() + childStarts[body + 1]);
+		}
+		if (mOrder.size() != count)
+		{
+			throw runtime_error("Wisdom-Holman parents must not form a cycle");
+		}
+	}
+
+	void WisdomHolmanIntegrator::Kick(const NBodyState& state, float timestep)
+	{
+		const float* accelerationX = state.AccelerationX();
+		const float* accelerationY = state.AccelerationY();
+		const float* accelerationZ = state.AccelerationZ();
+		for (uint32_t index = 0; index < state.Count(); ++index)
+		{
+			XMVECTOR acceleration = XMVectorSet(accelerationX[index], accelerationY[index], accelerationZ[index], 0.0f);
+			uint32_t parent = mParents[index];
+			if (parent != InvalidIndex)
+			{
+				// the relative acceleration minus the central term -mu r / |r|^3 that the drift integrates exactly
+				XMVECTOR position = XMVectorSet(static_cast<float>(mRelativeX[index]), static_cast<float>(mRelativeY[index]), static_cast<float>(mRelativeZ[index]), 0.0f);
+				XMVECTOR inverseRadius = XMVectorReciprocalSqrt(XMVector3LengthSq(position));
+				XMVECTOR strength = XMVectorScale(XMVectorMultiply(XMVectorMultiply(inverseRadius, inverseRadius), inverseRadius), mKeplerParameters[index]);
+				acceleration = XMVectorSubtract(acceleration, XMVectorSet(accelerationX[parent], accelerationY[parent], accelerationZ[parent], 0.0f));
+				acceleration = XMVectorMultiplyAdd(strength, position, acceleration);
+			}
+
+			mRelativeVelocityX[index] += XMVectorGetX(acceleration) * timestep;
+			mRelativeVelocityY[index] += XMVectorGetY(acceleration) * timestep;
+			mRelativeVelocityZ[index] += XMVectorGetZ(acceleration) * timestep;
+		}
+	}
+
+	void WisdomHolmanIntegrator::UpdateAbsoluteState(NBodyState& state) const
+	{
+		float* positionX = state.PositionX();
+		float* positionY = state.PositionY();
+		float* positionZ = state.PositionZ();
+		float* velocityX = state.VelocityX();
+		float* velocityY = state.VelocityY();
+		float* velocityZ = state.VelocityZ();
+
+		// the order puts parents before their children, so each parent is already absolute
+		for (uint32_t index : mOrder)
+		{
+			double parentPosition[3] = { 0, 0, 0 };
+			double parentVelocity[3] = { 0, 0, 0 };
+			uint32_t parent = mParents[index];
+			if (parent != InvalidIndex)
+			{
+				parentPosition[0] = positionX[parent];
+				parentPosition[1] = positionY[parent];
+				parentPosition[2] = positionZ[parent];
+				parentVelocity[0] = velocityX[parent];
+				parentVelocity[1] = velocityY[parent];
+				parentVelocity[2] = velocityZ[parent];
+			}
+
+			positionX[index] = static_cast<float>(mRelativeX[index] + parentPosition[0]);
+			positionY[index] = static_cast<float>(mRelativeY[index] + parentPosition[1]);
+			positionZ[index] = static_cast<float>(mRelativeZ[index] + parentPosition[2]);
+			velocityX[index] = static_cast<float>(mRelativeVelocityX[index] + parentVelocity[0]);
+			velocityY[index] = static_cast<float>(mRelativeVelocityY[index] + parentVelocity[1]);
+			velocityZ[index] = static_cast<float>(mRelativeVelocityZ[index] + parentVelocity[2]);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Integrator.h"
+
+namespace Simulation
+{
+	// Wisdom-Holman mixed variable integrator for hierarchical systems. Every body is advanced relative to its parent: the
+	// drift moves each relative orbit exactly along its two-body conic about GM_parent + GM_body, and the kicks apply only
+	// what is left of the relative acceleration, a_body - a_parent plus the Kepler term the drift already accounts for.
+	// The dominant central force is integrated exactly, so the timestep only has to follow how fast the perturbations
+	// change and the energy error scales with the perturbations rather than the central body. Roots drift in straight
+	// lines and are kicked by their full acceleration.
+	//
+	// Kick-drift-kick is symmetric and time reversible, so the energy error oscillates instead of growing. Parent relative
+	// velocities are not the canonical momenta of a heliocentric split, so the map is not strictly symplectic, but it needs
+	// no coordinate transform and follows moons of planets the way the catalog nests them.
+	//
+	// Reparent rebases a body on another parent where it is, so that its relative coordinates stay small as it wanders
+	// from one Hill sphere to another; the parents may then come in any order, and the absolute state is rebuilt
+	// parents first along a breadth first order kept for the purpose.
+	class WisdomHolmanIntegrator final : public Integrator
+	{
+	public:
+		// parents[i] is the body that body i orbits, or InvalidIndex for a root; the parents must not form a cycle.
+		explicit WisdomHolmanIntegrator(const std::vector<std::uint32_t>& parents);
+		WisdomHolmanIntegrator(const WisdomHolmanIntegrator&) = delete;
+		WisdomHolmanIntegrator& operator=(const WisdomHolmanIntegrator&) = delete;
+		WisdomHolmanIntegrator(WisdomHolmanIntegrator&&) = delete;
+		WisdomHolmanIntegrator& operator=(WisdomHolmanIntegrator&&) = delete;
+		~WisdomHolmanIntegrator() = default;
+
+		void Initialize(NBodyState& state, GravitySolver& solver) override;
+		void Step(NBodyState& state, GravitySolver& solver, double timestep) override;
+		void Reparent(std::uint32_t index, std::uint32_t parent, const NBodyState& state) override;
+		// The double precision relative coordinates, which the float state cannot give back.
+		void SaveState(std::vector<double>& values) const override;
+		void RestoreState(NBodyState& state, const double* values, std::uint64_t count) override;
+		std::uint32_t Parent(std::uint32_t index) const;
+
+		// Advances paddedCount two-body orbits, given as positions and velocities relative to the attracting body with
+		// gravitational parameters mu, by timestep. Bound orbits go BatchSize at a time through Danby's f and g functions
+		// in eccentric anomaly; unbound lanes fall back to universal variables, and lanes with mu = 0 move in a straight
+		// line. The state is double precision: each step only adds a small increment to it, so the single precision
+		// kernel's rounding scales with the distance moved rather than the orbit.
+		static void DriftKepler(double* x, double* y, double* z, double* velocityX, double* velocityY, double* velocityZ,
+			const float* mu, std::uint32_t paddedCount, float timestep);
+
+		static const std::uint32_t InvalidIndex;
+		static const std::uint32_t MaxKeplerIterations;
+		static const float MaxKeplerResidual;
+		static const std::uint32_t MaxUniversalIterations;
+
+	private:
+		static void DriftUniversal(double& x, double& y, double& z, double& velocityX, double& velocityY, double& velocityZ, float mu, float timestep);
+
+		void SortParentsFirst();
+		void Kick(const NBodyState& state, float timestep);
+		void UpdateAbsoluteState(NBodyState& state) const;
+
+		std::vector<std::uint32_t> mParents;
+		std::vector<std::uint32_t> mOrder;
+		std::vector<float> mKeplerParameters;
+		std::vector<double> mRelativeX;
+		std::vector<double> mRelativeY;
+		std::vector<double> mRelativeZ;
+		std::vector<double> mRelativeVelocityX;
+		std::vector<double> mRelativeVelocityY;
+		std::vector<double> mRelativeVelocityZ;
+	};
+}
@@ -0,0 +1,190 @@
+#include "pch.h"
+#include "WorkerProcess.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+using namespace std;
+using namespace DirectX;
+
+namespace Simulation
+{
+	WorkerProcess::WorkerProcess(const string& executable, const vector<string>& arguments) :
+		mProcessHandle(nullptr), mProcessId(0), mExited(false), mExitCode(0)
+	{
+#if defined(_WIN32)
+		// each argument quoted; none of ours contain quotes or trailing backslashes
+		string commandLine = "\"" + executable + "\"";
+		for (const string& argument : arguments)
+		{
+			commandLine += " \"" + argument + "\"";
+		}
+
+		STARTUPINFOA startupInfo = {};
+		startupInfo.cb = sizeof(startupInfo);
+		PROCESS_INFORMATION processInfo = {};
+		if (!CreateProcessA(executable.c_str(), &commandLine[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo))
+		{
+			throw runtime_error("Could not start process: " + executable);
+		}
+		CloseHandle(processInfo.hThread);
+		mProcessHandle = processInfo.hProcess;
+		mProcessId = processInfo.dwProcessId;
+#else
+		vector<char*> argv;
+		argv.push_back(const_cast<char*>(executable.c_str()));
+		for (const string& argument : arguments)
+		{
+			argv.push_back(const_cast<char*>(argument.c_str()));
+		}
+		argv.push_back(nullptr);
+
+		pid_t processId = 0;
+		if (posix_spawn(&processId, executable.c_str(), nullptr, nullptr, argv.data(), environ) != 0)
+		{
+			throw runtime_error("Could not start process: " + executable);
+		}
+		mProcessId = processId;
+#endif
+	}
+
+	WorkerProcess::~WorkerProcess()
+	{
+		if (!mExited)
+		{
+			Terminate();
+		}
+#if defined(_WIN32)
+		if (mProcessHandle != nullptr)
+		{
+			CloseHandle(mProcessHandle);
+		}
+#endif
+	}
+
+	bool WorkerProcess::TryWait(int& exitCode)
+	{
+		if (!mExited)
+		{
+#if defined(_WIN32)
+			DWORD code = 0;
+			if (WaitForSingleObject(mProcessHandle, 0) != WAIT_OBJECT_0 || !GetExitCodeProcess(mProcessHandle, &code))
+			{
+				return false;
+			}
+			mExitCode = static_cast<int>(code);
+#else
+			int status = 0;
+			pid_t result = waitpid(static_cast<pid_t>(mProcessId), &status, WNOHANG);
+			if (result == 0 || (result < 0 && errno == EINTR))
+			{
+				return false;
+			}
+			// a child killed by a signal, or one we could not wait for, counts as failed
+			mExitCode = (result > 0 && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+#endif
+			mExited = true;
+		}
+
+		exitCode = mExitCode;
+		return true;
+	}
+
+	int WorkerProcess::Wait()
+	{
+		if (!mExited)
+		{
+#if defined(_WIN32)
+			WaitForSingleObject(mProcessHandle, INFINITE);
+#else
+			int status = 0;
+			pid_t result;
+			do
+			{
+				result = waitpid(static_cast<pid_t>(mProcessId), &status, 0);
+			} while (result < 0 && errno == EINTR);
+			mExitCode = (result > 0 && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+			mExited = true;
+#endif
+		}
+
+		int exitCode = 0;
+		TryWait(exitCode);
+		return exitCode;
+	}
+
+	string WorkerProcess::CurrentExecutable()
+	{
+#if defined(_WIN32)
+		vector<char> path(MAX_PATH);
+		for (;;)
+		{
+			DWORD length = GetModuleFileNameA(nullptr, path.data(), static_cast<DWORD>(path.size()));
+			if (length == 0)
+			{
+				throw runtime_error("Could not find the running executable");
+			}
+			if (length < path.size())
+			{
+				return string(path.data(), length);
+			}
+			path.resize(path.size() * 2);
+		}
+#else
+		vector<char> path(256);
+		for (;;)
+		{
+			ssize_t length = readlink("/proc/self/exe", path.data(), path.size());
+			if (length < 0)
+			{
+				throw runtime_error("Could not find the running executable");
+			}
+			if (static_cast<size_t>(length) < path.size())
+			{
+				return string(path.data(), static_cast<size_t>(length));
+			}
+			path.resize(path.size() * 2);
+		}
+#endif
+	}
+
+	uint32_t WorkerProcess::CurrentProcessId()
+	{
+#if defined(_WIN32)
+		return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+		return static_cast<uint32_t>(getpid());
+#endif
+	}
+
+	void WorkerProcess::Terminate()
+	{
+#if defined(_WIN32)
+		TerminateProcess(mProcessHandle, 1);
+		WaitForSingleObject(mProcessHandle, INFINITE);
+#else
+		kill(static_cast<pid_t>(mProcessId), SIGKILL);
+		int status = 0;
+		while (waitpid(static_cast<pid_t>(mProcessId), &status, 0) < 0 && errno == EINTR)
+		{
+		}
+#endif
+		mExited = true;
+		mExitCode = -1;
+	}
+}
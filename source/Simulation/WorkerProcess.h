@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Simulation
+{
+	// A child process running an executable with a list of arguments, started by CreateProcess on Windows and
+	// posix_spawn elsewhere, for work split across processes rather than threads. TryWait polls for its exit without
+	// blocking, so a parent watching several children notices the first one to fail. A child still running when its
+	// WorkerProcess is destroyed is killed, so an exception in the parent never leaves workers behind.
+	class WorkerProcess final
+	{
+	public:
+		WorkerProcess(const std::string& executable, const std::vector<std::string>& arguments);
+		WorkerProcess(const WorkerProcess&) = delete;
+		WorkerProcess& operator=(const WorkerProcess&) = delete;
+		WorkerProcess(WorkerProcess&&) = delete;
+		WorkerProcess& operator=(WorkerProcess&&) = delete;
+		~WorkerProcess();
+
+		// True once the process has exited, with its exit code.
+		bool TryWait(int& exitCode);
+		int Wait();
+
+		// The running executable, so a program can start copies of itself as workers.
+		static std::string CurrentExecutable();
+		static std::uint32_t CurrentProcessId();
+
+	private:
+		void Terminate();
+
+		void* mProcessHandle;
+		std::int64_t mProcessId;
+		bool mExited;
+		int mExitCode;
+	};
+}
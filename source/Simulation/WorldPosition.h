@@ -0,0 +1,13 @@
+#pragma once
+
+namespace Simulation
+{
+	// A point in world units held in double precision, for positions that have to stay exact far from the world origin
+	// where a float would already have lost the detail a camera up close can see.
+	struct WorldPosition
+	{
+		double mX;
+		double mY;
+		double mZ;
+	};
+}
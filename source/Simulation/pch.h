@@ -0,0 +1,77 @@
+#pragma once
+
+// Standard
+#include <exception>
+#include <stdexcept>
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <regex>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+#include <array>
+
+// DirectX
+#include <DirectXMath.h>
+
+// Local
+#include "CeledtialBodyData.h"
+#include "BeltData.h"
+#include "EmitterData.h"
+#include "ConfigData.h"
+#include "ThreadPool.h"
+#include "FixedTimestep.h"
+#include "OrbitalElements.h"
+#include "KeplerSolver.h"
+#include "NBodyState.h"
+#include "GravitySolver.h"
+#include "DirectSummation.h"
+#include "BarnesHut.h"
+#include "Integrator.h"
+#include "LeapfrogIntegrator.h"
+#include "WisdomHolmanIntegrator.h"
+#include "BlockTimestepIntegrator.h"
+#include "MappedFile.h"
+#include "Ephemeris.h"
+#include "EphemerisBuilder.h"
+#include "WorldPosition.h"
+#include "BodyStateStore.h"
+#include "AsteroidBelt.h"
+#include "ParticleSystem.h"
+#include "SlotMap.h"
+#include "SpawnedBodies.h"
+#include "ConicPropagator.h"
+#include "SpacecraftFleet.h"
+#include "HillSphereIndex.h"
+#include "LambertSolver.h"
+#include "TransferPlanner.h"
+#include "TripleBuffer.h"
+#include "FrameFence.h"
+#include "RenderTransforms.h"
+#include "BodySnapshot.h"
+#include "BodySystem.h"
+#include "SimulationThread.h"
+#include "EventFinder.h"
+#include "DetailScheduler.h"
+#include "SharedMemory.h"
+#include "SharedRingBuffer.h"
+#include "WorkerProcess.h"
+#include "ShardedGravity.h"
+#include "GravityShard.h"
+#include "Checkpoint.h"
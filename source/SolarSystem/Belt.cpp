@@ -0,0 +1,151 @@
+#include "pch.h"
+
+using namespace DirectX;
+using namespace Library;
+
+namespace Rendering
+{
+	RTTI_DEFINITIONS(Belt)
+
+	const XMFLOAT4 Belt::DefaultColor = XMFLOAT4(0.6f, 0.55f, 0.5f, 1.0f);
+	const std::uint32_t Belt::IndexCount = 24;
+
+	Belt::Belt(Game& game, const std::shared_ptr<Camera>& camera, const Simulation::BodySnapshot& snapshot, std::uint32_t beltIndex,
+		const Simulation::SlotMap<CelestialBody>& bodies, const Simulation::SlotHandle& parentBody, CelestialLight& light) :
+		DrawableGameComponent(game, camera), mVertexShader(nullptr), mPixelShader(nullptr), mInputLayout(nullptr), mVertexBuffer(nullptr),
+		mIndexBuffer(nullptr), mInstanceBuffer(nullptr), mVertexCBufferPerObject(nullptr), mVertexCBufferPerObjectData(), mSnapshot(snapshot),
+		mBeltIndex(beltIndex), mCount(0), mBodies(bodies), mParentBody(parentBody), mLight(light)
+	{
+	}
+
+	void Belt::Initialize()
+	{
+		// Load a compiled vertex shader
+		std::vector<char> compiledVertexShader;
+		Utility::LoadBinaryFile(L"Content\\Shaders\\AsteroidBeltVS.cso", compiledVertexShader);
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateVertexShader(&compiledVertexShader[0], compiledVertexShader.size(), nullptr, mVertexShader.GetAddressOf()),
+			"ID3D11Device::CreatedVertexShader() failed.");
+
+		// Load a compiled pixel shader
+		std::vector<char> compiledPixelShader;
+		Utility::LoadBinaryFile(L"Content\\Shaders\\AsteroidBeltPS.cso", compiledPixelShader);
+		ThrowIfFailed(mGame->Direct3DDevice()->CreatePixelShader(&compiledPixelShader[0], compiledPixelShader.size(), nullptr, mPixelShader.GetAddressOf()),
+			"ID3D11Device::CreatedPixelShader() failed.");
+
+		// Create an input layout; the second slot steps once per asteroid
+		D3D11_INPUT_ELEMENT_DESC inputElementDescriptions[] =
+		{
+			{"POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+			{"INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1}
+		};
+
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateInputLayout(inputElementDescriptions, ARRAYSIZE(inputElementDescriptions), &compiledVertexShader[0],
+			compiledVertexShader.size(), mInputLayout.GetAddressOf()), "ID3D11Device::CreateInputLayout() failed.");
+
+		// A unit-diameter octahedron, which the instance scales by the asteroid's diameter
+		VertexPosition vertices[] =
+		{
+			VertexPosition(XMFLOAT4(0.5f, 0.0f, 0.0f, 1.0f)),
+			VertexPosition(XMFLOAT4(-0.5f, 0.0f, 0.0f, 1.0f)),
+			VertexPosition(XMFLOAT4(0.0f, 0.5f, 0.0f, 1.0f)),
+			VertexPosition(XMFLOAT4(0.0f, -0.5f, 0.0f, 1.0f)),
+			VertexPosition(XMFLOAT4(0.0f, 0.0f, 0.5f, 1.0f)),
+			VertexPosition(XMFLOAT4(0.0f, 0.0f, -0.5f, 1.0f))
+		};
+
+		UINT indices[] =
+		{
+			2, 4, 0,
+			2, 1, 4,
+			2, 5, 1,
+			2, 0, 5,
+			3, 0, 4,
+			3, 4, 1,
+			3, 1, 5,
+			3, 5, 0
+		};
+		assert(ARRAYSIZE(indices) == IndexCount);
+
+		D3D11_BUFFER_DESC vertexBufferDesc = {0};
+		vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		vertexBufferDesc.ByteWidth = sizeof(vertices);
+		vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA vertexSubResourceData = {0};
+		vertexSubResourceData.pSysMem = vertices;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexSubResourceData, mVertexBuffer.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+
+		D3D11_BUFFER_DESC indexBufferDesc = {0};
+		indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		indexBufferDesc.ByteWidth = sizeof(indices);
+		indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA indexSubResourceData = {0};
+		indexSubResourceData.pSysMem = indices;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&indexBufferDesc, &indexSubResourceData, mIndexBuffer.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+
+		// The instance buffer is rewritten whole every frame the belt moves
+		D3D11_BUFFER_DESC instanceBufferDesc = {0};
+		instanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		// a belt never changes size once generated
+		mCount = static_cast<std::uint32_t>(mSnapshot.mBeltInstances[mBeltIndex].size());
+		instanceBufferDesc.ByteWidth = static_cast<UINT>(sizeof(XMFLOAT4) * mCount);
+		instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&instanceBufferDesc, nullptr, mInstanceBuffer.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+		UpdateInstances();
+
+		// Create constant buffers
+		D3D11_BUFFER_DESC constantBufferDesc = {0};
+		constantBufferDesc.ByteWidth = sizeof(VertexCBufferPerObject);
+		constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, mVertexCBufferPerObject.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+	}
+
+	void Belt::Update(const GameTime&)
+	{
+		UpdateInstances();
+	}
+
+	void Belt::UpdateInstances()
+	{
+		const auto& instances = mSnapshot.mBeltInstances[mBeltIndex];
+		ID3D11DeviceContext* direct3DDeviceContext = mGame->Direct3DDeviceContext();
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		ThrowIfFailed(direct3DDeviceContext->Map(mInstanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource), "ID3D11DeviceContext::Map() failed.");
+		memcpy(mappedResource.pData, &instances[0], sizeof(XMFLOAT4) * instances.size());
+		direct3DDeviceContext->Unmap(mInstanceBuffer.Get(), 0);
+	}
+
+	void Belt::Draw(const GameTime&)
+	{
+		ID3D11DeviceContext* direct3DDeviceContext = mGame->Direct3DDeviceContext();
+		direct3DDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		direct3DDeviceContext->IASetInputLayout(mInputLayout.Get());
+
+		ID3D11Buffer* vertexBuffers[] = {mVertexBuffer.Get(), mInstanceBuffer.Get()};
+		UINT strides[] = {sizeof(VertexPosition), sizeof(XMFLOAT4)};
+		UINT offsets[] = {0, 0};
+		direct3DDeviceContext->IASetVertexBuffers(0, ARRAYSIZE(vertexBuffers), vertexBuffers, strides, offsets);
+		direct3DDeviceContext->IASetIndexBuffer(mIndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+
+		direct3DDeviceContext->VSSetShader(mVertexShader.Get(), nullptr, 0);
+		direct3DDeviceContext->PSSetShader(mPixelShader.Get(), nullptr, 0);
+
+		// instances are relative to the parent, which is placed here rather than per asteroid
+		XMStoreFloat4x4(&mVertexCBufferPerObjectData.ViewProjection, XMMatrixTranspose(mCamera->ViewProjectionMatrix()));
+		const XMFLOAT4X4& parentTransform = mBodies[mParentBody].WorldTransform();
+		mVertexCBufferPerObjectData.Origin = XMFLOAT3(parentTransform._41, parentTransform._42, parentTransform._43);
+		mVertexCBufferPerObjectData.LightPosition = mLight.Position();
+		mVertexCBufferPerObjectData.Color = DefaultColor;
+
+		direct3DDeviceContext->UpdateSubresource(mVertexCBufferPerObject.Get(), 0, nullptr, &mVertexCBufferPerObjectData, 0, 0);
+		direct3DDeviceContext->VSSetConstantBuffers(0, 1, mVertexCBufferPerObject.GetAddressOf());
+
+		direct3DDeviceContext->DrawIndexedInstanced(IndexCount, mCount, 0, 0, 0);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "DrawableGameComponent.h"
+#include <wrl.h>
+#include <d3d11_2.h>
+#include <DirectXMath.h>
+#include "SlotMap.h"
+
+namespace Simulation
+{
+	struct BodySnapshot;
+}
+
+namespace Rendering
+{
+	class CelestialBody;
+	class CelestialLight;
+
+	// Draws every asteroid of a belt as a small octahedron in a single instanced call. The instance buffer is refilled
+	// from the belt's evaluated positions in the drawn BodySnapshot on Update.
+	class Belt final : public Library::DrawableGameComponent
+	{
+		RTTI_DECLARATIONS(Belt, DrawableGameComponent)
+
+	public:
+		Belt(Library::Game& game, const std::shared_ptr<Library::Camera>& camera, const Simulation::BodySnapshot& snapshot, std::uint32_t beltIndex,
+			const Simulation::SlotMap<CelestialBody>& bodies, const Simulation::SlotHandle& parentBody, CelestialLight& light);
+
+		Belt() = delete;
+		Belt(const Belt&) = delete;
+		Belt& operator=(const Belt&) = delete;
+
+		void Initialize() override;
+		void Update(const Library::GameTime& gameTime) override;
+		void Draw(const Library::GameTime& gameTime) override;
+
+	private:
+		struct VertexCBufferPerObject
+		{
+			DirectX::XMFLOAT4X4 ViewProjection;
+			DirectX::XMFLOAT3 Origin;
+			float Padding1;
+			DirectX::XMFLOAT3 LightPosition;
+			float Padding2;
+			DirectX::XMFLOAT4 Color;
+
+			VertexCBufferPerObject() { }
+		};
+
+		void UpdateInstances();
+
+		static const DirectX::XMFLOAT4 DefaultColor;
+		static const std::uint32_t IndexCount;
+
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> mVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader> mPixelShader;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout> mInputLayout;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mVertexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mIndexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mInstanceBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mVertexCBufferPerObject;
+		VertexCBufferPerObject mVertexCBufferPerObjectData;
+
+		const Simulation::BodySnapshot& mSnapshot;
+		std::uint32_t mBeltIndex;
+		std::uint32_t mCount;
+		const Simulation::SlotMap<CelestialBody>& mBodies;
+		Simulation::SlotHandle mParentBody;
+		CelestialLight& mLight;
+	};
+}
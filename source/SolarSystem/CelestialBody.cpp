@@ -4,80 +4,87 @@
 using namespace std;
 using namespace Library;
 using namespace DirectX;
+using namespace Simulation;
 
 namespace Rendering
 {
-	float CelestialBody::sMeanDistance;
-	float CelestialBody::sRotationPeriod;
-	float CelestialBody::sOrbitalPeriod;
-	float CelestialBody::sDiameter;
+	CelestialBody::CelestialBody(Library::Game& game, const std::shared_ptr<Library::Camera>& camera, BodySystem& bodySystem, const BodySnapshot& snapshot,
+		const SlotMap<CelestialBody>& bodies, std::uint32_t index) :
+		DrawableGameComponent(game, camera), mHandle(), mParent(), mBodySystem(&bodySystem), mSnapshot(&snapshot), mBodies(&bodies), mIndex(index)
+	{
+	}
 
-	CelestialBody::CelestialBody(Library::Game& game, const std::shared_ptr<Library::Camera>& camera) :
-		DrawableGameComponent(game, camera), mParent(nullptr),
-		mRotationRate(0), mOrbitalRate(0), mRotationAngle(0), mOrbitalAngle(0),
-		mID(reinterpret_cast<std::uint64_t>(this))
+	void CelestialBody::SetHandle(const SlotHandle& handle)
 	{
-		UpdateWorldMatrix(MatrixHelper::Identity);
+		assert(mBodies->Find(handle) == this);
+		mHandle = handle;
 	}
 
-	void CelestialBody::SetParams(const CelestialBodyData& data)
+	void CelestialBody::Adopt(CelestialBody& body)
 	{
-		mData = data;
-		float netRotationPeriod = (sRotationPeriod * mData.mRotationPeriod);
-		mRotationRate = (netRotationPeriod == 0) ? 0 : (XM_2PI / netRotationPeriod);
-		mRotationAngle = 0.0f;
+		assert(body.mParent == SlotHandle());
 
-		float netOrbitalPeriod = (sOrbitalPeriod * mData.mOrbitalPeriod);
-		mOrbitalRate = (netOrbitalPeriod == 0) ? 0 : (XM_2PI / netOrbitalPeriod);
-		mOrbitalAngle = 0.0f;
-		XMStoreFloat4x4(&mTranslation, XMMatrixTranslation(sMeanDistance * mData.mMeanDistance, 0, 0));
-		Initialize();
+		mChildBodies.push_back(body.mHandle);
+		body.mParent = mHandle;
+		if (mBodySystem->Parent(body.mIndex) == mIndex)
+		{
+			body.InitializeOrbit();
+		}
+		else
+		{
+			body.mOrbit.reset();
+		}
 	}
 
-	void CelestialBody::Adopt(CelestialBody& body)
+	void CelestialBody::Release(CelestialBody& body)
 	{
-		mChildBodies.push_back(&body);
-		body.mParent = this;
+		assert(body.mParent == mHandle);
 
-		// calculate distance from the outer edge of the parent instead of origin
-		float childDistanceFromOrigin = (sMeanDistance * body.mData.mMeanDistance) + (mData.mDiameter / 2) * 20;
-		XMStoreFloat4x4(&body.mTranslation, XMMatrixTranslation(childDistanceFromOrigin, 0, 0));
-		body.Initialize();
-		body.InitializeOrbit();
+		mChildBodies.erase(find(mChildBodies.begin(), mChildBodies.end(), body.mHandle));
+		body.mParent = SlotHandle();
 	}
 
 	const CelestialBodyData& CelestialBody::Data() const
 	{
-		return mData;
+		return mBodySystem->Data(mIndex);
+	}
+
+	std::uint32_t CelestialBody::Index() const
+	{
+		return mIndex;
 	}
 
 	float CelestialBody::Radius() const
 	{
-		XMFLOAT3 translation(mTranslation._41, mTranslation._42, mTranslation._43);
-		return XMVectorGetByIndex(XMVector3Length(XMLoadFloat3(&translation)), 1);
+		return mBodySystem->SemiMajorAxis(mIndex);
 	}
 
-	const XMFLOAT4& CelestialBody::Position() const
+	WorldPosition CelestialBody::Position() const
 	{
-		return mPosition;
+		return mSnapshot->mTransforms.Position(mIndex);
 	}
 
 	const DirectX::XMFLOAT4X4& CelestialBody::WorldTransform() const
 	{
-		return mWorldTransform;
+		return mSnapshot->mTransforms.Transform(mIndex);
 	}
 
-	const DirectX::XMFLOAT4X4& CelestialBody::WorldTranslation() const
+	bool CelestialBody::TransformChanged() const
 	{
-		return mTranslation;
+		return mSnapshot->mTransforms.Changed(mIndex);
 	}
 
-	CelestialBody* CelestialBody::Parent() const
+	const SlotHandle& CelestialBody::Handle() const
+	{
+		return mHandle;
+	}
+
+	const SlotHandle& CelestialBody::Parent() const
 	{
 		return mParent;
 	}
 
-	const std::vector<CelestialBody*>& CelestialBody::Children() const
+	const std::vector<SlotHandle>& CelestialBody::Children() const
 	{
 		return mChildBodies;
 	}
@@ -85,47 +92,10 @@ namespace Rendering
 	void CelestialBody::Initialize()
 	{
 		GameComponent::Initialize();
-
-		float diameter = sDiameter * mData.mDiameter;
-		XMMATRIX transform = XMMatrixScaling(diameter, diameter, diameter);
-		transform = XMMatrixMultiply(transform, XMMatrixRotationY(mRotationAngle));
-		transform = XMMatrixMultiply(transform, XMMatrixRotationZ(XMConvertToRadians(mData.mAxialTilt)));
-		transform = XMMatrixMultiply(transform, XMLoadFloat4x4(&mTranslation));
-		if (mParent != nullptr)
-		{
-			XMVECTOR position = XMLoadFloat4(&mParent->Position());
-			transform = XMMatrixMultiply(transform, XMMatrixTranslationFromVector(position));
-		}
-		UpdateWorldMatrix(transform);
 	}
 
 	void CelestialBody::Update(const GameTime& gameTime)
 	{
-		const float elapsedSeconds = gameTime.ElapsedGameTimeSeconds().count();
-		mRotationAngle += elapsedSeconds * mRotationRate;
-		if (mRotationAngle >= XM_2PI || mRotationAngle <= -XM_2PI)
-		{
-			mRotationAngle = 0.0f;
-		}
-
-		mOrbitalAngle += elapsedSeconds * mOrbitalRate;
-		if (mOrbitalAngle >= XM_2PI || mOrbitalAngle <= -XM_2PI)
-		{
-			mOrbitalAngle = 0.0f;
-		}
-
-		float diameter = sDiameter * mData.mDiameter;
-		XMMATRIX transform = XMMatrixScaling(diameter, diameter, diameter);
-		transform = XMMatrixMultiply(transform, XMMatrixRotationY(mRotationAngle));
-		transform = XMMatrixMultiply(transform, XMMatrixRotationZ(XMConvertToRadians(mData.mAxialTilt)));
-		transform = XMMatrixMultiply(transform, XMLoadFloat4x4(&mTranslation));
-		transform = XMMatrixMultiply(transform, XMMatrixRotationY(mOrbitalAngle));
-		if (mParent != nullptr)
-		{
-			XMVECTOR position = XMLoadFloat4(&mParent->Position());
-			transform = XMMatrixMultiply(transform, XMMatrixTranslationFromVector(position));
-		}
-		UpdateWorldMatrix(transform);
 		if (mOrbit)
 		{
 			mOrbit->Update(gameTime);
@@ -137,54 +107,10 @@ namespace Rendering
 		return mOrbit;
 	}
 
-	void CelestialBody::SetConstantParams(float meanDistance, float rotationPeriod, float orbitalPeriod, float diameter)
-	{
-		sMeanDistance = meanDistance;
-		sRotationPeriod = rotationPeriod;
-		sOrbitalPeriod = orbitalPeriod;
-		sDiameter = diameter;
-	}
-
-	void CelestialBody::UpdateWorldMatrix(const DirectX::XMFLOAT4X4& transform)
-	{
-		UpdateWorldMatrix(XMLoadFloat4x4(&transform));
-	}
-
-	void CelestialBody::UpdateWorldMatrix(const DirectX::XMMATRIX& transform)
-	{
-		XMStoreFloat4x4(&mWorldTransform, transform);
-		XMFLOAT4 origin(0.0f, 0.0f, 0.0f, 1.0f);
-		XMVECTOR position = XMLoadFloat4(&origin);
-		XMVECTOR transformed = XMVector4Transform(position, transform);
-		XMStoreFloat4(&mPosition, transformed);
-	}
-
 	void CelestialBody::InitializeOrbit()
 	{
-		mOrbit = std::make_shared<Orbit>(*mGame, mCamera, *this);
+		mOrbit = std::make_shared<Orbit>(*mGame, mCamera, *mBodies, mHandle);
 		mOrbit->Initialize();
-		XMFLOAT3 translation(mTranslation._41, mTranslation._42, mTranslation._43);
-		float radius = XMVectorGetByIndex(XMVector3Length(XMLoadFloat3(&translation)), 0);
-		mOrbit->SetParams(radius, 10, XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f));
-	}
-
-	float CelestialBody::MeanDistance()
-	{
-		return sMeanDistance;
-	}
-
-	float CelestialBody::RotationPeriod()
-	{
-		return sRotationPeriod;
-	}
-
-	float CelestialBody::OrbitalPeriod()
-	{
-		return sOrbitalPeriod;
-	}
-
-	float CelestialBody::Diameter()
-	{
-		return sDiameter;
+		mOrbit->SetParams(Radius(), mBodySystem->Eccentricity(mIndex), mBodySystem->OrbitOrientation(mIndex), 10, XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f));
 	}
 }
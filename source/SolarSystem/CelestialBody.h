@@ -1,63 +1,59 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include "BodySystem.h"
+#include "SlotMap.h"
 #include "Orbit.h"
 
 namespace Rendering
 {
+	// Lives in a SlotMap and refers to its parent and children by handle, so that bodies can be added to and removed
+	// from the map without leaving dangling links. SetHandle must be given the body's own handle before Adopt.
+	//
+	// The links follow the simulation's dominant parents, so a body captured by another must be released by its old
+	// parent before the new one adopts it. Only a body under its catalog parent has an orbit line; under any other the
+	// scripted ellipse no longer describes its path.
 	class CelestialBody : Library::DrawableGameComponent
 	{
 	public:
-		CelestialBody(Library::Game& game, const std::shared_ptr<Library::Camera>& camera);
+		CelestialBody(Library::Game& game, const std::shared_ptr<Library::Camera>& camera, Simulation::BodySystem& bodySystem, const Simulation::BodySnapshot& snapshot,
+			const Simulation::SlotMap<CelestialBody>& bodies, std::uint32_t index);
+		CelestialBody(const CelestialBody&) = default;
+		CelestialBody& operator=(const CelestialBody&) = default;
+		CelestialBody(CelestialBody&&) = default;
+		CelestialBody& operator=(CelestialBody&&) = default;
 		virtual ~CelestialBody() = default;
 
-		void SetParams(const CelestialBodyData& data);
+		void SetHandle(const Simulation::SlotHandle& handle);
 		void Adopt(CelestialBody& body);
+		void Release(CelestialBody& body);
 
-		const CelestialBodyData& Data() const;
+		const Simulation::CelestialBodyData& Data() const;
+		std::uint32_t Index() const;
 		float Radius() const;
-		const DirectX::XMFLOAT4& Position() const;
+		Simulation::WorldPosition Position() const;
 		const DirectX::XMFLOAT4X4& WorldTransform() const;
-		const DirectX::XMFLOAT4X4& WorldTranslation() const;
-		CelestialBody* Parent() const;
-		const std::vector<CelestialBody*>& Children() const;
+		bool TransformChanged() const;
+		const Simulation::SlotHandle& Handle() const;
+		// Zeroed for a root.
+		const Simulation::SlotHandle& Parent() const;
+		const std::vector<Simulation::SlotHandle>& Children() const;
 
 		void Initialize() override;
 		void Update(const Library::GameTime& gameTime) override;
-		
+
 		std::shared_ptr<Orbit>& GetOrbit();
-		static void SetConstantParams(float meanDistance, float rotationPeriod, float orbitalPeriod, float diameter);
 	private:
 		void InitializeOrbit();
-		void UpdateWorldMatrix(const DirectX::XMFLOAT4X4& transform);
-		void UpdateWorldMatrix(const DirectX::XMMATRIX& transform);
-
-		DirectX::XMFLOAT4X4 mWorldTransform;
-		DirectX::XMFLOAT4 mPosition;
 
-		std::vector<CelestialBody*> mChildBodies;
-		CelestialBody* mParent;
+		std::vector<Simulation::SlotHandle> mChildBodies;
+		Simulation::SlotHandle mHandle;
+		Simulation::SlotHandle mParent;
 		std::shared_ptr<Orbit> mOrbit;
 
-		CelestialBodyData mData;
-		float mRotationRate;
-		float mOrbitalRate;
-		float mRotationAngle;
-		float mOrbitalAngle;
-		DirectX::XMFLOAT4X4 mTranslation;
-
-		const std::uint64_t mID;
-
-		// Constants
-		static float sMeanDistance;
-		static float sRotationPeriod;
-		static float sOrbitalPeriod;
-		static float sDiameter;
-
-	public:
-		static float MeanDistance();
-		static float RotationPeriod();
-		static float OrbitalPeriod();
-		static float Diameter();
+		Simulation::BodySystem* mBodySystem;
+		const Simulation::BodySnapshot* mSnapshot;
+		const Simulation::SlotMap<CelestialBody>* mBodies;
+		std::uint32_t mIndex;
 	};
 }
@@ -0,0 +1,34 @@
+cbuffer CBufferPerObject
+{
+	float4x4 ViewProjection;
+	float3 Origin;
+	float3 LightPosition;
+	float4 Color;
+}
+
+struct VS_INPUT
+{
+	float4 ObjectPosition: POSITION;
+	float4 Instance : INSTANCE;
+};
+
+struct VS_OUTPUT
+{
+	float4 Position: SV_Position;
+	float4 Color : COLOR;
+};
+
+// Instance xyz is the asteroid's position relative to the parent and w its diameter
+VS_OUTPUT main(VS_INPUT IN)
+{
+	VS_OUTPUT OUT = (VS_OUTPUT)0;
+
+	float3 worldPosition = Origin + IN.Instance.xyz + IN.ObjectPosition.xyz * IN.Instance.w;
+	OUT.Position = mul(float4(worldPosition, 1.0f), ViewProjection);
+
+	float3 normal = normalize(IN.ObjectPosition.xyz);
+	float3 lightDirection = normalize(LightPosition - worldPosition);
+	float n_dot_l = saturate(dot(normal, lightDirection));
+	OUT.Color = float4(Color.rgb * (0.2f + 0.8f * n_dot_l), Color.a);
+	return OUT;
+}
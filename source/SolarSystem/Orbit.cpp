@@ -9,10 +9,10 @@ namespace Rendering
 
 	const XMFLOAT4 Orbit::DefaultColor = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 
-	Orbit::Orbit(Game& game, const std::shared_ptr<Camera>& camera, CelestialBody& parentBody) :
+	Orbit::Orbit(Game& game, const std::shared_ptr<Camera>& camera, const Simulation::SlotMap<CelestialBody>& bodies, const Simulation::SlotHandle& body) :
 		DrawableGameComponent(game, camera), mVertexShader(nullptr), mPixelShader(nullptr), mInputLayout(nullptr),
 		mVertexBuffer(nullptr), mVertexCBufferPerObject(nullptr), mVertexCBufferPerObjectData(), mColor(DefaultColor),
-		mRadius(0), mWorldMatrix(MatrixHelper::Identity), mVertexCount(0), mParentBody(parentBody)
+		mRadius(0), mEccentricity(0), mOrientation(MatrixHelper::Identity), mWorldMatrix(MatrixHelper::Identity), mVertexCount(0), mBodies(bodies), mBody(body)
 	{
 	}
 
@@ -50,22 +50,40 @@ namespace Rendering
 
 	void Orbit::Update(const GameTime&)
 	{
-		if (mParentBody.Parent() != nullptr)
+		// the orbit only moves with the body it is centred on
+		const CelestialBody* parent = ParentBody();
+		if (parent != nullptr && parent->TransformChanged())
 		{
-			CelestialBody& body = *mParentBody.Parent();
+			UpdateWorldMatrix();
+		}
+	}
+
+	void Orbit::UpdateWorldMatrix()
+	{
+		const CelestialBody* parent = ParentBody();
+		if (parent != nullptr)
+		{
+			const CelestialBody& body = *parent;
 			XMFLOAT4 origin(0.0f, 0.0f, 0.0f, 1.0f);
 			XMVECTOR position = XMLoadFloat4(&origin);
 			XMVECTOR transformed = XMVector4Transform(position, XMLoadFloat4x4(&body.WorldTransform()));
-			mWorldMatrix = MatrixHelper::Identity;
-			XMStoreFloat4x4(&mWorldMatrix, XMMatrixMultiply(XMLoadFloat4x4(&mWorldMatrix), XMMatrixTranslationFromVector(transformed)));
+			XMStoreFloat4x4(&mWorldMatrix, XMMatrixMultiply(XMLoadFloat4x4(&mOrientation), XMMatrixTranslationFromVector(transformed)));
 		}
 	}
 
-	void Orbit::SetParams(float radius, float vertexPerUnit, const DirectX::XMFLOAT4& color)
+	const CelestialBody* Orbit::ParentBody() const
+	{
+		const CelestialBody* body = mBodies.Find(mBody);
+		return (body != nullptr) ? mBodies.Find(body->Parent()) : nullptr;
+	}
+
+	void Orbit::SetParams(float radius, float eccentricity, const DirectX::XMFLOAT4X4& orientation, float vertexPerUnit, const DirectX::XMFLOAT4& color)
 	{
 		mRadius = radius;
+		mEccentricity = eccentricity;
+		mOrientation = orientation;
 		mColor = color;
-		Update(GameTime());
+		UpdateWorldMatrix();
 
 		mVertexBuffer.Reset();
 		float maxAngle = (XM_2PI + XM_PIDIV4/4);
@@ -75,11 +93,13 @@ namespace Rendering
 		std::unique_ptr<VertexPositionColor> vertexData(new VertexPositionColor[mVertexCount]);
 		VertexPositionColor* vertices = vertexData.get();
 
+		// the ellipse is traced by eccentric anomaly with the parent at the focus; the orientation puts it in the orbit plane
 		float angle = 0;
 		float angleIncrement = (maxAngle / mVertexCount);
+		float minorRadius = mRadius * sqrt(1.0f - mEccentricity * mEccentricity);
 		for (std::uint32_t index = 0; index < mVertexCount; ++index)
 		{
-			vertices[index] = VertexPositionColor(XMFLOAT4(mRadius * cos(angle), 0.0f, mRadius * sin(angle), 1.0f), mColor);
+			vertices[index] = VertexPositionColor(XMFLOAT4(mRadius * (cos(angle) - mEccentricity), 0.0f, minorRadius * sin(angle), 1.0f), mColor);
 			angle += angleIncrement;
 		}
 
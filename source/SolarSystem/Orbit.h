@@ -4,24 +4,27 @@
 #include <wrl.h>
 #include <d3d11_2.h>
 #include <DirectXMath.h>
+#include "SlotMap.h"
 
 namespace Rendering
 {
 	class CelestialBody;
 
+	// The orbit line of a body, centred on the body's parent. Both are looked up by handle when drawn, since the map
+	// moves its values around as bodies come and go.
 	class Orbit final : public Library::DrawableGameComponent
 	{
 		RTTI_DECLARATIONS(Orbit, DrawableGameComponent)
 
 	public:
-		Orbit(Library::Game& game, const std::shared_ptr<Library::Camera>& camera, CelestialBody& parentBody);
+		Orbit(Library::Game& game, const std::shared_ptr<Library::Camera>& camera, const Simulation::SlotMap<CelestialBody>& bodies, const Simulation::SlotHandle& body);
 
 		Orbit() = delete;
 		Orbit(const Orbit&) = delete;
 		Orbit& operator=(const Orbit&) = delete;
 
 		void Initialize() override;
-		void SetParams(float radius, float vertexPerUnit, const DirectX::XMFLOAT4& color);
+		void SetParams(float radius, float eccentricity, const DirectX::XMFLOAT4X4& orientation, float vertexPerUnit, const DirectX::XMFLOAT4& color);
 		
 		void Update(const Library::GameTime& gameTime) override;
 		void Draw(const Library::GameTime& gameTime) override;
@@ -34,6 +37,10 @@ namespace Rendering
 			VertexCBufferPerObject(const DirectX::XMFLOAT4X4& wvp) : WorldViewProjection(wvp) { }
 		};
 
+		void UpdateWorldMatrix();
+		// Null for a root, or once the body or its parent is gone.
+		const CelestialBody* ParentBody() const;
+
 		static const DirectX::XMFLOAT4 DefaultColor;
 
 		Microsoft::WRL::ComPtr<ID3D11VertexShader> mVertexShader;
@@ -43,9 +50,12 @@ namespace Rendering
 		Microsoft::WRL::ComPtr<ID3D11Buffer> mVertexCBufferPerObject;
 		VertexCBufferPerObject mVertexCBufferPerObjectData;
 
-		CelestialBody& mParentBody;
+		const Simulation::SlotMap<CelestialBody>& mBodies;
+		Simulation::SlotHandle mBody;
 		DirectX::XMFLOAT4 mColor;
 		float mRadius;
+		float mEccentricity;
+		DirectX::XMFLOAT4X4 mOrientation;
 		DirectX::XMFLOAT4X4 mWorldMatrix;
 		uint32_t mVertexCount;
 	};
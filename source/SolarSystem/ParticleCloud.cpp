@@ -0,0 +1,120 @@
+#include "pch.h"
+
+using namespace DirectX;
+using namespace Library;
+
+namespace Rendering
+{
+	RTTI_DEFINITIONS(ParticleCloud)
+
+	// the simulation writes the vertex stream, which is copied as is
+	static_assert(sizeof(Simulation::ParticleColorVertex) == sizeof(VertexPositionColor), "Particle vertices must match VertexPositionColor");
+
+	ParticleCloud::ParticleCloud(Game& game, const std::shared_ptr<Camera>& camera, const Simulation::BodySnapshot& snapshot, std::uint32_t capacity) :
+		DrawableGameComponent(game, camera), mVertexShader(nullptr), mPixelShader(nullptr), mInputLayout(nullptr), mVertexBuffer(nullptr),
+		mVertexCBufferPerObject(nullptr), mDepthStencilState(nullptr), mVertexCBufferPerObjectData(), mRenderStateHelper(game),
+		mSnapshot(snapshot), mCapacity(capacity), mVertexCount(0)
+	{
+	}
+
+	void ParticleCloud::Initialize()
+	{
+		// Load a compiled vertex shader
+		std::vector<char> compiledVertexShader;
+		Utility::LoadBinaryFile(L"Content\\Shaders\\BasicVS.cso", compiledVertexShader);
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateVertexShader(&compiledVertexShader[0], compiledVertexShader.size(), nullptr, mVertexShader.GetAddressOf()),
+			"ID3D11Device::CreatedVertexShader() failed.");
+
+		// Load a compiled pixel shader
+		std::vector<char> compiledPixelShader;
+		Utility::LoadBinaryFile(L"Content\\Shaders\\BasicPS.cso", compiledPixelShader);
+		ThrowIfFailed(mGame->Direct3DDevice()->CreatePixelShader(&compiledPixelShader[0], compiledPixelShader.size(), nullptr, mPixelShader.GetAddressOf()),
+			"ID3D11Device::CreatedPixelShader() failed.");
+
+		// Create an input layout
+		D3D11_INPUT_ELEMENT_DESC inputElementDescriptions[] =
+		{
+			{"POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+			{"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0}
+		};
+
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateInputLayout(inputElementDescriptions, ARRAYSIZE(inputElementDescriptions), &compiledVertexShader[0],
+			compiledVertexShader.size(), mInputLayout.GetAddressOf()), "ID3D11Device::CreateInputLayout() failed.");
+
+		// One vertex per slot of the pool, rewritten whole every frame
+		D3D11_BUFFER_DESC vertexBufferDesc = {0};
+		vertexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		vertexBufferDesc.ByteWidth = static_cast<UINT>(sizeof(VertexPositionColor) * std::max(mCapacity, 1U));
+		vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vertexBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&vertexBufferDesc, nullptr, mVertexBuffer.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+
+		// Create constant buffers
+		D3D11_BUFFER_DESC constantBufferDesc = {0};
+		constantBufferDesc.ByteWidth = sizeof(VertexCBufferPerObject);
+		constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, mVertexCBufferPerObject.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+
+		// Blended particles are depth tested against the bodies but do not occlude one another
+		D3D11_DEPTH_STENCIL_DESC depthStencilDesc = {0};
+		depthStencilDesc.DepthEnable = TRUE;
+		depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+		depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateDepthStencilState(&depthStencilDesc, mDepthStencilState.GetAddressOf()),
+			"ID3D11Device::CreateDepthStencilState() failed.");
+	}
+
+	void ParticleCloud::Update(const GameTime&)
+	{
+		const auto& vertices = mSnapshot.mParticleVertices;
+		mVertexCount = static_cast<std::uint32_t>(vertices.size());
+		if (mVertexCount == 0)
+		{
+			return;
+		}
+
+		ID3D11DeviceContext* direct3DDeviceContext = mGame->Direct3DDeviceContext();
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		ThrowIfFailed(direct3DDeviceContext->Map(mVertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource), "ID3D11DeviceContext::Map() failed.");
+		memcpy(mappedResource.pData, &vertices[0], sizeof(Simulation::ParticleColorVertex) * mVertexCount);
+		direct3DDeviceContext->Unmap(mVertexBuffer.Get(), 0);
+	}
+
+	void ParticleCloud::Draw(const GameTime&)
+	{
+		if (mVertexCount == 0)
+		{
+			return;
+		}
+
+		ID3D11DeviceContext* direct3DDeviceContext = mGame->Direct3DDeviceContext();
+		direct3DDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+		direct3DDeviceContext->IASetInputLayout(mInputLayout.Get());
+
+		UINT stride = sizeof(VertexPositionColor);
+		UINT offset = 0;
+		direct3DDeviceContext->IASetVertexBuffers(0, 1, mVertexBuffer.GetAddressOf(), &stride, &offset);
+
+		direct3DDeviceContext->VSSetShader(mVertexShader.Get(), nullptr, 0);
+		direct3DDeviceContext->PSSetShader(mPixelShader.Get(), nullptr, 0);
+
+		// particles are in world space, and are shifted into the bodies' space relative to the render origin
+		const Simulation::WorldPosition& origin = mSnapshot.mTransforms.Origin();
+		XMMATRIX world = XMMatrixTranslation(static_cast<float>(-origin.mX), static_cast<float>(-origin.mY), static_cast<float>(-origin.mZ));
+		XMStoreFloat4x4(&mVertexCBufferPerObjectData.WorldViewProjection, XMMatrixTranspose(world * mCamera->ViewProjectionMatrix()));
+		direct3DDeviceContext->UpdateSubresource(mVertexCBufferPerObject.Get(), 0, nullptr, &mVertexCBufferPerObjectData, 0, 0);
+		direct3DDeviceContext->VSSetConstantBuffers(0, 1, mVertexCBufferPerObject.GetAddressOf());
+
+		mRenderStateHelper.SaveBlendState();
+		mRenderStateHelper.SaveDepthStencilState();
+		direct3DDeviceContext->OMSetBlendState(BlendStates::AlphaBlending.Get(), 0, 0xFFFFFFFF);
+		direct3DDeviceContext->OMSetDepthStencilState(mDepthStencilState.Get(), 0);
+
+		direct3DDeviceContext->Draw(mVertexCount, 0);
+
+		mRenderStateHelper.RestoreDepthStencilState();
+		mRenderStateHelper.RestoreBlendState();
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "DrawableGameComponent.h"
+#include "RenderStateHelper.h"
+#include <wrl.h>
+#include <d3d11_2.h>
+#include <DirectXMath.h>
+
+namespace Simulation
+{
+	struct BodySnapshot;
+}
+
+namespace Rendering
+{
+	// Draws the particles of a BodySystem as alpha blended points. Update copies the vertices of the drawn BodySnapshot,
+	// already rewound to the time the bodies are drawn at, into a dynamic vertex buffer sized to the pool.
+	class ParticleCloud final : public Library::DrawableGameComponent
+	{
+		RTTI_DECLARATIONS(ParticleCloud, DrawableGameComponent)
+
+	public:
+		ParticleCloud(Library::Game& game, const std::shared_ptr<Library::Camera>& camera, const Simulation::BodySnapshot& snapshot, std::uint32_t capacity);
+
+		ParticleCloud() = delete;
+		ParticleCloud(const ParticleCloud&) = delete;
+		ParticleCloud& operator=(const ParticleCloud&) = delete;
+
+		void Initialize() override;
+		void Update(const Library::GameTime& gameTime) override;
+		void Draw(const Library::GameTime& gameTime) override;
+
+	private:
+		struct VertexCBufferPerObject
+		{
+			DirectX::XMFLOAT4X4 WorldViewProjection;
+
+			VertexCBufferPerObject() { }
+			VertexCBufferPerObject(const DirectX::XMFLOAT4X4& wvp) : WorldViewProjection(wvp) { }
+		};
+
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> mVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader> mPixelShader;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout> mInputLayout;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mVertexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mVertexCBufferPerObject;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilState> mDepthStencilState;
+		VertexCBufferPerObject mVertexCBufferPerObjectData;
+		Library::RenderStateHelper mRenderStateHelper;
+
+		const Simulation::BodySnapshot& mSnapshot;
+		std::uint32_t mCapacity;
+		std::uint32_t mVertexCount;
+	};
+}
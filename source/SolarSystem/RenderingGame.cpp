@@ -1,6 +1,7 @@
 #include "pch.h"
 
 using namespace std;
+using namespace std::chrono;
 using namespace DirectX;
 using namespace Library;
 
@@ -13,7 +14,7 @@ namespace Rendering
 	const float RenderingGame::MovementRateDelta = 10;
 
 	RenderingGame::RenderingGame(std::function<void*()> getWindowCallback, std::function<void(SIZE&)> getRenderTargetSizeCallback) :
-		Game(getWindowCallback, getRenderTargetSizeCallback, false), mRenderStateHelper(*this)
+		Game(getWindowCallback, getRenderTargetSizeCallback, false), mRenderStateHelper(*this), mPresentTime(0)
 	{
 	}
 
@@ -21,6 +22,7 @@ namespace Rendering
 	{
 		RasterizerStates::Initialize(mDirect3DDevice.Get());
 		SamplerStates::Initialize(mDirect3DDevice.Get());
+		BlendStates::Initialize(mDirect3DDevice.Get());
 
 		mKeyboard = make_shared<KeyboardComponent>(*this);
 		mComponents.push_back(mKeyboard);
@@ -52,6 +54,13 @@ namespace Rendering
 		mCamera->SetPosition(CameraStart);
 	}
 
+	void RenderingGame::Run()
+	{
+		steady_clock::time_point frameStart = steady_clock::now();
+		Game::Run();
+		mFpsComponent->SetFrameStatistics(duration_cast<nanoseconds>(steady_clock::now() - frameStart) - mPresentTime, mSolarSystemDemo->SimulationLatency());
+	}
+
 	void RenderingGame::Update(const GameTime &gameTime)
 	{
 		mFpsComponent->Update(gameTime);
@@ -95,7 +104,9 @@ namespace Rendering
 		mFpsComponent->Draw(gameTime);
 		mRenderStateHelper.RestoreAll();
 
+		steady_clock::time_point presentStart = steady_clock::now();
 		HRESULT hr = mSwapChain->Present(1, 0);
+		mPresentTime = duration_cast<nanoseconds>(steady_clock::now() - presentStart);
 
 		// If the device was removed either by a disconnection or a driver upgrade, we must recreate all device resources.
 		if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
@@ -110,6 +121,7 @@ namespace Rendering
 
 	void RenderingGame::Shutdown()
 	{
+		BlendStates::Shutdown();
 		SamplerStates::Shutdown();
 		RasterizerStates::Shutdown();
 	}
@@ -4,6 +4,7 @@
 #include "RenderStateHelper.h"
 #include <windows.h>
 #include <functional>
+#include <chrono>
 
 namespace Library
 {
@@ -25,6 +26,8 @@ namespace Rendering
 		RenderingGame(std::function<void*()> getWindowCallback, std::function<void(SIZE&)> getRenderTargetSizeCallback);
 
 		void Initialize() override;
+		// Times every frame short of Present, which waits for the vertical blank, for the frame rate display.
+		void Run() override;
 		void Update(const Library::GameTime& gameTime) override;
 		void Draw(const Library::GameTime& gameTime) override;
 		void Shutdown() override;
@@ -46,5 +49,6 @@ namespace Rendering
 		std::shared_ptr<Library::FirstPersonCamera> mCamera;
 		std::shared_ptr<SolarSystemDemo> mSolarSystemDemo;
 		std::shared_ptr<Library::Skybox> mSkybox;
+		std::chrono::nanoseconds mPresentTime;
 	};
 }
@@ -2,8 +2,10 @@
 #include "ConfigData.h"
 
 using namespace std;
+using namespace std::chrono;
 using namespace Library;
 using namespace DirectX;
+using namespace Simulation;
 
 namespace Rendering
 {
@@ -11,11 +13,35 @@ namespace Rendering
 
 	const float SolarSystemDemo::LightModulationRate = 10000000;
 	const float SolarSystemDemo::SunLightDefaultIntensity = 93300000.0f * 100000;
+	const float SolarSystemDemo::SpawnRate = 1000.0f;
+	const float SolarSystemDemo::DebrisLifetime = 30.0f;
+	const float SolarSystemDemo::ProbeLaunchRate = 200.0f;
+	const XMFLOAT4 SolarSystemDemo::DebrisColor = XMFLOAT4(0.8f, 0.8f, 0.9f, 1.0f);
+	const XMFLOAT4 SolarSystemDemo::ProbeColor = XMFLOAT4(1.0f, 0.6f, 0.2f, 1.0f);
+
+	namespace
+	{
+		const wchar_t* IntegrationName(IntegrationMethod integration)
+		{
+			switch (integration)
+			{
+			case IntegrationMethod::WisdomHolman:
+				return L"Wisdom-Holman";
+
+			case IntegrationMethod::BlockTimestep:
+				return L"Block Timesteps";
+
+			default:
+				return L"Leapfrog";
+			}
+		}
+	}
 
 	SolarSystemDemo::SolarSystemDemo(Game & game, const shared_ptr<Camera>& camera) :
-		DrawableGameComponent(game, camera), mRootBody(nullptr), mSunLight(game, XMFLOAT3(0.0f, 0.0f, 0.0f), SunLightDefaultIntensity),
-		mRenderStateHelper(game), mKeyboard(nullptr), mIndexCount(0), mTextPosition(0.0f, 40.0f), mAnimationEnabled(false), mIsOrbitsEnabled(true),
-		mActiveBodyIndex(0), mIsCameraLocked(false), mIsInfoDisplayOn(true)
+		DrawableGameComponent(game, camera), mThreadPool(make_shared<ThreadPool>()), mSimulation(mBodySystem), mSnapshot(),
+		mSunLight(game, XMFLOAT3(0.0f, 0.0f, 0.0f), SunLightDefaultIntensity), mRenderStateHelper(game), mKeyboard(nullptr), mIndexCount(0),
+		mTextPosition(0.0f, 60.0f), mAnimationEnabled(false), mIsOrbitsEnabled(true), mIsBeltsEnabled(true), mIsParticlesEnabled(true),
+		mActiveBodyIndex(0), mPendingSpawns(0.0f), mSpawnSeed(0), mPendingLaunches(0.0f), mLaunchSeed(0), mReparentCount(0), mIsCameraLocked(false), mIsInfoDisplayOn(true)
 	{
 	}
 
@@ -27,13 +53,32 @@ namespace Rendering
 	void SolarSystemDemo::SetAnimationEnabled(bool enabled)
 	{
 		mAnimationEnabled = enabled;
+		mSimulation.SetAdvancing(enabled);
+	}
+
+	uint32_t SolarSystemDemo::SimulationLatency() const
+	{
+		return mSimulation.Latency();
 	}
 
 	void SolarSystemDemo::Initialize()
 	{
 		mConfigData.LoadConfigData("Content\\CelestialBodies.ini");
-		const CelestialBodyData& data = mConfigData.GetConstantsData();
-		CelestialBody::SetConstantParams(data.mMeanDistance, data.mRotationPeriod, data.mOrbitalPeriod, data.mDiameter);
+		// the pool is set first so that belts are generated on it
+		mBodySystem.SetThreadPool(mThreadPool);
+		mBodySystem.Initialize(mConfigData);
+
+		// A recorded run is optional; SimulationStepper --ephemeris writes one
+		try
+		{
+			mBodySystem.SetEphemeris(make_shared<Ephemeris>("Content\\CelestialBodies.eph"));
+		}
+		catch (const exception&)
+		{
+		}
+
+		// the components are built around the first snapshot, and only ever read the one drawn
+		mBodySystem.WriteSnapshot(mSnapshot);
 
 		// Load a compiled vertex shader
 		vector<char> compiledVertexShader;
@@ -86,12 +131,12 @@ namespace Rendering
 		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, mPSCBufferPerObject.ReleaseAndGetAddressOf()),
 			"ID3D11Device::CreateBuffer() failed.");
 
-		unordered_map<string, CelestialBody*> bodiesMap;
-		vector<string> parents;
-		mCelestialBodies.reserve(mConfigData.GetAllData().size());
+		mCelestialBodies.Reserve(mBodySystem.BodyCount());
+		mBodyHandles.clear();
 		// Load textures for the color and specular maps
-		for (const auto& section : mConfigData.GetAllData())
+		for (uint32_t index = 0; index < mBodySystem.BodyCount(); ++index)
 		{
+			const auto& section = mBodySystem.Data(index);
 			if (mColorTextures.find(section.mTextureName) == mColorTextures.end())
 			{
 				wstring textureName = L"Content\\Textures\\" + Utility::ToWideString(section.mTextureName);
@@ -100,11 +145,9 @@ namespace Rendering
 					textureView.ReleaseAndGetAddressOf()), "CreateWICTextureFromFile() failed.");
 				mColorTextures.insert({section.mTextureName, textureView});
 			}
-			CelestialBody body(*mGame, mCamera);
-			body.SetParams(section);
-			mCelestialBodies.push_back(body);
-			bodiesMap.insert({section.mName, &mCelestialBodies.back()});
-			parents.push_back(section.mParent);
+			SlotHandle handle = mCelestialBodies.Emplace(*mGame, mCamera, mBodySystem, mSnapshot, mCelestialBodies, index);
+			mCelestialBodies[handle].SetHandle(handle);
+			mBodyHandles.push_back(handle);
 		}
 
 		// Create text rendering helpers
@@ -124,20 +167,35 @@ namespace Rendering
 		mGame->Direct3DDeviceContext()->UpdateSubresource(mVSCBufferPerFrame.Get(), 0, nullptr, &mVSCBufferPerFrameData, 0, 0);
 		mGame->Direct3DDeviceContext()->UpdateSubresource(mPSCBufferPerFrame.Get(), 0, nullptr, &mPSCBufferPerFrameData, 0, 0);
 
-		uint32_t index = 0;
 		for (auto& body : mCelestialBodies)
 		{
-			if (parents[index] == "")
+			uint32_t parent = mBodySystem.Parent(body.Index());
+			if (parent != BodySystem::InvalidIndex)
 			{
-				mRootBody = &body;
+				mCelestialBodies[mBodyHandles[parent]].Adopt(body);
 			}
-			else
-			{
-				CelestialBody* parent = bodiesMap.at(parents[index]);
-				parent->Adopt(body);
-			}
-			++index;
 		}
+
+		for (uint32_t index = 0; index < mBodySystem.BeltCount(); ++index)
+		{
+			const AsteroidBelt& belt = mBodySystem.Belt(index);
+			auto component = make_shared<Rendering::Belt>(*mGame, mCamera, mSnapshot, index, mCelestialBodies, mBodyHandles[belt.Parent()], mSunLight);
+			component->Initialize();
+			mBelts.push_back(component);
+		}
+
+		if (mBodySystem.Particles().EmitterCount() > 0)
+		{
+			mParticleCloud = make_shared<ParticleCloud>(*mGame, mCamera, mSnapshot, mBodySystem.Particles().Capacity());
+			mParticleCloud->Initialize();
+		}
+
+		mSpawnedBodyCloud = make_shared<SpawnedBodyCloud>(*mGame, mCamera, mSnapshot, mSnapshot.mSpawnedInstances, mSnapshot.mSpawnedParents,
+			BodySystem::SpawnCapacity, DebrisColor, mSunLight);
+		mSpawnedBodyCloud->Initialize();
+		mSpacecraftCloud = make_shared<SpawnedBodyCloud>(*mGame, mCamera, mSnapshot, mSnapshot.mSpacecraftInstances, mSnapshot.mSpacecraftParents,
+			BodySystem::SpacecraftCapacity, ProbeColor, mSunLight);
+		mSpacecraftCloud->Initialize();
 	}
 
 	void SolarSystemDemo::Update(const GameTime& gameTime)
@@ -155,6 +213,104 @@ namespace Rendering
 				mIsOrbitsEnabled = !mIsOrbitsEnabled;
 			}
 
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::K))
+			{
+				mIsBeltsEnabled = !mIsBeltsEnabled;
+
+				// hidden belts are not uploaded, so catch up on showing them again
+				if (mIsBeltsEnabled)
+				{
+					for (auto& belt : mBelts)
+					{
+						belt->Update(gameTime);
+					}
+				}
+			}
+
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::T))
+			{
+				// live particles fade out on their own once emission stops
+				mIsParticlesEnabled = !mIsParticlesEnabled;
+				bool enabled = mIsParticlesEnabled;
+				mSimulation.Post([enabled](BodySystem& bodySystem) { bodySystem.SetParticlesEnabled(enabled); });
+			}
+
+			// the simulation may have moved on since the drawn snapshot, so toggles are decided where they are applied
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::G))
+			{
+				mSimulation.Post([](BodySystem& bodySystem)
+				{
+					bool isKinematic = (bodySystem.Mode() != SimulationMode::NBody);
+					bodySystem.SetMode(isKinematic ? SimulationMode::NBody : SimulationMode::Kinematic);
+				});
+			}
+
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::P) && mSnapshot.mHasEphemeris)
+			{
+				mSimulation.Post([](BodySystem& bodySystem)
+				{
+					bool isPlayback = (bodySystem.Mode() == SimulationMode::Playback);
+					bodySystem.SetMode(isPlayback ? SimulationMode::Kinematic : SimulationMode::Playback);
+				});
+			}
+
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::R))
+			{
+				mSimulation.Post([](BodySystem& bodySystem) { bodySystem.SetDynamicHierarchy(!bodySystem.DynamicHierarchy()); });
+			}
+
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::F))
+			{
+				uint32_t index = mActiveBodyIndex;
+				mSimulation.Post([index](BodySystem& bodySystem) { bodySystem.SetPaused(index, !bodySystem.Paused(index)); });
+			}
+
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::H))
+			{
+				mSimulation.Post([](BodySystem& bodySystem)
+				{
+					switch (bodySystem.Integration())
+					{
+					case IntegrationMethod::Leapfrog:
+						bodySystem.SetIntegration(IntegrationMethod::WisdomHolman);
+						break;
+
+					case IntegrationMethod::WisdomHolman:
+						bodySystem.SetIntegration(IntegrationMethod::BlockTimestep);
+						break;
+
+					default:
+						bodySystem.SetIntegration(IntegrationMethod::Leapfrog);
+						break;
+					}
+				});
+			}
+
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::M))
+			{
+				CycleSimulationThread();
+			}
+
+			if (mKeyboard->IsKeyDown(Keys::C))
+			{
+				SpawnDebris(gameTime);
+			}
+
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::X))
+			{
+				mSimulation.Post([](BodySystem& bodySystem) { bodySystem.ClearSpawnedBodies(); });
+			}
+
+			if (mKeyboard->IsKeyDown(Keys::N))
+			{
+				LaunchProbes(gameTime);
+			}
+
+			if (mKeyboard->WasKeyPressedThisFrame(Keys::Z))
+			{
+				mSimulation.Post([](BodySystem& bodySystem) { bodySystem.ClearSpacecraft(); });
+			}
+
 			bool updateCBuffersPerFrame = UpdateCelestialLight(gameTime);
 			if (updateCBuffersPerFrame)
 			{
@@ -163,22 +319,22 @@ namespace Rendering
 
 			if (mKeyboard->WasKeyPressedThisFrame(Keys::Left))
 			{
-				mActiveBodyIndex = (mActiveBodyIndex == 0) ? static_cast<std::uint32_t>(mCelestialBodies.size() - 1) : (mActiveBodyIndex - 1);
+				mActiveBodyIndex = (mActiveBodyIndex == 0) ? static_cast<std::uint32_t>(mBodyHandles.size() - 1) : (mActiveBodyIndex - 1);
 				shouldUpdateCamera = true;
-				mCamera->Reset();
+				ResetCamera();
 			}
 
 			if (mKeyboard->WasKeyPressedThisFrame(Keys::Right))
 			{
-				mActiveBodyIndex = (mActiveBodyIndex + 1) % mCelestialBodies.size();
+				mActiveBodyIndex = (mActiveBodyIndex + 1) % mBodyHandles.size();
 				shouldUpdateCamera = true;
-				mCamera->Reset();
+				ResetCamera();
 			}
 
 			if (mKeyboard->WasKeyPressedThisFrame(Keys::L))
 			{
 				mIsCameraLocked = !mIsCameraLocked;
-				mCamera->Reset();
+				ResetCamera();
 			}
 
 			if (mKeyboard->WasKeyPressedThisFrame(Keys::I))
@@ -187,20 +343,14 @@ namespace Rendering
 			}
 		}
 
-		std::vector<CelestialBody*> stack = { mRootBody };
+		// the simulation advances in fixed steps whatever the frame rate, and is drawn blended between the last two; with
+		// the simulation thread running, this frame draws what it published while the next one is being stepped
 		if (mAnimationEnabled)
 		{
-			while (!stack.empty())
-			{
-				CelestialBody* body = stack.back();
-				stack.pop_back();
-				for(auto& child : body->Children())
-				{
-					stack.push_back(child);
-				}
-				body->Update(gameTime);
-			}
+			ScheduleDetail();
 		}
+		mSimulation.Tick(gameTime.ElapsedGameTime());
+		AcquireSnapshot(gameTime);
 
 		if (shouldUpdateCamera || mIsCameraLocked)
 		{
@@ -210,8 +360,8 @@ namespace Rendering
 
 	void SolarSystemDemo::Draw(const GameTime& gameTime)
 	{
-		UNREFERENCED_PARAMETER(gameTime);
 		assert(mCamera != nullptr);
+		RebaseToCamera(gameTime);
 
 		ID3D11DeviceContext* direct3DDeviceContext = mGame->Direct3DDeviceContext();
 		direct3DDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -262,19 +412,83 @@ namespace Rendering
 			}
 		}
 
+		if (mIsBeltsEnabled)
+		{
+			for (auto& belt : mBelts)
+			{
+				belt->Draw(gameTime);
+			}
+		}
+
+		if (mParticleCloud != nullptr)
+		{
+			mParticleCloud->Draw(gameTime);
+		}
+
+		mSpawnedBodyCloud->Draw(gameTime);
+		mSpacecraftCloud->Draw(gameTime);
+
 		if (mIsInfoDisplayOn)
 		{
 			// Draw help text
 			mRenderStateHelper.SaveAll();
 			mSpriteBatch->Begin();
 
+			size_t asteroidCount = 0;
+			for (const auto& instances : mSnapshot.mBeltInstances)
+			{
+				asteroidCount += instances.size();
+			}
+
+			vector<uint32_t> tierBodyCounts(DetailScheduler::TierCount, 0);
+			for (uint32_t interval : mSnapshot.mUpdateIntervals)
+			{
+				uint32_t tier = 0;
+				while ((1U << tier) < interval)
+				{
+					++tier;
+				}
+				++tierBodyCounts[tier];
+			}
+
 			wostringstream helpLabel;
-			helpLabel << L"Active Body: " << Utility::ToWideString(mCelestialBodies[mActiveBodyIndex].Data().mName) << "\n";
+			helpLabel << L"Active Body: " << Utility::ToWideString(mCelestialBodies[mBodyHandles[mActiveBodyIndex]].Data().mName) << "\n";
 			helpLabel << L"Camera Controls(WASD QE + Left Mouse)" << "\n";
 			helpLabel << L"Sun Light Intensity (+V/-B): " << mVSCBufferPerFrameData.LightIntensity << "\n";
 			helpLabel << L"Camera Movement Speed (+/-): " << static_cast<FirstPersonCamera*>(mCamera.get())->MovementRate() << "\n";
 			helpLabel << L"Toggle Animation (Space)" << "\n";
 			helpLabel << L"Toggle Orbits (O)" << "\n";
+			helpLabel << L"Toggle Asteroid Belts (K): " << asteroidCount << L" asteroids" << "\n";
+			helpLabel << L"Toggle Particles (T): " << mSnapshot.mParticleVertices.size() << L" live" << "\n";
+			helpLabel << L"Spawn Debris (C) / Clear (X): " << mSnapshot.mSpawnedInstances.size() << L" bodies, " << mSnapshot.mSpawnedDroppedCount << L" dropped" << "\n";
+			helpLabel << L"Launch Probes (N) / Clear (Z): " << mSnapshot.mSpacecraftInstances.size() << L" probes, " << mSnapshot.mSpacecraftTransitionCount << L" parent changes" << "\n";
+			helpLabel << L"Toggle Gravity Simulation (G): " << ((mSnapshot.mMode == SimulationMode::NBody) ? L"On" : L"Off") << "\n";
+			helpLabel << L"Toggle Ephemeris Playback (P): " << (!mSnapshot.mHasEphemeris ? L"Unavailable" : ((mSnapshot.mMode == SimulationMode::Playback) ? L"On" : L"Off")) << "\n";
+			helpLabel << L"Cycle Integrator (H): " << IntegrationName(mSnapshot.mIntegration) << "\n";
+			helpLabel << L"Toggle Dynamic Hierarchy (R): " << (mSnapshot.mDynamicHierarchy ? L"On" : L"Off") << L", " << mSnapshot.mReparentCount << L" parent changes" << "\n";
+			helpLabel << L"Pause Active Body and Satellites (F): " << ((mSnapshot.mPaused[mActiveBodyIndex] != 0) ? L"On" : L"Off") << "\n";
+			helpLabel << L"Transforms Updated / Skipped: " << mSnapshot.mInterpolatedCount << L" / " << (mSnapshot.mTransforms.Count() - mSnapshot.mInterpolatedCount) << "\n";
+			helpLabel << L"Orbits Solved / Extrapolated: " << mSnapshot.mSolvedCount << L" / " << mSnapshot.mExtrapolatedCount << "\n";
+			helpLabel << L"Bodies per Update Tier:";
+			for (uint32_t count : tierBodyCounts)
+			{
+				helpLabel << L" " << count;
+			}
+			helpLabel << "\n";
+			helpLabel << L"Cycle Simulation Thread (M): ";
+			if (!mSimulation.Running())
+			{
+				helpLabel << L"Off";
+			}
+			else if (mSimulation.PipelineDepth() == 0)
+			{
+				helpLabel << L"Newest Snapshot";
+			}
+			else
+			{
+				helpLabel << L"Pipelined " << mSimulation.PipelineDepth() << L" Deep, Fence Wait " << duration<float, milli>(mSimulation.FenceWaitTime()).count() << L" ms";
+			}
+			helpLabel << "\n";
 			helpLabel << L"Toggle Skybox (Y)" << "\n";
 			helpLabel << L"Next Body / Previous Body (Left / Right)" << "\n";
 			helpLabel << L"Toggle Camera Locking (L)" << "\n";
@@ -316,6 +530,112 @@ namespace Rendering
 	void SolarSystemDemo::ToggleAnimation()
 	{
 		mAnimationEnabled = !mAnimationEnabled;
+		mSimulation.SetAdvancing(mAnimationEnabled);
+	}
+
+	void SolarSystemDemo::CycleSimulationThread()
+	{
+		// the depth only changes across a restart, which lets the pipeline drain first
+		if (!mSimulation.Running())
+		{
+			mSimulation.SetPipelineDepth(0);
+			mSimulation.Start();
+			return;
+		}
+
+		mSimulation.Stop();
+		if (mSimulation.PipelineDepth() < SimulationThread::MaxPipelineDepth)
+		{
+			mSimulation.SetPipelineDepth(mSimulation.PipelineDepth() + 1);
+			mSimulation.Start();
+		}
+	}
+
+	void SolarSystemDemo::SpawnDebris(const GameTime& gameTime)
+	{
+		// only whole bodies are spawned, and the remainder carries over to the next frame
+		mPendingSpawns += SpawnRate * gameTime.ElapsedGameTimeSeconds().count();
+		uint32_t count = static_cast<uint32_t>(mPendingSpawns);
+		if (count == 0)
+		{
+			return;
+		}
+		mPendingSpawns -= count;
+
+		uint32_t parent = mActiveBodyIndex;
+		uint32_t seed = mSpawnSeed++;
+		double lifetime = DebrisLifetime;
+		mSimulation.Post([parent, seed, count, lifetime](BodySystem& bodySystem)
+		{
+			if (bodySystem.GravitationalParameter(parent) <= 0)
+			{
+				return;
+			}
+
+			// two to six diameters out, on mildly eccentric and inclined orbits with the period of the parent's gravity
+			mt19937 generator(seed);
+			uniform_real_distribution<float> unit(0.0f, 1.0f);
+			float diameter = bodySystem.States().Scale(parent);
+			SpawnedBody body;
+			body.mParent = parent;
+			body.mDiameter = diameter * 0.02f;
+			body.mExpiry = bodySystem.SimulationTime() + lifetime;
+			for (uint32_t index = 0; index < count; ++index)
+			{
+				OrbitalElements& orbit = body.mElements;
+				orbit.mSemiMajorAxis = diameter * (2.0f + 4.0f * unit(generator));
+				orbit.mEccentricity = 0.2f * unit(generator);
+				orbit.mInclination = XM_PIDIV4 * unit(generator);
+				orbit.mLongitudeOfAscendingNode = XM_2PI * unit(generator);
+				orbit.mArgumentOfPeriapsis = XM_2PI * unit(generator);
+				orbit.mMeanAnomaly = XM_2PI * unit(generator);
+				orbit.mPeriod = 0;
+				bodySystem.SpawnBody(body);
+			}
+		});
+	}
+
+	void SolarSystemDemo::LaunchProbes(const GameTime& gameTime)
+	{
+		mPendingLaunches += ProbeLaunchRate * gameTime.ElapsedGameTimeSeconds().count();
+		uint32_t count = static_cast<uint32_t>(mPendingLaunches);
+		if (count == 0)
+		{
+			return;
+		}
+		mPendingLaunches -= count;
+
+		uint32_t parent = mActiveBodyIndex;
+		uint32_t seed = mLaunchSeed++;
+		mSimulation.Post([parent, seed, count](BodySystem& bodySystem)
+		{
+			if (bodySystem.GravitationalParameter(parent) <= 0)
+			{
+				return;
+			}
+
+			// two to three diameters out, prograde in the parent's equator at 1.1 to 1.5 times the circular speed, so that
+			// some stay bound and the rest leave through the sphere of influence
+			mt19937 generator(seed);
+			uniform_real_distribution<double> unit(0.0, 1.0);
+			double diameter = bodySystem.States().Scale(parent);
+			Spacecraft spacecraft = {};
+			spacecraft.mParent = parent;
+			spacecraft.mSize = static_cast<float>(diameter * 0.02);
+			for (uint32_t index = 0; index < count; ++index)
+			{
+				double radius = diameter * (2.0 + unit(generator));
+				double angle = XM_2PI * unit(generator);
+				double speed = sqrt(bodySystem.GravitationalParameter(parent) / radius) * (1.1 + 0.4 * unit(generator));
+				spacecraft.mPosition[0] = radius * cos(angle);
+				spacecraft.mPosition[1] = 0;
+				spacecraft.mPosition[2] = radius * sin(angle);
+				spacecraft.mVelocity[0] = -speed * sin(angle);
+				spacecraft.mVelocity[1] = 0;
+				spacecraft.mVelocity[2] = speed * cos(angle);
+				bodySystem.LaunchSpacecraft(spacecraft);
+			}
+		});
 	}
 
 	bool SolarSystemDemo::UpdateCelestialLight(const GameTime& gameTime)
@@ -344,9 +664,115 @@ namespace Rendering
 		return updateCBuffer;
 	}
 
+	void SolarSystemDemo::ResetCamera()
+	{
+		mCamera->Reset();
+		mSnapshot.mTransforms.SetOrigin(WorldPosition());
+	}
+
+	void SolarSystemDemo::RebaseToCamera(const GameTime& gameTime)
+	{
+		// the camera's own offset is folded into the render origin, so it always draws from the origin of float space
+		const XMFLOAT3& cameraPosition = mCamera->Position();
+		WorldPosition origin = mSnapshot.mTransforms.Origin();
+		origin.mX += cameraPosition.x;
+		origin.mY += cameraPosition.y;
+		origin.mZ += cameraPosition.z;
+		mSnapshot.mTransforms.SetOrigin(origin);
+		mCamera->SetPosition(0.0f, 0.0f, 0.0f);
+		mCamera->UpdateViewMatrix();
+
+		// every render transform moved, so the orbits follow their parents again
+		for (auto& body : mCelestialBodies)
+		{
+			body.Update(gameTime);
+		}
+
+		// the sun's light sits at the world origin
+		mSunLight.SetPosition(static_cast<float>(-origin.mX), static_cast<float>(-origin.mY), static_cast<float>(-origin.mZ));
+		mVSCBufferPerFrameData.LightPosition = mSunLight.Position();
+		mPSCBufferPerFrameData.LightPosition = mSunLight.Position();
+		mGame->Direct3DDeviceContext()->UpdateSubresource(mVSCBufferPerFrame.Get(), 0, nullptr, &mVSCBufferPerFrameData, 0, 0);
+		mGame->Direct3DDeviceContext()->UpdateSubresource(mPSCBufferPerFrame.Get(), 0, nullptr, &mPSCBufferPerFrameData, 0, 0);
+	}
+
+	void SolarSystemDemo::ScheduleDetail()
+	{
+		// only the bodies around the camera are solved at every step, judged by what a pixel covers at their distance
+		const WorldPosition& origin = mSnapshot.mTransforms.Origin();
+		const XMFLOAT3& cameraPosition = mCamera->Position();
+		WorldPosition viewpoint = { origin.mX + cameraPosition.x, origin.mY + cameraPosition.y, origin.mZ + cameraPosition.z };
+		float pixelsPerRadian = mGame->Viewport().Height / static_cast<PerspectiveCamera*>(mCamera.get())->FieldOfView();
+		double stepSeconds = mSimulation.StepSeconds();
+		DetailScheduler* scheduler = &mDetailScheduler;
+		mSimulation.Post([scheduler, viewpoint, pixelsPerRadian, stepSeconds](BodySystem& bodySystem)
+		{
+			scheduler->Schedule(bodySystem.States(), viewpoint, pixelsPerRadian, stepSeconds);
+			bodySystem.SetUpdateIntervals(scheduler->Intervals());
+		});
+	}
+
+	void SolarSystemDemo::AcquireSnapshot(const GameTime& gameTime)
+	{
+		// snapshots arrive relative to the simulation's origin, and are moved to the one the camera was left at
+		WorldPosition origin = mSnapshot.mTransforms.Origin();
+		if (!mSimulation.Acquire(mSnapshot))
+		{
+			return;
+		}
+		mSnapshot.mTransforms.SetOrigin(origin);
+		if (mSnapshot.mReparentCount != mReparentCount)
+		{
+			ReparentBodies();
+		}
+
+		// bodies are stored parent before child, so a flat sweep sees every parent's final transform
+		for (auto& body : mCelestialBodies)
+		{
+			body.Update(gameTime);
+		}
+
+		if (mIsBeltsEnabled)
+		{
+			for (auto& belt : mBelts)
+			{
+				belt->Update(gameTime);
+			}
+		}
+
+		if (mParticleCloud != nullptr)
+		{
+			mParticleCloud->Update(gameTime);
+		}
+	}
+
+	void SolarSystemDemo::ReparentBodies()
+	{
+		for (auto& body : mCelestialBodies)
+		{
+			uint32_t parent = mSnapshot.mParents[body.Index()];
+			CelestialBody* current = mCelestialBodies.Find(body.Parent());
+			uint32_t currentParent = (current != nullptr) ? current->Index() : BodySystem::InvalidIndex;
+			if (parent == currentParent)
+			{
+				continue;
+			}
+
+			if (current != nullptr)
+			{
+				current->Release(body);
+			}
+			if (parent != BodySystem::InvalidIndex)
+			{
+				mCelestialBodies[mBodyHandles[parent]].Adopt(body);
+			}
+		}
+		mReparentCount = mSnapshot.mReparentCount;
+	}
+
 	void SolarSystemDemo::UpdateCameraPosition()
 	{
-		CelestialBody& body = mCelestialBodies[mActiveBodyIndex];
+		CelestialBody& body = mCelestialBodies[mBodyHandles[mActiveBodyIndex]];
 		XMFLOAT4 origin(0.0f, 0.0f, 0.0f, 1.0f);
 		XMVECTOR originVector = XMLoadFloat4(&origin);
 		XMVECTOR bodyPosition = XMVector4Transform(originVector, XMLoadFloat4x4(&body.WorldTransform()));
@@ -4,7 +4,15 @@
 #include "RenderStateHelper.h"
 #include <DirectXMath.h>
 #include "ConfigData.h"
+#include "ThreadPool.h"
+#include "BodySystem.h"
+#include "SimulationThread.h"
+#include "DetailScheduler.h"
 #include "CelestialBody.h"
+#include "Belt.h"
+#include "ParticleCloud.h"
+#include "SpawnedBodyCloud.h"
+#include "SlotMap.h"
 #include <unordered_map>
 
 namespace Library
@@ -30,6 +38,8 @@ namespace Rendering
 
 		bool AnimationEnabled() const;
 		void SetAnimationEnabled(bool enabled);
+		// Frames between the simulation of what is drawn and the frame drawing it.
+		std::uint32_t SimulationLatency() const;
 
 		void Initialize() override;
 		void Update(const Library::GameTime& gameTime) override;
@@ -96,14 +106,45 @@ namespace Rendering
 		void CreateVertexBuffer(const Library::Mesh& mesh, ID3D11Buffer** vertexBuffer) const;
 		void ToggleAnimation();
 		bool UpdateCelestialLight(const Library::GameTime& gameTime);
+		void ResetCamera();
+		// Moves the render origin to the camera and the camera to the origin, so everything is drawn camera relative.
+		void RebaseToCamera(const Library::GameTime& gameTime);
 		void UpdateCameraPosition();
+		void ScheduleDetail();
+		// Takes the newest snapshot the simulation published, if any, and refreshes everything drawn from it.
+		void AcquireSnapshot(const Library::GameTime& gameTime);
+		// Cycles between simulating inline, on a thread drawing the newest snapshot, and pipelined one or two frames deep.
+		void CycleSimulationThread();
+		// Scatters debris on short lived orbits about the active body, as many as accumulate over the frame at SpawnRate.
+		void SpawnDebris(const Library::GameTime& gameTime);
+		// Launches probes from near the active body at up to escape speed, as many as accumulate at ProbeLaunchRate.
+		void LaunchProbes(const Library::GameTime& gameTime);
+		// Moves every body whose dominant parent changed in the snapshot under its new parent.
+		void ReparentBodies();
 
 		static const float LightModulationRate;
 		static const float SunLightDefaultIntensity;
-
-		ConfigData mConfigData;
-		std::vector<CelestialBody> mCelestialBodies;
-		CelestialBody* mRootBody;
+		static const float SpawnRate;
+		static const float DebrisLifetime;
+		static const float ProbeLaunchRate;
+		static const DirectX::XMFLOAT4 DebrisColor;
+		static const DirectX::XMFLOAT4 ProbeColor;
+
+		Simulation::ConfigData mConfigData;
+		std::shared_ptr<Simulation::ThreadPool> mThreadPool;
+		Simulation::BodySystem mBodySystem;
+		// Only used by commands, which run wherever the simulation does, so it has to outlive the thread.
+		Simulation::DetailScheduler mDetailScheduler;
+		Simulation::SimulationThread mSimulation;
+		// Everything drawn reads this rather than the BodySystem, which belongs to the simulation thread while it runs.
+		Simulation::BodySnapshot mSnapshot;
+		Simulation::SlotMap<CelestialBody> mCelestialBodies;
+		// Handles of the catalog bodies by BodySystem index.
+		std::vector<Simulation::SlotHandle> mBodyHandles;
+		std::vector<std::shared_ptr<Belt>> mBelts;
+		std::shared_ptr<ParticleCloud> mParticleCloud;
+		std::shared_ptr<SpawnedBodyCloud> mSpawnedBodyCloud;
+		std::shared_ptr<SpawnedBodyCloud> mSpacecraftCloud;
 		std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> mColorTextures;
 
 		VSCBufferPerFrame mVSCBufferPerFrameData;
@@ -128,8 +169,15 @@ namespace Rendering
 		DirectX::XMFLOAT2 mTextPosition;
 		
 		std::uint32_t mActiveBodyIndex;
+		float mPendingSpawns;
+		std::uint32_t mSpawnSeed;
+		float mPendingLaunches;
+		std::uint32_t mLaunchSeed;
+		std::uint64_t mReparentCount;
 		bool mAnimationEnabled;
 		bool mIsOrbitsEnabled;
+		bool mIsBeltsEnabled;
+		bool mIsParticlesEnabled;
 		bool mIsCameraLocked;
 		bool mIsInfoDisplayOn;
 	};
@@ -0,0 +1,162 @@
+#include "pch.h"
+
+using namespace DirectX;
+using namespace Library;
+
+namespace Rendering
+{
+	RTTI_DEFINITIONS(SpawnedBodyCloud)
+
+	const std::uint32_t SpawnedBodyCloud::IndexCount = 24;
+
+	SpawnedBodyCloud::SpawnedBodyCloud(Game& game, const std::shared_ptr<Camera>& camera, const Simulation::BodySnapshot& snapshot,
+		const std::vector<XMFLOAT4>& instances, const std::vector<std::uint32_t>& parents, std::uint32_t capacity, const XMFLOAT4& color,
+		CelestialLight& light) :
+		DrawableGameComponent(game, camera), mVertexShader(nullptr), mPixelShader(nullptr), mInputLayout(nullptr), mVertexBuffer(nullptr),
+		mIndexBuffer(nullptr), mInstanceBuffer(nullptr), mVertexCBufferPerObject(nullptr), mVertexCBufferPerObjectData(), mSnapshot(snapshot),
+		mInstances(instances), mParents(parents), mCapacity(capacity), mColor(color), mLight(light)
+	{
+	}
+
+	void SpawnedBodyCloud::Initialize()
+	{
+		// Load a compiled vertex shader
+		std::vector<char> compiledVertexShader;
+		Utility::LoadBinaryFile(L"Content\\Shaders\\AsteroidBeltVS.cso", compiledVertexShader);
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateVertexShader(&compiledVertexShader[0], compiledVertexShader.size(), nullptr, mVertexShader.GetAddressOf()),
+			"ID3D11Device::CreatedVertexShader() failed.");
+
+		// Load a compiled pixel shader
+		std::vector<char> compiledPixelShader;
+		Utility::LoadBinaryFile(L"Content\\Shaders\\AsteroidBeltPS.cso", compiledPixelShader);
+		ThrowIfFailed(mGame->Direct3DDevice()->CreatePixelShader(&compiledPixelShader[0], compiledPixelShader.size(), nullptr, mPixelShader.GetAddressOf()),
+			"ID3D11Device::CreatedPixelShader() failed.");
+
+		// Create an input layout; the second slot steps once per body
+		D3D11_INPUT_ELEMENT_DESC inputElementDescriptions[] =
+		{
+			{"POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+			{"INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1}
+		};
+
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateInputLayout(inputElementDescriptions, ARRAYSIZE(inputElementDescriptions), &compiledVertexShader[0],
+			compiledVertexShader.size(), mInputLayout.GetAddressOf()), "ID3D11Device::CreateInputLayout() failed.");
+
+		// A unit-diameter octahedron, which the instance scales by the body's diameter
+		VertexPosition vertices[] =
+		{
+			VertexPosition(XMFLOAT4(0.5f, 0.0f, 0.0f, 1.0f)),
+			VertexPosition(XMFLOAT4(-0.5f, 0.0f, 0.0f, 1.0f)),
+			VertexPosition(XMFLOAT4(0.0f, 0.5f, 0.0f, 1.0f)),
+			VertexPosition(XMFLOAT4(0.0f, -0.5f, 0.0f, 1.0f)),
+			VertexPosition(XMFLOAT4(0.0f, 0.0f, 0.5f, 1.0f)),
+			VertexPosition(XMFLOAT4(0.0f, 0.0f, -0.5f, 1.0f))
+		};
+
+		UINT indices[] =
+		{
+			2, 4, 0,
+			2, 1, 4,
+			2, 5, 1,
+			2, 0, 5,
+			3, 0, 4,
+			3, 4, 1,
+			3, 1, 5,
+			3, 5, 0
+		};
+		assert(ARRAYSIZE(indices) == IndexCount);
+
+		D3D11_BUFFER_DESC vertexBufferDesc = {0};
+		vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		vertexBufferDesc.ByteWidth = sizeof(vertices);
+		vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA vertexSubResourceData = {0};
+		vertexSubResourceData.pSysMem = vertices;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexSubResourceData, mVertexBuffer.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+
+		D3D11_BUFFER_DESC indexBufferDesc = {0};
+		indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		indexBufferDesc.ByteWidth = sizeof(indices);
+		indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA indexSubResourceData = {0};
+		indexSubResourceData.pSysMem = indices;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&indexBufferDesc, &indexSubResourceData, mIndexBuffer.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+
+		// The instance buffer holds as many bodies as the simulation can spawn, and is rewritten every frame
+		D3D11_BUFFER_DESC instanceBufferDesc = {0};
+		instanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		instanceBufferDesc.ByteWidth = static_cast<UINT>(sizeof(XMFLOAT4) * mCapacity);
+		instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&instanceBufferDesc, nullptr, mInstanceBuffer.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+
+		// Create constant buffers
+		D3D11_BUFFER_DESC constantBufferDesc = {0};
+		constantBufferDesc.ByteWidth = sizeof(VertexCBufferPerObject);
+		constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		ThrowIfFailed(mGame->Direct3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, mVertexCBufferPerObject.GetAddressOf()),
+			"ID3D11Device::CreateBuffer() failed.");
+	}
+
+	std::uint32_t SpawnedBodyCloud::UpdateInstances()
+	{
+		const auto& instances = mInstances;
+		const auto& parents = mParents;
+		std::uint32_t count = static_cast<std::uint32_t>(std::min<size_t>(instances.size(), mCapacity));
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		ID3D11DeviceContext* direct3DDeviceContext = mGame->Direct3DDeviceContext();
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		ThrowIfFailed(direct3DDeviceContext->Map(mInstanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource), "ID3D11DeviceContext::Map() failed.");
+		XMFLOAT4* mapped = static_cast<XMFLOAT4*>(mappedResource.pData);
+		for (std::uint32_t index = 0; index < count; ++index)
+		{
+			const XMFLOAT4X4& parentTransform = mSnapshot.mTransforms.Transform(parents[index]);
+			const XMFLOAT4& instance = instances[index];
+			mapped[index] = XMFLOAT4(parentTransform._41 + instance.x, parentTransform._42 + instance.y, parentTransform._43 + instance.z, instance.w);
+		}
+		direct3DDeviceContext->Unmap(mInstanceBuffer.Get(), 0);
+		return count;
+	}
+
+	void SpawnedBodyCloud::Draw(const GameTime&)
+	{
+		// parents are placed on the CPU, since the render origin moves every frame
+		std::uint32_t count = UpdateInstances();
+		if (count == 0)
+		{
+			return;
+		}
+
+		ID3D11DeviceContext* direct3DDeviceContext = mGame->Direct3DDeviceContext();
+		direct3DDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		direct3DDeviceContext->IASetInputLayout(mInputLayout.Get());
+
+		ID3D11Buffer* vertexBuffers[] = {mVertexBuffer.Get(), mInstanceBuffer.Get()};
+		UINT strides[] = {sizeof(VertexPosition), sizeof(XMFLOAT4)};
+		UINT offsets[] = {0, 0};
+		direct3DDeviceContext->IASetVertexBuffers(0, ARRAYSIZE(vertexBuffers), vertexBuffers, strides, offsets);
+		direct3DDeviceContext->IASetIndexBuffer(mIndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+
+		direct3DDeviceContext->VSSetShader(mVertexShader.Get(), nullptr, 0);
+		direct3DDeviceContext->PSSetShader(mPixelShader.Get(), nullptr, 0);
+
+		XMStoreFloat4x4(&mVertexCBufferPerObjectData.ViewProjection, XMMatrixTranspose(mCamera->ViewProjectionMatrix()));
+		mVertexCBufferPerObjectData.Origin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		mVertexCBufferPerObjectData.LightPosition = mLight.Position();
+		mVertexCBufferPerObjectData.Color = mColor;
+
+		direct3DDeviceContext->UpdateSubresource(mVertexCBufferPerObject.Get(), 0, nullptr, &mVertexCBufferPerObjectData, 0, 0);
+		direct3DDeviceContext->VSSetConstantBuffers(0, 1, mVertexCBufferPerObject.GetAddressOf());
+
+		direct3DDeviceContext->DrawIndexedInstanced(IndexCount, count, 0, 0, 0);
+	}
+}
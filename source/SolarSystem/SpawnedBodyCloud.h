@@ -0,0 +1,72 @@
+#pragma once
+
+#include "DrawableGameComponent.h"
+#include <wrl.h>
+#include <d3d11_2.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+namespace Simulation
+{
+	struct BodySnapshot;
+}
+
+namespace Rendering
+{
+	class CelestialLight;
+
+	// Draws the bodies spawned at runtime as small octahedra in one instanced call, with the asteroid belt shaders. Their
+	// instances in the drawn BodySnapshot are relative to parents that differ from body to body, so Draw places each on
+	// its parent's render transform, after the renderer has rebased it, into a dynamic buffer sized to the capacity. Debris
+	// and spacecraft are each one cloud, drawing their own instance and parent lists of the snapshot in their own color.
+	class SpawnedBodyCloud final : public Library::DrawableGameComponent
+	{
+		RTTI_DECLARATIONS(SpawnedBodyCloud, DrawableGameComponent)
+
+	public:
+		SpawnedBodyCloud(Library::Game& game, const std::shared_ptr<Library::Camera>& camera, const Simulation::BodySnapshot& snapshot,
+			const std::vector<DirectX::XMFLOAT4>& instances, const std::vector<std::uint32_t>& parents, std::uint32_t capacity, const DirectX::XMFLOAT4& color,
+			CelestialLight& light);
+
+		SpawnedBodyCloud() = delete;
+		SpawnedBodyCloud(const SpawnedBodyCloud&) = delete;
+		SpawnedBodyCloud& operator=(const SpawnedBodyCloud&) = delete;
+
+		void Initialize() override;
+		void Draw(const Library::GameTime& gameTime) override;
+
+	private:
+		struct VertexCBufferPerObject
+		{
+			DirectX::XMFLOAT4X4 ViewProjection;
+			DirectX::XMFLOAT3 Origin;
+			float Padding1;
+			DirectX::XMFLOAT3 LightPosition;
+			float Padding2;
+			DirectX::XMFLOAT4 Color;
+
+			VertexCBufferPerObject() { }
+		};
+
+		std::uint32_t UpdateInstances();
+
+		static const std::uint32_t IndexCount;
+
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> mVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader> mPixelShader;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout> mInputLayout;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mVertexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mIndexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mInstanceBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mVertexCBufferPerObject;
+		VertexCBufferPerObject mVertexCBufferPerObjectData;
+
+		const Simulation::BodySnapshot& mSnapshot;
+		const std::vector<DirectX::XMFLOAT4>& mInstances;
+		const std::vector<std::uint32_t>& mParents;
+		std::uint32_t mCapacity;
+		DirectX::XMFLOAT4 mColor;
+		CelestialLight& mLight;
+	};
+}
@@ -1,4 +1,4 @@
-#pragma once
+﻿#pragma once
 
 // Windows
 #include <windows.h>
@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <functional>
 #include <limits>
+#include <random>
 
 #if defined(DEBUG) || defined(_DEBUG)
 #define _CRTDBG_MAP_ALLOC
@@ -83,8 +84,24 @@
 #include "GamePadComponent.h"
 #include "Grid.h"
 #include "Orbit.h"
+#include "Belt.h"
+#include "ParticleCloud.h"
+#include "SpawnedBodyCloud.h"
 #include "CeledtialBodyData.h"
 
+// Simulation
+#include "ConfigData.h"
+#include "ThreadPool.h"
+#include "AsteroidBelt.h"
+#include "ParticleSystem.h"
+#include "SlotMap.h"
+#include "SpawnedBodies.h"
+#include "BodySystem.h"
+#include "SimulationThread.h"
+#include "Ephemeris.h"
+#include "FixedTimestep.h"
+#include "DetailScheduler.h"
+
 // Library.Desktop
 #include "UtilityWin32.h"
 
@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "CheckpointReports.h"
+#include "GravityBenchmarks.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Simulation;
+
+namespace SimulationStepper
+{
+	namespace
+	{
+		template <typename T>
+		bool SameArray(const vector<T>& first, const vector<T>& second)
+		{
+			return first.size() == second.size() && memcmp(first.data(), second.data(), first.size() * sizeof(T)) == 0;
+		}
+
+		// Whether two systems hold the same bits after blending both to their last Update.
+		bool SameSystem(BodySystem& first, BodySystem& second)
+		{
+			first.Interpolate(1.0f);
+			second.Interpolate(1.0f);
+			bool same = first.SimulationTime() == second.SimulationTime() && first.BodyCount() == second.BodyCount() && first.BeltCount() == second.BeltCount() &&
+				SameState(first.GravityState(), second.GravityState()) && SameArray(first.Spawned().Instances(), second.Spawned().Instances()) &&
+				SameArray(first.Fleet().Instances(), second.Fleet().Instances()) && first.Fleet().TransitionCount() == second.Fleet().TransitionCount();
+			for (uint32_t index = 0; same && index < first.BodyCount(); ++index)
+			{
+				WorldPosition firstPosition = first.States().PrecisePosition(index);
+				WorldPosition secondPosition = second.States().PrecisePosition(index);
+				same = memcmp(&firstPosition, &secondPosition, sizeof(WorldPosition)) == 0 && first.DominantParent(index) == second.DominantParent(index) &&
+					first.Paused(index) == second.Paused(index);
+			}
+			for (uint32_t index = 0; same && index < first.BeltCount(); ++index)
+			{
+				same = SameArray(first.Belt(index).Instances(), second.Belt(index).Instances());
+			}
+			return same;
+		}
+	}
+
+	void ReportCheckpoint(const string& configFile, const function<void(BodySystem&, const ConfigData&)>& configure,
+		const function<void(BodySystem&)>& attach, const string& path, uint64_t stepCount, float timestep)
+	{
+		auto startTime = high_resolution_clock::now();
+		ConfigData configData;
+		configData.LoadConfigData(configFile);
+		BodySystem straight;
+		configure(straight, configData);
+		double initializeSeconds = duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+
+		uint32_t bodyCount = straight.BodyCount();
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			float diameter = straight.States().Scale(index);
+			if (straight.Parent(index) == BodySystem::InvalidIndex || straight.GravitationalParameter(index) <= 0 || diameter <= 0)
+			{
+				continue;
+			}
+
+			SpawnedBody body = {};
+			body.mParent = index;
+			body.mDiameter = diameter * 0.02f;
+			body.mExpiry = numeric_limits<double>::infinity();
+			body.mElements.mSemiMajorAxis = diameter * 3.0f;
+			body.mElements.mEccentricity = 0.1f;
+			straight.SpawnBody(body);
+
+			double radius = diameter * 3.0;
+			Spacecraft spacecraft = {};
+			spacecraft.mParent = index;
+			spacecraft.mPosition[0] = radius;
+			spacecraft.mVelocity[2] = sqrt(straight.GravitationalParameter(index) / radius) * 1.2;
+			spacecraft.mSize = 1.0f;
+			straight.LaunchSpacecraft(spacecraft);
+		}
+
+		uint64_t savedStep = stepCount / 2;
+		uint32_t thawedBody = min(1U, bodyCount - 1);
+		uint32_t pausedBody = bodyCount - 1;
+		straight.SetPaused(thawedBody, true);
+		for (uint64_t step = 0; step < savedStep; ++step)
+		{
+			if (step == savedStep / 2)
+			{
+				straight.SetPaused(thawedBody, false);
+				straight.SetPaused(pausedBody, true);
+			}
+			straight.Update(timestep);
+		}
+
+		startTime = high_resolution_clock::now();
+		straight.SaveCheckpoint(path);
+		double saveSeconds = duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+		for (uint64_t step = savedStep; step < stepCount; ++step)
+		{
+			straight.Update(timestep);
+		}
+
+		BodySystem resumed;
+		attach(resumed);
+		startTime = high_resolution_clock::now();
+		resumed.RestoreCheckpoint(path);
+		double restoreSeconds = duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+		for (uint64_t step = savedStep; step < stepCount; ++step)
+		{
+			resumed.Update(timestep);
+		}
+
+		Checkpoint checkpoint(path);
+		cerr << "Checkpoint " << path << " at " << (savedStep * timestep) << "s\n";
+		cerr << "  Sections: " << checkpoint.SectionCount() << "\n";
+		cerr << "  File size (bytes): " << checkpoint.FileSize() << "\n";
+		cerr << "  Save wall time (ms): " << saveSeconds * 1000 << "\n";
+		cerr << "  Restore wall time (ms): " << restoreSeconds * 1000 << "\n";
+		cerr << "  Parse and initialize wall time (ms): " << initializeSeconds * 1000 << "\n";
+		bool same = SameSystem(straight, resumed);
+		cerr << "  Resumed run matches uninterrupted: " << (same ? "yes" : "no") << "\n";
+		if (!same)
+		{
+			throw runtime_error("Run resumed from " + path + " differs from the uninterrupted run");
+		}
+	}
+}
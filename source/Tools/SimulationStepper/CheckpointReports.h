@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace Simulation
+{
+	class BodySystem;
+	class ConfigData;
+}
+
+namespace SimulationStepper
+{
+	// Steps a system halfway, with a body paused and thawed, another left paused, and a spawned body and a craft about
+	// every massive body, saves a checkpoint there and steps on to the end. A second system restored from the checkpoint
+	// steps the second half and must land on the same bits, and the restore is timed against parsing the catalog and
+	// initializing from it.
+	void ReportCheckpoint(const std::string& configFile, const std::function<void(Simulation::BodySystem&, const Simulation::ConfigData&)>& configure,
+		const std::function<void(Simulation::BodySystem&)>& attach, const std::string& path, std::uint64_t stepCount, float timestep);
+}
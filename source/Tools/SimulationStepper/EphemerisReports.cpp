@@ -0,0 +1,193 @@
+#include "pch.h"
+#include "EphemerisReports.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Simulation;
+
+namespace SimulationStepper
+{
+	namespace
+	{
+		const uint32_t EphemerisChecksPerRecord = 7;
+		const uint32_t EphemerisBenchmarkEvaluations = 100000;
+		const double EphemerisTolerance = 2e-6;
+		const double EphemerisMinDistance = 1e-3;
+
+		// Shortest motion in each body's parent relative position: its own orbit at periapsis, and under gravity also the
+		// wobble its satellites pull it through.
+		vector<double> EphemerisPeriods(const BodySystem& bodySystem)
+		{
+			vector<double> periods(bodySystem.BodyCount());
+			for (uint32_t index = 0; index < bodySystem.BodyCount(); ++index)
+			{
+				periods[index] = EphemerisBuilder::PeriapsisPeriod(bodySystem.OrbitalPeriod(index), bodySystem.Data(index).mEccentricity);
+			}
+
+			if (bodySystem.Mode() == SimulationMode::NBody)
+			{
+				for (uint32_t index = bodySystem.BodyCount(); index > 0; --index)
+				{
+					uint32_t parent = bodySystem.Parent(index - 1);
+					double period = periods[index - 1];
+					if (parent != BodySystem::InvalidIndex && period > 0)
+					{
+						periods[parent] = (periods[parent] > 0) ? min(periods[parent], period) : period;
+					}
+				}
+			}
+			return periods;
+		}
+	}
+
+	void BuildEphemeris(BodySystem& bodySystem, double span, uint32_t degree, const string& path)
+	{
+		vector<double> periods = EphemerisPeriods(bodySystem);
+		double longestPeriod = *max_element(periods.begin(), periods.end());
+		double recordLength = (longestPeriod > 0) ? (longestPeriod / EphemerisBuilder::SegmentsPerOrbit) : span;
+		recordLength = min(recordLength, max(span, 1.0));
+
+		vector<string> names(bodySystem.BodyCount());
+		vector<uint32_t> parents(bodySystem.BodyCount());
+		for (uint32_t index = 0; index < bodySystem.BodyCount(); ++index)
+		{
+			names[index] = bodySystem.Data(index).mName;
+			parents[index] = bodySystem.Parent(index);
+		}
+		EphemerisBuilder builder(names, parents, periods, bodySystem.SimulationTime(), recordLength, degree);
+
+		// check positions are taken between the fitting nodes, in the same pass so the propagator only runs forward
+		vector<double> checkTimes;
+		vector<WorldPosition> checkPositions;
+		vector<WorldPosition> samplePositions;
+		auto record = [&bodySystem](vector<WorldPosition>& positions)
+		{
+			for (uint32_t index = 0; index < bodySystem.BodyCount(); ++index)
+			{
+				positions.push_back(bodySystem.States().PrecisePosition(index));
+			}
+		};
+
+		auto startTime = high_resolution_clock::now();
+		double startSimulationTime = bodySystem.SimulationTime();
+		double endTime = startSimulationTime + span;
+		while (builder.RecordCount() == 0 || builder.SampleTimes().front() < endTime)
+		{
+			double recordStart = startSimulationTime + builder.RecordCount() * recordLength;
+			samplePositions.clear();
+			uint32_t check = 0;
+			for (double sampleTime : builder.SampleTimes())
+			{
+				for (; check < EphemerisChecksPerRecord; ++check)
+				{
+					double checkTime = recordStart + (check + 0.37) * recordLength / EphemerisChecksPerRecord;
+					if (checkTime >= sampleTime)
+					{
+						break;
+					}
+					bodySystem.Update(static_cast<float>(checkTime - bodySystem.SimulationTime()));
+					checkTimes.push_back(bodySystem.SimulationTime());
+					record(checkPositions);
+				}
+				bodySystem.Update(static_cast<float>(sampleTime - bodySystem.SimulationTime()));
+				record(samplePositions);
+			}
+			builder.AddRecord(samplePositions);
+		}
+		builder.Write(path);
+		double buildSeconds = duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+
+		Ephemeris ephemeris(path);
+		uint32_t bodyCount = ephemeris.BodyCount();
+		vector<float> positionX(bodyCount);
+		vector<float> positionY(bodyCount);
+		vector<float> positionZ(bodyCount);
+		vector<float> relativeX(bodyCount);
+		vector<float> relativeY(bodyCount);
+		vector<float> relativeZ(bodyCount);
+		vector<double> worldBounds(bodyCount);
+		auto distance = [](double x, double y, double z)
+		{
+			return sqrt(x * x + y * y + z * z);
+		};
+
+		// the fit is checked where it is made, relative to the parent, so a moon far from the origin answers for its own
+		// orbit; the world positions then only add the float rounding of the sum down the hierarchy, which is bounded on
+		// its own: the parent's bound, this body's fit tolerance and a float step of every partial sum
+		double maxError = 0;
+		double maxToleranceRatio = 0;
+		double maxRoundingRatio = 0;
+		uint32_t worstBody = 0;
+		uint32_t worstRoundingBody = 0;
+		for (size_t check = 0; check < checkTimes.size(); ++check)
+		{
+			ephemeris.EvaluateRelative(checkTimes[check], relativeX.data(), relativeY.data(), relativeZ.data());
+			ephemeris.Evaluate(checkTimes[check], positionX.data(), positionY.data(), positionZ.data());
+			const WorldPosition* expected = &checkPositions[check * bodyCount];
+			for (uint32_t index = 0; index < bodyCount; ++index)
+			{
+				uint32_t parent = ephemeris.Parent(index);
+				WorldPosition origin = { 0, 0, 0 };
+				const WorldPosition& parentPosition = (parent != Ephemeris::InvalidIndex) ? expected[parent] : origin;
+				double expectedX = expected[index].mX - parentPosition.mX;
+				double expectedY = expected[index].mY - parentPosition.mY;
+				double expectedZ = expected[index].mZ - parentPosition.mZ;
+				double relativeError = distance(relativeX[index] - expectedX, relativeY[index] - expectedY, relativeZ[index] - expectedZ);
+				double tolerance = EphemerisTolerance * max(EphemerisMinDistance, distance(expectedX, expectedY, expectedZ));
+				if (relativeError / tolerance > maxToleranceRatio)
+				{
+					maxToleranceRatio = relativeError / tolerance;
+					worstBody = index;
+				}
+
+				double worldDistance = distance(expected[index].mX, expected[index].mY, expected[index].mZ);
+				worldBounds[index] = tolerance + numeric_limits<float>::epsilon() * worldDistance +
+					((parent != Ephemeris::InvalidIndex) ? worldBounds[parent] : 0.0);
+				double worldError = distance(positionX[index] - expected[index].mX, positionY[index] - expected[index].mY, positionZ[index] - expected[index].mZ);
+				maxError = max(maxError, worldError);
+				if (worldError / worldBounds[index] > maxRoundingRatio)
+				{
+					maxRoundingRatio = worldError / worldBounds[index];
+					worstRoundingBody = index;
+				}
+			}
+		}
+
+		startTime = high_resolution_clock::now();
+		for (uint32_t evaluation = 0; evaluation < EphemerisBenchmarkEvaluations; ++evaluation)
+		{
+			double time = ephemeris.StartTime() + (ephemeris.EndTime() - ephemeris.StartTime()) * evaluation / EphemerisBenchmarkEvaluations;
+			ephemeris.Evaluate(time, positionX.data(), positionY.data(), positionZ.data());
+		}
+		double evaluateSeconds = duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+
+		uint32_t segmentCount = 0;
+		for (uint32_t index = 0; index < bodyCount; ++index)
+		{
+			segmentCount += ephemeris.SegmentCount(index);
+		}
+
+		cerr << "Ephemeris " << path << "\n";
+		cerr << "  Span (s): " << ephemeris.StartTime() << " to " << ephemeris.EndTime() << "\n";
+		cerr << "  Records: " << ephemeris.RecordCount() << " of " << ephemeris.RecordLength() << "s, " << segmentCount << " segments each\n";
+		cerr << "  Degree: " << ephemeris.Degree() << "\n";
+		cerr << "  File size (bytes): " << ephemeris.FileSize() << "\n";
+		cerr << "  Build wall time (s): " << buildSeconds << "\n";
+		cerr << "  Max world position error: " << maxError << "\n";
+		cerr << "  Max parent-relative error against tolerance: " << maxToleranceRatio << " (" << names[worstBody] << ")\n";
+		cerr << "  Max world error against rounding bound: " << maxRoundingRatio << " (" << names[worstRoundingBody] << ")\n";
+		cerr << "  Evaluations/sec (all bodies): " << ((evaluateSeconds > 0) ? (EphemerisBenchmarkEvaluations / evaluateSeconds) : 0.0) << "\n";
+
+		// a table that misses its own check would draw bodies off their paths, so it is not left for the demo to load
+		if (!(maxToleranceRatio <= 1.0))
+		{
+			remove(path.c_str());
+			throw runtime_error("Ephemeris misses its tolerance by a factor of " + to_string(maxToleranceRatio) + " on " + names[worstBody]);
+		}
+		if (!(maxRoundingRatio <= 1.0))
+		{
+			remove(path.c_str());
+			throw runtime_error("Ephemeris world positions miss their rounding bound by a factor of " + to_string(maxRoundingRatio) + " on " + names[worstRoundingBody]);
+		}
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Simulation
+{
+	class BodySystem;
+}
+
+namespace SimulationStepper
+{
+	// Propagates a freshly configured system over [0, span] through the sample times of an EphemerisBuilder, writes
+	// the table, and reports its size, its error at times between the fitting nodes and how fast it evaluates.
+	void BuildEphemeris(Simulation::BodySystem& bodySystem, double span, std::uint32_t degree, const std::string& path);
+}
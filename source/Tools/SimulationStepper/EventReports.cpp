@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "EventReports.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Simulation;
+
+namespace SimulationStepper
+{
+	namespace
+	{
+		const double DaysPerYear = 365.25;
+		const double EventTolerance = 1e-5;
+		const uint32_t ListedEventCount = 10;
+
+		const char* EventTypeName(OrbitalEventType type)
+		{
+			switch (type)
+			{
+			case OrbitalEventType::SolarEclipse:
+				return "Solar eclipse";
+			case OrbitalEventType::LunarEclipse:
+				return "Lunar eclipse";
+			case OrbitalEventType::Transit:
+				return "Transit";
+			default:
+				return "Close approach";
+			}
+		}
+
+		bool SameEvents(const vector<OrbitalEvent>& first, const vector<OrbitalEvent>& second)
+		{
+			return equal(first.begin(), first.end(), second.begin(), second.end(), [](const OrbitalEvent& left, const OrbitalEvent& right)
+			{
+				return left.mType == right.mType && left.mBody == right.mBody && left.mOther == right.mOther && left.mStart == right.mStart &&
+					left.mPeak == right.mPeak && left.mEnd == right.mEnd && left.mDistance == right.mDistance && left.mUmbral == right.mUmbral;
+			});
+		}
+	}
+
+	void ReportEvents(const ConfigData& configData, double years, float approachDistance, const shared_ptr<ThreadPool>& threadPool)
+	{
+		BodySystem eventSystem;
+		eventSystem.Initialize(configData);
+
+		EventQuery query;
+		query.mBegin = 0;
+		query.mEnd = years * DaysPerYear * eventSystem.Constants().mOrbitalPeriod;
+		query.mEclipses = true;
+		query.mTransits = true;
+		query.mCloseApproaches = (approachDistance > 0);
+		query.mCloseApproachDistance = approachDistance;
+		query.mTolerance = EventTolerance;
+
+		EventFinder finder(eventSystem);
+		auto startTime = high_resolution_clock::now();
+		vector<OrbitalEvent> events = (threadPool != nullptr) ? finder.Find(query, *threadPool) : finder.Find(query);
+		auto endTime = high_resolution_clock::now();
+
+		uint32_t counts[4] = {};
+		uint32_t umbralCounts[4] = {};
+		for (const OrbitalEvent& event : events)
+		{
+			++counts[static_cast<uint32_t>(event.mType)];
+			umbralCounts[static_cast<uint32_t>(event.mType)] += event.mUmbral ? 1 : 0;
+		}
+
+		cerr << "Events over " << years << " years (" << query.mEnd << "s, " << ((threadPool != nullptr) ? threadPool->ThreadCount() : 1) << " threads)\n";
+		cerr << "  Pair functions: " << finder.FunctionCount() << "\n";
+		cerr << "  Separation evaluations: " << finder.EvaluationCount() << "\n";
+		cerr << "  Wall time (s): " << duration_cast<duration<double>>(endTime - startTime).count() << "\n";
+		for (OrbitalEventType type : { OrbitalEventType::SolarEclipse, OrbitalEventType::LunarEclipse, OrbitalEventType::Transit, OrbitalEventType::CloseApproach })
+		{
+			uint32_t index = static_cast<uint32_t>(type);
+			cerr << "  " << EventTypeName(type) << " events: " << counts[index] << " (" << umbralCounts[index] << " umbral)\n";
+		}
+		for (uint32_t index = 0; index < min(ListedEventCount, static_cast<uint32_t>(events.size())); ++index)
+		{
+			const OrbitalEvent& event = events[index];
+			cerr << "    " << event.mStart << "s " << EventTypeName(event.mType) << ": " << eventSystem.Data(event.mBody).mName << ", "
+				<< eventSystem.Data(event.mOther).mName << " for " << (event.mEnd - event.mStart) << "s, closest " << event.mDistance << "\n";
+		}
+
+		if (threadPool != nullptr)
+		{
+			bool deterministic = SameEvents(events, finder.Find(query));
+			cerr << "  Same on one thread: " << (deterministic ? "yes" : "no") << "\n";
+			if (!deterministic)
+			{
+				throw runtime_error("Events differ between the threaded and the serial search");
+			}
+		}
+	}
+}
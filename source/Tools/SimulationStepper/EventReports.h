@@ -0,0 +1,16 @@
+#pragma once
+
+#include <memory>
+
+namespace Simulation
+{
+	class ConfigData;
+	class ThreadPool;
+}
+
+namespace SimulationStepper
+{
+	// Searches a fresh scripted system for every eclipse, transit and close approach over the years after time zero. With a
+	// thread pool the events must match a search on one thread.
+	void ReportEvents(const Simulation::ConfigData& configData, double years, float approachDistance, const std::shared_ptr<Simulation::ThreadPool>& threadPool);
+}
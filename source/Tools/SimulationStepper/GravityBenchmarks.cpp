@@ -0,0 +1,389 @@
+#include "pch.h"
+#include "GravityBenchmarks.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace DirectX;
+using namespace Simulation;
+
+namespace SimulationStepper
+{
+	namespace
+	{
+		const uint32_t MinTreeBenchmarkBodies = 10000;
+		const uint32_t AccuracySampleCount = 64;
+		const float BlockBenchmarkRadiusRatio = 100.0f;
+
+		// A cold disk of light bodies around one heavy body.
+		void InitializeDisk(NBodyState& state, uint32_t bodyCount)
+		{
+			state.Resize(bodyCount);
+			state.SetBody(0, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0e6f);
+			for (uint32_t index = 1; index < bodyCount; ++index)
+			{
+				float radius = 100.0f + (index % 1000) * 0.5f;
+				float angle = index * 2.39996323f;
+				float speed = sqrt(1.0e6f / radius);
+				state.SetBody(index, XMFLOAT3(radius * cos(angle), (index % 7) - 3.0f, radius * sin(angle)),
+					XMFLOAT3(-speed * sin(angle), 0.0f, speed * cos(angle)), 1.0e-3f);
+			}
+		}
+
+		// An equal-mass Gaussian cluster at rest. Force accuracy is measured on it rather than on the disk, where the exact
+		// pull of the heavy body swamps whatever error the tree makes in the rest.
+		void InitializeCluster(NBodyState& state, uint32_t bodyCount)
+		{
+			mt19937 generator(0);
+			normal_distribution<float> coordinate(0.0f, 100.0f);
+			state.Resize(bodyCount);
+			for (uint32_t index = 0; index < bodyCount; ++index)
+			{
+				XMFLOAT3 position(coordinate(generator), coordinate(generator), coordinate(generator));
+				state.SetBody(index, position, XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0e-3f);
+			}
+		}
+
+		struct ForceError
+		{
+			double mMean;
+			double mWorst;
+		};
+
+		// Mean and worst acceleration error of a sample of bodies, relative to a double precision direct sum.
+		ForceError RelativeForceError(const NBodyState& state, float softening)
+		{
+			ForceError error = { 0, 0 };
+			uint32_t sampleCount = 0;
+			uint32_t stride = max(state.Count() / AccuracySampleCount, 1U);
+			for (uint32_t target = stride / 2; target < state.Count(); target += stride)
+			{
+				double exact[3] = { 0, 0, 0 };
+				for (uint32_t source = 0; source < state.Count(); ++source)
+				{
+					double deltaX = static_cast<double>(state.PositionX()[source]) - state.PositionX()[target];
+					double deltaY = static_cast<double>(state.PositionY()[source]) - state.PositionY()[target];
+					double deltaZ = static_cast<double>(state.PositionZ()[source]) - state.PositionZ()[target];
+					double distanceSquared = deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ + static_cast<double>(softening) * softening;
+					if (distanceSquared > 0)
+					{
+						double strength = state.GravitationalParameters()[source] / (distanceSquared * sqrt(distanceSquared));
+						exact[0] += strength * deltaX;
+						exact[1] += strength * deltaY;
+						exact[2] += strength * deltaZ;
+					}
+				}
+
+				double errorX = state.AccelerationX()[target] - exact[0];
+				double errorY = state.AccelerationY()[target] - exact[1];
+				double errorZ = state.AccelerationZ()[target] - exact[2];
+				double magnitude = sqrt(exact[0] * exact[0] + exact[1] * exact[1] + exact[2] * exact[2]);
+				if (magnitude > 0)
+				{
+					double relative = sqrt(errorX * errorX + errorY * errorY + errorZ * errorZ) / magnitude;
+					error.mMean += relative;
+					error.mWorst = max(error.mWorst, relative);
+					++sampleCount;
+				}
+			}
+			error.mMean = (sampleCount > 0) ? (error.mMean / sampleCount) : 0.0;
+			return error;
+		}
+
+		void WriteForceError(const ForceError& error)
+		{
+			cerr << "    Relative force error (mean / worst): " << error.mMean << " / " << error.mWorst << "\n";
+		}
+
+		// Integrates a disk split across shardCount worker processes and reports the run; returns the wall time per step.
+		double RunShards(NBodyState& state, uint32_t bodyCount, uint32_t shardCount, uint64_t stepCount, float timestep, float openingAngle)
+		{
+			InitializeDisk(state, bodyCount);
+			ShardedGravity sharded;
+			sharded.SetShardCount(shardCount);
+			sharded.SetSoftening(0.1f);
+			sharded.SetOpeningAngle(openingAngle);
+			sharded.Run(state, timestep, stepCount);
+
+			double stepSeconds = (stepCount > 0) ? (sharded.StepSeconds() / stepCount) : 0.0;
+			cerr << "  Bodies: " << bodyCount << ", processes: " << shardCount << "\n";
+			cerr << "    Wall time per step (s): " << stepSeconds << "\n";
+			cerr << "    Interactions/sec: " << ((sharded.StepSeconds() > 0) ? (sharded.Interactions() / sharded.StepSeconds()) : 0.0) << "\n";
+			cerr << "    Exchange share of step time: " << ((sharded.StepSeconds() > 0) ? (sharded.ExchangeSeconds() / sharded.StepSeconds()) : 0.0) << "\n";
+			if (stepCount > 0)
+			{
+				cerr << "    Halo bodies / summaries per step: " << (sharded.HaloBodyCount() / stepCount) << " / " << (sharded.SummaryCount() / stepCount) << "\n";
+				cerr << "    Exchanged bytes per step: " << (sharded.ExchangedBytes() / stepCount) << "\n";
+			}
+			return stepSeconds;
+		}
+	}
+
+	void ReportReparenting(const BodySystem& bodySystem)
+	{
+		cerr << "  Parent changes: " << bodySystem.ReparentCount() << "\n";
+		for (uint32_t index = 0; index < bodySystem.BodyCount(); ++index)
+		{
+			uint32_t parent = bodySystem.DominantParent(index);
+			if (parent != bodySystem.Parent(index))
+			{
+				cerr << "  " << bodySystem.Data(index).mName << " now orbits " << ((parent != BodySystem::InvalidIndex) ? bodySystem.Data(parent).mName : string("nothing")) << "\n";
+			}
+		}
+	}
+
+	bool SameState(const NBodyState& first, const NBodyState& second)
+	{
+		uint32_t count = first.Count();
+		return count == second.Count() &&
+			memcmp(first.PositionX(), second.PositionX(), count * sizeof(float)) == 0 &&
+			memcmp(first.PositionY(), second.PositionY(), count * sizeof(float)) == 0 &&
+			memcmp(first.PositionZ(), second.PositionZ(), count * sizeof(float)) == 0 &&
+			memcmp(first.VelocityX(), second.VelocityX(), count * sizeof(float)) == 0 &&
+			memcmp(first.VelocityY(), second.VelocityY(), count * sizeof(float)) == 0 &&
+			memcmp(first.VelocityZ(), second.VelocityZ(), count * sizeof(float)) == 0;
+	}
+
+	void BenchmarkGravity(uint32_t bodyCount, uint64_t stepCount, float timestep, const shared_ptr<ThreadPool>& threadPool)
+	{
+		NBodyState state;
+		InitializeDisk(state, bodyCount);
+
+		DirectSummation solver;
+		solver.SetSoftening(0.1f);
+		solver.SetThreadPool(threadPool);
+		LeapfrogIntegrator integrator;
+		integrator.Initialize(state, solver);
+		solver.ResetInteractions();
+
+		auto startTime = high_resolution_clock::now();
+		for (uint64_t step = 0; step < stepCount; ++step)
+		{
+			integrator.Step(state, solver, timestep);
+		}
+		auto endTime = high_resolution_clock::now();
+
+		double wallSeconds = duration_cast<duration<double>>(endTime - startTime).count();
+		cerr << "Direct summation benchmark (" << ((threadPool != nullptr) ? threadPool->ThreadCount() : 1) << " threads)\n";
+		cerr << "  Bodies: " << bodyCount << "\n";
+		cerr << "  Steps: " << stepCount << "\n";
+		cerr << "  Wall time (s): " << wallSeconds << "\n";
+		cerr << "  Interactions/sec: " << ((wallSeconds > 0) ? (solver.Interactions() / wallSeconds) : 0.0) << "\n";
+	}
+
+	void BenchmarkBarnesHut(uint32_t maxBodyCount, uint64_t stepCount, float timestep, uint32_t maxThreadCount, float openingAngle)
+	{
+		vector<uint32_t> threadCounts;
+		for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+		{
+			threadCounts.push_back(threadCount);
+		}
+		threadCounts.push_back(max(maxThreadCount, 1U));
+
+		cerr << "Barnes-Hut benchmark (opening angle " << openingAngle << ")\n";
+		for (uint64_t bodyCount = min(MinTreeBenchmarkBodies, maxBodyCount); bodyCount <= maxBodyCount; bodyCount *= 10)
+		{
+			NBodyState state;
+			double singleThreadSeconds = 0;
+			for (uint32_t threadCount : threadCounts)
+			{
+				shared_ptr<ThreadPool> threadPool;
+				if (threadCount > 1)
+				{
+					threadPool = make_shared<ThreadPool>(threadCount);
+				}
+
+				InitializeDisk(state, static_cast<uint32_t>(bodyCount));
+				BarnesHut solver;
+				solver.SetSoftening(0.1f);
+				solver.SetOpeningAngle(openingAngle);
+				solver.SetThreadPool(threadPool);
+				LeapfrogIntegrator integrator;
+				integrator.Initialize(state, solver);
+				solver.ResetInteractions();
+
+				auto startTime = high_resolution_clock::now();
+				for (uint64_t step = 0; step < stepCount; ++step)
+				{
+					integrator.Step(state, solver, timestep);
+				}
+				auto endTime = high_resolution_clock::now();
+
+				double wallSeconds = duration_cast<duration<double>>(endTime - startTime).count();
+				if (threadCount == 1)
+				{
+					singleThreadSeconds = wallSeconds;
+				}
+
+				cerr << "  Bodies: " << bodyCount << ", threads: " << threadCount << "\n";
+				cerr << "    Nodes: " << solver.NodeCount() << "\n";
+				cerr << "    Wall time per step (s): " << ((stepCount > 0) ? (wallSeconds / stepCount) : 0.0) << "\n";
+				cerr << "    Interactions/sec: " << ((wallSeconds > 0) ? (solver.Interactions() / wallSeconds) : 0.0) << "\n";
+				cerr << "    Speedup: " << ((wallSeconds > 0) ? (singleThreadSeconds / wallSeconds) : 0.0) << "\n";
+			}
+
+			InitializeCluster(state, static_cast<uint32_t>(bodyCount));
+			BarnesHut solver;
+			solver.SetSoftening(0.1f);
+			solver.SetOpeningAngle(openingAngle);
+			solver.ComputeAccelerations(state);
+			WriteForceError(RelativeForceError(state, 0.1f));
+		}
+	}
+
+	void BenchmarkSharding(uint32_t bodyCount, uint64_t stepCount, float timestep, uint32_t maxShardCount, float openingAngle)
+	{
+		vector<uint32_t> shardCounts;
+		for (uint32_t shardCount = 1; shardCount < maxShardCount; shardCount *= 2)
+		{
+			shardCounts.push_back(shardCount);
+		}
+		shardCounts.push_back(max(maxShardCount, 1U));
+
+		cerr << "Sharded gravity benchmark, strong scaling (opening angle " << openingAngle << ")\n";
+		NBodyState state;
+		double singleSeconds = 0;
+		for (uint32_t shardCount : shardCounts)
+		{
+			double stepSeconds = RunShards(state, bodyCount, shardCount, stepCount, timestep, openingAngle);
+			if (shardCount == 1)
+			{
+				singleSeconds = stepSeconds;
+			}
+			cerr << "    Speedup: " << ((stepSeconds > 0) ? (singleSeconds / stepSeconds) : 0.0) << "\n";
+		}
+
+		NBodyState repeated;
+		RunShards(repeated, bodyCount, shardCounts.back(), stepCount, timestep, openingAngle);
+		bool same = SameState(state, repeated);
+		cerr << "    Same on a second run: " << (same ? "yes" : "no") << "\n";
+		if (!same)
+		{
+			throw runtime_error("Sharded gravity differs between two runs with " + to_string(shardCounts.back()) + " processes");
+		}
+
+		cerr << "Sharded gravity force accuracy on a cluster of " << bodyCount << " bodies\n";
+		for (uint32_t shardCount : shardCounts)
+		{
+			InitializeCluster(state, bodyCount);
+			ShardedGravity sharded;
+			sharded.SetShardCount(shardCount);
+			sharded.SetSoftening(0.1f);
+			sharded.SetOpeningAngle(openingAngle);
+			sharded.Run(state, timestep, 0);
+			cerr << "  Processes: " << shardCount << "\n";
+			WriteForceError(RelativeForceError(state, 0.1f));
+		}
+
+		cerr << "Sharded gravity benchmark, weak scaling\n";
+		for (uint32_t shardCount : shardCounts)
+		{
+			double stepSeconds = RunShards(state, bodyCount * shardCount, shardCount, stepCount, timestep, openingAngle);
+			if (shardCount == 1)
+			{
+				singleSeconds = stepSeconds;
+			}
+			cerr << "    Efficiency: " << ((stepSeconds > 0) ? (singleSeconds / stepSeconds) : 0.0) << "\n";
+		}
+	}
+
+	void BenchmarkBlockTimesteps(uint32_t bodyCount, uint64_t bigStepCount, const shared_ptr<ThreadPool>& threadPool)
+	{
+		const float centralParameter = 1.0e6f;
+		const float innerRadius = 10.0f;
+
+		NBodyState initialState;
+		initialState.Resize(bodyCount);
+		initialState.SetBody(0, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), centralParameter);
+		vector<double> preferredTimesteps(bodyCount);
+		double shortestTimestep = numeric_limits<double>::max();
+		double longestTimestep = 0;
+		for (uint32_t index = 1; index < bodyCount; ++index)
+		{
+			float radius = innerRadius * pow(BlockBenchmarkRadiusRatio, (index - 1) / static_cast<float>(max(bodyCount - 2, 1U)));
+			float angle = index * 2.39996323f;
+			float speed = sqrt(centralParameter / radius);
+			initialState.SetBody(index, XMFLOAT3(radius * cos(angle), 0.0f, radius * sin(angle)),
+				XMFLOAT3(-speed * sin(angle), 0.0f, speed * cos(angle)), 1.0e-3f);
+
+			double period = XM_2PI * sqrt(static_cast<double>(radius) * radius * radius / centralParameter);
+			preferredTimesteps[index] = period / BodySystem::PhysicsStepsPerOrbit;
+			shortestTimestep = min(shortestTimestep, preferredTimesteps[index]);
+			longestTimestep = max(longestTimestep, preferredTimesteps[index]);
+		}
+		// the central body is pulled around by its fastest satellites
+		preferredTimesteps[0] = shortestTimestep;
+		initialState.RemoveNetMomentum();
+
+		uint32_t deepestLevel = static_cast<uint32_t>(ceil(log2(longestTimestep / shortestTimestep)));
+		uint64_t sharedStepCount = bigStepCount << deepestLevel;
+		double sharedTimestep = longestTimestep / (1u << deepestLevel);
+
+		cerr << "Block timestep benchmark (" << ((threadPool != nullptr) ? threadPool->ThreadCount() : 1) << " threads)\n";
+		cerr << "  Bodies: " << bodyCount << "\n";
+		cerr << "  Simulated time: " << bigStepCount * longestTimestep << "\n";
+
+		const float softening = 0.1f;
+		double sharedSeconds = 0;
+		for (uint32_t pass = 0; pass < 2; ++pass)
+		{
+			NBodyState state;
+			state.Resize(bodyCount);
+			for (uint32_t index = 0; index < bodyCount; ++index)
+			{
+				state.SetBody(index, initialState.Position(index), initialState.Velocity(index), initialState.GravitationalParameter(index));
+			}
+
+			DirectSummation solver;
+			solver.SetSoftening(softening);
+			solver.SetThreadPool(threadPool);
+			unique_ptr<Integrator> integrator;
+			BlockTimestepIntegrator* blockIntegrator = nullptr;
+			if (pass == 0)
+			{
+				integrator = make_unique<LeapfrogIntegrator>();
+			}
+			else
+			{
+				auto block = make_unique<BlockTimestepIntegrator>(preferredTimesteps);
+				blockIntegrator = block.get();
+				integrator = move(block);
+			}
+			integrator->Initialize(state, solver);
+			solver.ResetInteractions();
+			double initialEnergy = state.KineticEnergy() + state.PotentialEnergy(softening);
+
+			auto startTime = high_resolution_clock::now();
+			uint64_t stepCount = (pass == 0) ? sharedStepCount : bigStepCount;
+			double timestep = (pass == 0) ? sharedTimestep : longestTimestep;
+			for (uint64_t step = 0; step < stepCount; ++step)
+			{
+				integrator->Step(state, solver, timestep);
+			}
+			auto endTime = high_resolution_clock::now();
+
+			double wallSeconds = duration_cast<duration<double>>(endTime - startTime).count();
+			double energy = state.KineticEnergy() + state.PotentialEnergy(softening);
+			if (pass == 0)
+			{
+				sharedSeconds = wallSeconds;
+			}
+
+			cerr << ((pass == 0) ? "  Shared timestep\n" : "  Block timesteps\n");
+			cerr << "    Steps: " << stepCount << "\n";
+			cerr << "    Wall time (s): " << wallSeconds << "\n";
+			cerr << "    Interactions: " << solver.Interactions() << "\n";
+			cerr << "    Speedup: " << ((wallSeconds > 0) ? (sharedSeconds / wallSeconds) : 0.0) << "\n";
+			cerr << "    Relative energy drift: " << (energy - initialEnergy) / fabs(initialEnergy) << "\n";
+			if (blockIntegrator != nullptr)
+			{
+				vector<uint32_t> population = blockIntegrator->LevelPopulation();
+				cerr << "    Bodies per level:";
+				for (uint32_t level = 0; level <= deepestLevel; ++level)
+				{
+					cerr << " " << population[level];
+				}
+				cerr << "\n";
+			}
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+namespace Simulation
+{
+	class BodySystem;
+	class NBodyState;
+	class ThreadPool;
+}
+
+namespace SimulationStepper
+{
+	// Lists the bodies the dynamic hierarchy moved away from their catalog parents by the end of the run.
+	void ReportReparenting(const Simulation::BodySystem& bodySystem);
+	bool SameState(const Simulation::NBodyState& first, const Simulation::NBodyState& second);
+
+	// Integrates a cold disk of light bodies around one heavy body with the direct summation solver.
+	void BenchmarkGravity(std::uint32_t bodyCount, std::uint64_t stepCount, float timestep, const std::shared_ptr<Simulation::ThreadPool>& threadPool);
+
+	// Integrates disks of 10^4, 10^5, ... bodies up to maxBodyCount with the Barnes-Hut solver on 1, 2, 4, ... up to
+	// maxThreadCount threads, reporting throughput and speedup over one thread, and the force accuracy on a cluster of as
+	// many bodies.
+	void BenchmarkBarnesHut(std::uint32_t maxBodyCount, std::uint64_t stepCount, float timestep, std::uint32_t maxThreadCount, float openingAngle);
+
+	// Integrates the disk split across 1, 2, 4, ... up to maxShardCount worker processes. Strong scaling keeps bodyCount
+	// bodies whatever the number of processes and reports the speedup over one; weak scaling gives every process
+	// bodyCount bodies and reports the efficiency, one process's time over the time of many. The largest strong scaling
+	// run is repeated to check the processes give the same answer however they happen to be scheduled. The force accuracy
+	// is measured on a cluster of bodyCount bodies, as for BenchmarkBarnesHut.
+	void BenchmarkSharding(std::uint32_t bodyCount, std::uint64_t stepCount, float timestep, std::uint32_t maxShardCount, float openingAngle);
+
+	// Light bodies around one heavy body at radii spread evenly in log r over a hundredfold, so their periods span a
+	// thousandfold and the block levels are about equally populated. Integrates bigStepCount steps of the slowest body's
+	// preferred timestep with block timesteps, and the same time with a shared step as short as the fastest body's.
+	void BenchmarkBlockTimesteps(std::uint32_t bodyCount, std::uint64_t bigStepCount, const std::shared_ptr<Simulation::ThreadPool>& threadPool);
+}
@@ -0,0 +1,195 @@
+#include "pch.h"
+#include "KernelBenchmarks.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace DirectX;
+using namespace Simulation;
+
+namespace SimulationStepper
+{
+	namespace
+	{
+		const float DetailPixelsPerRadian = 1080.0f / XM_PIDIV4;
+		const float DetailViewpointOffset = 1.0f;
+		// short enough that the bodies away from the viewpoint go several steps between solves
+		const float DetailTimestep = 0.1f;
+		const uint32_t FrozenBenchmarkMovingFraction = 10;
+
+		// Steps the kernel DetailTimestep at a time with update intervals scheduled every step from a viewpoint just beside
+		// the first child, then checks every body against its exact orbit. The error bound holds for each level of the
+		// hierarchy, and the bodies here all orbit the root directly.
+		void BenchmarkDetail(BodyStateStore& states, uint64_t stepCount, const shared_ptr<ThreadPool>& threadPool, const vector<uint32_t>& levelOffsets)
+		{
+			float timestep = DetailTimestep;
+			uint32_t bodyCount = states.Count();
+			WorldPosition viewpoint = states.PrecisePosition(min(1U, bodyCount - 1));
+			viewpoint.mX += DetailViewpointOffset;
+
+			// the plain run left the kernel at its end time, so nothing can be extrapolated from there
+			states.Invalidate();
+			DetailScheduler scheduler;
+			uint64_t solvedBodies = 0;
+			uint64_t extrapolatedBodies = 0;
+			auto startTime = high_resolution_clock::now();
+			for (uint64_t step = 1; step <= stepCount; ++step)
+			{
+				scheduler.Schedule(states, viewpoint, DetailPixelsPerRadian, timestep);
+				states.SetUpdateIntervals(scheduler.Intervals());
+				if (threadPool != nullptr)
+				{
+					states.Evaluate(step * static_cast<double>(timestep), *threadPool, levelOffsets);
+				}
+				else
+				{
+					states.Evaluate(step * static_cast<double>(timestep));
+				}
+				solvedBodies += states.ComposedCount();
+				extrapolatedBodies += states.ExtrapolatedCount();
+			}
+			auto endTime = high_resolution_clock::now();
+
+			string threads = to_string((threadPool != nullptr) ? threadPool->ThreadCount() : 1) + " threads";
+			ReportThroughput("Kernel benchmark with level of detail (" + threads + ")", bodyCount, stepCount, duration_cast<duration<double>>(endTime - startTime).count());
+			if (stepCount > 0)
+			{
+				cerr << "  Orbits solved / extrapolated per step: " << (solvedBodies / stepCount) << " / " << (extrapolatedBodies / stepCount) << "\n";
+			}
+			cerr << "  Bodies per tier:";
+			for (uint32_t tier = 0; tier < DetailScheduler::TierCount; ++tier)
+			{
+				cerr << " " << scheduler.TierBodyCount(tier);
+			}
+			cerr << "\n";
+			// the first step solves every body
+			if (stepCount > 1 && extrapolatedBodies == 0)
+			{
+				throw runtime_error("Level of detail extrapolated no body");
+			}
+
+			// bodies are spread over their intervals, so the last step holds every age of extrapolation
+			double maxError = 0;
+			double time = stepCount * static_cast<double>(timestep);
+			for (uint32_t index = 0; index < bodyCount; ++index)
+			{
+				XMFLOAT3 exact;
+				XMStoreFloat3(&exact, states.EvaluateWorldPosition(index, time));
+				WorldPosition position = states.PrecisePosition(index);
+				double x = position.mX - viewpoint.mX;
+				double y = position.mY - viewpoint.mY;
+				double z = position.mZ - viewpoint.mZ;
+				double radius = states.Scale(index) / 2.0;
+				double distance = max(sqrt(x * x + y * y + z * z) - radius, DetailScheduler::NearDistance);
+				double errorX = position.mX - exact.x;
+				double errorY = position.mY - exact.y;
+				double errorZ = position.mZ - exact.z;
+				maxError = max(maxError, sqrt(errorX * errorX + errorY * errorY + errorZ * errorZ) / distance * DetailPixelsPerRadian);
+			}
+			cerr << "  Max position error (pixels): " << maxError << "\n";
+			cerr << "  Within " << scheduler.MaxError() << " pixels: " << ((maxError <= scheduler.MaxError()) ? "yes" : "no") << "\n";
+			if (maxError > scheduler.MaxError())
+			{
+				throw runtime_error("Level of detail misses its pixel error bound by a factor of " + to_string(maxError / scheduler.MaxError()));
+			}
+		}
+	}
+
+	void ReportThroughput(const string& label, uint32_t bodyCount, uint64_t stepCount, double wallSeconds)
+	{
+		uint64_t bodyUpdates = stepCount * bodyCount;
+		cerr << label << "\n";
+		cerr << "  Bodies: " << bodyCount << "\n";
+		cerr << "  Steps: " << stepCount << "\n";
+		cerr << "  Wall time (s): " << wallSeconds << "\n";
+		cerr << "  Body updates/sec: " << ((wallSeconds > 0) ? (bodyUpdates / wallSeconds) : 0.0) << "\n";
+	}
+
+	void BenchmarkKernel(uint32_t bodyCount, uint64_t stepCount, float timestep, const shared_ptr<ThreadPool>& threadPool)
+	{
+		BodyStateStore states;
+		states.Resize(bodyCount);
+		states.SetBody(0, BodyStateStore::InvalidIndex, 50.0f, 0.0f, 60.0, OrbitalElements());
+		for (uint32_t index = 1; index < bodyCount; ++index)
+		{
+			OrbitalElements orbit;
+			orbit.mSemiMajorAxis = 1000.0f + (index % 1000);
+			orbit.mEccentricity = (index % 90) * 0.01f;
+			orbit.mInclination = XMConvertToRadians(static_cast<float>(index % 30));
+			orbit.mLongitudeOfAscendingNode = XMConvertToRadians(static_cast<float>(index % 360));
+			orbit.mArgumentOfPeriapsis = XMConvertToRadians(static_cast<float>((index * 7) % 360));
+			orbit.mMeanAnomaly = XMConvertToRadians(static_cast<float>((index * 13) % 360));
+			orbit.mPeriod = 0.006 * orbit.mSemiMajorAxis * orbit.mSemiMajorAxis;
+			states.SetBody(index, 0, 0.1f, XMConvertToRadians(static_cast<float>(index % 180)), 6.0, orbit);
+		}
+
+		// one root level and a single level of children under it
+		vector<uint32_t> levelOffsets = { 0, min(bodyCount, 1U), bodyCount };
+
+		auto run = [&](const string& label)
+		{
+			uint64_t updatedBodies = 0;
+			auto startTime = high_resolution_clock::now();
+			for (uint64_t step = 1; step <= stepCount; ++step)
+			{
+				if (threadPool != nullptr)
+				{
+					states.Evaluate(step * static_cast<double>(timestep), *threadPool, levelOffsets);
+				}
+				else
+				{
+					states.Evaluate(step * static_cast<double>(timestep));
+				}
+				updatedBodies += states.UpdatedCount();
+			}
+			auto endTime = high_resolution_clock::now();
+
+			ReportThroughput(label, bodyCount, stepCount, duration_cast<duration<double>>(endTime - startTime).count());
+			cerr << "  Transforms updated per step: " << ((stepCount > 0) ? (updatedBodies / stepCount) : 0) << "\n";
+		};
+
+		string threads = to_string((threadPool != nullptr) ? threadPool->ThreadCount() : 1) + " threads";
+		run("Kernel benchmark (" + threads + ")");
+		BenchmarkDetail(states, stepCount, threadPool, levelOffsets);
+		states.SetUpdateIntervals(vector<uint32_t>(bodyCount, 1));
+
+		// freeze all but the first tenth of the belt; whole frozen batches are skipped
+		for (uint32_t index = max(1U, bodyCount / FrozenBenchmarkMovingFraction); index < bodyCount; ++index)
+		{
+			states.SetFrozen(index, true, stepCount * static_cast<double>(timestep));
+		}
+		run("Kernel benchmark, " + to_string(100 - 100 / FrozenBenchmarkMovingFraction) + "% frozen (" + threads + ")");
+	}
+
+	void BenchmarkKeplerSolver(uint32_t count, uint64_t passCount)
+	{
+		vector<float> meanAnomalies(count);
+		vector<float> eccentricities(count);
+		vector<float> eccentricAnomalies(count);
+		for (uint32_t index = 0; index < count; ++index)
+		{
+			meanAnomalies[index] = XMScalarModAngle(index * 0.618034f);
+			eccentricities[index] = (index % 91) * 0.01f;
+		}
+
+		auto startTime = high_resolution_clock::now();
+		for (uint64_t pass = 0; pass < passCount; ++pass)
+		{
+			KeplerSolver::SolveEccentricAnomalies(meanAnomalies.data(), eccentricities.data(), eccentricAnomalies.data(), count);
+		}
+		auto endTime = high_resolution_clock::now();
+
+		float maxResidual = 0.0f;
+		for (uint32_t index = 0; index < count; ++index)
+		{
+			float residual = eccentricAnomalies[index] - eccentricities[index] * sin(eccentricAnomalies[index]) - meanAnomalies[index];
+			maxResidual = max(maxResidual, fabs(residual));
+		}
+
+		double wallSeconds = duration_cast<duration<double>>(endTime - startTime).count();
+		cerr << "Kepler solver benchmark\n";
+		cerr << "  Solves: " << count * passCount << "\n";
+		cerr << "  Wall time (s): " << wallSeconds << "\n";
+		cerr << "  Solves/sec: " << ((wallSeconds > 0) ? (count * passCount / wallSeconds) : 0.0) << "\n";
+		cerr << "  Max residual (rad): " << maxResidual << "\n";
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Simulation
+{
+	class ThreadPool;
+}
+
+namespace SimulationStepper
+{
+	void ReportThroughput(const std::string& label, std::uint32_t bodyCount, std::uint64_t stepCount, double wallSeconds);
+
+	// Steps a synthetic belt of bodies orbiting a single root to measure the batched kernel on its own, then again with
+	// update intervals from a DetailScheduler and with most of the belt frozen.
+	void BenchmarkKernel(std::uint32_t bodyCount, std::uint64_t stepCount, float timestep, const std::shared_ptr<Simulation::ThreadPool>& threadPool);
+
+	// Solves Kepler's equation for a spread of mean anomalies and eccentricities up to 0.9 and reports the worst residual.
+	void BenchmarkKeplerSolver(std::uint32_t count, std::uint64_t passCount);
+}
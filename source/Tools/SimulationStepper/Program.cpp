@@ -0,0 +1,441 @@
+#include "pch.h"
+#include "KernelBenchmarks.h"
+#include "SceneReports.h"
+#include "SpacecraftReports.h"
+#include "EventReports.h"
+#include "GravityBenchmarks.h"
+#include "EphemerisReports.h"
+#include "CheckpointReports.h"
+#include "ThreadReports.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace DirectX;
+using namespace Simulation;
+using namespace SimulationStepper;
+
+namespace
+{
+	const uint64_t MaxGravityBenchmarkSteps = 10;
+	const uint64_t MaxBeltBenchmarkEvaluations = 100;
+	const uint64_t MaxSpawnBenchmarkSteps = 600;
+	const uint32_t DefaultPorkchopSize = 1000;
+	const uint64_t MaxSpacecraftBenchmarkSteps = 600;
+
+	const char* const Usage = "Usage: SimulationStepper <CelestialBodies.ini> <duration seconds> <timestep seconds> [--output positions.csv] [--bodies count] [--threads count] [--mode kinematic|nbody] [--integrator leapfrog|wisdom-holman|block] [--solver direct|barnes-hut] [--opening-angle theta] [--nbody count] [--barnes-hut count] [--block count] [--ephemeris output.eph] [--ephemeris-degree degree] [--particles] [--reparent] [--events years] [--approach distance] [--spawn rate] [--porkchop Departure:Arrival] [--porkchop-size count] [--spacecraft count] [--sharded count] [--checkpoint output.chk] [--threaded frames] [--pipeline depth]";
+
+	void WritePositions(ostream& stream, const BodySystem& bodySystem, double simulationTime)
+	{
+		stream << "Time,Body,X,Y,Z" << "\n";
+		stream << setprecision(9);
+		for (uint32_t index = 0; index < bodySystem.BodyCount(); ++index)
+		{
+			const auto& position = bodySystem.Position(index);
+			stream << simulationTime << "," << bodySystem.Data(index).mName << ","
+				<< position.x << "," << position.y << "," << position.z << "\n";
+		}
+	}
+
+	// Jumps a fresh system straight to the stepped end time; the closed form should land on the same state in one evaluation.
+	void ReportSeek(const ConfigData& configData, const BodySystem& steppedSystem)
+	{
+		BodySystem seekSystem;
+		seekSystem.Initialize(configData);
+
+		auto startTime = high_resolution_clock::now();
+		seekSystem.Seek(steppedSystem.SimulationTime());
+		auto endTime = high_resolution_clock::now();
+
+		float maxDeviation = 0.0f;
+		for (uint32_t index = 0; index < steppedSystem.BodyCount(); ++index)
+		{
+			XMVECTOR deviation = XMVectorSubtract(XMLoadFloat4(&seekSystem.Position(index)), XMLoadFloat4(&steppedSystem.Position(index)));
+			maxDeviation = max(maxDeviation, XMVectorGetX(XMVector3Length(deviation)));
+		}
+
+		cerr << "Seek to " << steppedSystem.SimulationTime() << "s\n";
+		cerr << "  Wall time (s): " << duration_cast<duration<double>>(endTime - startTime).count() << "\n";
+		cerr << "  Max deviation from stepped positions: " << maxDeviation << "\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+#if defined(_MSC_VER) && (defined(DEBUG) | defined(_DEBUG))
+	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+
+	try
+	{
+		// copies of this program started by ShardedGravity each step one shard
+		if (argc == 4 && string(argv[1]) == ShardedGravity::WorkerOption)
+		{
+			ShardedGravity::RunWorker(argv[2], static_cast<uint32_t>(stoul(argv[3])));
+			return 0;
+		}
+
+		if (argc < 4)
+		{
+			throw runtime_error(Usage);
+		}
+
+		string configFile = argv[1];
+		double simulationDuration = stod(argv[2]);
+		float timestep = stof(argv[3]);
+		if (simulationDuration < 0 || timestep <= 0)
+		{
+			throw runtime_error("Duration must be non-negative and timestep must be positive.");
+		}
+
+		string outputFile;
+		uint32_t benchmarkBodies = 0;
+		uint32_t threadCount = 1;
+		uint32_t gravityBodies = 0;
+		uint32_t treeBodies = 0;
+		uint32_t blockBodies = 0;
+		uint32_t shardedBodies = 0;
+		string ephemerisFile;
+		string checkpointFile;
+		uint32_t ephemerisDegree = EphemerisBuilder::DefaultDegree;
+		bool useBarnesHut = false;
+		bool useParticles = false;
+		bool useReparenting = false;
+		double eventYears = 0;
+		float approachDistance = 0;
+		double spawnRate = 0;
+		string porkchopBodies;
+		uint32_t spacecraftCount = 0;
+		uint64_t threadedFrames = 0;
+		uint32_t pipelineDepth = 0;
+		uint32_t porkchopSize = DefaultPorkchopSize;
+		float openingAngle = BarnesHut::DefaultOpeningAngle;
+		SimulationMode mode = SimulationMode::Kinematic;
+		IntegrationMethod integration = IntegrationMethod::Leapfrog;
+		for (int argument = 4; argument < argc; ++argument)
+		{
+			string option = argv[argument];
+			if (option == "--particles")
+			{
+				useParticles = true;
+				continue;
+			}
+			if (option == "--reparent")
+			{
+				useReparenting = true;
+				continue;
+			}
+
+			// every other option takes a value
+			if (argument + 1 >= argc)
+			{
+				throw runtime_error(Usage);
+			}
+
+			if (option == "--output")
+			{
+				outputFile = argv[++argument];
+			}
+			else if (option == "--bodies")
+			{
+				benchmarkBodies = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else if (option == "--threads")
+			{
+				threadCount = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else if (option == "--mode")
+			{
+				string modeName = argv[++argument];
+				if (modeName == "kinematic")
+				{
+					mode = SimulationMode::Kinematic;
+				}
+				else if (modeName == "nbody")
+				{
+					mode = SimulationMode::NBody;
+				}
+				else
+				{
+					throw runtime_error(Usage);
+				}
+			}
+			else if (option == "--integrator")
+			{
+				string integrationName = argv[++argument];
+				if (integrationName == "leapfrog")
+				{
+					integration = IntegrationMethod::Leapfrog;
+				}
+				else if (integrationName == "wisdom-holman")
+				{
+					integration = IntegrationMethod::WisdomHolman;
+				}
+				else if (integrationName == "block")
+				{
+					integration = IntegrationMethod::BlockTimestep;
+				}
+				else
+				{
+					throw runtime_error(Usage);
+				}
+			}
+			else if (option == "--solver")
+			{
+				string solverName = argv[++argument];
+				if (solverName == "direct")
+				{
+					useBarnesHut = false;
+				}
+				else if (solverName == "barnes-hut")
+				{
+					useBarnesHut = true;
+				}
+				else
+				{
+					throw runtime_error(Usage);
+				}
+			}
+			else if (option == "--opening-angle")
+			{
+				openingAngle = stof(argv[++argument]);
+			}
+			else if (option == "--nbody")
+			{
+				gravityBodies = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else if (option == "--barnes-hut")
+			{
+				treeBodies = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else if (option == "--block")
+			{
+				blockBodies = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else if (option == "--sharded")
+			{
+				shardedBodies = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else if (option == "--ephemeris")
+			{
+				ephemerisFile = argv[++argument];
+			}
+			else if (option == "--events")
+			{
+				eventYears = stod(argv[++argument]);
+			}
+			else if (option == "--approach")
+			{
+				approachDistance = stof(argv[++argument]);
+			}
+			else if (option == "--spawn")
+			{
+				spawnRate = stod(argv[++argument]);
+			}
+			else if (option == "--porkchop")
+			{
+				porkchopBodies = argv[++argument];
+			}
+			else if (option == "--porkchop-size")
+			{
+				porkchopSize = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else if (option == "--spacecraft")
+			{
+				spacecraftCount = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else if (option == "--ephemeris-degree")
+			{
+				ephemerisDegree = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else if (option == "--checkpoint")
+			{
+				checkpointFile = argv[++argument];
+			}
+			else if (option == "--threaded")
+			{
+				threadedFrames = stoull(argv[++argument]);
+			}
+			else if (option == "--pipeline")
+			{
+				pipelineDepth = static_cast<uint32_t>(stoul(argv[++argument]));
+			}
+			else
+			{
+				throw runtime_error(Usage);
+			}
+		}
+
+		ConfigData configData;
+		configData.LoadConfigData(configFile);
+
+		shared_ptr<ThreadPool> threadPool;
+		if (threadCount > 1)
+		{
+			threadPool = make_shared<ThreadPool>(threadCount);
+		}
+
+		// what a system restored from a checkpoint keeps rather than takes from the file
+		auto attach = [&](BodySystem& system)
+		{
+			system.SetThreadPool(threadPool);
+			if (useBarnesHut)
+			{
+				auto solver = make_unique<BarnesHut>();
+				solver->SetOpeningAngle(openingAngle);
+				system.SetSolver(move(solver));
+			}
+		};
+
+		auto configureFrom = [&](BodySystem& system, const ConfigData& data)
+		{
+			attach(system);
+			system.Initialize(data);
+			system.SetIntegration(integration);
+			system.SetMode(mode);
+			system.SetDynamicHierarchy(useReparenting);
+
+			// particles would swamp the body throughput, so they only run when asked for
+			system.SetParticlesEnabled(useParticles);
+		};
+		auto configure = [&](BodySystem& system)
+		{
+			configureFrom(system, configData);
+		};
+
+		BodySystem bodySystem;
+		configure(bodySystem);
+		bodySystem.Solver().ResetInteractions();
+
+		uint64_t stepCount = static_cast<uint64_t>(simulationDuration / timestep);
+		uint64_t updatedBodies = 0;
+		auto startTime = high_resolution_clock::now();
+		for (uint64_t step = 0; step < stepCount; ++step)
+		{
+			bodySystem.Update(timestep);
+			updatedBodies += bodySystem.UpdatedBodyCount();
+		}
+		auto endTime = high_resolution_clock::now();
+
+		double simulationTime = bodySystem.SimulationTime();
+		if (!outputFile.empty())
+		{
+			ofstream file(outputFile);
+			if (!file.good())
+			{
+				throw runtime_error("Could not open file: " + outputFile);
+			}
+			WritePositions(file, bodySystem, simulationTime);
+		}
+		else
+		{
+			WritePositions(cout, bodySystem, simulationTime);
+		}
+
+		double wallSeconds = duration_cast<duration<double>>(endTime - startTime).count();
+		ReportThroughput(configFile, bodySystem.BodyCount(), stepCount, wallSeconds);
+		if (stepCount > 0)
+		{
+			uint64_t updatedPerStep = updatedBodies / stepCount;
+			cerr << "  Transforms updated / skipped per step: " << updatedPerStep << " / " << (bodySystem.BodyCount() - updatedPerStep) << "\n";
+		}
+		if (mode == SimulationMode::Kinematic)
+		{
+			ReportSeek(configData, bodySystem);
+		}
+		else
+		{
+			cerr << "  Physics timestep (s): " << bodySystem.PhysicsTimestep() << "\n";
+			cerr << "  Relative energy drift: " << bodySystem.EnergyDrift() << "\n";
+			cerr << "  Interactions/sec: " << ((wallSeconds > 0) ? (bodySystem.Solver().Interactions() / wallSeconds) : 0.0) << "\n";
+			if (useReparenting)
+			{
+				ReportReparenting(bodySystem);
+			}
+		}
+
+		if (bodySystem.BeltCount() > 0)
+		{
+			ReportBelts(configData, bodySystem, min(stepCount, MaxBeltBenchmarkEvaluations), threadPool);
+		}
+
+		if (useParticles)
+		{
+			ReportParticles(bodySystem, configure, stepCount, timestep, threadPool);
+		}
+
+		if (eventYears > 0)
+		{
+			ReportEvents(configData, eventYears, approachDistance, threadPool);
+		}
+
+		if (spawnRate > 0)
+		{
+			BenchmarkSpawning(bodySystem, spawnRate, min(stepCount, MaxSpawnBenchmarkSteps), timestep, threadPool);
+		}
+
+		if (!porkchopBodies.empty())
+		{
+			size_t separator = porkchopBodies.find(':');
+			if (separator == string::npos)
+			{
+				throw runtime_error(Usage);
+			}
+			ReportPorkchop(configData, porkchopBodies.substr(0, separator), porkchopBodies.substr(separator + 1), porkchopSize, threadPool);
+		}
+
+		if (spacecraftCount > 0)
+		{
+			ReportSpacecraft(configData, spacecraftCount, min(stepCount, MaxSpacecraftBenchmarkSteps), timestep, threadPool);
+		}
+
+		if (benchmarkBodies > 0)
+		{
+			BenchmarkKernel(benchmarkBodies, stepCount, timestep, threadPool);
+			BenchmarkKeplerSolver(benchmarkBodies, stepCount);
+		}
+
+		if (gravityBodies > 0)
+		{
+			BenchmarkGravity(gravityBodies, min(stepCount, MaxGravityBenchmarkSteps), timestep, threadPool);
+		}
+
+		if (treeBodies > 0)
+		{
+			BenchmarkBarnesHut(treeBodies, min(stepCount, MaxGravityBenchmarkSteps), timestep, threadCount, openingAngle);
+		}
+
+		if (blockBodies > 0)
+		{
+			BenchmarkBlockTimesteps(blockBodies, min(stepCount, MaxGravityBenchmarkSteps), threadPool);
+		}
+
+		if (shardedBodies > 0)
+		{
+			BenchmarkSharding(shardedBodies, min(stepCount, MaxGravityBenchmarkSteps), timestep, threadCount, openingAngle);
+		}
+
+		if (!checkpointFile.empty())
+		{
+			ReportCheckpoint(configFile, configureFrom, attach, checkpointFile, stepCount, timestep);
+		}
+
+		if (threadedFrames > 0)
+		{
+			ReportSimulationThread(configure, threadedFrames, timestep, pipelineDepth);
+		}
+
+		if (!ephemerisFile.empty())
+		{
+			BodySystem ephemerisSystem;
+			configure(ephemerisSystem);
+			BuildEphemeris(ephemerisSystem, simulationDuration, ephemerisDegree, ephemerisFile);
+		}
+	}
+	catch (const exception& ex)
+	{
+		cerr << ex.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
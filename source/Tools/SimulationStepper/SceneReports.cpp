@@ -0,0 +1,262 @@
+#include "pch.h"
+#include "SceneReports.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace DirectX;
+using namespace Simulation;
+
+namespace SimulationStepper
+{
+	namespace
+	{
+		const uint64_t ParticleBenchmarkSteps = 60;
+		const double FrameSeconds = 1.0 / 60.0;
+		const double SpawnLifetime = 2.0;
+
+		// Sorted so that pools filled in a different order by different threads compare equal.
+		vector<ParticleColorVertex> SortedParticles(const ParticleSystem& particles)
+		{
+			vector<ParticleColorVertex> vertices(particles.Count());
+			particles.WriteVertices(vertices.data(), 0.0f);
+			sort(vertices.begin(), vertices.end(), [](const ParticleColorVertex& a, const ParticleColorVertex& b)
+			{
+				return (memcmp(&a, &b, sizeof(ParticleColorVertex)) < 0);
+			});
+			return vertices;
+		}
+	}
+
+	void ReportBelts(const ConfigData& configData, BodySystem& bodySystem, uint64_t evaluationCount, const shared_ptr<ThreadPool>& threadPool)
+	{
+		const auto& belts = configData.GetBeltData();
+		for (uint32_t index = 0; index < bodySystem.BeltCount(); ++index)
+		{
+			const AsteroidBelt& belt = bodySystem.Belt(index);
+			AsteroidBelt regenerated;
+			auto startTime = high_resolution_clock::now();
+			if (threadPool != nullptr)
+			{
+				regenerated.Generate(belt.Parent(), belt.Shape(), *threadPool);
+			}
+			else
+			{
+				regenerated.Generate(belt.Parent(), belt.Shape());
+			}
+			double generateSeconds = duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+
+			startTime = high_resolution_clock::now();
+			for (uint64_t evaluation = 1; evaluation <= evaluationCount; ++evaluation)
+			{
+				if (threadPool != nullptr)
+				{
+					regenerated.Evaluate(bodySystem.SimulationTime() * evaluation / evaluationCount, *threadPool);
+				}
+				else
+				{
+					regenerated.Evaluate(bodySystem.SimulationTime() * evaluation / evaluationCount);
+				}
+			}
+			double evaluateSeconds = duration_cast<duration<double>>(high_resolution_clock::now() - startTime).count();
+
+			AsteroidBelt serial;
+			serial.Generate(belt.Parent(), belt.Shape());
+			serial.Evaluate(bodySystem.SimulationTime());
+			bool deterministic = (serial.Instances().size() == regenerated.Instances().size()) &&
+				(memcmp(serial.Instances().data(), regenerated.Instances().data(), serial.Instances().size() * sizeof(XMFLOAT4)) == 0);
+
+			uint64_t asteroidUpdates = evaluationCount * belt.Count();
+			cerr << "Belt " << belts[index].mName << " around " << bodySystem.Data(belt.Parent()).mName << "\n";
+			cerr << "  Asteroids: " << belt.Count() << (belt.Shape().mQuantized ? " (quantized)" : "") << "\n";
+			cerr << "  Bytes per asteroid: " << belt.BytesPerAsteroid() << "\n";
+			cerr << "  Generation wall time (s): " << generateSeconds << "\n";
+			cerr << "  Asteroid updates/sec: " << ((evaluateSeconds > 0) ? (asteroidUpdates / evaluateSeconds) : 0.0) << "\n";
+			cerr << "  Same on one thread: " << (deterministic ? "yes" : "no") << "\n";
+			if (!deterministic)
+			{
+				throw runtime_error("Belt " + belts[index].mName + " differs between the threaded and the serial generation");
+			}
+		}
+	}
+
+	void ReportParticles(BodySystem& bodySystem, const function<void(BodySystem&)>& configure, uint64_t warmupSteps, float timestep,
+		const shared_ptr<ThreadPool>& threadPool)
+	{
+		const ParticleSystem& particles = bodySystem.Particles();
+
+		// Particles live seconds while the run's steps may be minutes, so they step a frame at a time here, first until
+		// every particle of the run has expired and the pool holds as many as the emitters keep alive.
+		double longestLifetime = 0;
+		for (uint32_t index = 0; index < particles.EmitterCount(); ++index)
+		{
+			const ParticleEmitter& emitter = particles.Emitter(index);
+			longestLifetime = max(longestLifetime, emitter.mLifetime * (1.0 + emitter.mLifetimeVariation));
+		}
+		uint64_t settleSteps = static_cast<uint64_t>(ceil(longestLifetime / FrameSeconds));
+		for (uint64_t step = 0; step < settleSteps; ++step)
+		{
+			bodySystem.Update(static_cast<float>(FrameSeconds));
+		}
+
+		uint64_t settledDroppedCount = particles.DroppedCount();
+		vector<ParticleColorVertex> colorVertices(particles.Capacity());
+		vector<ParticleSizeVertex> sizeVertices(particles.Capacity());
+		double updateSeconds = 0;
+		double colorSeconds = 0;
+		double sizeSeconds = 0;
+		uint64_t particleUpdates = 0;
+		for (uint64_t step = 0; step < ParticleBenchmarkSteps; ++step)
+		{
+			particleUpdates += particles.Count();
+			auto startTime = high_resolution_clock::now();
+			bodySystem.Update(static_cast<float>(FrameSeconds));
+			auto updateTime = high_resolution_clock::now();
+			if (threadPool != nullptr)
+			{
+				particles.WriteVertices(colorVertices.data(), 0.0f, *threadPool);
+			}
+			else
+			{
+				particles.WriteVertices(colorVertices.data(), 0.0f);
+			}
+			auto colorTime = high_resolution_clock::now();
+			if (threadPool != nullptr)
+			{
+				particles.WriteVertices(sizeVertices.data(), 0.0f, *threadPool);
+			}
+			else
+			{
+				particles.WriteVertices(sizeVertices.data(), 0.0f);
+			}
+			auto sizeTime = high_resolution_clock::now();
+
+			updateSeconds += duration_cast<duration<double>>(updateTime - startTime).count();
+			colorSeconds += duration_cast<duration<double>>(colorTime - updateTime).count();
+			sizeSeconds += duration_cast<duration<double>>(sizeTime - colorTime).count();
+		}
+
+		double frameSeconds = (updateSeconds + colorSeconds) / ParticleBenchmarkSteps;
+		cerr << "Particles (" << ((threadPool != nullptr) ? threadPool->ThreadCount() : 1) << " threads)\n";
+		cerr << "  Emitters: " << particles.EmitterCount() << "\n";
+		cerr << "  Live / capacity: " << particles.Count() << " / " << particles.Capacity() << "\n";
+		cerr << "  Bytes per particle: " << ParticleSystem::BytesPerParticle << "\n";
+		cerr << "  Step wall time (ms): " << 1000 * updateSeconds / ParticleBenchmarkSteps << "\n";
+		cerr << "  Color vertex stream wall time (ms): " << 1000 * colorSeconds / ParticleBenchmarkSteps << "\n";
+		cerr << "  Size vertex stream wall time (ms): " << 1000 * sizeSeconds / ParticleBenchmarkSteps << "\n";
+		cerr << "  Particle updates/sec: " << ((updateSeconds > 0) ? (particleUpdates / updateSeconds) : 0.0) << "\n";
+		cerr << "  Step and stream fit a 60 Hz frame: " << ((frameSeconds < FrameSeconds) ? "yes" : "no") << "\n";
+		cerr << "  Dropped: " << (particles.DroppedCount() - settledDroppedCount) << "\n";
+		if (particles.DroppedCount() != settledDroppedCount)
+		{
+			throw runtime_error("Particles dropped at their steady state: " + to_string(particles.DroppedCount() - settledDroppedCount));
+		}
+
+		if (threadPool != nullptr)
+		{
+			BodySystem serialSystem;
+			configure(serialSystem);
+			serialSystem.SetThreadPool(nullptr);
+			for (uint64_t step = 0; step < warmupSteps; ++step)
+			{
+				serialSystem.Update(timestep);
+			}
+			for (uint64_t step = 0; step < settleSteps + ParticleBenchmarkSteps; ++step)
+			{
+				serialSystem.Update(static_cast<float>(FrameSeconds));
+			}
+			vector<ParticleColorVertex> serial = SortedParticles(serialSystem.Particles());
+			vector<ParticleColorVertex> threaded = SortedParticles(particles);
+			bool deterministic = (serial.size() == threaded.size()) &&
+				(memcmp(serial.data(), threaded.data(), serial.size() * sizeof(ParticleColorVertex)) == 0);
+			cerr << "  Same on one thread: " << (deterministic ? "yes" : "no") << "\n";
+			if (!deterministic)
+			{
+				throw runtime_error("Particles differ between the threaded and the serial run");
+			}
+		}
+	}
+
+	void BenchmarkSpawning(const BodySystem& bodySystem, double rate, uint64_t stepCount, float timestep, const shared_ptr<ThreadPool>& threadPool)
+	{
+		vector<uint32_t> parents;
+		for (uint32_t index = 0; index < bodySystem.BodyCount(); ++index)
+		{
+			if (bodySystem.GravitationalParameter(index) > 0)
+			{
+				parents.push_back(index);
+			}
+		}
+		if (parents.empty())
+		{
+			return;
+		}
+
+		SpawnedBodies spawned;
+		spawned.SetCapacity(BodySystem::SpawnCapacity);
+		mt19937 generator(0);
+		uniform_real_distribution<float> unit(0.0f, 1.0f);
+		vector<SlotHandle> handles;
+		double time = 0;
+		double pendingSpawns = 0;
+		uint64_t spawnCount = 0;
+		uint64_t removedCount = 0;
+		uint64_t evaluatedCount = 0;
+		uint32_t peakCount = 0;
+		double spawnSeconds = 0;
+		double evaluateSeconds = 0;
+		for (uint64_t step = 0; step < stepCount; ++step)
+		{
+			time += timestep;
+			pendingSpawns += rate * timestep;
+			auto startTime = high_resolution_clock::now();
+			for (; pendingSpawns >= 1; pendingSpawns -= 1)
+			{
+				uint32_t parent = parents[generator() % parents.size()];
+				float diameter = bodySystem.States().Scale(parent);
+				SpawnedBody body;
+				body.mParent = parent;
+				body.mDiameter = diameter * 0.02f;
+				body.mExpiry = time + SpawnLifetime * (0.5 + unit(generator));
+				body.mElements.mSemiMajorAxis = diameter * (2.0f + 4.0f * unit(generator));
+				body.mElements.mEccentricity = 0.2f * unit(generator);
+				body.mElements.mInclination = XM_PIDIV4 * unit(generator);
+				body.mElements.mLongitudeOfAscendingNode = XM_2PI * unit(generator);
+				body.mElements.mArgumentOfPeriapsis = XM_2PI * unit(generator);
+				body.mElements.mMeanAnomaly = XM_2PI * unit(generator);
+				double semiMajorAxis = body.mElements.mSemiMajorAxis;
+				body.mElements.mPeriod = XM_2PI * sqrt(semiMajorAxis * semiMajorAxis * semiMajorAxis / bodySystem.GravitationalParameter(parent));
+				handles.push_back(spawned.Spawn(body));
+				++spawnCount;
+			}
+			removedCount += spawned.RemoveExpired(time);
+			auto spawnTime = high_resolution_clock::now();
+			if (threadPool != nullptr)
+			{
+				spawned.Evaluate(time, *threadPool);
+			}
+			else
+			{
+				spawned.Evaluate(time);
+			}
+			auto evaluateTime = high_resolution_clock::now();
+
+			evaluatedCount += spawned.Count();
+			peakCount = max(peakCount, spawned.Count());
+			spawnSeconds += duration_cast<duration<double>>(spawnTime - startTime).count();
+			evaluateSeconds += duration_cast<duration<double>>(evaluateTime - spawnTime).count();
+		}
+
+		uint64_t foundCount = 0;
+		for (const SlotHandle& handle : handles)
+		{
+			foundCount += (spawned.Find(handle) != nullptr) ? 1 : 0;
+		}
+
+		cerr << "Spawned bodies (" << ((threadPool != nullptr) ? threadPool->ThreadCount() : 1) << " threads)\n";
+		cerr << "  Spawned / removed / dropped: " << (spawnCount - spawned.DroppedCount()) << " / " << removedCount << " / " << spawned.DroppedCount() << "\n";
+		cerr << "  Live at end / peak / capacity: " << spawned.Count() << " / " << peakCount << " / " << spawned.Capacity() << "\n";
+		cerr << "  Spawns and removals/sec: " << ((spawnSeconds > 0) ? ((spawnCount + removedCount) / spawnSeconds) : 0.0) << "\n";
+		cerr << "  Body updates/sec: " << ((evaluateSeconds > 0) ? (evaluatedCount / evaluateSeconds) : 0.0) << "\n";
+		cerr << "  Handles found / live: " << foundCount << " / " << spawned.Count() << "\n";
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace Simulation
+{
+	class BodySystem;
+	class ConfigData;
+	class ThreadPool;
+}
+
+namespace SimulationStepper
+{
+	// Times generating and evaluating the catalog's belts, and checks that a belt generated on one thread matches the
+	// one the system generated over the pool.
+	void ReportBelts(const Simulation::ConfigData& configData, Simulation::BodySystem& bodySystem, std::uint64_t evaluationCount,
+		const std::shared_ptr<Simulation::ThreadPool>& threadPool);
+
+	// Steps the system on from the main run a 60 Hz frame at a time, for the longest particle lifetime and then another
+	// second, timing the particle update and both vertex streams in that second against the frame. Fails if a particle
+	// was dropped in that second. With a thread pool the particles must match a run on one thread.
+	void ReportParticles(Simulation::BodySystem& bodySystem, const std::function<void(Simulation::BodySystem&)>& configure, std::uint64_t warmupSteps,
+		float timestep, const std::shared_ptr<Simulation::ThreadPool>& threadPool);
+
+	// Spawns debris at the given rate per simulated second, each living two simulated seconds, about random catalog bodies
+	// while evaluating the live ones every step, as the demo does with C held. Handles of removed bodies must find nothing.
+	void BenchmarkSpawning(const Simulation::BodySystem& bodySystem, double rate, std::uint64_t stepCount, float timestep,
+		const std::shared_ptr<Simulation::ThreadPool>& threadPool);
+}
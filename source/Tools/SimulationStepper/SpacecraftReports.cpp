@@ -0,0 +1,261 @@
+#include "pch.h"
+#include "SpacecraftReports.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace DirectX;
+using namespace Simulation;
+
+namespace SimulationStepper
+{
+	namespace
+	{
+		const double PorkchopShortestFlight = 0.5;
+		const double PorkchopLongestFlight = 1.5;
+
+		// Launches craft about every massive body but the root, from 2 to 5 diameters out at 0.8 to 1.6 times the circular
+		// speed, so that some stay, some escape and some fall through the spheres of moons.
+		vector<float> GravitationalParameters(const BodySystem& bodySystem)
+		{
+			vector<float> gravitationalParameters(bodySystem.BodyCount());
+			for (uint32_t index = 0; index < bodySystem.BodyCount(); ++index)
+			{
+				gravitationalParameters[index] = bodySystem.GravitationalParameter(index);
+			}
+			return gravitationalParameters;
+		}
+
+		void LaunchFleet(const BodySystem& bodySystem, uint32_t count, SpacecraftFleet& fleet)
+		{
+			vector<uint32_t> parents;
+			for (uint32_t index = 0; index < bodySystem.BodyCount(); ++index)
+			{
+				if (bodySystem.GravitationalParameter(index) > 0 && bodySystem.Parent(index) != BodySystem::InvalidIndex)
+				{
+					parents.push_back(index);
+				}
+			}
+
+			fleet.SetCapacity(count);
+			fleet.SetBodies(bodySystem.States(), GravitationalParameters(bodySystem), 0);
+			if (parents.empty())
+			{
+				return;
+			}
+
+			mt19937 generator(0);
+			uniform_real_distribution<double> unit(0.0, 1.0);
+			for (uint32_t index = 0; index < count; ++index)
+			{
+				uint32_t parent = parents[index % parents.size()];
+				double radius = bodySystem.States().Scale(parent) * (2.0 + 3.0 * unit(generator));
+				double angle = XM_2PI * unit(generator);
+				double speed = sqrt(bodySystem.GravitationalParameter(parent) / radius) * (0.8 + 0.8 * unit(generator));
+				Spacecraft spacecraft = {};
+				spacecraft.mParent = parent;
+				spacecraft.mPosition[0] = radius * cos(angle);
+				spacecraft.mPosition[1] = radius * 0.1 * (unit(generator) - 0.5);
+				spacecraft.mPosition[2] = radius * sin(angle);
+				spacecraft.mVelocity[0] = -speed * sin(angle);
+				spacecraft.mVelocity[1] = speed * 0.05 * (unit(generator) - 0.5);
+				spacecraft.mVelocity[2] = speed * cos(angle);
+				spacecraft.mSize = 1.0f;
+				fleet.Launch(spacecraft, bodySystem.States());
+			}
+		}
+
+		bool SameCraft(const SpacecraftFleet& first, const SpacecraftFleet& second)
+		{
+			const vector<XMFLOAT4>& firstInstances = first.Instances();
+			const vector<XMFLOAT4>& secondInstances = second.Instances();
+			return first.Parents() == second.Parents() && first.TransitionCount() == second.TransitionCount() && firstInstances.size() == secondInstances.size() &&
+				memcmp(firstInstances.data(), secondInstances.data(), firstInstances.size() * sizeof(XMFLOAT4)) == 0;
+		}
+
+		// The orbit of a body, or the ancestor it rides with, about the central body of a transfer.
+		uint32_t TransferOrbit(const BodySystem& bodySystem, uint32_t body, uint32_t centralBody)
+		{
+			while (bodySystem.Parent(body) != centralBody)
+			{
+				body = bodySystem.Parent(body);
+			}
+			return body;
+		}
+	}
+
+	void ReportSpacecraft(const ConfigData& configData, uint32_t count, uint64_t stepCount, float timestep, const shared_ptr<ThreadPool>& threadPool)
+	{
+		BodySystem fleetSystem;
+		fleetSystem.Initialize(configData);
+		SpacecraftFleet fleet;
+		LaunchFleet(fleetSystem, count, fleet);
+
+		auto startTime = high_resolution_clock::now();
+		for (uint64_t step = 1; step <= stepCount; ++step)
+		{
+			if (threadPool != nullptr)
+			{
+				fleet.Advance(step * static_cast<double>(timestep), fleetSystem.States(), *threadPool);
+			}
+			else
+			{
+				fleet.Advance(step * static_cast<double>(timestep), fleetSystem.States());
+			}
+		}
+		auto endTime = high_resolution_clock::now();
+		fleet.Evaluate(fleet.Time());
+
+		// Each step again from the same craft, whole and in halves, skipping steps a cap left short. Only craft that changed
+		// parent at most twice in the step are compared: the body positions are single precision, so the crossing times
+		// of a pass differ in the last digits, and later passes in the same step magnify that.
+		SpacecraftFleet whole;
+		LaunchFleet(fleetSystem, count, whole);
+		SpacecraftFleet halves;
+		halves.SetCapacity(count);
+		vector<float> gravitationalParameters = GravitationalParameters(fleetSystem);
+		uint64_t comparedCount = 0;
+		uint64_t sameCount = 0;
+		vector<uint32_t> startTransitions;
+		for (uint64_t step = 1; step <= stepCount; ++step)
+		{
+			uint64_t cappedCount = whole.CappedCount() + halves.CappedCount();
+			double begin = whole.Time();
+			double end = step * static_cast<double>(timestep);
+			halves.SetBodies(fleetSystem.States(), gravitationalParameters, begin);
+			startTransitions.clear();
+			for (uint32_t index = 0; index < whole.Count(); ++index)
+			{
+				halves.Restore(whole.CraftAt(index));
+				startTransitions.push_back(whole.CraftAt(index).mTransitions);
+			}
+			whole.Advance(end, fleetSystem.States());
+			halves.Advance(0.5 * (begin + end), fleetSystem.States());
+			halves.Advance(end, fleetSystem.States());
+			if (whole.CappedCount() + halves.CappedCount() != cappedCount)
+			{
+				continue;
+			}
+
+			for (uint32_t index = 0; index < whole.Count(); ++index)
+			{
+				const Spacecraft& wholeCraft = whole.CraftAt(index);
+				const Spacecraft& halvesCraft = halves.CraftAt(index);
+				if (min(wholeCraft.mTransitions, halvesCraft.mTransitions) - startTransitions[index] > 2)
+				{
+					continue;
+				}
+
+				++comparedCount;
+				sameCount += (wholeCraft.mParent == halvesCraft.mParent && wholeCraft.mTransitions == halvesCraft.mTransitions) ? 1 : 0;
+			}
+		}
+
+		map<uint32_t, uint32_t> parentCounts;
+		for (uint32_t parent : fleet.Parents())
+		{
+			++parentCounts[parent];
+		}
+
+		double wallSeconds = duration_cast<duration<double>>(endTime - startTime).count();
+		cerr << "Spacecraft (" << ((threadPool != nullptr) ? threadPool->ThreadCount() : 1) << " threads)\n";
+		cerr << "  Craft / steps: " << fleet.Count() << " / " << stepCount << "\n";
+		cerr << "  Craft steps/sec: " << ((wallSeconds > 0) ? (fleet.Count() * static_cast<double>(stepCount) / wallSeconds) : 0.0) << "\n";
+		cerr << "  Parent changes: " << fleet.TransitionCount() << "\n";
+		cerr << "  Same parent and changes over a step whole and in halves, at most two changes: " << sameCount << " / " << comparedCount << "\n";
+		cerr << "  Advances capped whole / in halves: " << whole.CappedCount() << " / " << halves.CappedCount() << "\n";
+		for (const auto& parentCount : parentCounts)
+		{
+			cerr << "  About " << fleetSystem.Data(parentCount.first).mName << ": " << parentCount.second << "\n";
+		}
+
+		if (threadPool != nullptr)
+		{
+			SpacecraftFleet serial;
+			LaunchFleet(fleetSystem, count, serial);
+			for (uint64_t step = 1; step <= stepCount; ++step)
+			{
+				serial.Advance(step * static_cast<double>(timestep), fleetSystem.States());
+			}
+			serial.Evaluate(serial.Time());
+			bool deterministic = SameCraft(serial, fleet);
+			cerr << "  Same on one thread: " << (deterministic ? "yes" : "no") << "\n";
+			if (!deterministic)
+			{
+				throw runtime_error("Spacecraft differ between the threaded and the serial run");
+			}
+		}
+
+		if (sameCount != comparedCount)
+		{
+			throw runtime_error("Spacecraft steps whole and in halves disagree " + to_string(comparedCount - sameCount) + " times");
+		}
+	}
+
+	void ReportPorkchop(const ConfigData& configData, const string& departureName, const string& arrivalName, uint32_t size,
+		const shared_ptr<ThreadPool>& threadPool)
+	{
+		BodySystem transferSystem;
+		transferSystem.Initialize(configData);
+		TransferPlanner planner(transferSystem);
+
+		PorkchopQuery query;
+		query.mDeparture = transferSystem.FindBody(departureName);
+		query.mArrival = transferSystem.FindBody(arrivalName);
+		if (query.mDeparture == BodySystem::InvalidIndex || query.mArrival == BodySystem::InvalidIndex)
+		{
+			throw runtime_error("No such bodies: " + departureName + ", " + arrivalName);
+		}
+
+		uint32_t centralBody = planner.CentralBody(query.mDeparture, query.mArrival);
+		if (centralBody == BodySystem::InvalidIndex)
+		{
+			throw runtime_error("No common central body: " + departureName + ", " + arrivalName);
+		}
+
+		uint32_t departureOrbit = TransferOrbit(transferSystem, query.mDeparture, centralBody);
+		uint32_t arrivalOrbit = TransferOrbit(transferSystem, query.mArrival, centralBody);
+		double transferAxis = 0.5 * (static_cast<double>(transferSystem.SemiMajorAxis(departureOrbit)) + transferSystem.SemiMajorAxis(arrivalOrbit));
+		double hohmannTime = XM_PI * sqrt(transferAxis * transferAxis * transferAxis / transferSystem.GravitationalParameter(centralBody));
+		query.mDepartureBegin = 0;
+		query.mDepartureEnd = transferSystem.OrbitalPeriod(departureOrbit);
+		query.mDepartureCount = size;
+		query.mArrivalBegin = query.mDepartureBegin + PorkchopShortestFlight * hohmannTime;
+		query.mArrivalEnd = query.mDepartureEnd + PorkchopLongestFlight * hohmannTime;
+		query.mArrivalCount = size;
+		query.mRetrograde = false;
+
+		auto startTime = high_resolution_clock::now();
+		PorkchopGrid grid = (threadPool != nullptr) ? planner.Porkchop(query, *threadPool) : planner.Porkchop(query);
+		auto endTime = high_resolution_clock::now();
+
+		double wallSeconds = duration_cast<duration<double>>(endTime - startTime).count();
+		uint64_t cellCount = static_cast<uint64_t>(grid.mDepartureCount) * grid.mArrivalCount;
+		uint32_t bestDeparture = grid.mBestCell / grid.mArrivalCount;
+		uint32_t bestArrival = grid.mBestCell % grid.mArrivalCount;
+		cerr << "Porkchop " << departureName << " to " << arrivalName << " about " << transferSystem.Data(centralBody).mName << " ("
+			<< ((threadPool != nullptr) ? threadPool->ThreadCount() : 1) << " threads)\n";
+		cerr << "  Cells: " << grid.mDepartureCount << " x " << grid.mArrivalCount << "\n";
+		cerr << "  Solved / cells: " << grid.mSolvedCount << " / " << cellCount << "\n";
+		cerr << "  Wall time (s): " << wallSeconds << "\n";
+		cerr << "  Solves/sec: " << ((wallSeconds > 0) ? (cellCount / wallSeconds) : 0.0) << "\n";
+		cerr << "  Hohmann time (s): " << hohmannTime << "\n";
+		if (grid.mSolvedCount > 0)
+		{
+			cerr << "  Best departure / arrival (s): " << grid.mDepartureTimes[bestDeparture] << " / " << grid.mArrivalTimes[bestArrival] << "\n";
+			cerr << "  Best delta-v departure + arrival: " << grid.mDepartureDeltaV[grid.mBestCell] << " + " << grid.mArrivalDeltaV[grid.mBestCell] << "\n";
+		}
+
+		if (threadPool != nullptr)
+		{
+			PorkchopGrid serial = planner.Porkchop(query);
+			bool deterministic = (serial.mBestCell == grid.mBestCell) && (serial.mSolvedCount == grid.mSolvedCount) &&
+				(memcmp(serial.mDepartureDeltaV.data(), grid.mDepartureDeltaV.data(), cellCount * sizeof(float)) == 0) &&
+				(memcmp(serial.mArrivalDeltaV.data(), grid.mArrivalDeltaV.data(), cellCount * sizeof(float)) == 0);
+			cerr << "  Same on one thread: " << (deterministic ? "yes" : "no") << "\n";
+			if (!deterministic)
+			{
+				throw runtime_error("Porkchop grid differs between the threaded and the serial run");
+			}
+		}
+	}
+}
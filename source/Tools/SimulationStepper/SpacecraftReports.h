@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Simulation
+{
+	class ConfigData;
+	class ThreadPool;
+}
+
+namespace SimulationStepper
+{
+	// Flies a fleet on patched conics step by step and again in one Advance over the whole span, and fails unless every
+	// craft changed parent as often and ended about the same body both ways. With a thread pool the fleet must also match
+	// one flown on one thread.
+	void ReportSpacecraft(const Simulation::ConfigData& configData, std::uint32_t count, std::uint64_t stepCount, float timestep,
+		const std::shared_ptr<Simulation::ThreadPool>& threadPool);
+
+	// Fills a porkchop plot from one period of departures against arrivals spread around the Hohmann transfer time. With a
+	// thread pool the grid must match one filled on one thread.
+	void ReportPorkchop(const Simulation::ConfigData& configData, const std::string& departureName, const std::string& arrivalName, std::uint32_t size,
+		const std::shared_ptr<Simulation::ThreadPool>& threadPool);
+}
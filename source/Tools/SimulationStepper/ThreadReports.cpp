@@ -0,0 +1,76 @@
+#include "pch.h"
+#include "ThreadReports.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace Simulation;
+
+namespace SimulationStepper
+{
+	void ReportSimulationThread(const function<void(BodySystem&)>& configure, uint64_t frameCount, float timestep, uint32_t pipelineDepth)
+	{
+		BodySystem bodySystem;
+		configure(bodySystem);
+		nanoseconds frameTime = duration_cast<nanoseconds>(duration<double>(timestep));
+		SimulationThread simulationThread(bodySystem, frameTime);
+		simulationThread.SetAdvancing(true);
+		simulationThread.SetPipelineDepth(pipelineDepth);
+
+		BodySnapshot snapshot = {};
+		uint64_t acquiredCount = 0;
+		uint64_t maxRunAhead = 0;
+		auto checkRunAhead = [&]()
+		{
+			// the thread only simulates frames already ticked, so pipelined it stays depth snapshots ahead of the one drawn
+			uint64_t runAhead = simulationThread.PublishedCount() - snapshot.mSequence;
+			maxRunAhead = max(maxRunAhead, runAhead);
+			if (pipelineDepth > 0 && runAhead > pipelineDepth)
+			{
+				throw runtime_error("Simulation ran " + to_string(runAhead) + " snapshots ahead of a pipeline " + to_string(pipelineDepth) + " deep");
+			}
+		};
+		auto take = [&]()
+		{
+			uint64_t previousSequence = snapshot.mSequence;
+			bool acquired = simulationThread.Acquire(snapshot);
+			if (acquired && snapshot.mSequence <= previousSequence)
+			{
+				throw runtime_error("Snapshot sequence went back from " + to_string(previousSequence) + " to " + to_string(snapshot.mSequence));
+			}
+			acquiredCount += acquired ? 1 : 0;
+			checkRunAhead();
+		};
+
+		// drawing takes twice as long as a frame stepped inline, so the thread can run as far ahead as it is let
+		auto inlineStart = high_resolution_clock::now();
+		simulationThread.Tick(frameTime);
+		take();
+		nanoseconds drawTime = 2 * duration_cast<nanoseconds>(high_resolution_clock::now() - inlineStart);
+
+		auto startTime = high_resolution_clock::now();
+		simulationThread.Start();
+		for (uint64_t frame = 1; frame <= frameCount; ++frame)
+		{
+			simulationThread.Tick(frameTime);
+			take();
+			this_thread::sleep_for(drawTime);
+			checkRunAhead();
+		}
+		simulationThread.Stop();
+		take();
+		auto endTime = high_resolution_clock::now();
+
+		double wallSeconds = duration_cast<duration<double>>(endTime - startTime).count();
+		cerr << "Simulation thread (pipeline depth " << pipelineDepth << ")\n";
+		cerr << "  Frames: " << frameCount << "\n";
+		cerr << "  Snapshots published / acquired: " << simulationThread.PublishedCount() << " / " << acquiredCount << "\n";
+		cerr << "  Simulation time (s): " << bodySystem.SimulationTime() << "\n";
+		cerr << "  Frames/sec: " << ((wallSeconds > 0) ? (frameCount / wallSeconds) : 0.0) << "\n";
+		cerr << "  Most snapshots published ahead of the one drawn: " << maxRunAhead << "\n";
+		cerr << "  Sequence only moved forward: yes\n";
+		if (pipelineDepth > 0)
+		{
+			cerr << "  Never ahead of the pipeline: yes\n";
+		}
+	}
+}
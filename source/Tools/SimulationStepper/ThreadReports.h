@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace Simulation
+{
+	class BodySystem;
+}
+
+namespace SimulationStepper
+{
+	// Runs a system on a SimulationThread of its own for the given number of frames, one step each, acquiring a snapshot
+	// every frame as the demo does and then pausing twice as long as a frame stepped inline takes. Fails if a snapshot acquired carries a sequence number no later than the one before,
+	// or if, pipelined, the thread ever published more snapshots past the one drawn than the pipeline depth.
+	void ReportSimulationThread(const std::function<void(Simulation::BodySystem&)>& configure, std::uint64_t frameCount, float timestep,
+		std::uint32_t pipelineDepth);
+}
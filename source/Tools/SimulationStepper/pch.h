@@ -0,0 +1,58 @@
+#pragma once
+
+// Standard
+#include <exception>
+#include <stdexcept>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <map>
+#include <thread>
+
+#if defined(DEBUG) || defined(_DEBUG)
+#if defined(_MSC_VER)
+#define _CRTDBG_MAP_ALLOC
+#include <stdlib.h>
+#include <crtdbg.h>
+#endif
+#endif
+
+// DirectX
+#include <DirectXMath.h>
+
+// Simulation
+#include "CeledtialBodyData.h"
+#include "ConfigData.h"
+#include "ThreadPool.h"
+#include "KeplerSolver.h"
+#include "NBodyState.h"
+#include "DirectSummation.h"
+#include "BarnesHut.h"
+#include "LeapfrogIntegrator.h"
+#include "WisdomHolmanIntegrator.h"
+#include "BlockTimestepIntegrator.h"
+#include "Ephemeris.h"
+#include "EphemerisBuilder.h"
+#include "AsteroidBelt.h"
+#include "ParticleSystem.h"
+#include "SpawnedBodies.h"
+#include "ConicPropagator.h"
+#include "SpacecraftFleet.h"
+#include "LambertSolver.h"
+#include "TransferPlanner.h"
+#include "EventFinder.h"
+#include "DetailScheduler.h"
+#include "ShardedGravity.h"
+#include "Checkpoint.h"
+#include "BodySystem.h"
+#include "SimulationThread.h"